@@ -8,71 +8,31 @@
 
 from __future__ import print_function
 import argparse
-import os
 import re
 import subprocess
 import sys
 
 
-def run_locuspocus(infile, outfile, delta, ilenfile=None, debug=False):
-    command = 'locuspocus --verbose --namefmt=prelocus%lu'
-    command += ' --delta %d' % delta
-    command += ' --outfile %s.lp' % outfile
-    command += ' --cds'
+def run_locuspocus(infile, outfile, delta, namefmt, ilenfile=None,
+                   debug=False):
+    """
+    Compute all iLoci in a single LocusPocus invocation. Refinement, uLoci for
+    unannotated sequences, and serial names are all handled in memory as the
+    annotation is streamed, so the input is parsed exactly once.
+
+    uLoci are labelled by LocusPocus rather than by `uloci.py`: their source
+    column is `AEGeAn::LocusPocus` (not `AEGeAn::uloci.py`), and they carry
+    `unannot=true`, `iLocus_type=fiLocus`, and `effective_length` attributes.
+    """
+    namefmt = re.sub(r'%(\d*)d', r'%\1lu', namefmt)
+    command = ['locuspocus', '--verbose', '--cds', '--namefmt', namefmt,
+               '--delta', str(delta), '--outfile', outfile]
     if ilenfile:
-        command += ' --ilens %s' % ilenfile
-    command += ' %s' % infile
+        command += ['--ilens', ilenfile]
+    command.append(infile)
     if debug:
-        print('command: %s' % command, file=sys.stderr)
-
-    cmd = command.split(' ')
-    subprocess.check_call(cmd)
-
-    numloci = 0
-    with open('%s.lp' % outfile, 'r') as fp:
-        for line in fp:
-            if '\tlocus\t' in line:
-                numloci += 1
-    if debug:
-        print('numloci: %s' % numloci, file=sys.stderr)
-    return numloci
-
-
-def run_uloci(infile, outfile, counter, debug=False):
-    command = 'uloci.py --counter %d' % counter
-    command += ' --src AEGeAn::uloci.py'
-    command += ' %s' % infile
-    if debug:
-        print('command: %s' % command, file=sys.stderr)
-
-    cmd = command.split(' ')
-    with open('%s.ul' % outfile, 'w') as fp:
-        result = subprocess.call(cmd, stdout=fp)
-    if result:
-        print('command resulted in return status %d: %s' % (result, command),
-              file=sys.stderr)
-        exit(result)
-
-
-def combine_output(outfile, namefmt):
-    locusids = {}
-    with open(outfile, 'w') as fp:
-        command = 'gt gff3 -retainids -sort -tidy '
-        command += '%s.lp %s.ul' % (outfile, outfile)
-        cmd = command.split(' ')
-        p = subprocess.Popen(cmd, stdout=subprocess.PIPE,
-                             universal_newlines=True)
-        counter = 0
-        while True:
-            line = p.stdout.readline().rstrip()
-            if line:
-                if '\tlocus\t' in line:
-                    counter += 1
-                    locusname = namefmt % counter
-                    line = re.sub('Name=[^;\n]+', 'Name=%s' % locusname, line)
-                print(line, file=fp)
-            else:
-                break
+        print('command: %s' % ' '.join(command), file=sys.stderr)
+    subprocess.check_call(command)
 
 
 if __name__ == '__main__':
@@ -94,10 +54,5 @@ if __name__ == '__main__':
     if not args.out:
         args.out = '%s.loci' % args.infile
 
-    numloci = run_locuspocus(args.infile, args.out, args.delta, args.ilenfile,
-                             args.debug)
-    run_uloci(args.infile, args.out, numloci + 1, args.debug)
-    combine_output(args.out, args.namefmt)
-
-    os.unlink('%s.lp' % args.out)
-    os.unlink('%s.ul' % args.out)
+    run_locuspocus(args.infile, args.out, args.delta, args.namefmt,
+                   args.ilenfile, args.debug)
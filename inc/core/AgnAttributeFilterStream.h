@@ -27,7 +27,11 @@ typedef struct AgnAttributeFilterStream AgnAttributeFilterStream;
  * attribute keys/value pairs (such as `partial=true` or `pseudo=true`) to test
  * each feature node against. The values associated with each key in the hashmap
  * can be any non-NULL value. Any feature node having an attribute key/value
- * pair matching an entry in the hashmap will be discarded.
+ * pair matching an entry in the hashmap will be discarded. Besides exact
+ * matches (`key=value`), a filter may match values by prefix (`key^=prefix`),
+ * by POSIX extended regular expression (`key~=regex`), or by numeric
+ * comparison (`key<N`, `key<=N`, `key>N`, `key>=N`). Filters are compiled
+ * once, when the stream is created; invalid filters are reported and ignored.
  */
 GtNodeStream* agn_attribute_filter_stream_new(GtNodeStream *in_stream,
                                               GtHashmap *filters);
@@ -0,0 +1,49 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_ATTRIBUTE_PRUNE_STREAM
+#define AEGEAN_ATTRIBUTE_PRUNE_STREAM
+
+#include "extended/node_stream_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnAttributePruneStream
+ *
+ * Implements the GenomeTools ``GtNodeStream`` interface. This is a node stream
+ * that removes every attribute except ``ID``, ``Parent``, ``Name``,
+ * ``accession``, and any others requested from each feature in the stream;
+ * feature labels (see :c:func:`agn_feature_node_get_label`) depend only on
+ * attributes that are always kept. Placed directly after a GFF3 reader, it
+ * reduces the memory needed to hold annotations whose features carry long
+ * attributes that are never used, such as ``Dbxref`` and ``Note``.
+ */
+typedef struct AgnAttributePruneStream AgnAttributePruneStream;
+
+/**
+ * @function Class constructor. ``keylist`` is a comma-separated list of
+ * attribute keys to keep in addition to ``ID``, ``Parent``, ``Name``, and
+ * ``accession``; it may be NULL.
+ */
+GtNodeStream* agn_attribute_prune_stream_new(GtNodeStream *in_stream,
+                                             const char *keylist);
+
+/**
+ * @function Keep the attribute ``key`` as well. Programs use this for any
+ * attribute they read after the stream, such as ``pseudo``.
+ */
+void agn_attribute_prune_stream_keep(AgnAttributePruneStream *stream,
+                                     const char *key);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_attribute_prune_stream_unit_test(AgnUnitTest *test);
+
+#endif
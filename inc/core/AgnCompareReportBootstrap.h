@@ -0,0 +1,43 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_COMPARE_REPORT_BOOTSTRAP
+#define AEGEAN_COMPARE_REPORT_BOOTSTRAP
+
+#include "core/logger_api.h"
+#include "extended/node_visitor_api.h"
+
+/**
+ * @class AgnCompareReportBootstrap
+ *
+ * The ``AgnCompareReportBootstrap`` class processes a stream of ``AgnLocus``
+ * objects (typically a random sample of loci, see ``AgnLocusSampleStream``)
+ * and retains the comparison statistics of each locus. After the stream has
+ * been processed, loci are resampled with replacement to estimate a confidence
+ * interval for each summary statistic.
+ */
+typedef struct AgnCompareReportBootstrap AgnCompareReportBootstrap;
+
+/**
+ * @function After the node stream has been processed, call this function to
+ * write a table of summary statistics and their 95% bootstrap confidence
+ * intervals to ``outstream``.
+ */
+void agn_compare_report_bootstrap_create_summary(AgnCompareReportBootstrap *rpt,
+                                                 FILE *outstream);
+
+/**
+ * @function Class constructor. Confidence intervals will be computed from
+ * ``replicates`` bootstrap replicates, using a random number generator
+ * initialized with ``seed``. Status messages will be written to the logger.
+ */
+GtNodeVisitor *agn_compare_report_bootstrap_new(GtUword replicates,
+                                                GtUword seed, GtLogger *logger);
+
+#endif
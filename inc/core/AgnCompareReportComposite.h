@@ -0,0 +1,42 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_COMPARE_REPORT_COMPOSITE
+#define AEGEAN_COMPARE_REPORT_COMPOSITE
+
+#include "core/logger_api.h"
+#include "extended/node_visitor_api.h"
+
+/**
+ * @class AgnCompareReportComposite
+ *
+ * The ``AgnCompareReportComposite`` class allows a single pass over a stream
+ * of ``AgnLocus`` objects to feed several comparison reports (such as
+ * ``AgnCompareReportText``, ``AgnCompareReportHTML``, and
+ * ``AgnCompareReportTSV``). The comparative analysis of each locus is computed
+ * once, and then each locus and region node is forwarded to every report in
+ * the order in which they were added. Each report maintains its own summary
+ * data.
+ */
+typedef struct AgnCompareReportComposite AgnCompareReportComposite;
+
+/**
+ * @function Add a report to the composite. The composite takes ownership of
+ * ``report`` and will delete it when the composite itself is deleted, so any
+ * report-specific summary functions must be called before then.
+ */
+void agn_compare_report_composite_add(AgnCompareReportComposite *rpt,
+                                      GtNodeVisitor *report);
+
+/**
+ * @function Class constructor. Status messages will be written to the logger.
+ */
+GtNodeVisitor *agn_compare_report_composite_new(GtLogger *logger);
+
+#endif
@@ -64,4 +64,21 @@ void agn_compare_report_html_set_overview_func(AgnCompareReportHTML *rpt,
                                          AgnCompareReportHTMLOverviewFunc func,
                                          void *funcdata);
 
+/**
+ * @function Render PNG graphics using up to ``numworkers`` worker processes.
+ * The graphics style is loaded once and shared by all workers. By default,
+ * graphics are rendered in the main process.
+ */
+void agn_compare_report_html_set_png_workers(AgnCompareReportHTML *rpt,
+                                             GtUword numworkers);
+
+/**
+ * @function Embed an SVG graphic of each locus in the locus reports, using the
+ * file names and labels in ``svgdata``. SVG graphics are written inline by a
+ * built-in renderer and do not require cairo; they are used in place of PNG
+ * graphics when both are enabled.
+ */
+void agn_compare_report_html_set_svg(AgnCompareReportHTML *rpt,
+                                     AgnLocusPngMetadata *svgdata);
+
 #endif
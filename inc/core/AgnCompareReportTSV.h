@@ -0,0 +1,43 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_COMPARE_REPORT_TSV
+#define AEGEAN_COMPARE_REPORT_TSV
+
+#include "core/logger_api.h"
+#include "extended/node_visitor_api.h"
+
+/**
+ * @class AgnCompareReportTSV
+ *
+ * The ``AgnCompareReportTSV`` class processes a stream of ``AgnLocus`` objects
+ * (containing two alternative sources of annotation to be compared) and writes
+ * the comparison statistics in tab-delimited format, suitable for downstream
+ * analysis. Each reported clique pair is written as a single row containing
+ * its classification and all of the raw comparison statistics, and each
+ * unmatched reference or prediction clique is written as a row of its own.
+ * Rows are accumulated in a large internal buffer and written to the output as
+ * loci are processed.
+ */
+typedef struct AgnCompareReportTSV AgnCompareReportTSV;
+
+/**
+ * @function Write any buffered rows to the output stream.
+ */
+void agn_compare_report_tsv_flush(AgnCompareReportTSV *rpt);
+
+/**
+ * @function Class constructor. Creates a node visitor used to process a stream
+ * of ``AgnLocus`` objects containing two sources of annotation to be compared.
+ * Tabular output will be written to ``outstream`` and status messages will be
+ * written to the logger.
+ */
+GtNodeVisitor *agn_compare_report_tsv_new(FILE *outstream, GtLogger *logger);
+
+#endif
@@ -30,6 +30,15 @@ typedef struct AgnGeneStream AgnGeneStream;
  */
 GtNodeStream* agn_gene_stream_new(GtNodeStream *in_stream, GtLogger *logger);
 
+/**
+ * @function Class constructor. CDS and exon inference, which is performed
+ * independently for each gene, is distributed across ``numthreads`` threads.
+ * The output is identical to that of :c:func:`agn_gene_stream_new`.
+ */
+GtNodeStream* agn_gene_stream_new_parallel(GtNodeStream *in_stream,
+                                           GtLogger *logger,
+                                           GtUword numthreads);
+
 /**
  * @function Specify a source (GFF3 column 2) to be applied to newly inferred
  * features (default is '.').
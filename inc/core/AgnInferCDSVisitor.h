@@ -12,6 +12,7 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 #include "core/logger_api.h"
 #include "extended/node_stream_api.h"
+#include "AgnTypecheck.h"
 #include "AgnUnitTest.h"
 
 /**
@@ -23,6 +24,22 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
  */
 typedef struct AgnInferCDSVisitor AgnInferCDSVisitor;
 
+/**
+ * @function By default, the first segment of each discontinuous CDS lacking
+ * an ID is assigned one (``CDS0``, ``CDS1``, etc.) by a counter. When several
+ * visitors process different features concurrently, call this function to
+ * leave these IDs unassigned, and assign them afterward in input order with
+ * :c:func:`agn_infer_cds_id_stream_new`.
+ */
+void agn_infer_cds_visitor_defer_ids(AgnInferCDSVisitor *v);
+
+/**
+ * @function Constructor for a node stream that assigns IDs to discontinuous
+ * CDS features, exactly as a single ``AgnInferCDSVisitor`` would have. See
+ * :c:func:`agn_infer_cds_visitor_defer_ids`.
+ */
+GtNodeStream* agn_infer_cds_id_stream_new(GtNodeStream *in);
+
 /**
  * @function Constructor for a node stream based on this node visitor.
  */
@@ -40,6 +57,15 @@ GtNodeVisitor *agn_infer_cds_visitor_new(GtLogger *logger);
  */
 void agn_infer_cds_visitor_set_source(AgnInferCDSVisitor *v, GtStr *source);
 
+/**
+ * @function Apply the CDS inference procedure to ``mrna``, whose subfeatures
+ * have already been collected in ``groups`` with :c:func:`agn_typecheck_group`.
+ * Any features inferred are added to ``groups`` as well as to the mRNA.
+ */
+void agn_infer_cds_visitor_visit_mrna(AgnInferCDSVisitor *v,
+                                      GtFeatureNode *mrna,
+                                      AgnTypeGroups *groups);
+
 /**
  * @function Run unit tests for this class. Returns true if all tests passed.
  */
@@ -0,0 +1,74 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_INFER_STRUCTURE_VISITOR
+#define AEGEAN_INFER_STRUCTURE_VISITOR
+
+#include "core/logger_api.h"
+#include "core/str_api.h"
+#include "extended/node_stream_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnInferStructureVisitor
+ *
+ * Implements the GenomeTools ``GtNodeVisitor`` interface. This node visitor
+ * performs the work of an ``AgnInferCDSVisitor`` followed by an
+ * ``AgnInferExonsVisitor`` in a single pass: the subfeatures of each
+ * transcript are collected once into sorted per-type arrays, and the CDS,
+ * UTRs, start and stop codons, exons, and introns of each mRNA are inferred
+ * and checked using those arrays. The resulting features are identical to
+ * those produced by the two separate visitors.
+ */
+typedef struct AgnInferStructureVisitor AgnInferStructureVisitor;
+
+/**
+ * @function Constructor for a node stream based on this node visitor.
+ */
+GtNodeStream* agn_infer_structure_stream_new(GtNodeStream *in, GtStr *source,
+                                             GtLogger *logger);
+
+/**
+ * @function Leave the IDs of discontinuous CDS features unassigned, as
+ * described for :c:func:`agn_infer_cds_visitor_defer_ids`.
+ */
+void agn_infer_structure_visitor_defer_ids(AgnInferStructureVisitor *v);
+
+/**
+ * @function Skip CDS, UTR, and start/stop codon inference, inferring only
+ * exons and introns as an ``AgnInferExonsVisitor`` does.
+ */
+void agn_infer_structure_visitor_disable_cds(AgnInferStructureVisitor *v);
+
+/**
+ * @function Constructor for the node visitor.
+ */
+GtNodeVisitor *agn_infer_structure_visitor_new(GtLogger *logger);
+
+/**
+ * @function Set the source value (GFF3 column 2) that will be assigned to any
+ * inferred features (default is '.').
+ */
+void agn_infer_structure_visitor_set_source(AgnInferStructureVisitor *v,
+                                            GtStr *source);
+
+/**
+ * @function Once the features of each mRNA have been inferred, store the
+ * :c:type:`AgnTypeCensus` of the mRNA as user data under the key ``census``,
+ * computed from the collected arrays rather than by traversing the mRNA again.
+ * The census is only valid until the mRNA is modified.
+ */
+void agn_infer_structure_visitor_store_census(AgnInferStructureVisitor *v);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_infer_structure_visitor_unit_test(AgnUnitTest *test);
+
+#endif
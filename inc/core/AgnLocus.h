@@ -11,9 +11,11 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #define AEGEAN_LOCUS
 
 #include "annotationsketch/block_api.h"
+#include "annotationsketch/style_api.h"
 #include "core/array_api.h"
 #include "extended/feature_node_api.h"
 #include "AgnCliquePair.h"
+#include "AgnTypecheck.h"
 
 /**
  * @class AgnLocus
@@ -84,6 +86,22 @@ struct AgnLocusFilter
 };
 typedef struct AgnLocusFilter AgnLocusFilter;
 
+/**
+ * @type Iterator over the genes and/or mRNAs of a locus. Declare it on the
+ * stack, initialize it with :c:func:`agn_locus_iter_init`, and call
+ * :c:func:`agn_locus_iter_next` until it returns NULL; there is nothing to
+ * free. The members of each locus are indexed on first use, so iteration
+ * itself requires no allocation. Do not modify the members directly.
+ */
+struct AgnLocusIter
+{
+  GtArray *members;
+  GtUword index;
+  AgnComparisonSource source;
+  unsigned types;
+};
+typedef struct AgnLocusIter AgnLocusIter;
+
 /**
  * @function Associate the given annotation with this locus. Rather
  * than calling this function directly, users are recommended to use one of the
@@ -197,13 +215,15 @@ GtArray *agn_locus_get(AgnLocus *locus);
 
 /**
  * @function Get a list of all the prediction transcript cliques that have no
- * corresponding reference transcript clique.
+ * corresponding reference transcript clique; in a locus with no reference
+ * transcripts, this is every prediction clique.
  */
 GtArray *agn_locus_get_unique_pred_cliques(AgnLocus *locus);
 
 /**
  * @function Get a list of all the reference transcript cliques that have no
- * corresponding prediction transcript clique.
+ * corresponding prediction transcript clique; in a locus with no prediction
+ * transcripts, this is every reference clique.
  */
 GtArray *agn_locus_get_unique_refr_cliques(AgnLocus *locus);
 
@@ -263,6 +283,23 @@ GtUword agn_locus_gene_num(AgnLocus *locus, AgnComparisonSource src);
  */
 int agn_locus_inner_orientation(AgnLocus *left, AgnLocus *right);
 
+/**
+ * @function Initialize an iterator over the features of ``locus`` from the
+ * given source whose classes are included in ``types``: ``AGN_TYPE_GENE`` for
+ * genes, ``AGN_TYPE_MRNA`` for the mRNAs of those genes, or both. Features are
+ * reported in the same order as by :c:func:`agn_locus_genes` and
+ * :c:func:`agn_locus_mrnas`. The iterator is invalidated if features are
+ * added to or removed from the locus.
+ */
+void agn_locus_iter_init(AgnLocusIter *iter, AgnLocus *locus,
+                         AgnComparisonSource src, unsigned types);
+
+/**
+ * @function Returns the next feature of the locus, or NULL when the iterator
+ * is exhausted.
+ */
+GtFeatureNode *agn_locus_iter_next(AgnLocusIter *iter);
+
 /**
  * @function Get the mRNAs associated with this locus. Rather than calling
  * this function directly, users are encouraged to use one of the following
@@ -331,11 +368,31 @@ void agn_locus_png_track_selector(GtBlock *block, GtStr *track,void *data);
 
 #ifndef WITHOUT_CAIRO
 /**
- * @function Print a PNG graphic for this locus.
+ * @function Print a PNG graphic for this locus. The style file is loaded each
+ * time this function is called; when printing graphics for many loci, load the
+ * style once and use :c:func:`agn_locus_print_png_with_style` instead.
  */
 void agn_locus_print_png(AgnLocus *locus, AgnLocusPngMetadata *metadata);
+
+/**
+ * @function Print a PNG graphic for this locus using a previously loaded
+ * style. The style is not modified.
+ */
+void agn_locus_print_png_with_style(AgnLocus *locus,
+                                    AgnLocusPngMetadata *metadata,
+                                    GtStyle *style);
 #endif
 
+/**
+ * @function Print an SVG graphic for this locus to ``outstream``, with one
+ * track for reference transcripts and one track for prediction transcripts.
+ * The graphic is written directly using a fixed track layout, so it does not
+ * require cairo or a style file; only the file names and labels in
+ * ``metadata`` are used.
+ */
+void agn_locus_print_svg(AgnLocus *locus, AgnLocusPngMetadata *metadata,
+                         FILE *outstream);
+
 /**
  * @function Print a mapping of the transcript(s) associated with this locus in
  * a two-column tab-delimited format: ``transcriptId<tab>locusId``.
@@ -0,0 +1,53 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_LOCUS_COMPOSITION_STREAM
+#define AEGEAN_LOCUS_COMPOSITION_STREAM
+
+#include <stdio.h>
+#include "extended/node_stream_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnLocusCompositionStream
+ *
+ * Implements the ``GtNodeStream`` interface. As each ``locus`` feature passes
+ * through the stream, its nucleotide composition is computed from the
+ * corresponding genomic sequence and stored in the ``gc_content`` and
+ * ``n_content`` attributes. GC content is computed relative to the number of
+ * non-N nucleotides, and N content relative to the iLocus length. Statistics
+ * are also aggregated for each iLocus class (giLocus, iiLocus, fiLocus, or
+ * the value of the ``iLocus_type`` attribute for refined iLoci), and a summary
+ * table with a length histogram for each class is written once the input
+ * stream is exhausted.
+ *
+ * Only one sequence is held in memory at a time. The (uncompressed) sequence
+ * file is scanned sequentially, and the offset of each sequence is recorded
+ * along the way, so sequences occurring out of order with respect to the
+ * iLoci are read directly from their offsets rather than by re-reading the
+ * file.
+ */
+typedef struct AgnLocusCompositionStream AgnLocusCompositionStream;
+
+/**
+ * @function Class constructor. Genomic sequences are read from the Fasta file
+ * ``seqfile``, and the summary table is written to ``outstream`` (if it is not
+ * NULL). Returns NULL and sets ``error`` if the sequence file cannot be read.
+ */
+GtNodeStream *agn_locus_composition_stream_new(GtNodeStream *in_stream,
+                                               const char *seqfile,
+                                               FILE *outstream,
+                                               GtError *error);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_locus_composition_stream_unit_test(AgnUnitTest *test);
+
+#endif
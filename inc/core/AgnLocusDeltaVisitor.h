@@ -0,0 +1,62 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_LOCUS_DELTA_VISITOR
+#define AEGEAN_LOCUS_DELTA_VISITOR
+
+#include "core/file_api.h"
+#include "extended/node_visitor_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnLocusDeltaVisitor
+ *
+ * Implements the GenomeTools ``GtNodeVisitor`` interface. This visitor
+ * processes the gene loci produced by an ``AgnLocusStream`` with ``delta=0``
+ * and computes, for several values of delta at once, the iLoci that an
+ * ``AgnLocusStream`` with that delta would report: the extension of each iLocus
+ * depends only on the gaps between consecutive gene loci and on the sequence
+ * boundaries, so a single pass over the annotation suffices. The visitor
+ * reports iiLocus lengths (in the same format as
+ * :c:func:`agn_locus_stream_track_ilens`, with an additional leading column
+ * for delta) and a summary table of iLocus counts and lengths for each delta.
+ */
+typedef struct AgnLocusDeltaVisitor AgnLocusDeltaVisitor;
+
+/**
+ * @function Class constructor. The ``deltas`` array should contain one or more
+ * ``GtUword`` values; it is copied. If ``ilenfile`` is not NULL, the length of
+ * each intergenic iLocus for each delta is written to it.
+ */
+GtNodeVisitor *agn_locus_delta_visitor_new(GtArray *deltas, FILE *ilenfile);
+
+/**
+ * @function Write a summary of iLocus counts and lengths for each delta to
+ * ``outfile``. Should be called once, after the entire node stream has been
+ * processed.
+ */
+void agn_locus_delta_visitor_print_summary(AgnLocusDeltaVisitor *v,
+                                           GtFile *outfile);
+
+/**
+ * @function See :c:func:`agn_locus_stream_set_endmode`.
+ */
+void agn_locus_delta_visitor_set_endmode(AgnLocusDeltaVisitor *v, int endmode);
+
+/**
+ * @function See :c:func:`agn_locus_stream_skip_iiLoci`.
+ */
+void agn_locus_delta_visitor_skip_iiLoci(AgnLocusDeltaVisitor *v);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_locus_delta_visitor_unit_test(AgnUnitTest *test);
+
+#endif
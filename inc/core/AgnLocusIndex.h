@@ -0,0 +1,72 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_LOCUS_INDEX
+#define AEGEAN_LOCUS_INDEX
+
+#include "core/array_api.h"
+#include "core/error_api.h"
+#include "AgnLocusIndexOutStream.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnLocusIndex
+ *
+ * Read-only access to a binary iLocus index (see ``AgnLocusIndexOutStream``).
+ * The index is mapped into memory rather than read, and each lookup is
+ * resolved by binary search, so no GFF3 parsing is required at query time.
+ */
+typedef struct AgnLocusIndex AgnLocusIndex;
+
+/**
+ * @type A single iLocus reported by :c:func:`agn_locus_index_lookup`. The
+ * strings point into the index and remain valid until the index is deleted.
+ */
+struct AgnLocusIndexHit
+{
+  const char *seqid;
+  GtUword start;
+  GtUword end;
+  const char *id;
+  const char *type;
+};
+typedef struct AgnLocusIndexHit AgnLocusIndexHit;
+
+/**
+ * @function Returns true if the given file is an iLocus index, false otherwise.
+ */
+bool agn_locus_index_check(const char *filename);
+
+/**
+ * @function Class destructor.
+ */
+void agn_locus_index_delete(AgnLocusIndex *index);
+
+/**
+ * @function Find all iLoci on sequence ``seqid`` that overlap the range
+ * [``start``, ``end``]; for a point lookup, set ``start`` and ``end`` to the
+ * same value. Each iLocus found is appended to ``hits`` (an array of
+ * ``AgnLocusIndexHit`` objects) in order of position. Returns the number of
+ * iLoci found.
+ */
+GtUword agn_locus_index_lookup(AgnLocusIndex *index, const char *seqid,
+                               GtUword start, GtUword end, GtArray *hits);
+
+/**
+ * @function Class constructor. Returns NULL and sets ``error`` if the given
+ * file cannot be opened or is not a valid iLocus index.
+ */
+AgnLocusIndex *agn_locus_index_new(const char *filename, GtError *error);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_locus_index_unit_test(AgnUnitTest *test);
+
+#endif
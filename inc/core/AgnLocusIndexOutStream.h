@@ -0,0 +1,84 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_LOCUS_INDEX_OUT_STREAM
+#define AEGEAN_LOCUS_INDEX_OUT_STREAM
+
+#include <stdio.h>
+#include "core/types_api.h"
+#include "extended/node_stream_api.h"
+
+#define AGN_LOCUS_INDEX_MAGIC   "AGNLIDX"
+#define AGN_LOCUS_INDEX_VERSION 1
+
+/**
+ * @type Header of a binary iLocus index. An index file consists of this
+ * header, followed by ``numseqs`` sequence records sorted by sequence ID,
+ * ``numloci`` iLocus records, and finally a string table of ``strtabsize``
+ * bytes. Integers are stored in host byte order.
+ */
+struct AgnLocusIndexHeader
+{
+  char     magic[8];
+  GtUint32 version;
+  GtUint32 numseqs;
+  GtUint64 numloci;
+  GtUint64 strtabsize;
+};
+typedef struct AgnLocusIndexHeader AgnLocusIndexHeader;
+
+/**
+ * @type Directory entry for a single sequence. The iLoci on the sequence
+ * occupy a contiguous block of ``numloci`` iLocus records beginning at
+ * ``firstlocus``. ``seqid`` is an offset into the string table.
+ */
+struct AgnLocusIndexSeq
+{
+  GtUint64 seqid;
+  GtUint64 firstlocus;
+  GtUint64 numloci;
+};
+typedef struct AgnLocusIndexSeq AgnLocusIndexSeq;
+
+/**
+ * @type A single iLocus. Records of each sequence are sorted by start and then
+ * end coordinate, and ``maxend`` is the largest end coordinate of this record
+ * and all preceding records on the same sequence; since iLoci can overlap,
+ * this bounds the records that must be examined for any query. The ``id`` and
+ * ``type`` values are offsets into the string table.
+ */
+struct AgnLocusIndexEntry
+{
+  GtUint64 start;
+  GtUint64 end;
+  GtUint64 maxend;
+  GtUint64 id;
+  GtUint64 type;
+};
+typedef struct AgnLocusIndexEntry AgnLocusIndexEntry;
+
+/**
+ * @class AgnLocusIndexOutStream
+ *
+ * Implements the ``GtNodeStream`` interface. Nodes pass through this stream
+ * unchanged, while the coordinates, label, and type of each ``locus`` feature
+ * are recorded in a compact binary index that is written to the output file
+ * once the input stream is exhausted. The index can be loaded with
+ * ``AgnLocusIndex`` to find the iLoci containing given positions or ranges
+ * without parsing any GFF3.
+ */
+typedef struct AgnLocusIndexOutStream AgnLocusIndexOutStream;
+
+/**
+ * @function Class constructor. The index will be written to ``outstream``.
+ */
+GtNodeStream *agn_locus_index_out_stream_new(GtNodeStream *in_stream,
+                                             FILE *outstream);
+
+#endif
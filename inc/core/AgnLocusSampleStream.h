@@ -0,0 +1,49 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#ifndef AEGEAN_LOCUS_SAMPLE_STREAM
+#define AEGEAN_LOCUS_SAMPLE_STREAM
+
+#include "extended/node_stream_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnLocusSampleStream
+ *
+ * Implements the GenomeTools ``GtNodeStream`` interface. This is a node stream
+ * used to select a reproducible random subset of loci. By default each locus
+ * is retained independently with the given probability. Alternatively, loci
+ * can be stratified by length (in powers of 2) and sampled systematically
+ * within each stratum, so that loci of all sizes are represented in proportion
+ * to their abundance. Loci that are not selected are deleted; all other nodes
+ * pass through unchanged.
+ */
+typedef struct AgnLocusSampleStream AgnLocusSampleStream;
+
+/**
+ * @function Class constructor. Each locus is retained with probability
+ * ``rate`` (a value between 0 and 1). The same ``seed`` and input will always
+ * produce the same sample.
+ */
+GtNodeStream* agn_locus_sample_stream_new(GtNodeStream *in_stream, double rate,
+                                          GtUword seed);
+
+/**
+ * @function Sample loci systematically within strata defined by locus length,
+ * rather than independently.
+ */
+void agn_locus_sample_stream_stratify(AgnLocusSampleStream *stream);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_locus_sample_stream_unit_test(AgnUnitTest *test);
+
+#endif
@@ -0,0 +1,51 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_MILOCUS_STREAM
+#define AEGEAN_MILOCUS_STREAM
+
+#include "extended/node_stream_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnMilocusStream
+ *
+ * Implements the ``GtNodeStream`` interface. The ``AgnMilocusStream`` class
+ * post-processes refined iLoci (see ``AgnLocusRefineStream``), merging each
+ * run of consecutive single-gene and non-coding iLoci on the same sequence into
+ * a single merged iLocus (miLocus). Only the current run of mergeable iLoci is
+ * held in memory at any given time.
+ */
+typedef struct AgnMilocusStream AgnMilocusStream;
+
+/**
+ * @function Class constructor.
+ */
+GtNodeStream *agn_milocus_stream_new(GtNodeStream *in_stream);
+
+/**
+ * @function Assign a `Name` attribute with a serial number to each iLocus
+ * using the specified printf-style format.
+ */
+void agn_milocus_stream_set_name_format(AgnMilocusStream *stream,
+                                        const char *format);
+
+/**
+ * @function Set the source value to be used for all miLoci created by this
+ * stream. Default value is 'AEGeAn::AgnLocusStream'.
+ */
+void agn_milocus_stream_set_source(AgnMilocusStream *stream,
+                                   const char *source);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_milocus_stream_unit_test(AgnUnitTest *test);
+
+#endif
@@ -0,0 +1,52 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_NUCLEOTIDE_COMPARE_VISITOR
+#define AEGEAN_NUCLEOTIDE_COMPARE_VISITOR
+
+#include "extended/node_visitor_api.h"
+#include "AgnComparison.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnNucleotideCompareVisitor
+ *
+ * Implements the ``GtNodeVisitor`` interface for a fast, genome-wide
+ * nucleotide-level comparison of two sources of annotation. Rather than
+ * grouping genes into loci and enumerating transcript cliques, the visitor
+ * simply collects the CDS and UTR intervals of each feature (labeled as
+ * reference or prediction by the file from which it was parsed). When the
+ * stream has been processed, the intervals of each sequence are merged and
+ * swept to count true/false positives/negatives directly. A nucleotide is
+ * considered coding if it is covered by any CDS, and UTR if it is covered by
+ * a UTR but not by any CDS. Input need not be sorted.
+ */
+typedef struct AgnNucleotideCompareVisitor AgnNucleotideCompareVisitor;
+
+/**
+ * @function Finish the comparison and store genome-wide CDS and UTR
+ * nucleotide-level statistics in ``cds`` and ``utr``.
+ */
+void agn_nucleotide_compare_visitor_get_stats(AgnNucleotideCompareVisitor *v,
+                                              AgnCompStatsScaled *cds,
+                                              AgnCompStatsScaled *utr);
+
+/**
+ * @function Constructor. Features parsed from ``refrfile`` are treated as the
+ * reference and features parsed from ``predfile`` as the prediction.
+ */
+GtNodeVisitor *agn_nucleotide_compare_visitor_new(const char *refrfile,
+                                                  const char *predfile);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_nucleotide_compare_visitor_unit_test(AgnUnitTest *test);
+
+#endif
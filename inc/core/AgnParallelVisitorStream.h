@@ -0,0 +1,74 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_PARALLEL_VISITOR_STREAM
+#define AEGEAN_PARALLEL_VISITOR_STREAM
+
+#include <stdio.h>
+#include "extended/node_stream_api.h"
+#include "extended/node_visitor_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnParallelVisitorStream
+ *
+ * Implements the ``GtNodeStream`` interface. Like the GenomeTools
+ * ``GtVisitorStream`` class, each node in the input is processed by a node
+ * visitor before being passed on. Nodes are read from the input in batches,
+ * and each batch is split into contiguous slices that are processed
+ * concurrently by a pool of worker threads, each with its own visitor
+ * instance. Nodes are delivered to the output stream in input order.
+ *
+ * This is only appropriate for visitors that process each top-level feature
+ * independently of all others. Any output a visitor writes should go to the
+ * stream provided by :c:type:`AgnParallelVisitorFunc`: each worker writes to
+ * its own in-memory buffer, and buffers are copied to the real output stream
+ * in input order once each batch is complete.
+ *
+ * GenomeTools reference counts are not thread safe, so before a batch is
+ * dispatched each worker's features are given private copies of their
+ * sequence IDs, and the stream holds a reference to every feature in the
+ * batch until all workers are done. Visitors may therefore create features
+ * (with the sequence ID of an existing feature) and remove features, but any
+ * strings they attach to new features must not be shared with other workers.
+ */
+typedef struct AgnParallelVisitorStream AgnParallelVisitorStream;
+
+/**
+ * @functype Signature of the function used to create the visitor for each
+ * worker thread. ``outstream`` is the stream to which the visitor should write
+ * any output, and ``data`` is the pointer provided to the stream constructor.
+ */
+typedef GtNodeVisitor *(*AgnParallelVisitorFunc)(FILE *outstream, void *data);
+
+/**
+ * @function Class constructor. ``func`` is called once for each of the
+ * ``numthreads`` worker threads to create its visitor. If ``outstream`` is not
+ * NULL, visitor output is collected in order and written to it. With a single
+ * thread, nodes are visited as they are read, and ``outstream`` is passed
+ * directly to the visitor.
+ */
+GtNodeStream *agn_parallel_visitor_stream_new(GtNodeStream *in,
+                                              GtUword numthreads,
+                                              AgnParallelVisitorFunc func,
+                                              void *data, FILE *outstream);
+
+/**
+ * @function Set the number of nodes each worker thread processes per batch.
+ * The default is 256.
+ */
+void agn_parallel_visitor_stream_set_batch_size(AgnParallelVisitorStream *s,
+                                                GtUword batchsize);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_parallel_visitor_stream_unit_test(AgnUnitTest *test);
+
+#endif
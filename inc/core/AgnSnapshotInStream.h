@@ -0,0 +1,46 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_SNAPSHOT_IN_STREAM
+#define AEGEAN_SNAPSHOT_IN_STREAM
+
+#include "extended/node_stream_api.h"
+#include "AgnUnitTest.h"
+
+/**
+ * @class AgnSnapshotInStream
+ *
+ * Implements the ``GtNodeStream`` interface. Delivers the region nodes and
+ * feature nodes recorded in a binary annotation snapshot (see
+ * ``AgnSnapshotOutStream``). The snapshot is mapped into memory rather than
+ * read, and each feature graph is reconstructed only when it is requested, so
+ * opening even a very large snapshot is nearly instantaneous. Features are
+ * delivered in sorted order and have already been validated, so no sorting or
+ * validation is needed downstream.
+ */
+typedef struct AgnSnapshotInStream AgnSnapshotInStream;
+
+/**
+ * @function Returns true if the given file is an annotation snapshot, false
+ * otherwise (for example, if it is a GFF3 file).
+ */
+bool agn_snapshot_in_stream_check(const char *filename);
+
+/**
+ * @function Class constructor. Returns NULL and sets ``error`` if the given
+ * file cannot be opened or is not a valid annotation snapshot.
+ */
+GtNodeStream *agn_snapshot_in_stream_new(const char *filename, GtError *error);
+
+/**
+ * @function Run unit tests for this class. Returns true if all tests passed.
+ */
+bool agn_snapshot_in_stream_unit_test(AgnUnitTest *test);
+
+#endif
@@ -0,0 +1,113 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef AEGEAN_SNAPSHOT_OUT_STREAM
+#define AEGEAN_SNAPSHOT_OUT_STREAM
+
+#include <stdio.h>
+#include "core/types_api.h"
+#include "extended/node_stream_api.h"
+
+#define AGN_SNAPSHOT_MAGIC   "AGNSNAP"
+#define AGN_SNAPSHOT_VERSION 1
+#define AGN_SNAPSHOT_NONE    ((GtUint64)-1)
+
+#define AGN_SNAPSHOT_ROOT     1
+#define AGN_SNAPSHOT_PSEUDO   2
+#define AGN_SNAPSHOT_HASSCORE 4
+
+/**
+ * @type Header of a binary annotation snapshot. A snapshot file consists of
+ * this header, followed by ``numseqs`` sequence records, ``numfeats`` feature
+ * records, ``numedges`` parent/child records, and finally a string table of
+ * ``strtabsize`` bytes. Integers are stored in host byte order.
+ */
+struct AgnSnapshotHeader
+{
+  char     magic[8];
+  GtUint32 version;
+  GtUint32 numseqs;
+  GtUint64 numfeats;
+  GtUint64 numedges;
+  GtUint64 strtabsize;
+};
+typedef struct AgnSnapshotHeader AgnSnapshotHeader;
+
+/**
+ * @type Directory entry for a single sequence. The features (and parent/child
+ * relationships) annotated on the sequence occupy a contiguous block of the
+ * feature (and edge) records. If the sequence has no region declared, its
+ * range is [0, 0].
+ */
+struct AgnSnapshotSeq
+{
+  GtUint64 seqid;
+  GtUint64 start;
+  GtUint64 end;
+  GtUint64 firstfeat;
+  GtUint64 numfeats;
+  GtUint64 firstedge;
+  GtUint64 numedges;
+};
+typedef struct AgnSnapshotSeq AgnSnapshotSeq;
+
+/**
+ * @type A single feature. The ``type``, ``source``, and ``attrs`` values are
+ * offsets into the string table; attributes are stored as ``nattrs``
+ * consecutive key/value pairs of NUL-terminated strings. Features of each
+ * top-level feature graph are stored together, beginning with the top-level
+ * feature (flagged with ``AGN_SNAPSHOT_ROOT``). ``multirep`` is the index of
+ * the representative of a multi-feature, or ``AGN_SNAPSHOT_NONE``.
+ */
+struct AgnSnapshotFeature
+{
+  GtUint64 start;
+  GtUint64 end;
+  GtUint64 type;
+  GtUint64 source;
+  GtUint64 attrs;
+  GtUint64 multirep;
+  float    score;
+  GtUint32 nattrs;
+  GtUchar  strand;
+  GtUchar  phase;
+  GtUchar  flags;
+  GtUchar  reserved[5];
+};
+typedef struct AgnSnapshotFeature AgnSnapshotFeature;
+
+/**
+ * @type A parent/child relationship between two features, given as indices
+ * into the feature records.
+ */
+struct AgnSnapshotEdge
+{
+  GtUint64 parent;
+  GtUint64 child;
+};
+typedef struct AgnSnapshotEdge AgnSnapshotEdge;
+
+/**
+ * @class AgnSnapshotOutStream
+ *
+ * Implements the ``GtNodeStream`` interface. Nodes pass through this stream
+ * unchanged, while region nodes and feature nodes are recorded in a compact
+ * binary snapshot that is written to the output file once the input stream is
+ * exhausted. Snapshots can be loaded with ``AgnSnapshotInStream`` without
+ * parsing or validating any GFF3. The input must be sorted.
+ */
+typedef struct AgnSnapshotOutStream AgnSnapshotOutStream;
+
+/**
+ * @function Class constructor. The snapshot will be written to ``outstream``.
+ */
+GtNodeStream *agn_snapshot_out_stream_new(GtNodeStream *in_stream,
+                                          FILE *outstream);
+
+#endif
@@ -16,14 +16,112 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 /**
  * @module AgnTypecheck
  *
- * Functions for testing feature types.
+ * Functions for testing feature types. Each feature type is classified only
+ * once: GenomeTools interns type strings, so the classification of a type is
+ * cached by its address and each predicate reduces to a bit test.
  */ //;
 
+/**
+ * @type Bit flags for the classes of feature types recognized by this module.
+ * Types with several spellings (such as ``CDS`` and ``coding_sequence``) map
+ * to the same class, and a type may belong to more than one class: mRNAs are
+ * also transcripts, and 5' and 3' UTRs are also UTRs.
+ */
+enum AgnTypeClass
+{
+  AGN_TYPE_NONE        = 0,
+  AGN_TYPE_GENE        = 1 << 0,
+  AGN_TYPE_PSEUDOGENE  = 1 << 1,
+  AGN_TYPE_MRNA        = 1 << 2,
+  AGN_TYPE_TRANSCRIPT  = 1 << 3,
+  AGN_TYPE_EXON        = 1 << 4,
+  AGN_TYPE_INTRON      = 1 << 5,
+  AGN_TYPE_CDS         = 1 << 6,
+  AGN_TYPE_UTR         = 1 << 7,
+  AGN_TYPE_UTR5P       = 1 << 8,
+  AGN_TYPE_UTR3P       = 1 << 9,
+  AGN_TYPE_START_CODON = 1 << 10,
+  AGN_TYPE_STOP_CODON  = 1 << 11
+};
+typedef enum AgnTypeClass AgnTypeClass;
+
+/**
+ * @type Aggregate statistics for all features of a single type class: the
+ * number of features, their combined length, and the range spanning all of
+ * them (``{0, 0}`` if there are none).
+ */
+struct AgnTypeSummary
+{
+  GtUword count;
+  GtUword length;
+  GtRange range;
+};
+typedef struct AgnTypeSummary AgnTypeSummary;
+
+/**
+ * @type Statistics for each type class in a feature graph, as computed by
+ * :c:func:`agn_typecheck_census`.
+ */
+struct AgnTypeCensus
+{
+  AgnTypeSummary gene;
+  AgnTypeSummary pseudogene;
+  AgnTypeSummary mrna;
+  AgnTypeSummary transcript;
+  AgnTypeSummary exon;
+  AgnTypeSummary intron;
+  AgnTypeSummary cds;
+  AgnTypeSummary utr;
+  AgnTypeSummary utr5p;
+  AgnTypeSummary utr3p;
+  AgnTypeSummary start_codon;
+  AgnTypeSummary stop_codon;
+};
+typedef struct AgnTypeCensus AgnTypeCensus;
+
+/**
+ * @type The subfeatures of a transcript, grouped by type class as collected
+ * by :c:func:`agn_typecheck_group`. Each array holds ``GtFeatureNode *``
+ * values sorted by position, as returned by :c:func:`agn_typecheck_select`.
+ */
+struct AgnTypeGroups
+{
+  GtArray *cds;
+  GtArray *exons;
+  GtArray *introns;
+  GtArray *utrs;
+  GtArray *start_codons;
+  GtArray *stop_codons;
+};
+typedef struct AgnTypeGroups AgnTypeGroups;
+
 /**
  * @function Returns true if the given feature is a CDS; false otherwise.
  */
 bool agn_typecheck_cds(GtFeatureNode *fn);
 
+/**
+ * @function Traverse the feature graph rooted at ``fn`` (including ``fn``
+ * itself) once, and store the count, combined length, and spanning range of
+ * the features of each type class in ``census``. Features are counted exactly
+ * as by :c:func:`agn_typecheck_count`. Use this instead of several calls to
+ * :c:func:`agn_typecheck_select` or :c:func:`agn_typecheck_count` when only
+ * counts or lengths are needed.
+ */
+void agn_typecheck_census(GtFeatureNode *fn, AgnTypeCensus *census);
+
+/**
+ * @function Add a single feature ``fn`` (but not its subfeatures) to
+ * ``census``, in the summary of each of its type classes.
+ */
+void agn_typecheck_census_add(AgnTypeCensus *census, GtFeatureNode *fn);
+
+/**
+ * @function Returns the type classes (a bitwise OR of ``AgnTypeClass`` flags)
+ * of the given feature.
+ */
+unsigned agn_typecheck_classes(GtFeatureNode *fn);
+
 /**
  * @function Count the number of ``fn``'s children that have the given type.
  */
@@ -46,6 +144,19 @@ GtUword agn_typecheck_feature_combined_length(GtFeatureNode *root,
  */
 bool agn_typecheck_gene(GtFeatureNode *fn);
 
+/**
+ * @function Traverse the feature graph rooted at ``fn`` once, and collect its
+ * CDS, exon, intron, UTR, start codon, and stop codon features in ``groups``.
+ * The arrays are created if they are NULL and emptied otherwise, so the same
+ * groups can be reused for many features without reallocation.
+ */
+void agn_typecheck_group(GtFeatureNode *fn, AgnTypeGroups *groups);
+
+/**
+ * @function Release the arrays of ``groups``.
+ */
+void agn_typecheck_groups_free(AgnTypeGroups *groups);
+
 /**
  * @function Returns true if the given feature is an intron; false otherwise.
  */
@@ -12,6 +12,7 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 #include "core/array_api.h"
 #include "core/str_api.h"
+#include "core/types_api.h"
 #include "extended/feature_index_api.h"
 #include "extended/genome_node_api.h"
 
@@ -128,6 +129,13 @@ bool agn_feature_overlap_check(GtArray *feats);
  */
 int agn_genome_node_compare(GtGenomeNode **gn_a, GtGenomeNode **gn_b);
 
+/**
+ * @function Return the name of the file from which the given node was read.
+ * For nodes loaded from an annotation snapshot (see ``AgnSnapshotInStream``)
+ * this is the name of the snapshot file, rather than ``generated``.
+ */
+const char *agn_genome_node_get_filename(GtGenomeNode *gn);
+
 /**
  * @function Determine the length of an mRNA's 3' UTR.
  */
@@ -165,6 +173,20 @@ bool agn_overlap_ilocus(GtGenomeNode *f1, GtGenomeNode *f2,
  */
 void agn_print_version(const char *progname, FILE *outstream);
 
+/**
+ * @function Seeded pseudorandom number generator (xorshift64*), used where
+ * results must be reproducible across runs and platforms. Returns a value in
+ * the interval [0, 1) and updates ``state``, which must be non-zero (see
+ * :c:func:`agn_rand_seed`).
+ */
+double agn_rand_next(GtUint64 *state);
+
+/**
+ * @function Initialize a random number generator state from a user-supplied
+ * seed.
+ */
+GtUint64 agn_rand_seed(GtUword seed);
+
 /**
  * @function Format the given non-negative number with commas as the thousands
  * separator. The resulting string will be written to ``buffer``.
@@ -9,9 +9,13 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 **/
 
 #include "AgnAttributeFilterStream.h"
+#include "AgnAttributePruneStream.h"
 #include "AgnCliquePair.h"
+#include "AgnCompareReportBootstrap.h"
+#include "AgnCompareReportComposite.h"
 #include "AgnCompareReportHTML.h"
 #include "AgnCompareReportText.h"
+#include "AgnCompareReportTSV.h"
 #include "AgnComparison.h"
 #include "AgnFilterStream.h"
 #include "AgnGeneStream.h"
@@ -19,14 +23,25 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #include "AgnInferCDSVisitor.h"
 #include "AgnInferExonsVisitor.h"
 #include "AgnInferParentStream.h"
+#include "AgnInferStructureVisitor.h"
 #include "AgnLocus.h"
+#include "AgnLocusCompositionStream.h"
+#include "AgnLocusDeltaVisitor.h"
 #include "AgnLocusFilterStream.h"
+#include "AgnLocusIndex.h"
+#include "AgnLocusIndexOutStream.h"
 #include "AgnLocusMapVisitor.h"
 #include "AgnLocusRefineStream.h"
+#include "AgnLocusSampleStream.h"
 #include "AgnLocusStream.h"
+#include "AgnMilocusStream.h"
 #include "AgnMrnaRepVisitor.h"
+#include "AgnNucleotideCompareVisitor.h"
+#include "AgnParallelVisitorStream.h"
 #include "AgnPseudogeneFixVisitor.h"
 #include "AgnRemoveChildrenVisitor.h"
+#include "AgnSnapshotInStream.h"
+#include "AgnSnapshotOutStream.h"
 #include "AgnTranscriptClique.h"
 #include "AgnTypecheck.h"
 #include "AgnUnitTest.h"
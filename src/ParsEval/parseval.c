@@ -8,6 +8,7 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
 #include "pe_options.h"
+#include "pe_daemon.h"
 #include "pe_utils.h"
 
 int main(int argc, char **argv)
@@ -16,7 +17,7 @@ int main(int argc, char **argv)
   GtLogger *logger;
   GtQueue *streams;
   GtNodeStream *current_stream, *last_stream;
-  GtNodeVisitor *rpt;
+  GtNodeVisitor *rpt, *textrpt = NULL, *tsvrpt = NULL, *bootrpt = NULL;
   PeHtmlOverviewData odata;
   char *start_time;
 
@@ -33,6 +34,20 @@ int main(int argc, char **argv)
     fprintf(stderr, "[ParsEval] error: %s", gt_error_get(error));
     return 1;
   }
+  if(options.socketpath != NULL)
+  {
+    logger = gt_logger_new(true, "", stderr);
+    int result = pe_daemon_run(&options, logger, argc, argv, error);
+    if(result)
+      fprintf(stderr, "[ParsEval] error: %s\n", gt_error_get(error));
+    gt_free(start_time);
+    pe_free_option_memory(&options);
+    gt_logger_delete(logger);
+    gt_error_delete(error);
+    gt_lib_clean();
+    return result ? 1 : 0;
+  }
+
   int numfiles = argc - optind;
   if(numfiles != 2)
   {
@@ -49,65 +64,162 @@ int main(int argc, char **argv)
   //---------------------------------------------//
 
   const char * infiles[] = { options.refrfile, options.predfile };
-  current_stream = gt_gff3_in_stream_new_unsorted(2, infiles);
-  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)current_stream);
-  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)current_stream);
-  gt_queue_add(streams, current_stream);
-  last_stream = current_stream;
-
-  current_stream = gt_sort_stream_new(last_stream);
+  bool snapshots = agn_snapshot_in_stream_check(options.refrfile) ||
+                   agn_snapshot_in_stream_check(options.predfile);
+  if(snapshots)
+  {
+    // Snapshots are already validated and sorted; only GFF3 input needs to be
+    // loaded and validated before the two sources are merged.
+    GtArray *instreams = gt_array_new( sizeof(GtNodeStream *) );
+    int i;
+    for(i = 0; i < 2; i++)
+    {
+      current_stream = pe_input_stream(infiles[i], options.keepattrs, streams,
+                                       logger, error);
+      if(current_stream == NULL)
+      {
+        fprintf(stderr, "[ParsEval] error: %s\n", gt_error_get(error));
+        return 1;
+      }
+      gt_array_add(instreams, current_stream);
+    }
+    current_stream = gt_merge_stream_new(instreams);
+    gt_array_delete(instreams);
+  }
+  else
+  {
+    current_stream = gt_gff3_in_stream_new_unsorted(2, infiles);
+    gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)current_stream);
+    gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)current_stream);
+    if(options.keepattrs != NULL)
+    {
+      gt_queue_add(streams, current_stream);
+      current_stream = agn_attribute_prune_stream_new(current_stream,
+                                                      options.keepattrs);
+    }
+  }
   gt_queue_add(streams, current_stream);
   last_stream = current_stream;
 
-  current_stream = agn_gene_stream_new(last_stream, logger);
-  gt_queue_add(streams, current_stream);
-  last_stream = current_stream;
+  if(options.nucleotide_only)
+  {
+    rpt = agn_nucleotide_compare_visitor_new(options.refrfile,
+                                             options.predfile);
+    current_stream = gt_visitor_stream_new(last_stream, rpt);
+  }
+  else
+  {
+    if(!snapshots)
+    {
+      current_stream = gt_sort_stream_new(last_stream);
+      gt_queue_add(streams, current_stream);
+      last_stream = current_stream;
 
-  current_stream = agn_locus_stream_new(last_stream, options.delta);
-  agn_locus_stream_skip_iiLoci((AgnLocusStream *)current_stream);
-  agn_locus_stream_label_pairwise((AgnLocusStream *)current_stream,
-                                  options.refrfile, options.predfile);
-  gt_queue_add(streams, current_stream);
-  last_stream = current_stream;
+      current_stream = agn_gene_stream_new(last_stream, logger);
+      gt_queue_add(streams, current_stream);
+      last_stream = current_stream;
+    }
 
-  if(gt_array_size(options.filters) > 0)
-  {
-    current_stream = agn_locus_filter_stream_new(last_stream, options.filters);
+    current_stream = agn_locus_stream_new(last_stream, options.delta);
+    agn_locus_stream_skip_iiLoci((AgnLocusStream *)current_stream);
+    agn_locus_stream_label_pairwise((AgnLocusStream *)current_stream,
+                                    options.refrfile, options.predfile);
     gt_queue_add(streams, current_stream);
     last_stream = current_stream;
-  }
 
-  switch(options.outfmt)
-  {
-    case TEXTMODE:
-      if(options.summary_only)
-        rpt = agn_compare_report_text_new(NULL, false, logger);
-      else
-        rpt = agn_compare_report_text_new(options.outfile,options.gff3,logger);
-      break;
-    case HTMLMODE:
-      if(options.graphics)
+    if(gt_array_size(options.filters) > 0)
+    {
+      current_stream = agn_locus_filter_stream_new(last_stream,
+                                                   options.filters);
+      gt_queue_add(streams, current_stream);
+      last_stream = current_stream;
+    }
+
+    if(options.sample_rate < 1.0)
+    {
+      current_stream = agn_locus_sample_stream_new(last_stream,
+                                                   options.sample_rate,
+                                                   options.seed);
+      if(options.stratify)
+      {
+        agn_locus_sample_stream_stratify((AgnLocusSampleStream *)
+                                         current_stream);
+      }
+      gt_queue_add(streams, current_stream);
+      last_stream = current_stream;
+    }
+
+    switch(options.outfmt)
+    {
+      case TEXTMODE:
+        if(options.summary_only)
+          rpt = agn_compare_report_text_new(NULL, false, logger);
+        else
+          rpt = agn_compare_report_text_new(options.outfile, options.gff3,
+                                            logger);
+        break;
+      case HTMLMODE:
+        if(options.graphics && options.png)
+        {
+          rpt = agn_compare_report_html_new(options.outfilename, options.gff3,
+                                            &options.pngdata, logger);
+          agn_compare_report_html_set_png_workers((AgnCompareReportHTML *)rpt,
+                                                  options.pngworkers);
+        }
+        else if(options.graphics)
+        {
+          rpt = agn_compare_report_html_new(options.outfilename, options.gff3,
+                                            NULL, logger);
+          agn_compare_report_html_set_svg((AgnCompareReportHTML *)rpt,
+                                          &options.pngdata);
+        }
+        else
+        {
+          rpt = agn_compare_report_html_new(options.outfilename, options.gff3,
+                                            NULL, logger);
+        }
+        break;
+      case TSVMODE:
+        rpt = agn_compare_report_tsv_new(options.outfile, logger);
+        break;
+      default:
+        fprintf(stderr, "error: unknown output format\n");
+        return 1;
+        break;
+    }
+    if(options.sample_rate < 1.0 && options.bootstrap > 0)
+    {
+      bootrpt = agn_compare_report_bootstrap_new(options.bootstrap,
+                                                 options.seed, logger);
+    }
+    if(options.textfile != NULL || options.tsvfile != NULL || bootrpt != NULL)
+    {
+      GtNodeVisitor *composite = agn_compare_report_composite_new(logger);
+      agn_compare_report_composite_add((AgnCompareReportComposite *)composite,
+                                       rpt);
+      if(options.textfile != NULL)
+      {
+        textrpt = agn_compare_report_text_new(options.textfile, options.gff3,
+                                              logger);
+        agn_compare_report_composite_add((AgnCompareReportComposite *)composite,
+                                         textrpt);
+      }
+      if(options.tsvfile != NULL)
       {
-        rpt = agn_compare_report_html_new(options.outfilename, options.gff3,
-                                          &options.pngdata, logger);
+        tsvrpt = agn_compare_report_tsv_new(options.tsvfile, logger);
+        agn_compare_report_composite_add((AgnCompareReportComposite *)composite,
+                                         tsvrpt);
       }
-      else
+      if(bootrpt != NULL)
       {
-        rpt = agn_compare_report_html_new(options.outfilename, options.gff3,
-                                          NULL, logger);
+        agn_compare_report_composite_add((AgnCompareReportComposite *)composite,
+                                         bootrpt);
       }
-      break;
-    case CSVMODE:
-      fprintf(stderr, "error: CSV output mode support temporarily "
-              "unavailable\n");
-      return 1;
-      break;
-    default:
-      fprintf(stderr, "error: unknown output format\n");
-      return 1;
-      break;
+      current_stream = gt_visitor_stream_new(last_stream, composite);
+    }
+    else
+      current_stream = gt_visitor_stream_new(last_stream, rpt);
   }
-  current_stream = gt_visitor_stream_new(last_stream, rpt);
   gt_queue_add(streams, current_stream);
   last_stream = current_stream;
 
@@ -119,11 +231,26 @@ int main(int argc, char **argv)
   if(result == -1)
     fprintf(stderr, "[ParsEval] error: %s", gt_error_get(error));
 
-  if(options.outfmt == TEXTMODE)
+  if(options.nucleotide_only)
+  {
+    AgnCompStatsScaled cds, utr;
+    agn_nucleotide_compare_visitor_get_stats((AgnNucleotideCompareVisitor *)rpt,
+                                             &cds, &utr);
+    if(options.outfmt == TEXTMODE)
+      pe_summary_header(&options, options.outfile, start_time, argc, argv);
+    pe_summary_nucleotide(options.outfile, &cds, &utr,
+                          options.outfmt == TSVMODE);
+  }
+  else if(options.outfmt == TEXTMODE)
   {
     pe_summary_header(&options, options.outfile, start_time, argc, argv);
     agn_compare_report_text_create_summary((AgnCompareReportText *)rpt,
                                            options.outfile);
+    if(bootrpt != NULL)
+    {
+      agn_compare_report_bootstrap_create_summary((AgnCompareReportBootstrap *)
+                                                  bootrpt, options.outfile);
+    }
   }
   else if(options.outfmt == HTMLMODE)
   {
@@ -142,16 +269,37 @@ int main(int argc, char **argv)
                                               &odata);
     agn_compare_report_html_create_summary((AgnCompareReportHTML *)rpt);
   }
+  else if(options.outfmt == TSVMODE)
+    agn_compare_report_tsv_flush((AgnCompareReportTSV *)rpt);
+
+  if(textrpt != NULL)
+  {
+    pe_summary_header(&options, options.textfile, start_time, argc, argv);
+    agn_compare_report_text_create_summary((AgnCompareReportText *)textrpt,
+                                           options.textfile);
+    if(bootrpt != NULL)
+    {
+      agn_compare_report_bootstrap_create_summary((AgnCompareReportBootstrap *)
+                                                  bootrpt, options.textfile);
+    }
+  }
+  else if(bootrpt != NULL && options.outfmt != TEXTMODE)
+  {
+    agn_compare_report_bootstrap_create_summary((AgnCompareReportBootstrap *)
+                                                bootrpt, stderr);
+  }
+  if(tsvrpt != NULL)
+    agn_compare_report_tsv_flush((AgnCompareReportTSV *)tsvrpt);
 
   // Free memory and terminate
   gt_free(start_time);
-  pe_free_option_memory(&options);
   while(gt_queue_size(streams) > 0)
   {
     current_stream = gt_queue_get(streams);
     gt_node_stream_delete(current_stream);
   }
   gt_queue_delete(streams);
+  pe_free_option_memory(&options);
   gt_logger_delete(logger);
   gt_error_delete(error);
   gt_lib_clean();
@@ -0,0 +1,354 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "extended/array_in_stream_api.h"
+#include "extended/array_out_stream_api.h"
+#include "pe_daemon.h"
+#include "pe_utils.h"
+
+#define PE_DAEMON_MAX_REQUEST 4096
+
+/**
+ * @function Load the given GFF3 file (parse, prune attributes not listed in
+ * ``keepattrs`` if it is not NULL, validate, and sort) or annotation snapshot,
+ * storing the resulting nodes in ``nodes``.
+ */
+static int pe_daemon_load(const char *filename, const char *keepattrs,
+                          GtArray *nodes, GtLogger *logger, GtError *error)
+{
+  GtQueue *streams = gt_queue_new();
+  GtNodeStream *stream, *out;
+  int result = -1;
+
+  stream = pe_input_stream(filename, keepattrs, streams, logger, error);
+  if(stream != NULL)
+  {
+    out = gt_array_out_stream_all_new(stream, nodes, error);
+    gt_queue_add(streams, out);
+    result = gt_node_stream_pull(out, error);
+  }
+
+  while(gt_queue_size(streams) > 0)
+    gt_node_stream_delete(gt_queue_get(streams));
+  gt_queue_delete(streams);
+  return result;
+}
+
+/**
+ * @function Merge the resident reference nodes with the nodes of a single
+ * prediction, preserving sorted order. Reference nodes are shared with the
+ * resident copy (a reference is added for each), while prediction nodes are
+ * handed over to the merged array. Where both sources declare a sequence
+ * region for the same sequence, a single region spanning both is reported.
+ */
+static GtArray *pe_daemon_merge(GtArray *refrnodes, GtHashmap *refrregions,
+                                GtArray *prednodes)
+{
+  GtArray *merged = gt_array_new( sizeof(GtGenomeNode *) );
+  GtArray *predfiltered = gt_array_new( sizeof(GtGenomeNode *) );
+  GtHashmap *replacements = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
+                                           NULL);
+  GtUword i, j;
+
+  for(i = 0; i < gt_array_size(prednodes); i++)
+  {
+    GtGenomeNode *gn = *(GtGenomeNode **)gt_array_get(prednodes, i);
+    GtRegionNode *rn = gt_region_node_try_cast(gn);
+    if(rn == NULL)
+    {
+      gt_array_add(predfiltered, gn);
+      continue;
+    }
+
+    const char *seqid = gt_str_get(gt_genome_node_get_seqid(gn));
+    GtGenomeNode *refrrn = gt_hashmap_get(refrregions, seqid);
+    if(refrrn == NULL)
+    {
+      gt_array_add(predfiltered, gn);
+      continue;
+    }
+
+    GtRange refrrange = gt_genome_node_get_range(refrrn);
+    GtRange predrange = gt_genome_node_get_range(gn);
+    if(!gt_range_contains(&refrrange, &predrange))
+    {
+      GtRange joined = gt_range_join(&refrrange, &predrange);
+      GtGenomeNode *newrn = gt_region_node_new(gt_genome_node_get_seqid(gn),
+                                               joined.start, joined.end);
+      gt_hashmap_add(replacements, gt_cstr_dup(seqid), newrn);
+    }
+    gt_genome_node_delete(gn);
+  }
+
+  i = 0;
+  j = 0;
+  while(i < gt_array_size(refrnodes) || j < gt_array_size(predfiltered))
+  {
+    GtGenomeNode *refrgn = NULL, *predgn = NULL;
+    if(i < gt_array_size(refrnodes))
+      refrgn = *(GtGenomeNode **)gt_array_get(refrnodes, i);
+    if(j < gt_array_size(predfiltered))
+      predgn = *(GtGenomeNode **)gt_array_get(predfiltered, j);
+
+    if(predgn == NULL ||
+       (refrgn != NULL && gt_genome_node_cmp(refrgn, predgn) <= 0))
+    {
+      GtGenomeNode *newrn = NULL;
+      if(gt_region_node_try_cast(refrgn))
+      {
+        const char *seqid = gt_str_get(gt_genome_node_get_seqid(refrgn));
+        newrn = gt_hashmap_get(replacements, seqid);
+      }
+      if(newrn != NULL)
+        gt_array_add(merged, newrn);
+      else
+      {
+        gt_genome_node_ref(refrgn);
+        gt_array_add(merged, refrgn);
+      }
+      i++;
+    }
+    else
+    {
+      gt_array_add(merged, predgn);
+      j++;
+    }
+  }
+
+  gt_hashmap_delete(replacements);
+  gt_array_delete(predfiltered);
+  return merged;
+}
+
+/**
+ * @function Compare a single prediction against the resident reference and
+ * write the report to ``outstream``.
+ */
+static int pe_daemon_compare(ParsEvalOptions *options, GtArray *refrnodes,
+                             GtHashmap *refrregions, PeOutFormat format,
+                             const char *predfile, FILE *outstream,
+                             GtLogger *logger, int argc, char **argv,
+                             GtError *error)
+{
+  GtArray *prednodes, *merged;
+  GtNodeStream *ais, *locusstream, *filterstream = NULL, *rptstream;
+  GtNodeVisitor *rpt;
+  GtUword progress = 0;
+  int result;
+
+  prednodes = gt_array_new( sizeof(GtGenomeNode *) );
+  result = pe_daemon_load(predfile, options->keepattrs, prednodes, logger,
+                          error);
+  if(result)
+  {
+    while(gt_array_size(prednodes) > 0)
+      gt_genome_node_delete(*(GtGenomeNode **)gt_array_pop(prednodes));
+    gt_array_delete(prednodes);
+    return result;
+  }
+  merged = pe_daemon_merge(refrnodes, refrregions, prednodes);
+  gt_array_delete(prednodes);
+
+  ais = gt_array_in_stream_new(merged, &progress, error);
+  locusstream = agn_locus_stream_new(ais, options->delta);
+  agn_locus_stream_skip_iiLoci((AgnLocusStream *)locusstream);
+  agn_locus_stream_label_pairwise((AgnLocusStream *)locusstream,
+                                  options->refrfile, predfile);
+  if(gt_array_size(options->filters) > 0)
+    filterstream = agn_locus_filter_stream_new(locusstream, options->filters);
+
+  if(format == TSVMODE)
+    rpt = agn_compare_report_tsv_new(outstream, logger);
+  else
+    rpt = agn_compare_report_text_new(NULL, false, logger);
+  rptstream = gt_visitor_stream_new(filterstream ? filterstream : locusstream,
+                                    rpt);
+
+  result = gt_node_stream_pull(rptstream, error);
+  if(!result)
+  {
+    if(format == TSVMODE)
+      agn_compare_report_tsv_flush((AgnCompareReportTSV *)rpt);
+    else
+    {
+      ParsEvalOptions reqoptions = *options;
+      char *start_time = pe_get_start_time();
+      reqoptions.predfile = predfile;
+      reqoptions.predlabel = NULL;
+      pe_summary_header(&reqoptions, outstream, start_time, argc, argv);
+      agn_compare_report_text_create_summary((AgnCompareReportText *)rpt,
+                                             outstream);
+      gt_free(start_time);
+    }
+  }
+
+  gt_node_stream_delete(rptstream);
+  if(filterstream != NULL)
+    gt_node_stream_delete(filterstream);
+  gt_node_stream_delete(locusstream);
+  gt_node_stream_delete(ais);
+  while(gt_array_size(merged) > progress)
+    gt_genome_node_delete(*(GtGenomeNode **)gt_array_pop(merged));
+  gt_array_delete(merged);
+  return result;
+}
+
+/**
+ * @function Read and process a single request from a client connection.
+ * Returns true if the service should shut down.
+ */
+static bool pe_daemon_handle(ParsEvalOptions *options, GtArray *refrnodes,
+                             GtHashmap *refrregions, int client,
+                             GtLogger *logger, int argc, char **argv)
+{
+  char request[PE_DAEMON_MAX_REQUEST];
+  FILE *instream, *outstream;
+  bool shutdown = false;
+
+  instream = fdopen(client, "r");
+  outstream = fdopen(dup(client), "w");
+  if(instream == NULL || outstream == NULL)
+  {
+    if(instream != NULL)
+      fclose(instream);
+    else
+      close(client);
+    if(outstream != NULL)
+      fclose(outstream);
+    return false;
+  }
+
+  if(fgets(request, PE_DAEMON_MAX_REQUEST, instream) == NULL)
+  {
+    fclose(instream);
+    fclose(outstream);
+    return false;
+  }
+  request[strcspn(request, "\r\n")] = '\0';
+
+  PeOutFormat format = options->outfmt;
+  char *predfile = request;
+  if(strncmp(request, "tsv ", 4) == 0)
+  {
+    format = TSVMODE;
+    predfile = request + 4;
+  }
+  else if(strncmp(request, "text ", 5) == 0)
+  {
+    format = TEXTMODE;
+    predfile = request + 5;
+  }
+
+  if(strcmp(predfile, "shutdown") == 0)
+  {
+    gt_logger_log(logger, "[ParsEval] shutdown requested");
+    shutdown = true;
+  }
+  else if(predfile[0] == '\0')
+    fputs("error: empty request\n", outstream);
+  else
+  {
+    GtError *error = gt_error_new();
+    gt_logger_log(logger, "[ParsEval] comparing '%s'", predfile);
+    if(pe_daemon_compare(options, refrnodes, refrregions, format, predfile,
+                         outstream, logger, argc, argv, error))
+    {
+      fprintf(outstream, "error: %s\n", gt_error_get(error));
+      gt_logger_log(logger, "[ParsEval] error comparing '%s': %s", predfile,
+                    gt_error_get(error));
+    }
+    gt_error_delete(error);
+  }
+
+  fclose(instream);
+  fclose(outstream);
+  return shutdown;
+}
+
+int pe_daemon_run(ParsEvalOptions *options, GtLogger *logger, int argc,
+                  char **argv, GtError *error)
+{
+  GtArray *refrnodes;
+  GtHashmap *refrregions;
+  struct sockaddr_un address;
+  int sock, result = 0;
+  GtUword i;
+
+  agn_assert(options && options->socketpath);
+  if(strlen(options->socketpath) >= sizeof(address.sun_path))
+  {
+    gt_error_set(error, "socket path '%s' is too long", options->socketpath);
+    return -1;
+  }
+
+  refrnodes = gt_array_new( sizeof(GtGenomeNode *) );
+  if(pe_daemon_load(options->refrfile, options->keepattrs, refrnodes, logger,
+                    error))
+  {
+    while(gt_array_size(refrnodes) > 0)
+      gt_genome_node_delete(*(GtGenomeNode **)gt_array_pop(refrnodes));
+    gt_array_delete(refrnodes);
+    return -1;
+  }
+  refrregions = gt_hashmap_new(GT_HASH_STRING, NULL, NULL);
+  for(i = 0; i < gt_array_size(refrnodes); i++)
+  {
+    GtGenomeNode *gn = *(GtGenomeNode **)gt_array_get(refrnodes, i);
+    if(gt_region_node_try_cast(gn))
+    {
+      const char *seqid = gt_str_get(gt_genome_node_get_seqid(gn));
+      gt_hashmap_add(refrregions, (char *)seqid, gn);
+    }
+  }
+
+  sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, options->socketpath);
+  if(options->overwrite)
+    unlink(options->socketpath);
+  if(sock < 0 ||
+     bind(sock, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+     listen(sock, 16) != 0)
+  {
+    gt_error_set(error, "could not listen on socket '%s'",
+                 options->socketpath);
+    result = -1;
+  }
+  else
+  {
+    signal(SIGPIPE, SIG_IGN);
+    gt_logger_log(logger, "[ParsEval] loaded %lu reference nodes; listening on "
+                  "'%s'", gt_array_size(refrnodes), options->socketpath);
+    bool shutdown = false;
+    while(!shutdown)
+    {
+      int client = accept(sock, NULL, NULL);
+      if(client < 0)
+        continue;
+      shutdown = pe_daemon_handle(options, refrnodes, refrregions, client,
+                                  logger, argc, argv);
+    }
+    unlink(options->socketpath);
+  }
+
+  if(sock >= 0)
+    close(sock);
+  gt_hashmap_delete(refrregions);
+  while(gt_array_size(refrnodes) > 0)
+    gt_genome_node_delete(*(GtGenomeNode **)gt_array_pop(refrnodes));
+  gt_array_delete(refrnodes);
+  return result;
+}
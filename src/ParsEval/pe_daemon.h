@@ -0,0 +1,26 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#ifndef PARSEVAL_DAEMON
+#define PARSEVAL_DAEMON
+
+#include "pe_options.h"
+
+/**
+ * @function Load and validate the reference annotation once, then listen on
+ * the Unix socket ``options->socketpath`` for comparison requests. Each client
+ * connection sends a single line of the form ``[text|tsv] PATH``; the
+ * prediction at ``PATH`` is compared against the resident reference and the
+ * report is written back on the same connection. The request ``shutdown``
+ * stops the service. Returns 0 on a clean shutdown and -1 on error.
+ */
+int pe_daemon_run(ParsEvalOptions *options, GtLogger *logger, int argc,
+                  char **argv, GtError *error);
+
+#endif
@@ -8,11 +8,16 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
 
+#include <unistd.h>
 #include "pe_options.h"
 
 void pe_free_option_memory(ParsEvalOptions *options)
 {
   fclose(options->outfile);
+  if(options->textfile != NULL)
+    fclose(options->textfile);
+  if(options->tsvfile != NULL)
+    fclose(options->tsvfile);
   gt_array_delete(options->filters);
 }
 
@@ -21,26 +26,37 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
 {
   int opt = 0;
   int optindex = 0;
-  const char *optstr = "a:df:ghkl:o:pr:st:Vvwx:y:";
+  const char *optstr = "a:b:de:f:ghj:K:kl:m:no:Ppr:S:sT:t:uVvwx:y:z:";
   const struct option parseval_options[] =
   {
     { "datashare",  required_argument, NULL, 'a' },
+    { "bootstrap",  required_argument, NULL, 'b' },
     { "debug",      no_argument,       NULL, 'd' },
+    { "textfile",   required_argument, NULL, 'e' },
     { "outformat",  required_argument, NULL, 'f' },
     { "printgff3",  no_argument,       NULL, 'g' },
     { "help",       no_argument,       NULL, 'h' },
+    { "pngworkers", required_argument, NULL, 'j' },
+    { "keep-attrs", required_argument, NULL, 'K' },
     { "makefilter", no_argument,       NULL, 'k' },
     { "delta",      required_argument, NULL, 'l' },
+    { "sample",     required_argument, NULL, 'm' },
+    { "nucleotide-only", no_argument,  NULL, 'n' },
     { "outfile",    required_argument, NULL, 'o' },
+    { "png",        no_argument,       NULL, 'P' },
     { "nopng",      no_argument,       NULL, 'p' },
     { "filterfile", required_argument, NULL, 'r' },
+    { "socket",     required_argument, NULL, 'S' },
     { "summary",    no_argument,       NULL, 's' },
+    { "tsvfile",    required_argument, NULL, 'T' },
     { "maxtrans",   required_argument, NULL, 't' },
+    { "stratify",   no_argument,       NULL, 'u' },
     { "verbose",    no_argument,       NULL, 'V' },
     { "version",    no_argument,       NULL, 'v' },
     { "overwrite",  no_argument,       NULL, 'w' },
     { "refrlabel",  required_argument, NULL, 'x' },
     { "predlabel",  required_argument, NULL, 'y' },
+    { "seed",       required_argument, NULL, 'z' },
     { NULL,         no_argument,       NULL,  0  },
   };
 
@@ -52,13 +68,27 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
     {
       options->data_path = optarg;
     }
+    else if(opt == 'b')
+    {
+      if(sscanf(optarg, "%lu", &options->bootstrap) == EOF)
+      {
+        fprintf(stderr, "error: could not convert bootstrap '%s' to an "
+                "integer\n", optarg);
+        exit(1);
+      }
+    }
     else if(opt == 'd')
     {
       options->debug = true;
     }
+    else if(opt == 'e')
+    {
+      options->textfilename = optarg;
+    }
     else if(opt == 'f')
     {
-      if      (strcmp(optarg, "csv")  == 0) options->outfmt = CSVMODE;
+      if      (strcmp(optarg, "tsv")  == 0) options->outfmt = TSVMODE;
+      else if (strcmp(optarg, "csv")  == 0) options->outfmt = TSVMODE;
       else if (strcmp(optarg, "text") == 0) options->outfmt = TEXTMODE;
       else if (strcmp(optarg, "html") == 0) options->outfmt = HTMLMODE;
       else
@@ -78,6 +108,19 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
       pe_print_usage(stdout);
       exit(0);
     }
+    else if(opt == 'j')
+    {
+      if(sscanf(optarg, "%lu", &options->pngworkers) == EOF)
+      {
+        fprintf(stderr, "error: could not convert pngworkers '%s' to an "
+                "integer\n", optarg);
+        exit(1);
+      }
+    }
+    else if(opt == 'K')
+    {
+      options->keepattrs = optarg;
+    }
     else if(opt == 'k')
     {
       options->makefilter = true;
@@ -91,10 +134,28 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
         exit(1);
       }
     }
+    else if(opt == 'm')
+    {
+      if(sscanf(optarg, "%lf", &options->sample_rate) == EOF ||
+         options->sample_rate <= 0.0 || options->sample_rate > 1.0)
+      {
+        fprintf(stderr, "error: sample rate '%s' must be a number in the "
+                "interval (0, 1]\n", optarg);
+        exit(1);
+      }
+    }
+    else if(opt == 'n')
+    {
+      options->nucleotide_only = true;
+    }
     else if(opt == 'o')
     {
       options->outfilename = optarg;
     }
+    else if(opt == 'P')
+    {
+      options->png = true;
+    }
     else if(opt == 'p')
     {
       options->graphics = false;
@@ -110,10 +171,18 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
       agn_locus_filter_parse(filterfile, options->filters);
       fclose(filterfile);
     }
+    else if(opt == 'S')
+    {
+      options->socketpath = optarg;
+    }
     else if(opt == 's')
     {
       options->summary_only = true;
     }
+    else if(opt == 'T')
+    {
+      options->tsvfilename = optarg;
+    }
     else if(opt == 't')
     {
       if(sscanf(optarg, "%d", &options->max_transcripts) == EOF)
@@ -123,6 +192,10 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
         exit(1);
       }
     }
+    else if(opt == 'u')
+    {
+      options->stratify = true;
+    }
     else if(opt == 'V')
     {
       options->verbose = true;
@@ -144,12 +217,21 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
     {
       options->predlabel = optarg;
     }
+    else if(opt == 'z')
+    {
+      if(sscanf(optarg, "%lu", &options->seed) == EOF)
+      {
+        fprintf(stderr, "error: could not convert seed '%s' to an integer\n",
+                optarg);
+        exit(1);
+      }
+    }
   }
   
 #ifdef WITHOUT_CAIRO
-  if(options->graphics)
+  if(options->graphics && options->png)
   {
-    fputs("error: AEGeAn was compiled without graphics support. Please "
+    fputs("error: AEGeAn was compiled without PNG graphics support. Please "
           "recompile to enable this feature.\n", stderr);
     exit(1);
   }
@@ -180,6 +262,36 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
     gt_array_add(options->filters, filter);
   }
 
+  if(options->socketpath != NULL)
+  {
+    if(argc - optind != 1)
+    {
+      pe_print_usage(stderr);
+      fprintf(stderr, "error: must provide 1 (and only 1) reference file in "
+              "service mode, you provided %d\n\n", argc - optind);
+      exit(1);
+    }
+    if(options->outfmt == HTMLMODE || options->nucleotide_only ||
+       options->sample_rate < 1.0)
+    {
+      fputs("error: service mode supports only text and tsv comparisons\n",
+            stderr);
+      exit(1);
+    }
+    if(options->outfilename != NULL || options->textfilename != NULL ||
+       options->tsvfilename != NULL)
+    {
+      fprintf(stderr, "warning: reports are written to the client connection "
+              "in service mode; ignoring output files\n");
+      options->outfilename = NULL;
+      options->textfilename = NULL;
+      options->tsvfilename = NULL;
+    }
+    options->refrfile = argv[optind];
+    options->graphics = false;
+    return optind;
+  }
+
   if(argc - optind != 2)
   {
     pe_print_usage(stderr);
@@ -188,7 +300,30 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
     exit(1);
   }
 
-  if(options->outfmt == HTMLMODE && options->summary_only)
+  if(options->nucleotide_only)
+  {
+    if(options->outfmt == HTMLMODE)
+    {
+      fputs("error: nucleotide-only mode requires text or tsv output format\n",
+            stderr);
+      exit(1);
+    }
+    if(options->textfilename != NULL || options->tsvfilename != NULL)
+    {
+      fprintf(stderr, "warning: additional reports are not supported in "
+              "nucleotide-only mode; ignoring\n");
+      options->textfilename = NULL;
+      options->tsvfilename = NULL;
+    }
+    if(options->sample_rate < 1.0)
+    {
+      fprintf(stderr, "warning: sampling is not supported in nucleotide-only "
+              "mode; ignoring\n");
+      options->sample_rate = 1.0;
+    }
+  }
+
+  if(options->outfmt != TEXTMODE && options->summary_only)
   {
     fprintf(stderr, "warning: summary-only mode requires text output format; "
             "ignoring\n");
@@ -273,7 +408,7 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
 
     if(options->graphics && options->summary_only)
     {
-      fprintf(stderr, "warning: cannot print PNG graphics in summary only "
+      fprintf(stderr, "warning: cannot print graphics in summary only "
               "mode; ignoring\n");
       options->graphics = false;
     }
@@ -292,6 +427,29 @@ int pe_parse_options(int argc, char **argv, ParsEvalOptions *options,
     }
   }
 
+  const char *extranames[] = { options->textfilename, options->tsvfilename };
+  FILE **extrafiles[] = { &options->textfile, &options->tsvfile };
+  int i;
+  for(i = 0; i < 2; i++)
+  {
+    if(extranames[i] == NULL)
+      continue;
+    char filecmd[1024];
+    sprintf(filecmd, "test -f %s", extranames[i]);
+    if(system(filecmd) == 0 && !options->overwrite)
+    {
+      fprintf(stderr, "error: outfile '%s' exists; use '-w' to force "
+              "overwrite\n", extranames[i]);
+      exit(1);
+    }
+    *extrafiles[i] = fopen(extranames[i], "w");
+    if(*extrafiles[i] == NULL)
+    {
+      fprintf(stderr, "error: cannot open output file '%s'\n", extranames[i]);
+      exit(1);
+    }
+  }
+
   options->refrfile = argv[optind];
   options->predfile = argv[optind + 1];
   if(options->outfmt != HTMLMODE && options->graphics)
@@ -315,30 +473,68 @@ void pe_print_usage(FILE *outstream)
   fprintf(outstream,
 "\nParsEval: comparative analysis of two alternative sources of annotation\n"
 "Usage: parseval [options] reference.gff3 prediction.gff3\n"
+"       parseval [options] --socket=PATH reference.gff3\n"
 "  Basic options:\n"
 "    -d|--debug:                 Print debugging messages\n"
 "    -h|--help:                  Print help message and exit\n"
+"    -K|--keep-attrs: STRING     Remove all attributes except ID, Parent,\n"
+"                                Name, accession, and those in the given\n"
+"                                comma-separated list from GFF3 input, to\n"
+"                                reduce memory usage\n"
 "    -l|--delta: INT             Extend gene loci by this many nucleotides;\n"
 "                                default is 0\n"
+"    -m|--sample: FLOAT          Compare only a random sample of loci, each\n"
+"                                selected with the given probability, and\n"
+"                                report bootstrap confidence intervals for\n"
+"                                summary statistics; default is 1.0 (compare\n"
+"                                all loci)\n"
+"    -n|--nucleotide-only        Skip locus parsing and transcript matching;\n"
+"                                only report genome-wide CDS and UTR\n"
+"                                nucleotide-level statistics\n"
+"    -S|--socket: PATH           Load the reference once and serve\n"
+"                                comparison requests on a Unix socket; each\n"
+"                                request is a line '[text|tsv] PRED.gff3',\n"
+"                                and 'shutdown' stops the service\n"
 "    -V|--verbose:               Print verbose warning messages\n"
 "    -v|--version:               Print version number and exit\n\n"
+"  Sampling options:\n"
+"    -b|--bootstrap: INT         Number of bootstrap replicates used to\n"
+"                                compute confidence intervals for a sampled\n"
+"                                comparison; use 0 to disable; default is\n"
+"                                1000\n"
+"    -u|--stratify               Sample loci systematically within length\n"
+"                                strata rather than independently\n"
+"    -z|--seed: INT              Seed for the random number generator used\n"
+"                                for sampling; default is 0\n\n"
 "  Output options:\n"
 "    -a|--datashare: STRING      Location from which to copy shared data for\n"
 "                                HTML output (if `make install' has not yet\n"
 "                                been run)\n"
 "    -f|--outformat: STRING      Indicate desired output format; possible\n"
-"                                options: 'csv', 'text', or 'html'\n"
-"                                (default='text'); in 'text' or 'csv' mode,\n"
+"                                options: 'tsv', 'text', or 'html'\n"
+"                                (default='text'); in 'text' or 'tsv' mode,\n"
 "                                will create a single file; in 'html' mode,\n"
 "                                will create a directory\n"
+"    -e|--textfile: FILENAME     In addition to the output format selected\n"
+"                                above, write a text report to this file\n"
 "    -g|--nogff3:                Do no print GFF3 output corresponding to each\n"
 "                                comparison\n"
 "    -o|--outfile: FILENAME      File/directory to which output will be\n"
 "                                written; default is the terminal (STDOUT)\n"
-"    -p|--nopng:                 In HTML output mode, skip generation of PNG\n"
+"    -j|--pngworkers: INT        Number of worker processes used to render\n"
+"                                PNG graphics in HTML output mode; default\n"
+"                                is the number of available processors\n"
+"    -P|--png:                   In HTML output mode, render PNG graphics\n"
+"                                with cairo instead of the built-in SVG\n"
+"                                graphics\n"
+"    -p|--nopng:                 In HTML output mode, skip generation of\n"
 "                                graphics for each gene locus\n"
 "    -s|--summary:               Only print summary statistics, do not print\n"
 "                                individual comparisons\n"
+"    -T|--tsvfile: FILENAME      In addition to the output format selected\n"
+"                                above, write a tab-delimited report to this\n"
+"                                file; all reports are generated from a\n"
+"                                single comparison pass\n"
 "    -w|--overwrite:             Force overwrite of any existing output files\n"
 "    -x|--refrlabel: STRING      Optional label for reference annotations\n"
 "    -y|--predlabel: STRING      Optional label for prediction annotations\n\n"
@@ -360,9 +556,6 @@ void pe_set_option_defaults(ParsEvalOptions *options)
   options->gff3 = true;
   options->summary_only = false;
   options->graphics = true;
-#ifdef WITHOUT_CAIRO
-  options->graphics = false;
-#endif
   options->refrfile = NULL;
   options->predfile = NULL;
   options->refrlabel = NULL;
@@ -375,4 +568,18 @@ void pe_set_option_defaults(ParsEvalOptions *options)
   options->verbose = false;
   options->max_transcripts = 32;
   options->delta = 0;
+  options->textfilename = NULL;
+  options->textfile = NULL;
+  options->tsvfilename = NULL;
+  options->tsvfile = NULL;
+  options->nucleotide_only = false;
+  options->sample_rate = 1.0;
+  options->seed = 0;
+  options->stratify = false;
+  options->bootstrap = 1000;
+  options->socketpath = NULL;
+  long numprocs = sysconf(_SC_NPROCESSORS_ONLN);
+  options->pngworkers = numprocs > 0 ? numprocs : 1;
+  options->png = false;
+  options->keepattrs = NULL;
 }
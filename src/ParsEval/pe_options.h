@@ -22,7 +22,7 @@ enum PeOutFormat
 {
   TEXTMODE,
   HTMLMODE,
-  CSVMODE
+  TSVMODE
 };
 typedef enum PeOutFormat PeOutFormat;
 
@@ -50,6 +50,19 @@ struct ParsEvalOptions
   bool verbose;
   int max_transcripts;
   GtUword delta;
+  const char *textfilename;
+  FILE *textfile;
+  const char *tsvfilename;
+  FILE *tsvfile;
+  bool nucleotide_only;
+  double sample_rate;
+  GtUword seed;
+  bool stratify;
+  GtUword bootstrap;
+  const char *socketpath;
+  GtUword pngworkers;
+  bool png;
+  const char *keepattrs;
 };
 typedef struct ParsEvalOptions ParsEvalOptions;
 
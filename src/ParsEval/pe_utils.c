@@ -25,6 +25,42 @@ char *pe_get_start_time()
   return gt_cstr_dup(timestr);
 }
 
+GtNodeStream *pe_input_stream(const char *filename, const char *keepattrs,
+                              GtQueue *streams, GtLogger *logger,
+                              GtError *error)
+{
+  GtNodeStream *current_stream, *last_stream;
+
+  if(agn_snapshot_in_stream_check(filename))
+  {
+    current_stream = agn_snapshot_in_stream_new(filename, error);
+    if(current_stream != NULL)
+      gt_queue_add(streams, current_stream);
+    return current_stream;
+  }
+
+  current_stream = gt_gff3_in_stream_new_unsorted(1, &filename);
+  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)current_stream);
+  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)current_stream);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  if(keepattrs != NULL)
+  {
+    current_stream = agn_attribute_prune_stream_new(last_stream, keepattrs);
+    gt_queue_add(streams, current_stream);
+    last_stream = current_stream;
+  }
+
+  current_stream = gt_sort_stream_new(last_stream);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  current_stream = agn_gene_stream_new(last_stream, logger);
+  gt_queue_add(streams, current_stream);
+  return current_stream;
+}
+
 void pe_summary_html_overview(FILE *outstream, void *data)
 {
   int x;
@@ -70,3 +106,34 @@ void pe_summary_header(ParsEvalOptions *options, FILE *outstream,
   }
   fprintf(outstream, "\n\n");
 }
+
+void pe_summary_nucleotide(FILE *outstream, AgnCompStatsScaled *cds,
+                           AgnCompStatsScaled *utr, bool tsv)
+{
+  if(tsv)
+  {
+    fprintf(outstream, "feature\ttp\tfn\tfp\ttn\tmc\tcc\tsn\tsp\tf1\ted\n");
+    fprintf(outstream, "CDS\t%lu\t%lu\t%lu\t%lu\t%s\t%s\t%s\t%s\t%s\t%s\n",
+            cds->tp, cds->fn, cds->fp, cds->tn, cds->mcs, cds->ccs, cds->sns,
+            cds->sps, cds->f1s, cds->eds);
+    fprintf(outstream, "UTR\t%lu\t%lu\t%lu\t%lu\t%s\t%s\t%s\t%s\t%s\t%s\n",
+            utr->tp, utr->fn, utr->fp, utr->tn, utr->mcs, utr->ccs, utr->sns,
+            utr->sps, utr->f1s, utr->eds);
+    return;
+  }
+
+  fprintf(outstream, "  %-30s   %-10s   %-10s\n",
+          "Nucleotide-level comparison", "CDS", "UTRs");
+  fprintf(outstream, "    %-30s %-10s   %-10s\n", "Matching coefficient:",
+          cds->mcs, utr->mcs);
+  fprintf(outstream, "    %-30s %-10s   %-10s\n", "Correlation coefficient:",
+          cds->ccs, utr->ccs);
+  fprintf(outstream, "    %-30s %-10s   %-10s\n", "Sensitivity:",
+          cds->sns, utr->sns);
+  fprintf(outstream, "    %-30s %-10s   %-10s\n", "Specificity:",
+          cds->sps, utr->sps);
+  fprintf(outstream, "    %-30s %-10s   %-10s\n", "F1 Score:",
+          cds->f1s, utr->f1s);
+  fprintf(outstream, "    %-30s %-10s   %-10s\n", "Annotation edit distance:",
+          cds->eds, utr->eds);
+}
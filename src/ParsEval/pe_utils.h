@@ -24,7 +24,12 @@ struct PeHtmlOverviewData
 typedef struct PeHtmlOverviewData PeHtmlOverviewData;
 
 char *pe_get_start_time();
+GtNodeStream *pe_input_stream(const char *filename, const char *keepattrs,
+                              GtQueue *streams, GtLogger *logger,
+                              GtError *error);
 void pe_summary_html_overview(FILE *outstream, void *data);
+void pe_summary_nucleotide(FILE *outstream, AgnCompStatsScaled *cds,
+                           AgnCompStatsScaled *utr, bool tsv);
 void pe_summary_header(ParsEvalOptions *options, FILE *outstream,
                        char *start_time, int argc, char **argv);
 
@@ -17,6 +17,9 @@ typedef struct
   GtFile *outstream;
   GtStr *source;
   bool infer;
+  FILE *snapshot;
+  GtUword numthreads;
+  const char *keepattrs;
 } CanonGFF3Options;
 
 static void print_usage(FILE *outstream)
@@ -27,10 +30,20 @@ static void print_usage(FILE *outstream)
 "     -i|--infer              for transcript features lacking an explicitly\n"
 "                             declared gene feature as a parent, create this\n"
 "                             feature on-they-fly\n"
+"     -j|--threads: INT       infer CDS and exon features for different genes\n"
+"                             in parallel using the given number of threads;\n"
+"                             output is identical to a single-threaded run\n"
+"     -K|--keep-attrs: STRING remove all attributes except ID, Parent, Name,\n"
+"                             accession, and those in the given\n"
+"                             comma-separated list, to reduce memory usage\n"
 "     -o|--outfile: STRING    name of file to which GFF3 data will be\n"
 "                             written; default is terminal (stdout)\n"
 "     -s|--source: STRING     reset the source of each feature to the given\n"
 "                             value\n"
+"     -S|--snapshot: STRING   write a binary snapshot of the sorted canonical\n"
+"                             annotations to the given file, for fast loading\n"
+"                             by other AEGeAn programs; GFF3 output is only\n"
+"                             written if '-o' is also specified\n"
 "     -v|--version            print version number and exit\n\n",
         outstream);
 }
@@ -40,12 +53,15 @@ static void canon_gff3_parse_options(int argc, char * const *argv,
 {
   int opt = 0;
   int optindex = 0;
-  const char *optstr = "hio:s:v";
+  const char *optstr = "hij:K:o:S:s:v";
   const struct option init_options[] =
   {
     { "help",    no_argument,       NULL, 'h' },
     { "infer",   no_argument,       NULL, 'i' },
+    { "threads", required_argument, NULL, 'j' },
+    { "keep-attrs", required_argument, NULL, 'K' },
     { "outfile", required_argument, NULL, 'o' },
+    { "snapshot", required_argument, NULL, 'S' },
     { "source",  required_argument, NULL, 's' },
     { "version", no_argument,       NULL, 'v' },
     { NULL,      no_argument,       NULL, 0 },
@@ -62,12 +78,38 @@ static void canon_gff3_parse_options(int argc, char * const *argv,
     }
     else if(opt == 'i')
       options->infer = true;
+    else if(opt == 'j')
+    {
+      char extra;
+      if(optarg[0] == '-' ||
+         sscanf(optarg, "%lu%c", &options->numthreads, &extra) != 1 ||
+         options->numthreads == 0)
+      {
+        fprintf(stderr, "[CanonGFF3] error: invalid number of threads '%s'\n",
+                optarg);
+        exit(1);
+      }
+    }
+    else if(opt == 'K')
+      options->keepattrs = optarg;
     else if(opt == 'o')
     {
       if(options->outstream != NULL)
         gt_file_delete(options->outstream);
       options->outstream = gt_file_new(optarg, "w", error);
     }
+    else if(opt == 'S')
+    {
+      if(options->snapshot != NULL)
+        fclose(options->snapshot);
+      options->snapshot = fopen(optarg, "wb");
+      if(options->snapshot == NULL)
+      {
+        fprintf(stderr, "[CanonGFF3] error: cannot open snapshot file '%s'\n",
+                optarg);
+        exit(1);
+      }
+    }
     else if(opt == 's')
     {
       if(options->source != NULL)
@@ -89,7 +131,7 @@ int main(int argc, char * const *argv)
   GtLogger *logger;
   GtQueue *streams;
   GtNodeStream *stream, *last_stream;
-  CanonGFF3Options options = { NULL, NULL, false };
+  CanonGFF3Options options = { NULL, NULL, false, NULL, 1, NULL };
 
   gt_lib_init();
   error = gt_error_new();
@@ -105,6 +147,13 @@ int main(int argc, char * const *argv)
   gt_queue_add(streams, stream);
   last_stream = stream;
 
+  if(options.keepattrs != NULL)
+  {
+    stream = agn_attribute_prune_stream_new(last_stream, options.keepattrs);
+    gt_queue_add(streams, stream);
+    last_stream = stream;
+  }
+
   if(options.infer)
   {
     GtHashmap *type_parents = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
@@ -118,7 +167,8 @@ int main(int argc, char * const *argv)
     last_stream = stream;
   }
 
-  stream = agn_gene_stream_new(last_stream, logger);
+  stream = agn_gene_stream_new_parallel(last_stream, logger,
+                                        options.numthreads);
   gt_queue_add(streams, stream);
   last_stream = stream;
 
@@ -130,11 +180,25 @@ int main(int argc, char * const *argv)
     last_stream = stream;
   }
 
-  stream = gt_gff3_out_stream_new(last_stream, options.outstream);
-  if(!options.infer)
-    gt_gff3_out_stream_retain_id_attributes((GtGFF3OutStream *)stream);
-  gt_queue_add(streams, stream);
-  last_stream = stream;
+  if(options.snapshot != NULL)
+  {
+    stream = gt_sort_stream_new(last_stream);
+    gt_queue_add(streams, stream);
+    last_stream = stream;
+
+    stream = agn_snapshot_out_stream_new(last_stream, options.snapshot);
+    gt_queue_add(streams, stream);
+    last_stream = stream;
+  }
+
+  if(options.snapshot == NULL || options.outstream != NULL)
+  {
+    stream = gt_gff3_out_stream_new(last_stream, options.outstream);
+    if(!options.infer)
+      gt_gff3_out_stream_retain_id_attributes((GtGFF3OutStream *)stream);
+    gt_queue_add(streams, stream);
+    last_stream = stream;
+  }
 
   if(gt_node_stream_pull(last_stream, error) == -1)
   {
@@ -152,6 +216,8 @@ int main(int argc, char * const *argv)
     gt_str_delete(options.source);
   if(options.outstream != NULL)
     gt_file_delete(options.outstream);
+  if(options.snapshot != NULL)
+    fclose(options.snapshot);
   gt_error_delete(error);
   gt_logger_delete(logger);
   gt_lib_clean();
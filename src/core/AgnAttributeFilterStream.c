@@ -8,6 +8,8 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
 
+#include <regex.h>
+#include <stdlib.h>
 #include <string.h>
 #include "extended/array_in_stream_api.h"
 #include "extended/array_out_stream_api.h"
@@ -16,14 +18,42 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #include "AgnUtils.h"
 
 //------------------------------------------------------------------------------
-// Data structure definition
+// Data structure definitions
 //------------------------------------------------------------------------------
 
+typedef enum
+{
+  ATTRIBUTE_MATCH_PREFIX,
+  ATTRIBUTE_MATCH_REGEX,
+  ATTRIBUTE_MATCH_LT,
+  ATTRIBUTE_MATCH_LE,
+  ATTRIBUTE_MATCH_GT,
+  ATTRIBUTE_MATCH_GE
+} AttributeMatchType;
+
+typedef struct
+{
+  AttributeMatchType type;
+  char *prefix;
+  size_t prefixlen;
+  regex_t *regex;
+  double bound;
+} AttributeMatcher;
+
+// All filters for a single attribute key: a set of values that must match
+// exactly, and any prefix, regex, or numeric matchers
+typedef struct
+{
+  char *key;
+  GtHashmap *values;
+  GtArray *matchers;
+} AttributeFilterKey;
+
 struct AgnAttributeFilterStream
 {
   const GtNodeStream parent_instance;
   GtNodeStream *in_stream;
-  GtHashmap *filters;
+  GtArray *keys;
 };
 
 
@@ -39,11 +69,40 @@ struct AgnAttributeFilterStream
  */
 static const GtNodeStreamClass* attribute_filter_stream_class(void);
 
+/**
+ * @function Parse a single filter and add it to the table of filters, indexed
+ * by attribute key. Implements the ``GtHashmapVisitFunc`` interface.
+ */
+static int attribute_filter_stream_compile(void *key, void *value, void *data,
+                                           GtError *error);
+
 /**
  * @function Class destructor.
  */
 static void attribute_filter_stream_free(GtNodeStream *ns);
 
+/**
+ * @function Find the filters for the given attribute key, creating an empty
+ * entry if there are none yet.
+ */
+static AttributeFilterKey *
+attribute_filter_stream_get_key(AgnAttributeFilterStream *stream,
+                                const char *key, size_t keylen);
+
+/**
+ * @function Determine whether any attribute of the given feature matches any
+ * of the filters.
+ */
+static bool attribute_filter_stream_match(AgnAttributeFilterStream *stream,
+                                          GtFeatureNode *fn);
+
+/**
+ * @function Determine whether an attribute value satisfies a prefix, regex, or
+ * numeric matcher.
+ */
+static bool attribute_filter_stream_match_value(AttributeMatcher *matcher,
+                                                const char *value);
+
 /**
  * @function Pulls nodes from the input stream and feeds them to the output
  * stream if they pass the provided filtering criteria.
@@ -52,9 +111,11 @@ static int attribute_filter_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
                                         GtError *error);
 
 /**
- * @function Generate data for unit testing.
+ * @function Generate data for unit testing: the genes of a partial
+ * *P. barbatus* annotation that pass the given filter.
  */
-static void attribute_filter_stream_test_data(GtQueue *queue);
+static void attribute_filter_stream_test_data(GtQueue *queue,
+                                              const char *filter);
 
 
 //------------------------------------------------------------------------------
@@ -70,7 +131,9 @@ GtNodeStream* agn_attribute_filter_stream_new(GtNodeStream *in_stream,
   ns = gt_node_stream_create(attribute_filter_stream_class(), false);
   stream = attribute_filter_stream_cast(ns);
   stream->in_stream = gt_node_stream_ref(in_stream);
-  stream->filters = gt_hashmap_ref(filters);
+  stream->keys = gt_array_new( sizeof(AttributeFilterKey) );
+  gt_hashmap_foreach_in_key_order(filters, attribute_filter_stream_compile,
+                                  stream, NULL);
   return ns;
 }
 
@@ -89,7 +152,7 @@ static const GtNodeStreamClass *attribute_filter_stream_class(void)
 bool agn_attribute_filter_stream_unit_test(AgnUnitTest *test)
 {
   GtQueue *queue = gt_queue_new();
-  attribute_filter_stream_test_data(queue);
+  attribute_filter_stream_test_data(queue, "partial=true");
   bool test1 = gt_queue_size(queue) == 2;
   if(test1)
   {
@@ -101,17 +164,210 @@ bool agn_attribute_filter_stream_unit_test(AgnUnitTest *test)
     test1 = test1 && gt_genome_node_get_start(gene) == 654911;
     gt_genome_node_delete(gene);
   }
-
   agn_unit_test_result(test, "Pogonomyrmex barbatus (partial)", test1);
+
+  attribute_filter_stream_test_data(queue, "Dbxref^=GeneID:10543082");
+  bool test2 = gt_queue_size(queue) == 2;
+  if(test2)
+  {
+    GtGenomeNode *gene = gt_queue_get(queue);
+    test2 = test2 && gt_genome_node_get_start(gene) == 646485;
+    gt_genome_node_delete(gene);
+
+    gene = gt_queue_get(queue);
+    test2 = test2 && gt_genome_node_get_start(gene) == 654911;
+    gt_genome_node_delete(gene);
+  }
+  agn_unit_test_result(test, "prefix", test2);
+
+  attribute_filter_stream_test_data(queue, "accession>=105430796");
+  bool test3 = gt_queue_size(queue) == 1;
+  if(test3)
+  {
+    GtGenomeNode *gene = gt_queue_get(queue);
+    test3 = gt_genome_node_get_start(gene) == 646485;
+    gt_genome_node_delete(gene);
+  }
+  agn_unit_test_result(test, "numeric", test3);
+
+  attribute_filter_stream_test_data(queue, "Name~=^LOC1054307(95|96)$");
+  bool test4 = gt_queue_size(queue) == 1;
+  if(test4)
+  {
+    GtGenomeNode *gene = gt_queue_get(queue);
+    test4 = gt_genome_node_get_start(gene) == 652674;
+    gt_genome_node_delete(gene);
+  }
+  agn_unit_test_result(test, "regex", test4);
+
+  while(gt_queue_size(queue) > 0)
+    gt_genome_node_delete(gt_queue_get(queue));
   gt_queue_delete(queue);
   return agn_unit_test_success(test);
 }
 
+static int attribute_filter_stream_compile(void *key, void *value, void *data,
+                                           GtError *error)
+{
+  AgnAttributeFilterStream *stream = data;
+  const char *filter = key;
+  size_t keylen = strcspn(filter, "=<>^~");
+  const char *op = filter + keylen;
+  if(keylen == 0 || *op == '\0')
+  {
+    fprintf(stderr, "[AgnAttributeFilterStream] warning: ignoring invalid "
+            "attribute filter '%s'\n", filter);
+    return 0;
+  }
+
+  if(*op == '=')
+  {
+    AttributeFilterKey *fk = attribute_filter_stream_get_key(stream, filter,
+                                                             keylen);
+    if(gt_hashmap_get(fk->values, op + 1) == NULL)
+    {
+      char *valuecopy = gt_cstr_dup(op + 1);
+      gt_hashmap_add(fk->values, valuecopy, valuecopy);
+    }
+    return 0;
+  }
+
+  AttributeMatcher matcher;
+  memset(&matcher, 0, sizeof(AttributeMatcher));
+  bool valid = true;
+  if(strncmp(op, "^=", 2) == 0)
+  {
+    matcher.type = ATTRIBUTE_MATCH_PREFIX;
+    matcher.prefix = gt_cstr_dup(op + 2);
+    matcher.prefixlen = strlen(matcher.prefix);
+  }
+  else if(strncmp(op, "~=", 2) == 0)
+  {
+    matcher.type = ATTRIBUTE_MATCH_REGEX;
+    matcher.regex = gt_malloc(sizeof(regex_t));
+    if(regcomp(matcher.regex, op + 2, REG_EXTENDED | REG_NOSUB) != 0)
+    {
+      gt_free(matcher.regex);
+      valid = false;
+    }
+  }
+  else if(*op == '<' || *op == '>')
+  {
+    bool orequal = op[1] == '=';
+    if(*op == '<')
+      matcher.type = orequal ? ATTRIBUTE_MATCH_LE : ATTRIBUTE_MATCH_LT;
+    else
+      matcher.type = orequal ? ATTRIBUTE_MATCH_GE : ATTRIBUTE_MATCH_GT;
+    const char *operand = orequal ? op + 2 : op + 1;
+    char *end;
+    matcher.bound = strtod(operand, &end);
+    valid = end != operand && *end == '\0';
+  }
+  else
+    valid = false;
+
+  if(!valid)
+  {
+    fprintf(stderr, "[AgnAttributeFilterStream] warning: ignoring invalid "
+            "attribute filter '%s'\n", filter);
+    return 0;
+  }
+
+  AttributeFilterKey *fk = attribute_filter_stream_get_key(stream, filter,
+                                                           keylen);
+  gt_array_add(fk->matchers, matcher);
+  return 0;
+}
+
 static void attribute_filter_stream_free(GtNodeStream *ns)
 {
   AgnAttributeFilterStream *stream = attribute_filter_stream_cast(ns);
   gt_node_stream_delete(stream->in_stream);
-  gt_hashmap_delete(stream->filters);
+
+  GtUword i, j;
+  for(i = 0; i < gt_array_size(stream->keys); i++)
+  {
+    AttributeFilterKey *fk = gt_array_get(stream->keys, i);
+    for(j = 0; j < gt_array_size(fk->matchers); j++)
+    {
+      AttributeMatcher *matcher = gt_array_get(fk->matchers, j);
+      if(matcher->prefix != NULL)
+        gt_free(matcher->prefix);
+      if(matcher->regex != NULL)
+      {
+        regfree(matcher->regex);
+        gt_free(matcher->regex);
+      }
+    }
+    gt_array_delete(fk->matchers);
+    gt_hashmap_delete(fk->values);
+    gt_free(fk->key);
+  }
+  gt_array_delete(stream->keys);
+}
+
+static AttributeFilterKey *
+attribute_filter_stream_get_key(AgnAttributeFilterStream *stream,
+                                const char *key, size_t keylen)
+{
+  GtUword i;
+  for(i = 0; i < gt_array_size(stream->keys); i++)
+  {
+    AttributeFilterKey *fk = gt_array_get(stream->keys, i);
+    if(strlen(fk->key) == keylen && strncmp(fk->key, key, keylen) == 0)
+      return fk;
+  }
+
+  AttributeFilterKey newkey;
+  newkey.key = gt_calloc(keylen + 1, sizeof(char));
+  strncpy(newkey.key, key, keylen);
+  newkey.values = gt_hashmap_new(GT_HASH_STRING, gt_free_func, NULL);
+  newkey.matchers = gt_array_new( sizeof(AttributeMatcher) );
+  gt_array_add(stream->keys, newkey);
+  return gt_array_get_last(stream->keys);
+}
+
+static bool attribute_filter_stream_match(AgnAttributeFilterStream *stream,
+                                          GtFeatureNode *fn)
+{
+  GtUword i, j;
+  for(i = 0; i < gt_array_size(stream->keys); i++)
+  {
+    AttributeFilterKey *fk = gt_array_get(stream->keys, i);
+    const char *value = gt_feature_node_get_attribute(fn, fk->key);
+    if(value == NULL)
+      continue;
+    if(gt_hashmap_get(fk->values, value) != NULL)
+      return true;
+    for(j = 0; j < gt_array_size(fk->matchers); j++)
+    {
+      AttributeMatcher *matcher = gt_array_get(fk->matchers, j);
+      if(attribute_filter_stream_match_value(matcher, value))
+        return true;
+    }
+  }
+  return false;
+}
+
+static bool attribute_filter_stream_match_value(AttributeMatcher *matcher,
+                                                const char *value)
+{
+  if(matcher->type == ATTRIBUTE_MATCH_PREFIX)
+    return strncmp(value, matcher->prefix, matcher->prefixlen) == 0;
+  if(matcher->type == ATTRIBUTE_MATCH_REGEX)
+    return regexec(matcher->regex, value, 0, NULL, 0) == 0;
+
+  char *end;
+  double number = strtod(value, &end);
+  if(end == value || *end != '\0')
+    return false;
+  if(matcher->type == ATTRIBUTE_MATCH_LT)
+    return number < matcher->bound;
+  if(matcher->type == ATTRIBUTE_MATCH_LE)
+    return number <= matcher->bound;
+  if(matcher->type == ATTRIBUTE_MATCH_GT)
+    return number > matcher->bound;
+  return number >= matcher->bound;
 }
 
 static int attribute_filter_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
@@ -139,29 +395,10 @@ static int attribute_filter_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
     GtFeatureNode *current;
     GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
     for(current  = gt_feature_node_iterator_next(iter);
-        current != NULL;
+        current != NULL && !dodelete;
         current  = gt_feature_node_iterator_next(iter))
     {
-      GtStrArray *attrkeys = gt_feature_node_get_attribute_list(current);
-      GtUword i;
-      for(i = 0; i < gt_str_array_size(attrkeys); i++)
-      {
-        const char *key = gt_str_array_get(attrkeys, i);
-        const char *value = gt_feature_node_get_attribute(current, key);
-
-        GtStr *keyvalue = gt_str_new_cstr(key);
-        gt_str_append_char(keyvalue, '=');
-        gt_str_append_cstr(keyvalue, value);
-
-        void *test = gt_hashmap_get(stream->filters, gt_str_get(keyvalue));
-        gt_str_delete(keyvalue);
-        if(test != NULL)
-        {
-          dodelete = true;
-          break;
-        }
-      }
-      gt_str_array_delete(attrkeys);
+      dodelete = attribute_filter_stream_match(stream, current);
     }
     gt_feature_node_iterator_delete(iter);
     if(dodelete)
@@ -173,7 +410,8 @@ static int attribute_filter_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
   return 0;
 }
 
-static void attribute_filter_stream_test_data(GtQueue *queue)
+static void attribute_filter_stream_test_data(GtQueue *queue,
+                                              const char *filter)
 {
   GtNodeStream *current_stream, *last_stream;
   GtQueue *streams = gt_queue_new();
@@ -186,7 +424,7 @@ static void attribute_filter_stream_test_data(GtQueue *queue)
   last_stream = current_stream;
 
   GtHashmap *attrs = gt_hashmap_new(GT_HASH_STRING, gt_free_func, NULL);
-  char *keyvalue = gt_cstr_dup("partial=true");
+  char *keyvalue = gt_cstr_dup(filter);
   gt_hashmap_add(attrs, keyvalue, keyvalue);
   current_stream = agn_attribute_filter_stream_new(last_stream, attrs);
   gt_queue_add(streams, current_stream);
@@ -0,0 +1,241 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include <string.h>
+#include "core/hashmap_api.h"
+#include "core/queue_api.h"
+#include "extended/array_out_stream_api.h"
+#include "extended/feature_node_iterator_api.h"
+#include "AgnAttributePruneStream.h"
+#include "AgnTypecheck.h"
+#include "AgnUtils.h"
+
+//------------------------------------------------------------------------------
+// Data structure definition
+//------------------------------------------------------------------------------
+
+struct AgnAttributePruneStream
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in_stream;
+  GtHashmap *keys2keep;
+};
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+#define attribute_prune_stream_cast(GS)\
+        gt_node_stream_cast(attribute_prune_stream_class(), GS)
+
+/**
+ * @function Implements the GtNodeStream interface for this class.
+ */
+static const GtNodeStreamClass* attribute_prune_stream_class(void);
+
+/**
+ * @function Class destructor.
+ */
+static void attribute_prune_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Pulls nodes from the input stream, removes unwanted attributes
+ * from each feature, and feeds them to the output stream.
+ */
+static int attribute_prune_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                       GtError *error);
+
+/**
+ * @function Remove all attributes not marked to be kept from a single feature.
+ */
+static void attribute_prune_stream_prune(AgnAttributePruneStream *stream,
+                                         GtFeatureNode *fn);
+
+/**
+ * @function Generate data for unit testing: the features of a FlyBase gene,
+ * pruned with the given list of keys.
+ */
+static void attribute_prune_stream_test_data(GtQueue *queue,
+                                             const char *keylist);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream* agn_attribute_prune_stream_new(GtNodeStream *in_stream,
+                                             const char *keylist)
+{
+  GtNodeStream *ns;
+  AgnAttributePruneStream *stream;
+  agn_assert(in_stream);
+  ns = gt_node_stream_create(attribute_prune_stream_class(), false);
+  stream = attribute_prune_stream_cast(ns);
+  stream->in_stream = gt_node_stream_ref(in_stream);
+  stream->keys2keep = gt_hashmap_new(GT_HASH_STRING, gt_free_func, NULL);
+  agn_attribute_prune_stream_keep(stream, "ID");
+  agn_attribute_prune_stream_keep(stream, "Parent");
+  agn_attribute_prune_stream_keep(stream, "Name");
+  agn_attribute_prune_stream_keep(stream, "accession");
+
+  if(keylist != NULL)
+  {
+    char *keys = gt_cstr_dup(keylist);
+    char *key;
+    for(key = strtok(keys, ","); key != NULL; key = strtok(NULL, ","))
+      agn_attribute_prune_stream_keep(stream, key);
+    gt_free(keys);
+  }
+  return ns;
+}
+
+void agn_attribute_prune_stream_keep(AgnAttributePruneStream *stream,
+                                     const char *key)
+{
+  agn_assert(stream && key);
+  if(gt_hashmap_get(stream->keys2keep, key) == NULL)
+  {
+    char *keycopy = gt_cstr_dup(key);
+    gt_hashmap_add(stream->keys2keep, keycopy, keycopy);
+  }
+}
+
+bool agn_attribute_prune_stream_unit_test(AgnUnitTest *test)
+{
+  GtQueue *queue = gt_queue_new();
+  attribute_prune_stream_test_data(queue, NULL);
+  attribute_prune_stream_test_data(queue, "score,Alias");
+  agn_assert(gt_queue_size(queue) == 2);
+
+  GtFeatureNode *gene = gt_queue_get(queue);
+  GtArray *mrnas = agn_typecheck_select(gene, agn_typecheck_mrna);
+  GtFeatureNode *mrna = *(GtFeatureNode **)gt_array_get(mrnas, 0);
+  bool test1 = gt_feature_node_get_attribute(gene, "Name") != NULL &&
+               gt_feature_node_get_attribute(gene, "Alias") == NULL &&
+               gt_feature_node_get_attribute(gene, "Dbxref") == NULL &&
+               gt_feature_node_get_attribute(mrna, "Parent") != NULL &&
+               gt_feature_node_get_attribute(mrna, "score") == NULL;
+  if(test1)
+  {
+    GtStrArray *keys = gt_feature_node_get_attribute_list(mrna);
+    test1 = gt_str_array_size(keys) == 3;
+    gt_str_array_delete(keys);
+  }
+  agn_unit_test_result(test, "default keys", test1);
+  gt_array_delete(mrnas);
+  gt_genome_node_delete((GtGenomeNode *)gene);
+
+  gene = gt_queue_get(queue);
+  mrnas = agn_typecheck_select(gene, agn_typecheck_mrna);
+  mrna = *(GtFeatureNode **)gt_array_get(mrnas, 0);
+  const char *alias = gt_feature_node_get_attribute(gene, "Alias");
+  const char *score = gt_feature_node_get_attribute(mrna, "score");
+  bool test2 = alias != NULL && strcmp(alias, "unnamed") == 0 &&
+               score != NULL && strcmp(score, "7") == 0 &&
+               gt_feature_node_get_attribute(gene, "Dbxref") == NULL &&
+               gt_feature_node_get_attribute(mrna, "score_text") == NULL;
+  agn_unit_test_result(test, "additional keys", test2);
+  gt_array_delete(mrnas);
+  gt_genome_node_delete((GtGenomeNode *)gene);
+
+  gt_queue_delete(queue);
+  return agn_unit_test_success(test);
+}
+
+static const GtNodeStreamClass *attribute_prune_stream_class(void)
+{
+  static const GtNodeStreamClass *nsc = NULL;
+  if(!nsc)
+  {
+    nsc = gt_node_stream_class_new(sizeof (AgnAttributePruneStream),
+                                   attribute_prune_stream_free,
+                                   attribute_prune_stream_next);
+  }
+  return nsc;
+}
+
+static void attribute_prune_stream_free(GtNodeStream *ns)
+{
+  AgnAttributePruneStream *stream = attribute_prune_stream_cast(ns);
+  gt_node_stream_delete(stream->in_stream);
+  gt_hashmap_delete(stream->keys2keep);
+}
+
+static int attribute_prune_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                       GtError *error)
+{
+  AgnAttributePruneStream *stream;
+  GtFeatureNode *fn;
+  int had_err;
+  gt_error_check(error);
+  stream = attribute_prune_stream_cast(ns);
+
+  had_err = gt_node_stream_next(stream->in_stream, gn, error);
+  if(had_err || !*gn)
+    return had_err;
+
+  fn = gt_feature_node_try_cast(*gn);
+  if(!fn)
+    return 0;
+
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+  GtFeatureNode *current;
+  for(current  = gt_feature_node_iterator_next(iter);
+      current != NULL;
+      current  = gt_feature_node_iterator_next(iter))
+  {
+    attribute_prune_stream_prune(stream, current);
+  }
+  gt_feature_node_iterator_delete(iter);
+
+  return 0;
+}
+
+static void attribute_prune_stream_prune(AgnAttributePruneStream *stream,
+                                         GtFeatureNode *fn)
+{
+  GtStrArray *keys = gt_feature_node_get_attribute_list(fn);
+  GtUword i;
+  for(i = 0; i < gt_str_array_size(keys); i++)
+  {
+    const char *key = gt_str_array_get(keys, i);
+    if(gt_hashmap_get(stream->keys2keep, key) == NULL)
+      gt_feature_node_remove_attribute(fn, key);
+  }
+  gt_str_array_delete(keys);
+}
+
+static void attribute_prune_stream_test_data(GtQueue *queue,
+                                             const char *keylist)
+{
+  GtError *error = gt_error_new();
+  const char *infile = "data/gff3/FBgn0035002.gff3";
+  GtNodeStream *gff3in = gt_gff3_in_stream_new_unsorted(1, &infile);
+  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)gff3in);
+  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)gff3in);
+  GtNodeStream *prunestream = agn_attribute_prune_stream_new(gff3in, keylist);
+  GtArray *feats = gt_array_new( sizeof(GtFeatureNode *) );
+  GtNodeStream *arraystream = gt_array_out_stream_new(prunestream, feats,
+                                                      error);
+  int pullresult = gt_node_stream_pull(arraystream, error);
+  if(pullresult == -1)
+  {
+    fprintf(stderr, "[AgnAttributePruneStream::attribute_prune_stream_test_"
+            "data] error processing features: %s\n", gt_error_get(error));
+  }
+  gt_node_stream_delete(gff3in);
+  gt_node_stream_delete(prunestream);
+  gt_node_stream_delete(arraystream);
+  agn_assert(gt_array_size(feats) == 1);
+  gt_queue_add(queue, *(GtFeatureNode **)gt_array_get(feats, 0));
+  gt_array_delete(feats);
+  gt_error_delete(error);
+}
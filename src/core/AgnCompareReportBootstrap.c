@@ -0,0 +1,250 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include <math.h>
+#include <string.h>
+#include "AgnComparison.h"
+#include "AgnCompareReportBootstrap.h"
+#include "AgnLocus.h"
+#include "AgnUtils.h"
+
+#define compare_report_bootstrap_cast(GV)\
+        gt_node_visitor_cast(compare_report_bootstrap_class(), GV)
+
+#define AGN_BOOTSTRAP_NUM_METRICS 15
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+struct AgnCompareReportBootstrap
+{
+  const GtNodeVisitor parent_instance;
+  GtArray *locusstats;
+  GtUword replicates;
+  GtUword seed;
+  GtLogger *logger;
+};
+
+static const char *metric_labels[AGN_BOOTSTRAP_NUM_METRICS] =
+{
+  "CDS structure sensitivity",
+  "CDS structure specificity",
+  "CDS structure F1 score",
+  "Exon structure sensitivity",
+  "Exon structure specificity",
+  "Exon structure F1 score",
+  "UTR structure sensitivity",
+  "UTR structure specificity",
+  "UTR structure F1 score",
+  "CDS nucleotide sensitivity",
+  "CDS nucleotide specificity",
+  "CDS nucleotide F1 score",
+  "CDS nucleotide correlation",
+  "UTR nucleotide F1 score",
+  "Overall matching coefficient",
+};
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Implement the GtNodeVisitor interface.
+ */
+static const GtNodeVisitorClass *compare_report_bootstrap_class();
+
+/**
+ * @function Comparison function for sorting metric values.
+ */
+static int compare_report_bootstrap_double_cmp(const void *p1, const void *p2);
+
+/**
+ * @function Free memory used by this node visitor.
+ */
+static void compare_report_bootstrap_free(GtNodeVisitor *nv);
+
+/**
+ * @function Resolve the given aggregate stats and store the value of each
+ * reported metric in ``values``.
+ */
+static void compare_report_bootstrap_metrics(AgnComparison *stats,
+                                             double *values);
+
+/**
+ * @function Retain the comparison stats of each locus.
+ */
+static int compare_report_bootstrap_visit_feature_node(GtNodeVisitor *nv,
+                                                       GtFeatureNode *fn,
+                                                       GtError *error);
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+void agn_compare_report_bootstrap_create_summary(AgnCompareReportBootstrap *rpt,
+                                                 FILE *outstream)
+{
+  GtUword numloci, i, j, k;
+  double estimate[AGN_BOOTSTRAP_NUM_METRICS];
+  double *values[AGN_BOOTSTRAP_NUM_METRICS];
+  GtUword numvalues[AGN_BOOTSTRAP_NUM_METRICS];
+  AgnComparison stats;
+
+  agn_assert(rpt && outstream);
+  numloci = gt_array_size(rpt->locusstats);
+  if(numloci == 0)
+  {
+    fprintf(outstream, "  No loci sampled; cannot compute confidence "
+            "intervals\n");
+    return;
+  }
+
+  agn_comparison_init(&stats);
+  for(i = 0; i < numloci; i++)
+    agn_comparison_aggregate(&stats, gt_array_get(rpt->locusstats, i));
+  compare_report_bootstrap_metrics(&stats, estimate);
+
+  for(j = 0; j < AGN_BOOTSTRAP_NUM_METRICS; j++)
+  {
+    values[j] = gt_malloc( sizeof(double) * rpt->replicates );
+    numvalues[j] = 0;
+  }
+
+  GtUint64 randstate = agn_rand_seed(rpt->seed);
+  for(k = 0; k < rpt->replicates; k++)
+  {
+    double replicate[AGN_BOOTSTRAP_NUM_METRICS];
+    agn_comparison_init(&stats);
+    for(i = 0; i < numloci; i++)
+    {
+      GtUword index = agn_rand_next(&randstate) * numloci;
+      agn_comparison_aggregate(&stats, gt_array_get(rpt->locusstats, index));
+    }
+    compare_report_bootstrap_metrics(&stats, replicate);
+    for(j = 0; j < AGN_BOOTSTRAP_NUM_METRICS; j++)
+    {
+      if(!isnan(replicate[j]))
+        values[j][numvalues[j]++] = replicate[j];
+    }
+  }
+
+  fprintf(outstream, "  Bootstrap 95%% confidence intervals (%lu loci, %lu "
+          "replicates)\n", numloci, rpt->replicates);
+  fprintf(outstream, "    %-30s %-10s %-10s %-10s\n", "", "Estimate", "Lower",
+          "Upper");
+  for(j = 0; j < AGN_BOOTSTRAP_NUM_METRICS; j++)
+  {
+    char label[64];
+    sprintf(label, "%s:", metric_labels[j]);
+    if(isnan(estimate[j]) || numvalues[j] == 0)
+    {
+      fprintf(outstream, "    %-30s %-10s %-10s %-10s\n", label, "--", "--",
+              "--");
+      gt_free(values[j]);
+      continue;
+    }
+    qsort(values[j], numvalues[j], sizeof(double),
+          compare_report_bootstrap_double_cmp);
+    GtUword lower = floor(0.025 * (numvalues[j] - 1));
+    GtUword upper = ceil(0.975 * (numvalues[j] - 1));
+    fprintf(outstream, "    %-30s %-10.3lf %-10.3lf %-10.3lf\n", label,
+            estimate[j], values[j][lower], values[j][upper]);
+    gt_free(values[j]);
+  }
+  fputs("\n", outstream);
+}
+
+GtNodeVisitor *agn_compare_report_bootstrap_new(GtUword replicates,
+                                                GtUword seed, GtLogger *logger)
+{
+  GtNodeVisitor *nv = gt_node_visitor_create(compare_report_bootstrap_class());
+  AgnCompareReportBootstrap *rpt = compare_report_bootstrap_cast(nv);
+  rpt->locusstats = gt_array_new( sizeof(AgnComparison) );
+  rpt->replicates = replicates;
+  rpt->seed = seed;
+  rpt->logger = logger;
+  return nv;
+}
+
+static const GtNodeVisitorClass *compare_report_bootstrap_class()
+{
+  static const GtNodeVisitorClass *nvc = NULL;
+  if(!nvc)
+  {
+    nvc = gt_node_visitor_class_new(sizeof (AgnCompareReportBootstrap),
+                                    compare_report_bootstrap_free, NULL,
+                                    compare_report_bootstrap_visit_feature_node,
+                                    NULL, NULL, NULL);
+  }
+  return nvc;
+}
+
+static int compare_report_bootstrap_double_cmp(const void *p1, const void *p2)
+{
+  double d1 = *(const double *)p1;
+  double d2 = *(const double *)p2;
+  if(d1 < d2)
+    return -1;
+  if(d1 > d2)
+    return 1;
+  return 0;
+}
+
+static void compare_report_bootstrap_free(GtNodeVisitor *nv)
+{
+  AgnCompareReportBootstrap *rpt;
+  agn_assert(nv);
+
+  rpt = compare_report_bootstrap_cast(nv);
+  gt_array_delete(rpt->locusstats);
+}
+
+static void compare_report_bootstrap_metrics(AgnComparison *stats,
+                                             double *values)
+{
+  agn_comparison_resolve(stats);
+  values[0]  = stats->cds_struc_stats.sn;
+  values[1]  = stats->cds_struc_stats.sp;
+  values[2]  = stats->cds_struc_stats.f1;
+  values[3]  = stats->exon_struc_stats.sn;
+  values[4]  = stats->exon_struc_stats.sp;
+  values[5]  = stats->exon_struc_stats.f1;
+  values[6]  = stats->utr_struc_stats.sn;
+  values[7]  = stats->utr_struc_stats.sp;
+  values[8]  = stats->utr_struc_stats.f1;
+  values[9]  = stats->cds_nuc_stats.sn;
+  values[10] = stats->cds_nuc_stats.sp;
+  values[11] = stats->cds_nuc_stats.f1;
+  values[12] = stats->cds_nuc_stats.cc;
+  values[13] = stats->utr_nuc_stats.f1;
+  values[14] = (double)stats->overall_matches / (double)stats->overall_length;
+}
+
+static int compare_report_bootstrap_visit_feature_node(GtNodeVisitor *nv,
+                                                       GtFeatureNode *fn,
+                                                       GtError *error)
+{
+  AgnCompareReportBootstrap *rpt;
+  AgnLocus *locus;
+  AgnComparison stats;
+
+  gt_error_check(error);
+  agn_assert(nv && fn && gt_feature_node_has_type(fn, "locus"));
+
+  rpt = compare_report_bootstrap_cast(nv);
+  locus = (AgnLocus *)fn;
+  agn_locus_comparative_analysis(locus, rpt->logger);
+  agn_comparison_init(&stats);
+  agn_locus_comparison_aggregate(locus, &stats);
+  gt_array_add(rpt->locusstats, stats);
+
+  return 0;
+}
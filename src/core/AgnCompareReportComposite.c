@@ -0,0 +1,145 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include "AgnCompareReportComposite.h"
+#include "AgnLocus.h"
+
+#define compare_report_composite_cast(GV)\
+        gt_node_visitor_cast(compare_report_composite_class(), GV)
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+struct AgnCompareReportComposite
+{
+  const GtNodeVisitor parent_instance;
+  GtArray *reports;
+  GtLogger *logger;
+};
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Implement the GtNodeVisitor interface.
+ */
+static const GtNodeVisitorClass *compare_report_composite_class();
+
+/**
+ * @function Free memory used by this node visitor and all of its reports.
+ */
+static void compare_report_composite_free(GtNodeVisitor *nv);
+
+/**
+ * @function Compare each locus once, then pass it on to each report.
+ */
+static int compare_report_composite_visit_feature_node(GtNodeVisitor *nv,
+                                                       GtFeatureNode *fn,
+                                                       GtError *error);
+
+/**
+ * @function Pass region nodes on to each report.
+ */
+static int compare_report_composite_visit_region_node(GtNodeVisitor *nv,
+                                                      GtRegionNode *rn,
+                                                      GtError *error);
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+void agn_compare_report_composite_add(AgnCompareReportComposite *rpt,
+                                      GtNodeVisitor *report)
+{
+  agn_assert(rpt && report);
+  gt_array_add(rpt->reports, report);
+}
+
+GtNodeVisitor *agn_compare_report_composite_new(GtLogger *logger)
+{
+  GtNodeVisitor *nv = gt_node_visitor_create(compare_report_composite_class());
+  AgnCompareReportComposite *rpt = compare_report_composite_cast(nv);
+  rpt->reports = gt_array_new( sizeof(GtNodeVisitor *) );
+  rpt->logger = logger;
+  return nv;
+}
+
+static const GtNodeVisitorClass *compare_report_composite_class()
+{
+  static const GtNodeVisitorClass *nvc = NULL;
+  if(!nvc)
+  {
+    nvc = gt_node_visitor_class_new(sizeof (AgnCompareReportComposite),
+                                    compare_report_composite_free, NULL,
+                                    compare_report_composite_visit_feature_node,
+                                    compare_report_composite_visit_region_node,
+                                    NULL, NULL);
+  }
+  return nvc;
+}
+
+static void compare_report_composite_free(GtNodeVisitor *nv)
+{
+  AgnCompareReportComposite *rpt;
+  agn_assert(nv);
+
+  rpt = compare_report_composite_cast(nv);
+  while(gt_array_size(rpt->reports) > 0)
+  {
+    GtNodeVisitor **report = gt_array_pop(rpt->reports);
+    gt_node_visitor_delete(*report);
+  }
+  gt_array_delete(rpt->reports);
+}
+
+static int compare_report_composite_visit_feature_node(GtNodeVisitor *nv,
+                                                       GtFeatureNode *fn,
+                                                       GtError *error)
+{
+  AgnCompareReportComposite *rpt;
+  GtUword i;
+  int had_err = 0;
+
+  gt_error_check(error);
+  agn_assert(nv && fn && gt_feature_node_has_type(fn, "locus"));
+
+  rpt = compare_report_composite_cast(nv);
+  agn_locus_comparative_analysis((AgnLocus *)fn, rpt->logger);
+  for(i = 0; !had_err && i < gt_array_size(rpt->reports); i++)
+  {
+    GtNodeVisitor **report = gt_array_get(rpt->reports, i);
+    had_err = gt_genome_node_accept((GtGenomeNode *)fn, *report, error);
+  }
+
+  return had_err;
+}
+
+static int compare_report_composite_visit_region_node(GtNodeVisitor *nv,
+                                                      GtRegionNode *rn,
+                                                      GtError *error)
+{
+  AgnCompareReportComposite *rpt;
+  GtUword i;
+  int had_err = 0;
+
+  gt_error_check(error);
+  agn_assert(nv && rn);
+
+  rpt = compare_report_composite_cast(nv);
+  for(i = 0; !had_err && i < gt_array_size(rpt->reports); i++)
+  {
+    GtNodeVisitor **report = gt_array_get(rpt->reports, i);
+    had_err = gt_genome_node_accept((GtGenomeNode *)rn, *report, error);
+  }
+
+  return had_err;
+}
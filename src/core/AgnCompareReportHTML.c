@@ -8,7 +8,11 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
 
+#include <errno.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include "core/hashmap_api.h"
 #include "AgnComparison.h"
 #include "AgnCompareReportHTML.h"
@@ -18,6 +22,13 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #define compare_report_html_cast(GV)\
         gt_node_visitor_cast(compare_report_html_class(), GV)
 
+#define AGN_NUM_COMP_CLASSES 6
+
+// Maximum number of loci queued for PNG rendering; the index of each queued
+// locus is written to a pipe before the workers start, so the whole queue must
+// fit in the pipe buffer.
+#define AGN_PNG_QUEUE_SIZE 512
+
 //------------------------------------------------------------------------------
 // Data structure definitions
 //------------------------------------------------------------------------------
@@ -26,12 +37,20 @@ struct AgnCompareReportHTML
 {
   const GtNodeVisitor parent_instance;
   AgnLocusPngMetadata *pngdata;
+#ifndef WITHOUT_CAIRO
+  GtStyle *style;
+#endif
+  GtUword pngworkers;
+  GtArray *pngqueue;
+  AgnLocusPngMetadata *svgdata;
   AgnComparisonData data;
   GtStrArray *seqids;
   const char *outdir;
   GtHashmap *seqdata;
-  GtHashmap *seqlocusdata;
-  GtHashmap *compclassdata;
+  GtStr *seqfileid;
+  FILE *seqfile;
+  FILE *classfiles[AGN_NUM_COMP_CLASSES];
+  GtUword classcounts[AGN_NUM_COMP_CLASSES];
   AgnCompareReportHTMLOverviewFunc ofunc;
   void *ofuncdata;
   GtLogger *logger;
@@ -49,6 +68,18 @@ typedef struct
   GtUword  refrtrans, predtrans;
 } SeqfileLocusData;
 
+static const char *compclass_filenames[AGN_NUM_COMP_CLASSES] =
+{
+  "perfectmatches.html", "mislabeled.html", "cdsmatches.html",
+  "exonmatches.html", "utrmatches.html", "nonmatches.html"
+};
+
+static const char *compclass_labels[AGN_NUM_COMP_CLASSES] =
+{
+  "perfect matches", "perfect matches with mislabeled UTRs", "CDS matches",
+  "exon structure matches", "UTR matches", "non-matches"
+};
+
 //------------------------------------------------------------------------------
 // Prototypes for private functions
 //------------------------------------------------------------------------------
@@ -111,6 +142,30 @@ static void compare_report_html_pair_structure(FILE *outstream,
                                                const char *label,
                                                const char *units);
 
+/**
+ * @function Render the PNG graphics for all queued loci. A fixed pool of worker
+ * processes is started, each of which inherits the loaded style and a snapshot
+ * of the queue, and the workers take locus indices from a shared pipe until it
+ * is empty. The main process then waits for each worker it started.
+ */
+static void compare_report_html_png_flush(AgnCompareReportHTML *rpt);
+
+#ifndef WITHOUT_CAIRO
+/**
+ * @function Render the PNG graphic for the given locus. If multiple workers are
+ * enabled, the locus is queued and the queue is flushed once it is full;
+ * otherwise, the graphic is rendered immediately.
+ */
+static void compare_report_html_png_render(AgnCompareReportHTML *rpt,
+                                           AgnLocus *locus);
+
+/**
+ * @function Worker process loop: render queued loci whose indices are read from
+ * ``fd`` until the pipe is empty.
+ */
+static void compare_report_html_png_worker(AgnCompareReportHTML *rpt, int fd);
+#endif
+
 /**
  * @function List loci according to their comparison class: perfect match, CDS
  * match, etc.
@@ -132,18 +187,28 @@ static void compare_report_html_print_pair(AgnCliquePair *pair, FILE *outstream,
                                            GtUword k, bool collapse, bool gff3);
 
 /**
- * @function Create the sequence-level summary pages.
+ * @function Finalize the sequence-level summary pages: close the page for the
+ * last sequence processed, and create (empty) pages for any sequences with no
+ * loci.
  */
 static void compare_report_html_print_seqfiles(AgnCompareReportHTML *rpt);
 
 /**
- * @function Store informatino about each locus for later use when creating the
- * sequence-level summary pages.
+ * @function Write a row for the given locus to its sequence-level summary page,
+ * and spill a copy of the row to a temporary file for each comparison class
+ * the locus belongs to. Pages are written as loci stream through, so memory
+ * use does not grow with the number of loci.
  */
 static void
 compare_report_html_save_seq_locus_data(AgnCompareReportHTML *rpt,
                                         AgnLocus *locus);
 
+/**
+ * @function Print the footer of the current sequence summary page, if any, and
+ * close it.
+ */
+static void compare_report_html_seqfile_close(AgnCompareReportHTML *rpt);
+
 /**
  * @function The HTML report includes a summary page for each sequence. This
  * function prints the header for that file.
@@ -151,6 +216,12 @@ compare_report_html_save_seq_locus_data(AgnCompareReportHTML *rpt,
 static void compare_report_html_seqfile_header(FILE *outstream,
                                                const char *seqid);
 
+/**
+ * @function Open the summary page for the given sequence and print its header.
+ */
+static void compare_report_html_seqfile_open(AgnCompareReportHTML *rpt,
+                                             const char *seqid);
+
 /**
  * @function The HTML report includes a summary page for each sequence. This
  * function prints the footer for that file.
@@ -206,6 +277,7 @@ static int compare_report_html_visit_region_node(GtNodeVisitor *nv,
 void agn_compare_report_html_create_summary(AgnCompareReportHTML *rpt)
 {
   agn_assert(rpt);
+  compare_report_html_png_flush(rpt);
 
   // Create the output file
   char filename[1024];
@@ -242,27 +314,37 @@ GtNodeVisitor *agn_compare_report_html_new(const char *outdir, bool gff3,
 {
   GtNodeVisitor *nv = gt_node_visitor_create(compare_report_html_class());
   AgnCompareReportHTML *rpt = compare_report_html_cast(nv);
+  GtUword i;
   rpt->pngdata = pngdata;
+  rpt->pngworkers = 1;
+  rpt->pngqueue = gt_array_new(sizeof(AgnLocus *));
+  rpt->svgdata = NULL;
+#ifndef WITHOUT_CAIRO
+  rpt->style = NULL;
+  if(pngdata != NULL)
+  {
+    GtError *error = gt_error_new();
+    rpt->style = gt_style_new(error);
+    if(rpt->style == NULL ||
+       gt_style_load_file(rpt->style, pngdata->stylefile, error))
+    {
+      fprintf(stderr, "error: %s\n", gt_error_get(error));
+      exit(EXIT_FAILURE);
+    }
+    gt_error_delete(error);
+  }
+#endif
   agn_comparison_data_init(&rpt->data);
   rpt->seqids = gt_str_array_new();
   rpt->outdir = outdir;
   rpt->seqdata = gt_hashmap_new(GT_HASH_STRING, gt_free_func, gt_free_func);
-  rpt->seqlocusdata = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
-                                     (GtFree)gt_array_delete);
-  rpt->compclassdata = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
-                                      (GtFree)gt_array_delete);
-  gt_hashmap_add(rpt->compclassdata, gt_cstr_dup("perfect"),
-                 gt_array_new(sizeof(SeqfileLocusData)));
-  gt_hashmap_add(rpt->compclassdata, gt_cstr_dup("mislabeled"),
-                 gt_array_new(sizeof(SeqfileLocusData)));
-  gt_hashmap_add(rpt->compclassdata, gt_cstr_dup("cds"),
-                 gt_array_new(sizeof(SeqfileLocusData)));
-  gt_hashmap_add(rpt->compclassdata, gt_cstr_dup("exon"),
-                 gt_array_new(sizeof(SeqfileLocusData)));
-  gt_hashmap_add(rpt->compclassdata, gt_cstr_dup("utr"),
-                 gt_array_new(sizeof(SeqfileLocusData)));
-  gt_hashmap_add(rpt->compclassdata, gt_cstr_dup("nonmatch"),
-                 gt_array_new(sizeof(SeqfileLocusData)));
+  rpt->seqfileid = gt_str_new();
+  rpt->seqfile = NULL;
+  for(i = 0; i < AGN_NUM_COMP_CLASSES; i++)
+  {
+    rpt->classfiles[i] = NULL;
+    rpt->classcounts[i] = 0;
+  }
   rpt->logger = logger;
   rpt->summary_title = gt_str_new_cstr("ParsEval Summary");
   rpt->gff3 = gff3;
@@ -286,6 +368,20 @@ void agn_compare_report_html_set_overview_func(AgnCompareReportHTML *rpt,
   rpt->ofuncdata = funcdata;
 }
 
+void agn_compare_report_html_set_png_workers(AgnCompareReportHTML *rpt,
+                                             GtUword numworkers)
+{
+  agn_assert(rpt);
+  rpt->pngworkers = numworkers > 0 ? numworkers : 1;
+}
+
+void agn_compare_report_html_set_svg(AgnCompareReportHTML *rpt,
+                                     AgnLocusPngMetadata *svgdata)
+{
+  agn_assert(rpt);
+  rpt->svgdata = svgdata;
+}
+
 static const GtNodeVisitorClass *compare_report_html_class()
 {
   static const GtNodeVisitorClass *nvc = NULL;
@@ -413,33 +509,49 @@ static void compare_report_html_footer(FILE *outstream)
 static void compare_report_html_free(GtNodeVisitor *nv)
 {
   AgnCompareReportHTML *rpt;
+  GtUword i;
   agn_assert(nv);
 
   rpt = compare_report_html_cast(nv);
+  compare_report_html_png_flush(rpt);
+  compare_report_html_seqfile_close(rpt);
+  for(i = 0; i < AGN_NUM_COMP_CLASSES; i++)
+  {
+    if(rpt->classfiles[i] != NULL)
+      fclose(rpt->classfiles[i]);
+  }
+#ifndef WITHOUT_CAIRO
+  if(rpt->style != NULL)
+    gt_style_delete(rpt->style);
+#endif
+  gt_array_delete(rpt->pngqueue);
   gt_str_array_delete(rpt->seqids);
   gt_hashmap_delete(rpt->seqdata);
-  gt_hashmap_delete(rpt->seqlocusdata);
-  gt_hashmap_delete(rpt->compclassdata);
+  gt_str_delete(rpt->seqfileid);
   gt_str_delete(rpt->summary_title);
 }
 
 static void compare_report_html_locus_gene_ids(AgnLocus *locus, FILE *outstream)
 {
   GtUword i;
-  GtArray *refr_genes = agn_locus_refr_gene_ids(locus);
-  GtArray *pred_genes = agn_locus_pred_gene_ids(locus);
+  AgnLocusIter refriter, prediter;
+  agn_locus_iter_init(&refriter, locus, REFERENCESOURCE, AGN_TYPE_GENE);
+  agn_locus_iter_init(&prediter, locus, PREDICTIONSOURCE, AGN_TYPE_GENE);
+  GtFeatureNode *refrgene = agn_locus_iter_next(&refriter);
+  GtFeatureNode *predgene = agn_locus_iter_next(&prediter);
 
   fputs("      <h2>Gene annotations</h2>\n"
         "      <table>\n"
         "        <tr><th>Reference</th><th>Prediction</th></tr>\n",
         outstream);
-  for(i = 0; i < gt_array_size(refr_genes) || i < gt_array_size(pred_genes); i++)
+  for(i = 0; refrgene != NULL || predgene != NULL; i++)
   {
     fputs("        <tr>", outstream);
-    if(i < gt_array_size(refr_genes))
+    if(refrgene != NULL)
     {
-      const char *gid = *(const char **)gt_array_get(refr_genes, i);
+      const char *gid = gt_feature_node_get_attribute(refrgene, "ID");
       fprintf(outstream, "<td>%s</td>", gid);
+      refrgene = agn_locus_iter_next(&refriter);
     }
     else
     {
@@ -447,10 +559,11 @@ static void compare_report_html_locus_gene_ids(AgnLocus *locus, FILE *outstream)
       else       fputs("<td>&nbsp;</td>", outstream);
     }
 
-    if(i < gt_array_size(pred_genes))
+    if(predgene != NULL)
     {
-      const char *gid = *(const char **)gt_array_get(pred_genes, i);
+      const char *gid = gt_feature_node_get_attribute(predgene, "ID");
       fprintf(outstream, "<td>%s</td>", gid);
+      predgene = agn_locus_iter_next(&prediter);
     }
     else
     {
@@ -460,8 +573,6 @@ static void compare_report_html_locus_gene_ids(AgnLocus *locus, FILE *outstream)
     fputs("</tr>\n", outstream);
   }
   fputs("      </table>\n\n", outstream);
-  gt_array_delete(refr_genes);
-  gt_array_delete(pred_genes);
 }
 
 static void compare_report_html_locus_handler(AgnCompareReportHTML *rpt,
@@ -487,10 +598,18 @@ static void compare_report_html_locus_handler(AgnCompareReportHTML *rpt,
   }
 
   compare_report_html_locus_header(locus, outstream);
+  if(rpt->svgdata != NULL)
+  {
+    fputs("      <div class='graphic'>\n", outstream);
+    agn_locus_print_svg(locus, rpt->svgdata, outstream);
+    fputs("      </div>\n\n", outstream);
+  }
 #ifndef WITHOUT_CAIRO
-  if(rpt->pngdata != NULL)
+  else if(rpt->pngdata != NULL)
   {
-    agn_locus_print_png(locus, rpt->pngdata);
+    // The page only refers to the graphic by name, so it can be written while
+    // the graphic is still being rendered.
+    compare_report_html_png_render(rpt, locus);
     fprintf(outstream,
             "      <div class='graphic'>\n"
             "        <a href='%s_%lu-%lu.png'><img src='%s_%lu-%lu.png' /></a>\n"
@@ -708,142 +827,137 @@ static void compare_report_html_pair_structure(FILE *outstream,
 
 
 
-static void compare_report_html_print_compclassfiles(AgnCompareReportHTML *rpt)
+static void compare_report_html_png_flush(AgnCompareReportHTML *rpt)
 {
-  GtArray *compclassdata;
-  GtUword i;
+#ifndef WITHOUT_CAIRO
+  GtUword i, numloci = gt_array_size(rpt->pngqueue);
+  if(numloci == 0)
+    return;
 
-  compclassdata = gt_hashmap_get(rpt->compclassdata, "perfect");
-  if(gt_array_size(compclassdata) > 0)
+  GtUword numworkers = rpt->pngworkers < numloci ? rpt->pngworkers : numloci;
+  pid_t *workers = gt_malloc(sizeof(pid_t) * numworkers);
+  GtUword numstarted = 0;
+  int fds[2];
+  if(pipe(fds) == 0)
   {
-    char filename[AGN_MAX_FILENAME_SIZE];
-    sprintf(filename, "%s/perfectmatches.html", rpt->outdir);
-    FILE *outstream = fopen(filename, "w");
-    if(!outstream)
+    // Queue every index and close the write end before starting the workers,
+    // so that each worker sees end-of-file once the queue has been drained.
+    bool queued = true;
+    for(i = 0; i < numloci && queued; i++)
+      queued = write(fds[1], &i, sizeof(GtUword)) == sizeof(GtUword);
+    close(fds[1]);
+    while(queued && numstarted < numworkers)
     {
-      fprintf(stderr, "error: unable to open %s\n", filename);
-      exit(1);
+      pid_t pid = fork();
+      if(pid == 0)
+        compare_report_html_png_worker(rpt, fds[0]);
+      if(pid < 0)
+        break;
+      workers[numstarted++] = pid;
     }
-    compare_report_html_compclass_header(outstream, "perfect matches");
-
-    for(i = 0; i < gt_array_size(compclassdata); i++)
-    {
-      SeqfileLocusData *data = gt_array_get(compclassdata, i);
-      compare_report_html_print_locus_to_seqfile(data, true, outstream);
-    }
-    compare_report_html_seqfile_footer(outstream);
-    fclose(outstream);
+    close(fds[0]);
   }
 
-  compclassdata = gt_hashmap_get(rpt->compclassdata, "mislabeled");
-  if(gt_array_size(compclassdata) > 0)
+  bool success = true;
+  for(i = 0; i < numstarted; i++)
   {
-    char filename[AGN_MAX_FILENAME_SIZE];
-    sprintf(filename, "%s/mislabeled.html", rpt->outdir);
-    FILE *outstream = fopen(filename, "w");
-    if(!outstream)
+    int status;
+    while(waitpid(workers[i], &status, 0) < 0)
     {
-      fprintf(stderr, "error: unable to open %s\n", filename);
-      exit(1);
-    }
-    compare_report_html_compclass_header(outstream, "perfect matches with "
-                                         "mislabeled UTRs");
-
-    for(i = 0; i < gt_array_size(compclassdata); i++)
-    {
-      SeqfileLocusData *data = gt_array_get(compclassdata, i);
-      compare_report_html_print_locus_to_seqfile(data, true, outstream);
+      if(errno != EINTR)
+      {
+        fprintf(stderr, "error: could not wait for PNG worker: %s\n",
+                strerror(errno));
+        exit(1);
+      }
     }
-    compare_report_html_seqfile_footer(outstream);
-    fclose(outstream);
+    if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+      success = false;
   }
-
-  compclassdata = gt_hashmap_get(rpt->compclassdata, "cds");
-  if(gt_array_size(compclassdata) > 0)
+  gt_free(workers);
+  if(!success)
   {
-    char filename[AGN_MAX_FILENAME_SIZE];
-    sprintf(filename, "%s/cdsmatches.html", rpt->outdir);
-    FILE *outstream = fopen(filename, "w");
-    if(!outstream)
-    {
-      fprintf(stderr, "error: unable to open %s\n", filename);
-      exit(1);
-    }
-    compare_report_html_compclass_header(outstream, "CDS matches");
-
-    for(i = 0; i < gt_array_size(compclassdata); i++)
-    {
-      SeqfileLocusData *data = gt_array_get(compclassdata, i);
-      compare_report_html_print_locus_to_seqfile(data, true, outstream);
-    }
-    compare_report_html_seqfile_footer(outstream);
-    fclose(outstream);
+    fprintf(stderr, "error: PNG worker failed\n");
+    exit(1);
   }
 
-  compclassdata = gt_hashmap_get(rpt->compclassdata, "exon");
-  if(gt_array_size(compclassdata) > 0)
+  if(numstarted == 0)
   {
-    char filename[AGN_MAX_FILENAME_SIZE];
-    sprintf(filename, "%s/exonmatches.html", rpt->outdir);
-    FILE *outstream = fopen(filename, "w");
-    if(!outstream)
-    {
-      fprintf(stderr, "error: unable to open %s\n", filename);
-      exit(1);
-    }
-    compare_report_html_compclass_header(outstream, "exon matches");
-
-    for(i = 0; i < gt_array_size(compclassdata); i++)
-    {
-      SeqfileLocusData *data = gt_array_get(compclassdata, i);
-      compare_report_html_print_locus_to_seqfile(data, true, outstream);
-    }
-    compare_report_html_seqfile_footer(outstream);
-    fclose(outstream);
+    gt_logger_log(rpt->logger, "warning: could not start PNG workers; "
+                  "rendering in the main process");
+  }
+  for(i = 0; i < numloci; i++)
+  {
+    AgnLocus *locus = *(AgnLocus **)gt_array_get(rpt->pngqueue, i);
+    if(numstarted == 0)
+      agn_locus_print_png_with_style(locus, rpt->pngdata, rpt->style);
+    gt_genome_node_delete(locus);
   }
+  gt_array_reset(rpt->pngqueue);
+#endif
+}
 
-  compclassdata = gt_hashmap_get(rpt->compclassdata, "utr");
-  if(gt_array_size(compclassdata) > 0)
+#ifndef WITHOUT_CAIRO
+static void compare_report_html_png_render(AgnCompareReportHTML *rpt,
+                                           AgnLocus *locus)
+{
+  if(rpt->pngworkers <= 1)
   {
-    char filename[AGN_MAX_FILENAME_SIZE];
-    sprintf(filename, "%s/utrmatches.html", rpt->outdir);
-    FILE *outstream = fopen(filename, "w");
-    if(!outstream)
-    {
-      fprintf(stderr, "error: unable to open %s\n", filename);
-      exit(1);
-    }
-    compare_report_html_compclass_header(outstream, "UTR matches");
+    agn_locus_print_png_with_style(locus, rpt->pngdata, rpt->style);
+    return;
+  }
 
-    for(i = 0; i < gt_array_size(compclassdata); i++)
-    {
-      SeqfileLocusData *data = gt_array_get(compclassdata, i);
-      compare_report_html_print_locus_to_seqfile(data, true, outstream);
-    }
-    compare_report_html_seqfile_footer(outstream);
-    fclose(outstream);
+  gt_genome_node_ref(locus);
+  gt_array_add(rpt->pngqueue, locus);
+  if(gt_array_size(rpt->pngqueue) >= AGN_PNG_QUEUE_SIZE)
+    compare_report_html_png_flush(rpt);
+}
+
+static void compare_report_html_png_worker(AgnCompareReportHTML *rpt, int fd)
+{
+  GtUword locusindex;
+  ssize_t bytes;
+  while((bytes = read(fd, &locusindex, sizeof(GtUword))) != 0)
+  {
+    if(bytes < 0 && errno == EINTR)
+      continue;
+    if(bytes != sizeof(GtUword) ||
+       locusindex >= gt_array_size(rpt->pngqueue))
+      _exit(1);
+    AgnLocus *locus = *(AgnLocus **)gt_array_get(rpt->pngqueue, locusindex);
+    agn_locus_print_png_with_style(locus, rpt->pngdata, rpt->style);
   }
+  _exit(0);
+}
+#endif
+
+static void compare_report_html_print_compclassfiles(AgnCompareReportHTML *rpt)
+{
+  SeqfileLocusData data;
+  GtUword i;
 
-  compclassdata = gt_hashmap_get(rpt->compclassdata, "nonmatch");
-  if(gt_array_size(compclassdata) > 0)
+  for(i = 0; i < AGN_NUM_COMP_CLASSES; i++)
   {
+    if(rpt->classcounts[i] == 0)
+      continue;
+
     char filename[AGN_MAX_FILENAME_SIZE];
-    sprintf(filename, "%s/nonmatches.html", rpt->outdir);
+    sprintf(filename, "%s/%s", rpt->outdir, compclass_filenames[i]);
     FILE *outstream = fopen(filename, "w");
     if(!outstream)
     {
       fprintf(stderr, "error: unable to open %s\n", filename);
       exit(1);
     }
-    compare_report_html_compclass_header(outstream, "non-matches");
+    compare_report_html_compclass_header(outstream, compclass_labels[i]);
 
-    for(i = 0; i < gt_array_size(compclassdata); i++)
-    {
-      SeqfileLocusData *data = gt_array_get(compclassdata, i);
-      compare_report_html_print_locus_to_seqfile(data, true, outstream);
-    }
+    rewind(rpt->classfiles[i]);
+    while(fread(&data, sizeof(SeqfileLocusData), 1, rpt->classfiles[i]) == 1)
+      compare_report_html_print_locus_to_seqfile(&data, true, outstream);
     compare_report_html_seqfile_footer(outstream);
     fclose(outstream);
+    fclose(rpt->classfiles[i]);
+    rpt->classfiles[i] = NULL;
   }
 }
 
@@ -961,29 +1075,18 @@ static void compare_report_html_print_pair(AgnCliquePair *pair, FILE *outstream,
 
 static void compare_report_html_print_seqfiles(AgnCompareReportHTML *rpt)
 {
-  GtUword i, j;
+  GtUword i;
+
+  compare_report_html_seqfile_close(rpt);
   for(i = 0; i < gt_str_array_size(rpt->seqids); i++)
   {
     const char *seqid = gt_str_array_get(rpt->seqids, i);
-    char seqfilename[AGN_MAX_FILENAME_SIZE];
-    sprintf(seqfilename, "%s/%s/index.html", rpt->outdir, seqid);
-    FILE *outstream = fopen(seqfilename, "w");
-    if(!outstream)
-    {
-      fprintf(stderr, "error: unable to open %s\n", seqfilename);
-      exit(1);
-    }
-    compare_report_html_seqfile_header(outstream, seqid);
+    AgnComparisonData *seqdat = gt_hashmap_get(rpt->seqdata, seqid);
+    if(seqdat->info.num_loci > 0)
+      continue;
 
-    GtArray *sld = gt_hashmap_get(rpt->seqlocusdata, seqid);
-    agn_assert(sld);
-    for(j = 0; j < gt_array_size(sld); j++)
-    {
-      SeqfileLocusData *data = gt_array_get(sld, j);
-      compare_report_html_print_locus_to_seqfile(data, false, outstream);
-    }
-    compare_report_html_seqfile_footer(outstream);
-    fclose(outstream);
+    compare_report_html_seqfile_open(rpt, seqid);
+    compare_report_html_seqfile_close(rpt);
   }
 }
 
@@ -992,7 +1095,7 @@ compare_report_html_save_seq_locus_data(AgnCompareReportHTML *rpt,
                                         AgnLocus *locus)
 {
   SeqfileLocusData data;
-  GtArray *pairs2report, *seqlocusdata;
+  GtArray *pairs2report;
   GtStr *seqid;
   GtUword i;
 
@@ -1024,42 +1127,54 @@ compare_report_html_save_seq_locus_data(AgnCompareReportHTML *rpt,
     else agn_assert(false);
   }
 
-  seqlocusdata = gt_hashmap_get(rpt->seqlocusdata, gt_str_get(seqid));
-  gt_array_add(seqlocusdata, data);
-
-  GtArray *ccdata;
-  if(data.numperfect > 0)
-  {
-    ccdata = gt_hashmap_get(rpt->compclassdata, "perfect");
-    gt_array_add(ccdata, data);
-  }
-  if(data.nummislabeled > 0)
-  {
-    ccdata = gt_hashmap_get(rpt->compclassdata, "mislabeled");
-    gt_array_add(ccdata, data);
-  }
-  if(data.numcdsmatch > 0)
-  {
-    ccdata = gt_hashmap_get(rpt->compclassdata, "cds");
-    gt_array_add(ccdata, data);
-  }
-  if(data.numexonmatch > 0)
+  if(strcmp(gt_str_get(rpt->seqfileid), gt_str_get(seqid)) != 0)
   {
-    ccdata = gt_hashmap_get(rpt->compclassdata, "exon");
-    gt_array_add(ccdata, data);
+    compare_report_html_seqfile_close(rpt);
+    compare_report_html_seqfile_open(rpt, gt_str_get(seqid));
   }
-  if(data.numutrmatch > 0)
+  compare_report_html_print_locus_to_seqfile(&data, false, rpt->seqfile);
+
+  unsigned classnums[AGN_NUM_COMP_CLASSES] =
   {
-    ccdata = gt_hashmap_get(rpt->compclassdata, "utr");
-    gt_array_add(ccdata, data);
-  }
-  if(data.numnonmatch > 0)
+    data.numperfect, data.nummislabeled, data.numcdsmatch, data.numexonmatch,
+    data.numutrmatch, data.numnonmatch
+  };
+  for(i = 0; i < AGN_NUM_COMP_CLASSES; i++)
   {
-    ccdata = gt_hashmap_get(rpt->compclassdata, "nonmatch");
-    gt_array_add(ccdata, data);
+    if(classnums[i] == 0)
+      continue;
+
+    if(rpt->classfiles[i] == NULL)
+    {
+      rpt->classfiles[i] = tmpfile();
+      if(rpt->classfiles[i] == NULL)
+      {
+        fprintf(stderr, "error: unable to create temporary file for %s\n",
+                compclass_filenames[i]);
+        exit(1);
+      }
+    }
+    if(fwrite(&data, sizeof(SeqfileLocusData), 1, rpt->classfiles[i]) != 1)
+    {
+      fprintf(stderr, "error: unable to write temporary file for %s\n",
+              compclass_filenames[i]);
+      exit(1);
+    }
+    rpt->classcounts[i]++;
   }
 }
 
+static void compare_report_html_seqfile_close(AgnCompareReportHTML *rpt)
+{
+  if(rpt->seqfile == NULL)
+    return;
+
+  compare_report_html_seqfile_footer(rpt->seqfile);
+  fclose(rpt->seqfile);
+  rpt->seqfile = NULL;
+  gt_str_reset(rpt->seqfileid);
+}
+
 static void compare_report_html_seqfile_header(FILE *outstream,
                                                const char *seqid)
 {
@@ -1118,6 +1233,21 @@ static void compare_report_html_seqfile_footer(FILE *outstream)
   fputs("</html>\n", outstream);
 }
 
+static void compare_report_html_seqfile_open(AgnCompareReportHTML *rpt,
+                                             const char *seqid)
+{
+  char seqfilename[AGN_MAX_FILENAME_SIZE];
+  sprintf(seqfilename, "%s/%s/index.html", rpt->outdir, seqid);
+  rpt->seqfile = fopen(seqfilename, "w");
+  if(!rpt->seqfile)
+  {
+    fprintf(stderr, "error: unable to open %s\n", seqfilename);
+    exit(1);
+  }
+  gt_str_set(rpt->seqfileid, seqid);
+  compare_report_html_seqfile_header(rpt->seqfile, seqid);
+}
+
 static void compare_report_html_summary_annot(AgnCompInfo *info,
                                               FILE *outstream)
 {
@@ -1397,16 +1527,12 @@ static int compare_report_html_visit_region_node(GtNodeVisitor *nv,
   agn_comparison_data_init(data);
   gt_hashmap_add(rpt->seqdata, (char *)seqid, data);
 
-  GtArray *sld = gt_array_new( sizeof(SeqfileLocusData) );
-  agn_assert(sld);
-  gt_hashmap_add(rpt->seqlocusdata, gt_cstr_dup(seqid), sld);
-
-  char seqdircmd[AGN_MAX_FILENAME_SIZE];
-  sprintf(seqdircmd, "mkdir %s/%s", rpt->outdir, seqid);
-  if(system(seqdircmd))
+  char seqdir[AGN_MAX_FILENAME_SIZE];
+  sprintf(seqdir, "%s/%s", rpt->outdir, seqid);
+  if(mkdir(seqdir, 0755) != 0 && errno != EEXIST)
   {
-    fprintf(stderr, "error: could not create directory %s/%s\n", rpt->outdir,
-            seqid);
+    fprintf(stderr, "error: could not create directory %s: %s\n", seqdir,
+            strerror(errno));
     exit(1);
   }
 
@@ -0,0 +1,399 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+
+#include <math.h>
+#include <string.h>
+#include "AgnComparison.h"
+#include "AgnCompareReportTSV.h"
+#include "AgnLocus.h"
+
+#define compare_report_tsv_cast(GV)\
+        gt_node_visitor_cast(compare_report_tsv_class(), GV)
+
+// Rows are accumulated in memory and written to the output stream whenever the
+// buffer grows beyond this many bytes.
+#define AGN_TSV_BUFFER_SIZE 4194304
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+struct AgnCompareReportTSV
+{
+  const GtNodeVisitor parent_instance;
+  GtStr *buffer;
+  FILE *outstream;
+  GtLogger *logger;
+};
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Implement the GtNodeVisitor interface.
+ */
+static const GtNodeVisitorClass *compare_report_tsv_class();
+
+/**
+ * @function Return a short label for the given comparison classification.
+ */
+static const char *compare_report_tsv_class_label(AgnCompClassification c);
+
+/**
+ * @function Append the IDs of all transcripts in the given clique to the
+ * buffer, separated by commas.
+ */
+static void compare_report_tsv_clique_ids(AgnCompareReportTSV *rpt,
+                                          AgnTranscriptClique *clique);
+
+/**
+ * @function Free memory used by this node visitor.
+ */
+static void compare_report_tsv_free(GtNodeVisitor *nv);
+
+/**
+ * @function Append a floating point value to the buffer, or `NA` if the value
+ * is undefined.
+ */
+static void compare_report_tsv_float(AgnCompareReportTSV *rpt, double value);
+
+/**
+ * @function Write the column headers to the buffer.
+ */
+static void compare_report_tsv_header(AgnCompareReportTSV *rpt);
+
+/**
+ * @function Append the locus coordinates (first three columns) to the buffer.
+ */
+static void compare_report_tsv_locus(AgnCompareReportTSV *rpt,
+                                     AgnLocus *locus);
+
+/**
+ * @function Write one row for each clique pair and each unmatched clique
+ * associated with the given locus.
+ */
+static void compare_report_tsv_locus_handler(AgnCompareReportTSV *rpt,
+                                             AgnLocus *locus);
+
+/**
+ * @function Write a row for the given clique pair.
+ */
+static void compare_report_tsv_pair(AgnCompareReportTSV *rpt,
+                                    AgnLocus *locus, AgnCliquePair *pair);
+
+/**
+ * @function Append feature-level structure comparison stats to the buffer.
+ */
+static void compare_report_tsv_stats_binary(AgnCompareReportTSV *rpt,
+                                            AgnCompStatsBinary *stats);
+
+/**
+ * @function Append nucleotide-level comparison stats to the buffer.
+ */
+static void compare_report_tsv_stats_scaled(AgnCompareReportTSV *rpt,
+                                            AgnCompStatsScaled *stats);
+
+/**
+ * @function Write a row for a clique that has no counterpart in the other
+ * annotation source.
+ */
+static void compare_report_tsv_unmatched(AgnCompareReportTSV *rpt,
+                                         AgnLocus *locus,
+                                         AgnTranscriptClique *clique,
+                                         bool isrefr);
+
+/**
+ * @function Append an unsigned integer value to the buffer.
+ */
+static void compare_report_tsv_uword(AgnCompareReportTSV *rpt, GtUword value);
+
+/**
+ * @function Process feature nodes.
+ */
+static int compare_report_tsv_visit_feature_node(GtNodeVisitor *nv,
+                                                 GtFeatureNode *fn,
+                                                 GtError *error);
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+void agn_compare_report_tsv_flush(AgnCompareReportTSV *rpt)
+{
+  agn_assert(rpt);
+  if(gt_str_length(rpt->buffer) > 0)
+  {
+    fwrite(gt_str_get(rpt->buffer), sizeof(char), gt_str_length(rpt->buffer),
+           rpt->outstream);
+    gt_str_reset(rpt->buffer);
+  }
+  fflush(rpt->outstream);
+}
+
+GtNodeVisitor *agn_compare_report_tsv_new(FILE *outstream, GtLogger *logger)
+{
+  agn_assert(outstream);
+  GtNodeVisitor *nv = gt_node_visitor_create(compare_report_tsv_class());
+  AgnCompareReportTSV *rpt = compare_report_tsv_cast(nv);
+  rpt->buffer = gt_str_new();
+  rpt->outstream = outstream;
+  rpt->logger = logger;
+  compare_report_tsv_header(rpt);
+
+  return nv;
+}
+
+static const GtNodeVisitorClass *compare_report_tsv_class()
+{
+  static const GtNodeVisitorClass *nvc = NULL;
+  if(!nvc)
+  {
+    nvc = gt_node_visitor_class_new(sizeof (AgnCompareReportTSV),
+                                    compare_report_tsv_free, NULL,
+                                    compare_report_tsv_visit_feature_node,
+                                    NULL, NULL, NULL);
+  }
+  return nvc;
+}
+
+static const char *compare_report_tsv_class_label(AgnCompClassification c)
+{
+  switch(c)
+  {
+    case AGN_COMP_CLASS_PERFECT_MATCH: return "perfect";
+    case AGN_COMP_CLASS_MISLABELED:    return "mislabeled";
+    case AGN_COMP_CLASS_CDS_MATCH:     return "cds";
+    case AGN_COMP_CLASS_EXON_MATCH:    return "exon";
+    case AGN_COMP_CLASS_UTR_MATCH:     return "utr";
+    case AGN_COMP_CLASS_NON_MATCH:     return "nonmatch";
+    default:                           return "unclassified";
+  }
+}
+
+static void compare_report_tsv_clique_ids(AgnCompareReportTSV *rpt,
+                                          AgnTranscriptClique *clique)
+{
+  GtUword i;
+  GtArray *ids = agn_transcript_clique_ids(clique);
+  for(i = 0; i < gt_array_size(ids); i++)
+  {
+    const char *id = *(const char **)gt_array_get(ids, i);
+    if(i > 0)
+      gt_str_append_char(rpt->buffer, ',');
+    gt_str_append_cstr(rpt->buffer, id);
+  }
+  gt_array_delete(ids);
+}
+
+static void compare_report_tsv_free(GtNodeVisitor *nv)
+{
+  AgnCompareReportTSV *rpt;
+  agn_assert(nv);
+
+  rpt = compare_report_tsv_cast(nv);
+  if(gt_str_length(rpt->buffer) > 0)
+    agn_compare_report_tsv_flush(rpt);
+  gt_str_delete(rpt->buffer);
+}
+
+static void compare_report_tsv_float(AgnCompareReportTSV *rpt, double value)
+{
+  char numstr[32];
+  if(isnan(value) || isinf(value))
+    sprintf(numstr, "\tNA");
+  else
+    sprintf(numstr, "\t%.4lf", value);
+  gt_str_append_cstr(rpt->buffer, numstr);
+}
+
+static void compare_report_tsv_header(AgnCompareReportTSV *rpt)
+{
+  const char *labels[] = { "cds_struc", "exon_struc", "utr_struc" };
+  const char *nuclabels[] = { "cds_nuc", "utr_nuc" };
+  const char *binfields[] = { "correct", "missing", "wrong", "sn", "sp", "f1",
+                              "ed" };
+  const char *scafields[] = { "tp", "fn", "fp", "tn", "mc", "cc", "sn", "sp",
+                              "f1", "ed" };
+  GtUword i, j;
+
+  gt_str_append_cstr(rpt->buffer, "seqid\tstart\tend\tclass\trefr_transcripts"
+                                  "\tpred_transcripts");
+  for(i = 0; i < 3; i++)
+  {
+    for(j = 0; j < 7; j++)
+    {
+      gt_str_append_char(rpt->buffer, '\t');
+      gt_str_append_cstr(rpt->buffer, labels[i]);
+      gt_str_append_char(rpt->buffer, '_');
+      gt_str_append_cstr(rpt->buffer, binfields[j]);
+    }
+  }
+  for(i = 0; i < 2; i++)
+  {
+    for(j = 0; j < 10; j++)
+    {
+      gt_str_append_char(rpt->buffer, '\t');
+      gt_str_append_cstr(rpt->buffer, nuclabels[i]);
+      gt_str_append_char(rpt->buffer, '_');
+      gt_str_append_cstr(rpt->buffer, scafields[j]);
+    }
+  }
+  gt_str_append_cstr(rpt->buffer, "\toverall_matches\toverall_length\n");
+}
+
+static void compare_report_tsv_locus(AgnCompareReportTSV *rpt,
+                                     AgnLocus *locus)
+{
+  GtRange range = gt_genome_node_get_range(locus);
+  GtStr *seqid = gt_genome_node_get_seqid(locus);
+  gt_str_append_str(rpt->buffer, seqid);
+  compare_report_tsv_uword(rpt, range.start);
+  compare_report_tsv_uword(rpt, range.end);
+}
+
+static void compare_report_tsv_locus_handler(AgnCompareReportTSV *rpt,
+                                             AgnLocus *locus)
+{
+  GtArray *pairs2report, *unique;
+  GtUword i;
+
+  // Loci with only reference or only prediction transcripts have no pairs,
+  // but their cliques are still reported as unmatched.
+  pairs2report = agn_locus_pairs_to_report(locus);
+  for(i = 0; pairs2report != NULL && i < gt_array_size(pairs2report); i++)
+  {
+    AgnCliquePair *pair = *(AgnCliquePair **)gt_array_get(pairs2report, i);
+    compare_report_tsv_pair(rpt, locus, pair);
+  }
+
+  unique = agn_locus_get_unique_refr_cliques(locus);
+  for(i = 0; unique != NULL && i < gt_array_size(unique); i++)
+  {
+    AgnTranscriptClique **clique = gt_array_get(unique, i);
+    compare_report_tsv_unmatched(rpt, locus, *clique, true);
+  }
+
+  unique = agn_locus_get_unique_pred_cliques(locus);
+  for(i = 0; unique != NULL && i < gt_array_size(unique); i++)
+  {
+    AgnTranscriptClique **clique = gt_array_get(unique, i);
+    compare_report_tsv_unmatched(rpt, locus, *clique, false);
+  }
+
+  if(gt_str_length(rpt->buffer) >= AGN_TSV_BUFFER_SIZE)
+  {
+    fwrite(gt_str_get(rpt->buffer), sizeof(char), gt_str_length(rpt->buffer),
+           rpt->outstream);
+    gt_str_reset(rpt->buffer);
+  }
+}
+
+static void compare_report_tsv_pair(AgnCompareReportTSV *rpt,
+                                    AgnLocus *locus, AgnCliquePair *pair)
+{
+  AgnComparison *stats = agn_clique_pair_get_stats(pair);
+  AgnCompClassification c = agn_clique_pair_classify(pair);
+
+  compare_report_tsv_locus(rpt, locus);
+  gt_str_append_char(rpt->buffer, '\t');
+  gt_str_append_cstr(rpt->buffer, compare_report_tsv_class_label(c));
+  gt_str_append_char(rpt->buffer, '\t');
+  compare_report_tsv_clique_ids(rpt, agn_clique_pair_get_refr_clique(pair));
+  gt_str_append_char(rpt->buffer, '\t');
+  compare_report_tsv_clique_ids(rpt, agn_clique_pair_get_pred_clique(pair));
+
+  compare_report_tsv_stats_binary(rpt, &stats->cds_struc_stats);
+  compare_report_tsv_stats_binary(rpt, &stats->exon_struc_stats);
+  compare_report_tsv_stats_binary(rpt, &stats->utr_struc_stats);
+  compare_report_tsv_stats_scaled(rpt, &stats->cds_nuc_stats);
+  compare_report_tsv_stats_scaled(rpt, &stats->utr_nuc_stats);
+  compare_report_tsv_uword(rpt, stats->overall_matches);
+  compare_report_tsv_uword(rpt, stats->overall_length);
+  gt_str_append_char(rpt->buffer, '\n');
+}
+
+static void compare_report_tsv_stats_binary(AgnCompareReportTSV *rpt,
+                                            AgnCompStatsBinary *stats)
+{
+  compare_report_tsv_uword(rpt, stats->correct);
+  compare_report_tsv_uword(rpt, stats->missing);
+  compare_report_tsv_uword(rpt, stats->wrong);
+  compare_report_tsv_float(rpt, stats->sn);
+  compare_report_tsv_float(rpt, stats->sp);
+  compare_report_tsv_float(rpt, stats->f1);
+  compare_report_tsv_float(rpt, stats->ed);
+}
+
+static void compare_report_tsv_stats_scaled(AgnCompareReportTSV *rpt,
+                                            AgnCompStatsScaled *stats)
+{
+  compare_report_tsv_uword(rpt, stats->tp);
+  compare_report_tsv_uword(rpt, stats->fn);
+  compare_report_tsv_uword(rpt, stats->fp);
+  compare_report_tsv_uword(rpt, stats->tn);
+  compare_report_tsv_float(rpt, stats->mc);
+  compare_report_tsv_float(rpt, stats->cc);
+  compare_report_tsv_float(rpt, stats->sn);
+  compare_report_tsv_float(rpt, stats->sp);
+  compare_report_tsv_float(rpt, stats->f1);
+  compare_report_tsv_float(rpt, stats->ed);
+}
+
+static void compare_report_tsv_unmatched(AgnCompareReportTSV *rpt,
+                                         AgnLocus *locus,
+                                         AgnTranscriptClique *clique,
+                                         bool isrefr)
+{
+  GtUword i;
+
+  compare_report_tsv_locus(rpt, locus);
+  if(isrefr)
+  {
+    gt_str_append_cstr(rpt->buffer, "\tunmatched_refr\t");
+    compare_report_tsv_clique_ids(rpt, clique);
+    gt_str_append_cstr(rpt->buffer, "\tNA");
+  }
+  else
+  {
+    gt_str_append_cstr(rpt->buffer, "\tunmatched_pred\tNA\t");
+    compare_report_tsv_clique_ids(rpt, clique);
+  }
+
+  // 3 x 7 structure stats, 2 x 10 nucleotide stats, 2 overall counts
+  for(i = 0; i < 43; i++)
+    gt_str_append_cstr(rpt->buffer, "\tNA");
+  gt_str_append_char(rpt->buffer, '\n');
+}
+
+static void compare_report_tsv_uword(AgnCompareReportTSV *rpt, GtUword value)
+{
+  char numstr[32];
+  sprintf(numstr, "\t%lu", value);
+  gt_str_append_cstr(rpt->buffer, numstr);
+}
+
+static int compare_report_tsv_visit_feature_node(GtNodeVisitor *nv,
+                                                 GtFeatureNode *fn,
+                                                 GtError *error)
+{
+  AgnCompareReportTSV *rpt;
+  AgnLocus *locus;
+
+  gt_error_check(error);
+  agn_assert(nv && fn && gt_feature_node_has_type(fn, "locus"));
+
+  rpt = compare_report_tsv_cast(nv);
+  locus = (AgnLocus *)fn;
+  agn_locus_comparative_analysis(locus, rpt->logger);
+  compare_report_tsv_locus_handler(rpt, locus);
+
+  return 0;
+}
@@ -339,27 +339,28 @@ static double gaeval_visitor_calculate_integrity(AgnGaevalVisitor *v,
   }
   gt_array_delete(overlapping);
 
-  GtUword utr5p_len = agn_mrna_5putr_length(genemodel);
+  AgnTypeCensus census;
+  agn_typecheck_census(genemodel, &census);
+
+  GtUword utr5p_len = census.utr5p.length;
   double utr5p_score = 0.0;
   if(utr5p_len >= v->params.exp_5putr_len)
     utr5p_score = 1.0;
   else
     utr5p_score = (double)utr5p_len / (double)v->params.exp_5putr_len;
 
-  GtUword utr3p_len = agn_mrna_3putr_length(genemodel);
+  GtUword utr3p_len = census.utr3p.length;
   double utr3p_score = 0.0;
   if(utr3p_len >= v->params.exp_3putr_len)
     utr3p_score = 1.0;
   else
     utr3p_score = (double)utr3p_len / (double)v->params.exp_3putr_len;
 
-  GtArray *introns = agn_typecheck_select(genemodel, agn_typecheck_intron);
-  GtUword exoncount = agn_typecheck_count(genemodel, agn_typecheck_exon);
-  agn_assert(gt_array_size(introns) == exoncount - 1);
+  agn_assert(census.intron.count == census.exon.count - 1);
   double structure_score = 0.0;
-  if(gt_array_size(introns) == 0)
+  if(census.intron.count == 0)
   {
-    GtUword cdslen = agn_mrna_cds_length(genemodel);
+    GtUword cdslen = census.cds.length;
     if(cdslen >= v->params.exp_cds_len)
       structure_score = 1.0;
     else
@@ -367,10 +368,11 @@ static double gaeval_visitor_calculate_integrity(AgnGaevalVisitor *v,
   }
   else
   {
+    GtArray *introns = agn_typecheck_select(genemodel, agn_typecheck_intron);
     structure_score = gaeval_visitor_introns_confirmed(introns, gaps);
+    gt_array_delete(introns);
   }
   gt_array_delete(gaps);
-  gt_array_delete(introns);
 
   double integrity = (v->params.alpha   * structure_score) +
                      (v->params.beta    * coverage)        +
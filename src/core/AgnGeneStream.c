@@ -7,13 +7,15 @@ the 'LICENSE' file in the AEGeAn source code distribution or
 online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
+#include <string.h>
 #include "core/hashmap_api.h"
 #include "core/logger_api.h"
 #include "core/queue_api.h"
 #include "AgnFilterStream.h"
 #include "AgnGeneStream.h"
 #include "AgnInferCDSVisitor.h"
-#include "AgnInferExonsVisitor.h"
+#include "AgnInferStructureVisitor.h"
+#include "AgnParallelVisitorStream.h"
 #include "AgnUtils.h"
 #include "AgnTypecheck.h"
 
@@ -29,6 +31,7 @@ struct AgnGeneStream
   GtNodeStream *in_stream;
   GtQueue *streams;
   GtLogger *logger;
+  GtArray *loggers;
   GtStr *source;
 };
 
@@ -47,6 +50,13 @@ static const GtNodeStreamClass* gene_stream_class(void);
  */
 static void gene_stream_free(GtNodeStream *ns);
 
+/**
+ * @function Create a structure inference visitor for one worker thread of a
+ * parallel visitor stream, logging to ``outstream``.
+ */
+static GtNodeVisitor *gene_stream_infer_structure_visitor(FILE *outstream,
+                                                          void *data);
+
 /**
  * @function Pulls nodes from the input stream and feeds them to the output
  * stream if they pass validation.
@@ -54,9 +64,17 @@ static void gene_stream_free(GtNodeStream *ns);
 static int gene_stream_next(GtNodeStream *ns, GtGenomeNode **gn,GtError *error);
 
 /**
- * @function Generate data for unit testing.
+ * @function Generate data for unit testing: the genes in ``file``, processed
+ * with ``numthreads`` worker threads.
  */
-static void gene_stream_test_data(GtQueue *queue);
+static void gene_stream_test_data(GtQueue *queue, const char *file,
+                                  GtUword numthreads);
+
+/**
+ * @function Create a logger for one worker thread, writing to ``outstream``.
+ */
+static GtLogger *gene_stream_worker_logger(AgnGeneStream *stream,
+                                           FILE *outstream);
 
 
 //------------------------------------------------------------------------------
@@ -65,6 +83,13 @@ static void gene_stream_test_data(GtQueue *queue);
 
 
 GtNodeStream* agn_gene_stream_new(GtNodeStream *in_stream, GtLogger *logger)
+{
+  return agn_gene_stream_new_parallel(in_stream, logger, 1);
+}
+
+GtNodeStream* agn_gene_stream_new_parallel(GtNodeStream *in_stream,
+                                           GtLogger *logger,
+                                           GtUword numthreads)
 {
   GtNodeStream *ns, *current_stream, *last_stream;
   AgnGeneStream *stream;
@@ -73,20 +98,34 @@ GtNodeStream* agn_gene_stream_new(GtNodeStream *in_stream, GtLogger *logger)
   ns = gt_node_stream_create(gene_stream_class(), false);
   stream = gene_stream_cast(ns);
   stream->logger = logger;
+  stream->loggers = gt_array_new( sizeof(GtLogger *) );
   stream->streams = gt_queue_new();
   stream->source = NULL;
   gt_queue_add(stream->streams, gt_node_stream_ref(in_stream));
   last_stream = in_stream;
 
-  current_stream = agn_infer_cds_stream_new(last_stream, stream->source,
-                                            logger);
-  gt_queue_add(stream->streams, current_stream);
-  last_stream = current_stream;
-
-  current_stream = agn_infer_exons_stream_new(last_stream, stream->source,
-                                              logger);
-  gt_queue_add(stream->streams, current_stream);
-  last_stream = current_stream;
+  if(numthreads <= 1)
+  {
+    GtNodeVisitor *nv = agn_infer_structure_visitor_new(logger);
+    agn_infer_structure_visitor_store_census((AgnInferStructureVisitor *)nv);
+    current_stream = gt_visitor_stream_new(last_stream, nv);
+    gt_queue_add(stream->streams, current_stream);
+    last_stream = current_stream;
+  }
+  else
+  {
+    // Each worker logs to its own buffer, so messages are reported in order.
+    FILE *logstream = gt_logger_target(logger);
+    current_stream = agn_parallel_visitor_stream_new(last_stream, numthreads,
+                                           gene_stream_infer_structure_visitor,
+                                           stream, logstream);
+    gt_queue_add(stream->streams, current_stream);
+    last_stream = current_stream;
+
+    current_stream = agn_infer_cds_id_stream_new(last_stream);
+    gt_queue_add(stream->streams, current_stream);
+    last_stream = current_stream;
+  }
 
   GtHashmap *typestokeep = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
                                           gt_free_func);
@@ -111,7 +150,7 @@ void agn_gene_stream_set_source(AgnGeneStream *gs, GtStr *source)
 bool agn_gene_stream_unit_test(AgnUnitTest *test)
 {
   GtQueue *queue = gt_queue_new();
-  gene_stream_test_data(queue);
+  gene_stream_test_data(queue, "data/gff3/gene-stream-data.gff3", 1);
   agn_assert(gt_queue_size(queue) == 4);
 
   GtFeatureNode *fn = gt_queue_get(queue);
@@ -172,8 +211,51 @@ bool agn_gene_stream_unit_test(AgnUnitTest *test)
   agn_unit_test_result(test, "mRNA boundaries", test4);
   gt_genome_node_delete((GtGenomeNode *)fn);
   gt_array_delete(mrnas);
-
   gt_queue_delete(queue);
+
+  // CDS features and their IDs are inferred in parallel and then numbered in
+  // order; results must not depend on the number of threads.
+  GtQueue *serial = gt_queue_new();
+  GtQueue *parallel = gt_queue_new();
+  gene_stream_test_data(serial, "data/gff3/grape-codons.gff3", 1);
+  gene_stream_test_data(parallel, "data/gff3/grape-codons.gff3", 3);
+  bool test5 = gt_queue_size(serial) == 4 &&
+               gt_queue_size(serial) == gt_queue_size(parallel);
+  while(gt_queue_size(serial) > 0 && gt_queue_size(parallel) > 0)
+  {
+    GtFeatureNode *fn1 = gt_queue_get(serial);
+    GtFeatureNode *fn2 = gt_queue_get(parallel);
+    GtArray *cds1 = agn_typecheck_select(fn1, agn_typecheck_cds);
+    GtArray *cds2 = agn_typecheck_select(fn2, agn_typecheck_cds);
+    GtRange range1 = gt_genome_node_get_range((GtGenomeNode *)fn1);
+    GtRange range2 = gt_genome_node_get_range((GtGenomeNode *)fn2);
+    test5 = test5 && gt_range_compare(&range1, &range2) == 0 &&
+            gt_array_size(cds1) > 0 &&
+            gt_array_size(cds1) == gt_array_size(cds2);
+    GtUword i;
+    for(i = 0; test5 && i < gt_array_size(cds1); i++)
+    {
+      GtFeatureNode *c1 = *(GtFeatureNode **)gt_array_get(cds1, i);
+      GtFeatureNode *c2 = *(GtFeatureNode **)gt_array_get(cds2, i);
+      const char *id1 = gt_feature_node_get_attribute(c1, "ID");
+      const char *id2 = gt_feature_node_get_attribute(c2, "ID");
+      range1 = gt_genome_node_get_range((GtGenomeNode *)c1);
+      range2 = gt_genome_node_get_range((GtGenomeNode *)c2);
+      test5 = id1 != NULL && id2 != NULL && strcmp(id1, id2) == 0 &&
+              gt_range_compare(&range1, &range2) == 0;
+    }
+    gt_array_delete(cds1);
+    gt_array_delete(cds2);
+    gt_genome_node_delete((GtGenomeNode *)fn1);
+    gt_genome_node_delete((GtGenomeNode *)fn2);
+  }
+  while(gt_queue_size(serial) > 0)
+    gt_genome_node_delete(gt_queue_get(serial));
+  while(gt_queue_size(parallel) > 0)
+    gt_genome_node_delete(gt_queue_get(parallel));
+  agn_unit_test_result(test, "parallel inference, CDS IDs", test5);
+  gt_queue_delete(serial);
+  gt_queue_delete(parallel);
   return agn_unit_test_success(test);
 }
 
@@ -200,6 +282,24 @@ static void gene_stream_free(GtNodeStream *ns)
   gt_queue_delete(stream->streams);
   if(stream->source != NULL)
     gt_str_delete(stream->source);
+  while(gt_array_size(stream->loggers) > 0)
+  {
+    GtLogger **logger = gt_array_pop(stream->loggers);
+    gt_logger_delete(*logger);
+  }
+  gt_array_delete(stream->loggers);
+}
+
+static GtNodeVisitor *gene_stream_infer_structure_visitor(FILE *outstream,
+                                                          void *data)
+{
+  AgnGeneStream *stream = data;
+  GtLogger *logger = gene_stream_worker_logger(stream, outstream);
+  GtNodeVisitor *nv = agn_infer_structure_visitor_new(logger);
+  AgnInferStructureVisitor *v = (AgnInferStructureVisitor *)nv;
+  agn_infer_structure_visitor_defer_ids(v);
+  agn_infer_structure_visitor_store_census(v);
+  return nv;
 }
 
 static int gene_stream_next(GtNodeStream *ns, GtGenomeNode **gn, GtError *error)
@@ -238,23 +338,31 @@ static int gene_stream_next(GtNodeStream *ns, GtGenomeNode **gn, GtError *error)
         continue;
       }
 
-      GtArray *cds     = agn_typecheck_select(current, agn_typecheck_cds);
-      GtArray *exons   = agn_typecheck_select(current, agn_typecheck_exon);
-      GtArray *introns = agn_typecheck_select(current, agn_typecheck_intron);
+      // Use the census stored during inference if there is one.
+      AgnTypeCensus census;
+      GtGenomeNode *mrnagn = (GtGenomeNode *)current;
+      AgnTypeCensus *stored = gt_genome_node_get_user_data(mrnagn, "census");
+      if(stored != NULL)
+      {
+        census = *stored;
+        gt_genome_node_release_user_data(mrnagn, "census");
+      }
+      else
+        agn_typecheck_census(current, &census);
 
       bool keepmrna = true;
-      if(gt_array_size(cds) < 1)
+      if(census.cds.count < 1)
       {
         const char *mrnaid = agn_feature_node_get_label(current);
         gt_logger_log(stream->logger, "ignoring mRNA '%s': no CDS", mrnaid);
         keepmrna = false;
       }
-      if(gt_array_size(exons) != gt_array_size(introns) + 1)
+      if(census.exon.count != census.intron.count + 1)
       {
         const char *mrnaid = agn_feature_node_get_label(current);
         gt_logger_log(stream->logger, "error: mRNA '%s' has %lu exons but "
-                      "%lu introns", mrnaid, gt_array_size(exons),
-                      gt_array_size(introns));
+                      "%lu introns", mrnaid, census.exon.count,
+                      census.intron.count);
         keepmrna = false;
       }
 
@@ -272,10 +380,6 @@ static int gene_stream_next(GtNodeStream *ns, GtGenomeNode **gn, GtError *error)
         num_valid_mrnas++;
       else
         gt_queue_add(invalid_transcripts, current);
-
-      gt_array_delete(cds);
-      gt_array_delete(exons);
-      gt_array_delete(introns);
     }
     gt_feature_node_iterator_delete(iter);
     while(gt_queue_size(invalid_transcripts) > 0)
@@ -299,10 +403,10 @@ static int gene_stream_next(GtNodeStream *ns, GtGenomeNode **gn, GtError *error)
   return 0;
 }
 
-static void gene_stream_test_data(GtQueue *queue)
+static void gene_stream_test_data(GtQueue *queue, const char *file,
+                                  GtUword numthreads)
 {
   GtError *error = gt_error_new();
-  const char *file = "data/gff3/gene-stream-data.gff3";
   GtNodeStream *gff3in = gt_gff3_in_stream_new_unsorted(1, &file);
   gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)gff3in);
   gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)gff3in);
@@ -313,7 +417,8 @@ static void gene_stream_test_data(GtQueue *queue)
             "/dev/null");
   }
   GtLogger *logger = gt_logger_new(true, "", log);
-  GtNodeStream *stream = agn_gene_stream_new(gff3in, logger);
+  GtNodeStream *stream = agn_gene_stream_new_parallel(gff3in, logger,
+                                                      numthreads);
   GtArray *feats = gt_array_new( sizeof(GtFeatureNode *) );
   GtNodeStream *arraystream = gt_array_out_stream_new(stream, feats, error);
   int pullresult = gt_node_stream_pull(arraystream, error);
@@ -338,3 +443,12 @@ static void gene_stream_test_data(GtQueue *queue)
   gt_array_delete(feats);
   gt_error_delete(error);
 }
+
+static GtLogger *gene_stream_worker_logger(AgnGeneStream *stream,
+                                           FILE *outstream)
+{
+  bool enabled = gt_logger_enabled(stream->logger) && outstream != NULL;
+  GtLogger *logger = gt_logger_new(enabled, "", outstream);
+  gt_array_add(stream->loggers, logger);
+  return logger;
+}
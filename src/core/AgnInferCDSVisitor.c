@@ -7,6 +7,7 @@ the 'LICENSE' file in the AEGeAn source code distribution or
 online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
+#include <string.h>
 #include "core/array_api.h"
 #include "AgnFilterStream.h"
 #include "AgnInferCDSVisitor.h"
@@ -16,6 +17,9 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #define infer_cds_visitor_cast(GV)\
         gt_node_visitor_cast(infer_cds_visitor_class(), GV)
 
+#define infer_cds_id_visitor_cast(GV)\
+        gt_node_visitor_cast(infer_cds_id_visitor_class(), GV)
+
 //------------------------------------------------------------------------------
 // Data structure definitions
 //------------------------------------------------------------------------------
@@ -30,10 +34,18 @@ struct AgnInferCDSVisitor
   GtArray *starts;
   GtArray *stops;
   GtUword cdscounter;
+  bool deferids;
+  AgnTypeGroups groups;
   GtLogger *logger;
   GtStr *source;
 };
 
+typedef struct
+{
+  const GtNodeVisitor parent_instance;
+  GtUword cdscounter;
+} InferCDSIdVisitor;
+
 
 //------------------------------------------------------------------------------
 // Prototypes for private functions
@@ -74,6 +86,20 @@ static const GtNodeVisitorClass *infer_cds_visitor_class();
  */
 static void infer_cds_visitor_free(GtNodeVisitor *ns);
 
+/**
+ * @function Implement the interface to the GtNodeVisitor class for the ID
+ * assignment visitor.
+ */
+static const GtNodeVisitorClass *infer_cds_id_visitor_class();
+
+/**
+ * @function Assign an ID to the representative of each discontinuous CDS that
+ * lacks one, visiting mRNAs in the same order as the inference visitor.
+ */
+static int infer_cds_id_visitor_visit_feature_node(GtNodeVisitor *nv,
+                                                   GtFeatureNode *fn,
+                                                   GtError *error);
+
 /**
  * @function Infer CDS for any mRNAs that have none specified but have exons and
  * start/stop codons explicitly specified.
@@ -124,6 +150,20 @@ static int infer_cds_visitor_visit_feature_node(GtNodeVisitor *nv,
 // Method implementations
 //------------------------------------------------------------------------------
 
+void agn_infer_cds_visitor_defer_ids(AgnInferCDSVisitor *v)
+{
+  agn_assert(v);
+  v->deferids = true;
+}
+
+GtNodeStream* agn_infer_cds_id_stream_new(GtNodeStream *in)
+{
+  GtNodeVisitor *nv = gt_node_visitor_create(infer_cds_id_visitor_class());
+  InferCDSIdVisitor *v = infer_cds_id_visitor_cast(nv);
+  v->cdscounter = 0;
+  return gt_visitor_stream_new(in, nv);
+}
+
 GtNodeStream* agn_infer_cds_stream_new(GtNodeStream *in, GtStr *source,
                                        GtLogger *logger)
 {
@@ -142,6 +182,8 @@ GtNodeVisitor *agn_infer_cds_visitor_new(GtLogger *logger)
   AgnInferCDSVisitor *v = infer_cds_visitor_cast(nv);
   v->logger = logger;
   v->cdscounter = 0;
+  v->deferids = false;
+  memset(&v->groups, 0, sizeof(AgnTypeGroups));
   v->source = NULL;
   return nv;
 }
@@ -224,6 +266,30 @@ bool agn_infer_cds_visitor_unit_test(AgnUnitTest *test)
   return agn_unit_test_success(test);
 }
 
+void agn_infer_cds_visitor_visit_mrna(AgnInferCDSVisitor *v,
+                                      GtFeatureNode *mrna,
+                                      AgnTypeGroups *groups)
+{
+  agn_assert(v && mrna && groups);
+  v->mrna   = mrna;
+  v->cds    = groups->cds;
+  v->utrs   = groups->utrs;
+  v->exons  = groups->exons;
+  v->starts = groups->start_codons;
+  v->stops  = groups->stop_codons;
+
+  infer_cds_visitor_infer_cds(v);
+  infer_cds_visitor_check_start(v);
+  infer_cds_visitor_check_stop(v);
+  infer_cds_visitor_infer_utrs(v);
+  infer_cds_visitor_check_cds_multi(v);
+  infer_cds_visitor_check_cds_phase(v);
+  infer_cds_visitor_set_utrs(v);
+
+  v->mrna = NULL;
+  v->cds = v->utrs = v->exons = v->starts = v->stops = NULL;
+}
+
 static void infer_cds_visitor_check_cds_multi(AgnInferCDSVisitor *v)
 {
   if(gt_array_size(v->cds) <= 1)
@@ -233,7 +299,7 @@ static void infer_cds_visitor_check_cds_multi(AgnInferCDSVisitor *v)
 
   GtFeatureNode **firstsegment = gt_array_get(v->cds, 0);
   const char *id = gt_feature_node_get_attribute(*firstsegment, "ID");
-  if(id == NULL)
+  if(id == NULL && !v->deferids)
   {
     char newid[64];
     sprintf(newid, "CDS%lu", v->cdscounter++);
@@ -418,9 +484,62 @@ static const GtNodeVisitorClass *infer_cds_visitor_class()
   return nvc;
 }
 
+static const GtNodeVisitorClass *infer_cds_id_visitor_class()
+{
+  static const GtNodeVisitorClass *nvc = NULL;
+  if(!nvc)
+  {
+    nvc = gt_node_visitor_class_new(sizeof (InferCDSIdVisitor), NULL, NULL,
+                                    infer_cds_id_visitor_visit_feature_node,
+                                    NULL, NULL, NULL);
+  }
+  return nvc;
+}
+
+static int infer_cds_id_visitor_visit_feature_node(GtNodeVisitor *nv,
+                                                   GtFeatureNode *fn,
+                                                   GtError *error)
+{
+  InferCDSIdVisitor *v = infer_cds_id_visitor_cast(nv);
+  gt_error_check(error);
+
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+  GtFeatureNode *current;
+  for(current  = gt_feature_node_iterator_next(iter);
+      current != NULL;
+      current  = gt_feature_node_iterator_next(iter))
+  {
+    if(!agn_typecheck_mrna(current))
+      continue;
+
+    GtFeatureNodeIterator *subiter = gt_feature_node_iterator_new(current);
+    GtFeatureNode *cds;
+    for(cds  = gt_feature_node_iterator_next(subiter);
+        cds != NULL;
+        cds  = gt_feature_node_iterator_next(subiter))
+    {
+      if(!agn_typecheck_cds(cds) || !gt_feature_node_is_multi(cds) ||
+         gt_feature_node_get_multi_representative(cds) != cds)
+        continue;
+      if(gt_feature_node_get_attribute(cds, "ID") == NULL)
+      {
+        char newid[64];
+        sprintf(newid, "CDS%lu", v->cdscounter++);
+        gt_feature_node_add_attribute(cds, "ID", newid);
+      }
+      break;
+    }
+    gt_feature_node_iterator_delete(subiter);
+  }
+  gt_feature_node_iterator_delete(iter);
+
+  return 0;
+}
+
 static void infer_cds_visitor_free(GtNodeVisitor *nv)
 {
   AgnInferCDSVisitor *v = infer_cds_visitor_cast(nv);
+  agn_typecheck_groups_free(&v->groups);
   if(v->source)
     gt_str_delete(v->source);
 }
@@ -688,27 +807,8 @@ static int infer_cds_visitor_visit_feature_node(GtNodeVisitor *nv,
     if(!agn_typecheck_mrna(current))
       continue;
 
-    v->cds    = agn_typecheck_select(current, agn_typecheck_cds);
-    v->utrs   = agn_typecheck_select(current, agn_typecheck_utr);
-    v->exons  = agn_typecheck_select(current, agn_typecheck_exon);
-    v->starts = agn_typecheck_select(current, agn_typecheck_start_codon);
-    v->stops  = agn_typecheck_select(current, agn_typecheck_stop_codon);
-    v->mrna   = current;
-
-    infer_cds_visitor_infer_cds(v);
-    infer_cds_visitor_check_start(v);
-    infer_cds_visitor_check_stop(v);
-    infer_cds_visitor_infer_utrs(v);
-    infer_cds_visitor_check_cds_multi(v);
-    infer_cds_visitor_check_cds_phase(v);
-    infer_cds_visitor_set_utrs(v);
-
-    v->mrna = NULL;
-    gt_array_delete(v->cds);
-    gt_array_delete(v->utrs);
-    gt_array_delete(v->exons);
-    gt_array_delete(v->starts);
-    gt_array_delete(v->stops);
+    agn_typecheck_group(current, &v->groups);
+    agn_infer_cds_visitor_visit_mrna(v, current, &v->groups);
   }
   gt_feature_node_iterator_delete(iter);
 
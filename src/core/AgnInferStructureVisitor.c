@@ -0,0 +1,841 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include <string.h>
+#include "core/array_api.h"
+#include "core/hashmap_api.h"
+#include "extended/feature_node_iterator_api.h"
+#include "AgnInferCDSVisitor.h"
+#include "AgnInferExonsVisitor.h"
+#include "AgnInferStructureVisitor.h"
+#include "AgnTypecheck.h"
+#include "AgnUtils.h"
+
+#define infer_structure_visitor_cast(GV)\
+        gt_node_visitor_cast(infer_structure_visitor_class(), GV)
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+typedef struct
+{
+  GtFeatureNode *transcript;
+  AgnTypeGroups groups;
+} StructureTranscript;
+
+struct AgnInferStructureVisitor
+{
+  const GtNodeVisitor parent_instance;
+  GtNodeVisitor *cdsvisitor;
+  GtArray *transcripts;
+  GtUword numtranscripts;
+  GtHashmap *transcriptindex;
+  GtArray *units;
+  GtArray *members;
+  GtArray *inferred;
+  bool storecensus;
+  GtLogger *logger;
+  GtStr *source;
+};
+
+typedef struct
+{
+  GtUword start;
+  GtUword end;
+  const char *parent;
+} StructureTestFeature;
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Implement the interface to the GtNodeVisitor class.
+ */
+static const GtNodeVisitorClass *infer_structure_visitor_class();
+
+/**
+ * @function If a feature with the given range was already inferred for another
+ * mRNA of the same gene, associate it with ``mrna`` as well instead of
+ * creating a duplicate feature. Returns the feature, or NULL if there is none.
+ */
+static GtFeatureNode *
+infer_structure_visitor_collapse_feature(AgnInferStructureVisitor *v,
+                                         GtFeatureNode *mrna, GtRange *range);
+
+/**
+ * @function Destructor.
+ */
+static void infer_structure_visitor_free(GtNodeVisitor *nv);
+
+/**
+ * @function Infer exons from the CDS and UTR segments of each mRNA of the
+ * current gene or transcript. ``numexons`` is the number of exons the gene
+ * had, and is incremented for each exon created.
+ */
+static void infer_structure_visitor_infer_exons(AgnInferStructureVisitor *v,
+                                                GtUword *numexons);
+
+/**
+ * @function Infer introns from the exons of each mRNA of the current gene or
+ * transcript.
+ */
+static void infer_structure_visitor_infer_introns(AgnInferStructureVisitor *v);
+
+/**
+ * @function Store the census of the given transcript as user data.
+ */
+static void infer_structure_visitor_store_census(StructureTranscript *t);
+
+/**
+ * @function Generate data for unit testing: the nodes of ``filename``
+ * processed either by this visitor (if ``fused`` is true) or by a CDS
+ * inference visitor followed by an exon inference visitor.
+ */
+static void infer_structure_visitor_test_data(GtArray *nodes,
+                                              const char *filename,
+                                              bool fused);
+
+/**
+ * @function Check that the distinct features of the given ``type`` in
+ * ``nodes`` are exactly those listed in ``expected``, with the same
+ * coordinates and Parent attribute. A feature shared by several mRNAs must be
+ * a single node whose Parent lists all of them.
+ */
+static bool
+infer_structure_visitor_test_expected(GtArray *nodes, const char *type,
+                                      const StructureTestFeature *expected,
+                                      GtUword numexpected);
+
+/**
+ * @function Identify the transcripts associated with this top-level feature,
+ * collect their subfeatures, and apply the inference procedures.
+ */
+static int infer_structure_visitor_visit_feature_node(GtNodeVisitor *nv,
+                                                      GtFeatureNode *fn,
+                                                      GtError *error);
+
+/**
+ * @function Infer the exons and introns of the transcripts of a single gene
+ * (or of a single transcript), and check that exons do not overlap.
+ */
+static int infer_structure_visitor_visit_unit(AgnInferStructureVisitor *v,
+                                              GtFeatureNode *unit,
+                                              GtError *error);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream* agn_infer_structure_stream_new(GtNodeStream *in, GtStr *source,
+                                             GtLogger *logger)
+{
+  GtNodeVisitor *nv = agn_infer_structure_visitor_new(logger);
+  if(source != NULL)
+  {
+    agn_infer_structure_visitor_set_source((AgnInferStructureVisitor *)nv,
+                                           source);
+  }
+  return gt_visitor_stream_new(in, nv);
+}
+
+void agn_infer_structure_visitor_defer_ids(AgnInferStructureVisitor *v)
+{
+  agn_assert(v && v->cdsvisitor);
+  agn_infer_cds_visitor_defer_ids((AgnInferCDSVisitor *)v->cdsvisitor);
+}
+
+void agn_infer_structure_visitor_disable_cds(AgnInferStructureVisitor *v)
+{
+  agn_assert(v);
+  if(v->cdsvisitor != NULL)
+  {
+    gt_node_visitor_delete(v->cdsvisitor);
+    v->cdsvisitor = NULL;
+  }
+}
+
+GtNodeVisitor *agn_infer_structure_visitor_new(GtLogger *logger)
+{
+  GtNodeVisitor *nv;
+  nv = gt_node_visitor_create(infer_structure_visitor_class());
+  AgnInferStructureVisitor *v = infer_structure_visitor_cast(nv);
+  v->cdsvisitor = agn_infer_cds_visitor_new(logger);
+  v->transcripts = gt_array_new( sizeof(StructureTranscript) );
+  v->numtranscripts = 0;
+  v->transcriptindex = gt_hashmap_new(GT_HASH_DIRECT, NULL, NULL);
+  v->units = gt_array_new( sizeof(GtFeatureNode *) );
+  v->members = gt_array_new( sizeof(StructureTranscript *) );
+  v->inferred = gt_array_new( sizeof(GtFeatureNode *) );
+  v->storecensus = false;
+  v->logger = logger;
+  v->source = NULL;
+  return nv;
+}
+
+void agn_infer_structure_visitor_set_source(AgnInferStructureVisitor *v,
+                                            GtStr *source)
+{
+  agn_assert(v && source);
+  if(v->source != NULL)
+    gt_str_delete(v->source);
+  v->source = gt_str_ref(source);
+  if(v->cdsvisitor != NULL)
+  {
+    agn_infer_cds_visitor_set_source((AgnInferCDSVisitor *)v->cdsvisitor,
+                                     source);
+  }
+}
+
+void agn_infer_structure_visitor_store_census(AgnInferStructureVisitor *v)
+{
+  agn_assert(v);
+  v->storecensus = true;
+}
+
+bool agn_infer_structure_visitor_unit_test(AgnUnitTest *test)
+{
+  const char *files[] = { "data/gff3/grape-codons.gff3",
+                          "data/gff3/grape-utrs.gff3",
+                          "data/gff3/gene-stream-data.gff3" };
+  const char *labels[] = { "codons", "UTRs", "gene stream data" };
+  GtUword i, j;
+  for(i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+  {
+    GtArray *fused = gt_array_new( sizeof(GtGenomeNode *) );
+    GtArray *chained = gt_array_new( sizeof(GtGenomeNode *) );
+    infer_structure_visitor_test_data(fused, files[i], true);
+    infer_structure_visitor_test_data(chained, files[i], false);
+
+    bool structuretest = gt_array_size(fused) > 0 &&
+                         gt_array_size(fused) == gt_array_size(chained);
+    bool censustest = structuretest;
+    for(j = 0; structuretest && j < gt_array_size(fused); j++)
+    {
+      GtGenomeNode *gn1 = *(GtGenomeNode **)gt_array_get(fused, j);
+      GtGenomeNode *gn2 = *(GtGenomeNode **)gt_array_get(chained, j);
+      GtFeatureNode *fn1 = gt_feature_node_try_cast(gn1);
+      GtFeatureNode *fn2 = gt_feature_node_try_cast(gn2);
+      structuretest = (fn1 == NULL) == (fn2 == NULL);
+      if(!structuretest || fn1 == NULL)
+        continue;
+
+      AgnTypeCensus census1, census2;
+      agn_typecheck_census(fn1, &census1);
+      agn_typecheck_census(fn2, &census2);
+      structuretest = memcmp(&census1, &census2, sizeof(AgnTypeCensus)) == 0;
+
+      GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn1);
+      GtFeatureNode *current;
+      for(current  = gt_feature_node_iterator_next(iter);
+          current != NULL;
+          current  = gt_feature_node_iterator_next(iter))
+      {
+        if(!agn_typecheck_mrna(current))
+          continue;
+        AgnTypeCensus *stored = gt_genome_node_get_user_data(
+                                    (GtGenomeNode *)current, "census");
+        agn_typecheck_census(current, &census1);
+        censustest = censustest && stored != NULL &&
+                     memcmp(stored, &census1, sizeof(AgnTypeCensus)) == 0;
+      }
+      gt_feature_node_iterator_delete(iter);
+    }
+
+    char label[64];
+    sprintf(label, "%s: CDS inference", labels[i]);
+    agn_unit_test_result(test, label, structuretest);
+    sprintf(label, "%s: stored census", labels[i]);
+    agn_unit_test_result(test, label, structuretest && censustest);
+
+    for(j = 0; j < gt_array_size(fused); j++)
+      gt_genome_node_delete(*(GtGenomeNode **)gt_array_get(fused, j));
+    for(j = 0; j < gt_array_size(chained); j++)
+      gt_genome_node_delete(*(GtGenomeNode **)gt_array_get(chained, j));
+    gt_array_delete(fused);
+    gt_array_delete(chained);
+  }
+
+  // Exons and introns are checked against fixed coordinates, since exon
+  // inference is implemented by this class alone.
+  StructureTestFeature utrexons[] = {
+    {    72,   167, "chr8.g1.t1" }, {   349,   522, "chr8.g1.t1" },
+    {   611,   702, "chr8.g1.t1" }, {  4916,  5081, "chr8.g1.t1" },
+    { 10538, 11678, "chr8.g2.t1" }, { 22053, 22550, "chr8.g3.t1" },
+    { 22651, 23448, "chr8.g3.t1" }, { 26493, 26709, "chr8.g4.t1" },
+    { 26811, 26898, "chr8.g4.t1" }, { 27014, 27073, "chr8.g4.t1" },
+    { 27515, 27547, "chr8.g4.t1" }, { 27626, 27703, "chr8.g4.t1" },
+    { 27795, 27838, "chr8.g4.t1" }, { 27956, 27996, "chr8.g4.t1" },
+    { 28104, 28186, "chr8.g4.t1" }, { 28559, 28650, "chr8.g4.t1" },
+    { 28775, 28844, "chr8.g4.t1" }, { 28959, 29000, "chr8.g4.t1" },
+    { 29102, 29591, "chr8.g4.t1" },
+  };
+  StructureTestFeature utrintrons[] = {
+    {   168,   348, "chr8.g1.t1" }, {   523,   610, "chr8.g1.t1" },
+    {   703,  4915, "chr8.g1.t1" }, { 22551, 22650, "chr8.g3.t1" },
+    { 26710, 26810, "chr8.g4.t1" }, { 26899, 27013, "chr8.g4.t1" },
+    { 27074, 27514, "chr8.g4.t1" }, { 27548, 27625, "chr8.g4.t1" },
+    { 27704, 27794, "chr8.g4.t1" }, { 27839, 27955, "chr8.g4.t1" },
+    { 27997, 28103, "chr8.g4.t1" }, { 28187, 28558, "chr8.g4.t1" },
+    { 28651, 28774, "chr8.g4.t1" }, { 28845, 28958, "chr8.g4.t1" },
+    { 29001, 29101, "chr8.g4.t1" },
+  };
+  StructureTestFeature isoformintrons[] = {
+    {   851,  1003, "mRNA1" },       {  1223,  2156, "mRNA1" },
+    {  2289,  2801, "mRNA1" },       {  5501,  6099, "mRNA2" },
+    {  6401,  6999, "mRNA2,mRNA3" }, { 15501, 16099, "mRNA4" },
+    { 16401, 16999, "mRNA4,mRNA5" }, { 30851, 31003, "mRNA6" },
+    { 31223, 32156, "mRNA6" },       { 32289, 32801, "mRNA6" },
+  };
+  StructureTestFeature sharedexons[] = {
+    { 1000, 1499, "mRNA1,mRNA2" }, { 2000, 2299, "mRNA1" },
+    { 3000, 3299, "mRNA2" },       { 4000, 5000, "mRNA1" },
+    { 4000, 5200, "mRNA2" },
+  };
+  StructureTestFeature sharedintrons[] = {
+    { 1500, 1999, "mRNA1" }, { 1500, 2999, "mRNA2" },
+    { 2300, 3999, "mRNA1" }, { 3300, 3999, "mRNA2" },
+  };
+  GtUword numutrexons = sizeof(utrexons) / sizeof(utrexons[0]);
+  GtUword numutrintrons = sizeof(utrintrons) / sizeof(utrintrons[0]);
+  GtUword numisoformintrons = sizeof(isoformintrons) /
+                              sizeof(isoformintrons[0]);
+  GtUword numsharedexons = sizeof(sharedexons) / sizeof(sharedexons[0]);
+  GtUword numsharedintrons = sizeof(sharedintrons) / sizeof(sharedintrons[0]);
+
+  GtArray *nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  infer_structure_visitor_test_data(nodes, "data/gff3/grape-utrs.gff3", true);
+  bool utrtest = infer_structure_visitor_test_expected(nodes, "exon", utrexons,
+                                                       numutrexons) &&
+                 infer_structure_visitor_test_expected(nodes, "intron",
+                                                       utrintrons,
+                                                       numutrintrons);
+  agn_unit_test_result(test, "UTRs: exon and intron coordinates", utrtest);
+  for(j = 0; j < gt_array_size(nodes); j++)
+    gt_genome_node_delete(*(GtGenomeNode **)gt_array_get(nodes, j));
+  gt_array_reset(nodes);
+
+  infer_structure_visitor_test_data(nodes, "data/gff3/gene-stream-data.gff3",
+                                    true);
+  bool isoformtest = infer_structure_visitor_test_expected(nodes, "intron",
+                                                           isoformintrons,
+                                                           numisoformintrons);
+  agn_unit_test_result(test, "isoforms: intron coordinates", isoformtest);
+  for(j = 0; j < gt_array_size(nodes); j++)
+    gt_genome_node_delete(*(GtGenomeNode **)gt_array_get(nodes, j));
+  gt_array_reset(nodes);
+
+  infer_structure_visitor_test_data(nodes, "data/gff3/shared-exon.gff3", true);
+  bool sharedtest = infer_structure_visitor_test_expected(nodes, "exon",
+                                                          sharedexons,
+                                                          numsharedexons) &&
+                    infer_structure_visitor_test_expected(nodes, "intron",
+                                                          sharedintrons,
+                                                          numsharedintrons);
+  agn_unit_test_result(test, "isoforms: shared exon", sharedtest);
+  for(j = 0; j < gt_array_size(nodes); j++)
+    gt_genome_node_delete(*(GtGenomeNode **)gt_array_get(nodes, j));
+  gt_array_delete(nodes);
+
+  return agn_unit_test_success(test);
+}
+
+static const GtNodeVisitorClass *infer_structure_visitor_class()
+{
+  static const GtNodeVisitorClass *nvc = NULL;
+  if(!nvc)
+  {
+    nvc = gt_node_visitor_class_new(sizeof (AgnInferStructureVisitor),
+                                    infer_structure_visitor_free, NULL,
+                                    infer_structure_visitor_visit_feature_node,
+                                    NULL, NULL, NULL);
+  }
+  return nvc;
+}
+
+static GtFeatureNode *
+infer_structure_visitor_collapse_feature(AgnInferStructureVisitor *v,
+                                         GtFeatureNode *mrna, GtRange *range)
+{
+  GtUword i;
+  for(i = 0; i < gt_array_size(v->inferred); i++)
+  {
+    GtFeatureNode *fn = *(GtFeatureNode **)gt_array_get(v->inferred, i);
+    GtRange fnrange = gt_genome_node_get_range((GtGenomeNode *)fn);
+    if(gt_range_compare(range, &fnrange) != 0)
+      continue;
+
+    gt_feature_node_add_child(mrna, fn);
+    gt_genome_node_ref((GtGenomeNode *)fn);
+    const char *parentattr = gt_feature_node_get_attribute(fn, "Parent");
+    const char *tid = gt_feature_node_get_attribute(mrna, "ID");
+    if(strlen(tid) > 1023)
+    {
+      gt_logger_log(v->logger, "[AgnInferStructureVisitor::infer_structure_"
+                    "visitor_collapse_feature] mRNA ID is too long (%lu "
+                    "characters), will be truncated\n", strlen(tid));
+    }
+    char parentstr[1024];
+    strncpy(parentstr, parentattr, 1023);
+    sprintf(parentstr + strlen(parentstr), ",%s", tid);
+    gt_feature_node_set_attribute(fn, "Parent", parentstr);
+    return fn;
+  }
+  return NULL;
+}
+
+static void infer_structure_visitor_free(GtNodeVisitor *nv)
+{
+  AgnInferStructureVisitor *v = infer_structure_visitor_cast(nv);
+  GtUword i;
+  for(i = 0; i < gt_array_size(v->transcripts); i++)
+  {
+    StructureTranscript *t = gt_array_get(v->transcripts, i);
+    agn_typecheck_groups_free(&t->groups);
+  }
+  gt_array_delete(v->transcripts);
+  gt_hashmap_delete(v->transcriptindex);
+  gt_array_delete(v->units);
+  gt_array_delete(v->members);
+  gt_array_delete(v->inferred);
+  if(v->cdsvisitor != NULL)
+    gt_node_visitor_delete(v->cdsvisitor);
+  if(v->source != NULL)
+    gt_str_delete(v->source);
+}
+
+static void infer_structure_visitor_infer_exons(AgnInferStructureVisitor *v,
+                                                GtUword *numexons)
+{
+  GtUword i, j, k;
+  gt_array_reset(v->inferred);
+  for(k = 0; k < gt_array_size(v->members); k++)
+  {
+    StructureTranscript *t = *(StructureTranscript **)
+                             gt_array_get(v->members, k);
+    GtFeatureNode *fn = t->transcript;
+    if(!agn_typecheck_mrna(fn))
+      continue;
+
+    const char *mrnaid = gt_feature_node_get_attribute(fn, "ID");
+    unsigned int ln = gt_genome_node_get_line_number((GtGenomeNode *)fn);
+    GtArray *cds  = t->groups.cds;
+    GtArray *utrs = t->groups.utrs;
+    if(gt_array_size(cds) == 0)
+    {
+      gt_logger_log(v->logger, "cannot infer missing exons for mRNA '%s' "
+                    "(line %u) without CDS feature(s)", mrnaid, ln);
+      continue;
+    }
+
+    bool *adjacent_utrs = gt_calloc(gt_array_size(utrs) + 1, sizeof(bool));
+    GtArray *exons_to_add = gt_array_new( sizeof(GtRange) );
+    for(i = 0; i < gt_array_size(cds); i++)
+    {
+      GtGenomeNode **cdssegment = gt_array_get(cds, i);
+      GtRange crange = gt_genome_node_get_range(*cdssegment);
+      GtRange erange = crange;
+      for(j = 0; j < gt_array_size(utrs); j++)
+      {
+        GtGenomeNode **utrsegment = gt_array_get(utrs, j);
+        GtRange urange = gt_genome_node_get_range(*utrsegment);
+
+        // If the UTR segment is adjacent to the CDS, merge the ranges
+        if(urange.end+1 == crange.start || crange.end+1 == urange.start)
+        {
+          erange = gt_range_join(&erange, &urange);
+          adjacent_utrs[j] = true;
+        }
+      }
+      gt_array_add(exons_to_add, erange);
+    }
+
+    // Now create UTR-only exons
+    for(j = 0; j < gt_array_size(utrs); j++)
+    {
+      GtGenomeNode **utrsegment = gt_array_get(utrs, j);
+      GtRange urange = gt_genome_node_get_range(*utrsegment);
+      if(!adjacent_utrs[j])
+        gt_array_add(exons_to_add, urange);
+    }
+
+    for(i = 0; i < gt_array_size(exons_to_add); i++)
+    {
+      GtRange *erange = gt_array_get(exons_to_add, i);
+      GtFeatureNode *fn_exon;
+      fn_exon = infer_structure_visitor_collapse_feature(v, fn, erange);
+      if(fn_exon != NULL)
+      {
+        gt_array_add(t->groups.exons, fn_exon);
+        continue;
+      }
+
+      GtGenomeNode **firstcds = gt_array_get(cds, 0);
+      GtGenomeNode *exon = gt_feature_node_new
+      (
+        gt_genome_node_get_seqid(*firstcds), "exon", erange->start, erange->end,
+        gt_feature_node_get_strand(*(GtFeatureNode **)firstcds)
+      );
+      fn_exon = (GtFeatureNode *)exon;
+      if(v->source)
+        gt_feature_node_set_source(fn_exon, v->source);
+      gt_feature_node_add_child(fn, fn_exon);
+      if(mrnaid)
+        gt_feature_node_add_attribute(fn_exon, "Parent", mrnaid);
+      gt_array_add(t->groups.exons, fn_exon);
+      gt_array_add(v->inferred, fn_exon);
+      (*numexons)++;
+    }
+    gt_array_delete(exons_to_add);
+    gt_free(adjacent_utrs);
+    gt_array_sort(t->groups.exons, (GtCompare)agn_genome_node_compare);
+
+    if(*numexons == 0)
+    {
+      gt_logger_log(v->logger, "unable to infer exons for mRNA '%s' (line %u)",
+                    mrnaid, ln);
+    }
+  }
+}
+
+static void infer_structure_visitor_infer_introns(AgnInferStructureVisitor *v)
+{
+  GtUword i, k;
+  gt_array_reset(v->inferred);
+  for(k = 0; k < gt_array_size(v->members); k++)
+  {
+    StructureTranscript *t = *(StructureTranscript **)
+                             gt_array_get(v->members, k);
+    GtFeatureNode *fn = t->transcript;
+    if(!agn_typecheck_mrna(fn))
+      continue;
+
+    const char *mrnaid = gt_feature_node_get_attribute(fn, "ID");
+    unsigned int ln = gt_genome_node_get_line_number((GtGenomeNode *)fn);
+    GtArray *exons = t->groups.exons;
+    if(gt_array_size(exons) < 2)
+      continue;
+
+    GtArray *introns_to_add = gt_array_new( sizeof(GtRange) );
+    for(i = 1; i < gt_array_size(exons); i++)
+    {
+      GtGenomeNode **exon1 = gt_array_get(exons, i-1);
+      GtGenomeNode **exon2 = gt_array_get(exons, i);
+      GtRange first_range  = gt_genome_node_get_range(*exon1);
+      GtRange second_range = gt_genome_node_get_range(*exon2);
+
+      if(first_range.end == second_range.start - 1)
+      {
+        // No introns are inferred for the remaining mRNAs either
+        gt_logger_log(v->logger, "mRNA '%s' (line %u) has directly adjacent "
+                      "exons", mrnaid, ln);
+        gt_array_delete(introns_to_add);
+        return;
+      }
+      else
+      {
+        GtRange irange = { first_range.end + 1, second_range.start - 1 };
+        gt_array_add(introns_to_add, irange);
+      }
+    }
+
+    for(i = 0; i < gt_array_size(introns_to_add); i++)
+    {
+      GtRange *irange = gt_array_get(introns_to_add, i);
+      GtFeatureNode *fn_intron;
+      fn_intron = infer_structure_visitor_collapse_feature(v, fn, irange);
+      if(fn_intron != NULL)
+      {
+        gt_array_add(t->groups.introns, fn_intron);
+        continue;
+      }
+
+      GtGenomeNode **firstexon = gt_array_get(exons, 0);
+      GtGenomeNode *intron = gt_feature_node_new
+      (
+        gt_genome_node_get_seqid(*firstexon), "intron", irange->start,
+        irange->end, gt_feature_node_get_strand(*(GtFeatureNode **)firstexon)
+      );
+      fn_intron = (GtFeatureNode *)intron;
+      if(v->source)
+        gt_feature_node_set_source(fn_intron, v->source);
+      gt_feature_node_add_child(fn, fn_intron);
+      if(mrnaid)
+        gt_feature_node_add_attribute(fn_intron, "Parent", mrnaid);
+      gt_array_add(t->groups.introns, fn_intron);
+      gt_array_add(v->inferred, fn_intron);
+    }
+    gt_array_delete(introns_to_add);
+  }
+}
+
+static void infer_structure_visitor_store_census(StructureTranscript *t)
+{
+  GtArray *arrays[] = { t->groups.cds, t->groups.exons, t->groups.introns,
+                        t->groups.utrs, t->groups.start_codons,
+                        t->groups.stop_codons };
+  AgnTypeCensus *census = gt_calloc(1, sizeof(AgnTypeCensus));
+  agn_typecheck_census_add(census, t->transcript);
+  GtUword i, j;
+  for(i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++)
+  {
+    for(j = 0; j < gt_array_size(arrays[i]); j++)
+    {
+      GtFeatureNode *fn = *(GtFeatureNode **)gt_array_get(arrays[i], j);
+      agn_typecheck_census_add(census, fn);
+    }
+  }
+
+  GtGenomeNode *gn = (GtGenomeNode *)t->transcript;
+  if(gt_genome_node_get_user_data(gn, "census") != NULL)
+    gt_genome_node_release_user_data(gn, "census");
+  gt_genome_node_add_user_data(gn, "census", census, gt_free_func);
+}
+
+static void infer_structure_visitor_test_data(GtArray *nodes,
+                                              const char *filename,
+                                              bool fused)
+{
+  GtError *error = gt_error_new();
+  GtNodeStream *gff3in = gt_gff3_in_stream_new_unsorted(1, &filename);
+  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)gff3in);
+  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)gff3in);
+  FILE *log = fopen("/dev/null", "w");
+  if(log == NULL)
+  {
+    fprintf(stderr, "[AgnInferStructureVisitor::infer_structure_visitor_test_"
+            "data] error opening /dev/null");
+  }
+  GtLogger *logger = gt_logger_new(true, "", log);
+
+  GtQueue *streams = gt_queue_new();
+  GtNodeStream *last_stream;
+  if(fused)
+  {
+    GtNodeVisitor *nv = agn_infer_structure_visitor_new(logger);
+    agn_infer_structure_visitor_store_census((AgnInferStructureVisitor *)nv);
+    last_stream = gt_visitor_stream_new(gff3in, nv);
+    gt_queue_add(streams, last_stream);
+  }
+  else
+  {
+    last_stream = agn_infer_cds_stream_new(gff3in, NULL, logger);
+    gt_queue_add(streams, last_stream);
+    last_stream = agn_infer_exons_stream_new(last_stream, NULL, logger);
+    gt_queue_add(streams, last_stream);
+  }
+  GtNodeStream *arraystream = gt_array_out_stream_new(last_stream, nodes,
+                                                      error);
+  gt_queue_add(streams, arraystream);
+  int pullresult = gt_node_stream_pull(arraystream, error);
+  if(pullresult == -1)
+  {
+    fprintf(stderr, "[AgnInferStructureVisitor::infer_structure_visitor_test_"
+            "data] error processing features: %s\n", gt_error_get(error));
+  }
+
+  gt_node_stream_delete(gff3in);
+  while(gt_queue_size(streams) > 0)
+  {
+    GtNodeStream *stream = gt_queue_get(streams);
+    gt_node_stream_delete(stream);
+  }
+  gt_queue_delete(streams);
+  gt_logger_delete(logger);
+  if(log != NULL)
+    fclose(log);
+  gt_array_sort(nodes, (GtCompare)agn_genome_node_compare);
+  gt_error_delete(error);
+}
+
+static bool
+infer_structure_visitor_test_expected(GtArray *nodes, const char *type,
+                                      const StructureTestFeature *expected,
+                                      GtUword numexpected)
+{
+  GtHashmap *seen = gt_hashmap_new(GT_HASH_DIRECT, NULL, NULL);
+  bool *matched = gt_calloc(numexpected, sizeof(bool));
+  GtUword i, j, numfeatures = 0;
+  bool success = true;
+  for(i = 0; i < gt_array_size(nodes); i++)
+  {
+    GtGenomeNode *gn = *(GtGenomeNode **)gt_array_get(nodes, i);
+    GtFeatureNode *fn = gt_feature_node_try_cast(gn);
+    if(fn == NULL)
+      continue;
+
+    GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+    GtFeatureNode *current;
+    for(current  = gt_feature_node_iterator_next(iter);
+        current != NULL;
+        current  = gt_feature_node_iterator_next(iter))
+    {
+      if(strcmp(gt_feature_node_get_type(current), type) != 0 ||
+         gt_hashmap_get(seen, current) != NULL)
+        continue;
+      gt_hashmap_add(seen, current, current);
+      numfeatures++;
+
+      GtRange range = gt_genome_node_get_range((GtGenomeNode *)current);
+      const char *parent = gt_feature_node_get_attribute(current, "Parent");
+      bool found = false;
+      for(j = 0; !found && j < numexpected; j++)
+      {
+        found = !matched[j] && range.start == expected[j].start &&
+                range.end == expected[j].end && parent != NULL &&
+                strcmp(parent, expected[j].parent) == 0;
+        if(found)
+          matched[j] = true;
+      }
+      success = success && found;
+    }
+    gt_feature_node_iterator_delete(iter);
+  }
+
+  gt_free(matched);
+  gt_hashmap_delete(seen);
+  return success && numfeatures == numexpected;
+}
+
+static int infer_structure_visitor_visit_feature_node(GtNodeVisitor *nv,
+                                                      GtFeatureNode *fn,
+                                                      GtError *error)
+{
+  AgnInferStructureVisitor *v = infer_structure_visitor_cast(nv);
+  gt_error_check(error);
+
+  // Collect the subfeatures of each transcript, once.
+  v->numtranscripts = 0;
+  gt_hashmap_reset(v->transcriptindex);
+  gt_array_reset(v->units);
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+  GtFeatureNode *current;
+  for(current  = gt_feature_node_iterator_next(iter);
+      current != NULL;
+      current  = gt_feature_node_iterator_next(iter))
+  {
+    unsigned classes = agn_typecheck_classes(current);
+    if(!(classes & (AGN_TYPE_GENE | AGN_TYPE_TRANSCRIPT)))
+      continue;
+    gt_array_add(v->units, current);
+    if(!(classes & AGN_TYPE_TRANSCRIPT) ||
+       gt_hashmap_get(v->transcriptindex, current) != NULL)
+      continue;
+
+    if(v->numtranscripts == gt_array_size(v->transcripts))
+    {
+      StructureTranscript newtranscript;
+      memset(&newtranscript, 0, sizeof(StructureTranscript));
+      gt_array_add(v->transcripts, newtranscript);
+    }
+    StructureTranscript *t = gt_array_get(v->transcripts, v->numtranscripts);
+    v->numtranscripts++;
+    t->transcript = current;
+    agn_typecheck_group(current, &t->groups);
+    gt_hashmap_add(v->transcriptindex, current, (void *)v->numtranscripts);
+  }
+  gt_feature_node_iterator_delete(iter);
+
+  GtUword i;
+  if(v->cdsvisitor != NULL)
+  {
+    AgnInferCDSVisitor *cv = (AgnInferCDSVisitor *)v->cdsvisitor;
+    for(i = 0; i < v->numtranscripts; i++)
+    {
+      StructureTranscript *t = gt_array_get(v->transcripts, i);
+      if(!agn_typecheck_mrna(t->transcript))
+        continue;
+      agn_infer_cds_visitor_visit_mrna(cv, t->transcript, &t->groups);
+      gt_array_sort(t->groups.cds, (GtCompare)agn_genome_node_compare);
+      gt_array_sort(t->groups.utrs, (GtCompare)agn_genome_node_compare);
+    }
+  }
+
+  for(i = 0; i < gt_array_size(v->units); i++)
+  {
+    GtFeatureNode *unit = *(GtFeatureNode **)gt_array_get(v->units, i);
+    if(infer_structure_visitor_visit_unit(v, unit, error))
+      return -1;
+  }
+
+  if(v->storecensus)
+  {
+    for(i = 0; i < v->numtranscripts; i++)
+    {
+      StructureTranscript *t = gt_array_get(v->transcripts, i);
+      if(agn_typecheck_mrna(t->transcript))
+        infer_structure_visitor_store_census(t);
+    }
+  }
+
+  return 0;
+}
+
+static int infer_structure_visitor_visit_unit(AgnInferStructureVisitor *v,
+                                              GtFeatureNode *unit,
+                                              GtError *error)
+{
+  GtUword i, index, numexons = 0, numintrons = 0;
+  gt_array_reset(v->members);
+  index = (GtUword)gt_hashmap_get(v->transcriptindex, unit);
+  if(index > 0)
+  {
+    StructureTranscript *t = gt_array_get(v->transcripts, index - 1);
+    gt_array_add(v->members, t);
+  }
+  else
+  {
+    GtFeatureNodeIterator *iter = gt_feature_node_iterator_new_direct(unit);
+    GtFeatureNode *child;
+    for(child  = gt_feature_node_iterator_next(iter);
+        child != NULL;
+        child  = gt_feature_node_iterator_next(iter))
+    {
+      index = (GtUword)gt_hashmap_get(v->transcriptindex, child);
+      if(index == 0)
+        continue;
+      StructureTranscript *t = gt_array_get(v->transcripts, index - 1);
+      gt_array_add(v->members, t);
+    }
+    gt_feature_node_iterator_delete(iter);
+  }
+
+  for(i = 0; i < gt_array_size(v->members); i++)
+  {
+    StructureTranscript *t = *(StructureTranscript **)
+                             gt_array_get(v->members, i);
+    numexons += gt_array_size(t->groups.exons);
+    numintrons += gt_array_size(t->groups.introns);
+  }
+
+  if(numexons == 0)
+    infer_structure_visitor_infer_exons(v, &numexons);
+
+  for(i = gt_array_size(v->members); i > 0; i--)
+  {
+    StructureTranscript *t = *(StructureTranscript **)
+                             gt_array_get(v->members, i - 1);
+    if(!agn_typecheck_mrna(t->transcript))
+      continue;
+    if(agn_feature_overlap_check(t->groups.exons))
+    {
+      const char *rnaid = gt_feature_node_get_attribute(t->transcript, "ID");
+      gt_error_set(error, "mRNA '%s' contains overlapping exons", rnaid);
+      return -1;
+    }
+  }
+
+  if(numintrons == 0 && numexons > 1)
+    infer_structure_visitor_infer_introns(v);
+
+  return 0;
+}
@@ -15,6 +15,25 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #include "AgnTypecheck.h"
 #include "AgnUtils.h"
 
+#define AGN_LOCUS_SVG_WIDTH  800
+#define AGN_LOCUS_SVG_MARGIN 10
+#define AGN_LOCUS_SVG_RULER  30
+#define AGN_LOCUS_SVG_LABEL  18
+#define AGN_LOCUS_SVG_ROW    14
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+// Entry in the index of a locus' genes and mRNAs used by AgnLocusIter
+typedef struct
+{
+  GtFeatureNode *feature;
+  unsigned types;
+  bool inrefr;
+  bool inpred;
+} LocusMember;
+
 //------------------------------------------------------------------------------
 // Prototypes for private functions
 //------------------------------------------------------------------------------
@@ -73,11 +92,36 @@ static GtUword locus_length(AgnLocus *locus,
 static void locus_select_pairs(AgnLocus *locus, GtArray *refrcliques,
                                GtArray *predcliques, GtArray *clique_pairs);
 
+/**
+ * @function Write ``text`` to the output stream, escaping any characters with
+ * special meaning in XML.
+ */
+static void locus_svg_escape(const char *text, FILE *outstream);
+
+/**
+ * @function Print an SVG track for the given reference or prediction
+ * transcripts, one transcript per row, beginning at vertical position ``y``.
+ * Returns the vertical position following the track.
+ */
+static GtUword locus_svg_track(GtArray *trans, GtRange *range,
+                               const char *label, const char *source,
+                               bool isrefr, GtUword y, FILE *outstream);
+
 /**
  * @function Generate data for unit testing.
  */
 static void locus_test_data(GtQueue *queue);
 
+#ifndef WITHOUT_CAIRO
+/**
+ * @function Label each transcript with the name of the file it came from, or
+ * remove the label if ``filename`` is NULL. Transcripts restored from an
+ * annotation snapshot have no file name of their own (only their top-level
+ * features do), so the PNG track selector relies on this label.
+ */
+static void locus_png_label_transcripts(GtArray *trans, const char *filename);
+#endif
+
 /**
  * @function Track order function for PNG graphics.
  */
@@ -99,6 +143,12 @@ static int locus_track_order(const char *s1, const char *s2, void *data)
  */
 static GtArray *locus_transcript_neighbors(GtGenomeNode *gn, GtArray *trans);
 
+/**
+ * @function Retrieve the index of the locus' genes and mRNAs, creating it if
+ * necessary.
+ */
+static GtArray *locus_members(AgnLocus *locus);
+
 /**
  * @function Test whether a transcript should be filtered.
  */
@@ -118,6 +168,8 @@ static void locus_update_range(AgnLocus *locus, GtFeatureNode *transcript);
 void agn_locus_add(AgnLocus *locus, GtFeatureNode *feature,
                    AgnComparisonSource source)
 {
+  if(gt_genome_node_get_user_data(locus, "members") != NULL)
+    gt_genome_node_release_user_data(locus, "members");
   gt_feature_node_add_child((GtFeatureNode *)locus, feature);
   locus_update_range(locus, feature);
 
@@ -215,13 +267,11 @@ AgnLocus *agn_locus_clone(AgnLocus *locus)
 GtUword agn_locus_cds_length(AgnLocus *locus, AgnComparisonSource src)
 {
   GtUword length = 0;
-  GtArray *mrnas = agn_locus_mrnas(locus, src);
-  while(gt_array_size(mrnas) > 0)
-  {
-    GtFeatureNode **mrna = gt_array_pop(mrnas);
-    length += agn_mrna_cds_length(*mrna);
-  }
-  gt_array_delete(mrnas);
+  AgnLocusIter iter;
+  GtFeatureNode *mrna;
+  agn_locus_iter_init(&iter, locus, src, AGN_TYPE_MRNA);
+  while((mrna = agn_locus_iter_next(&iter)) != NULL)
+    length += agn_mrna_cds_length(mrna);
 
   return length;
 }
@@ -229,7 +279,9 @@ GtUword agn_locus_cds_length(AgnLocus *locus, AgnComparisonSource src)
 void agn_locus_comparative_analysis(AgnLocus *locus, GtLogger *logger)
 {
   GtArray *pairs2report = gt_genome_node_get_user_data(locus, "pairs2report");
-  if(pairs2report != NULL)
+  if(pairs2report != NULL ||
+     gt_genome_node_get_user_data(locus, "uniqrefr") != NULL ||
+     gt_genome_node_get_user_data(locus, "uniqpred") != NULL)
     return;
 
   GtArray *refr_trans = agn_locus_refr_mrnas(locus);
@@ -241,23 +293,16 @@ void agn_locus_comparative_analysis(AgnLocus *locus, GtLogger *logger)
 
   if(refrcliques == NULL || predcliques == NULL)
   {
+    // With no counterpart to compare against, every clique is unmatched
     if(refrcliques)
     {
-      while(gt_array_size(refrcliques) > 0)
-      {
-        AgnTranscriptClique **clique = gt_array_pop(refrcliques);
-        agn_transcript_clique_delete(*clique);
-      }
-      gt_array_delete(refrcliques);
+      gt_genome_node_add_user_data(locus, "uniqrefr", refrcliques,
+                                   (GtFree)locus_clique_array_delete);
     }
     if(predcliques)
     {
-      while(gt_array_size(predcliques) > 0)
-      {
-        AgnTranscriptClique **clique = gt_array_pop(predcliques);
-        agn_transcript_clique_delete(*clique);
-      }
-      gt_array_delete(predcliques);
+      gt_genome_node_add_user_data(locus, "uniqpred", predcliques,
+                                   (GtFree)locus_clique_array_delete);
     }
     return;
   }
@@ -552,19 +597,11 @@ GtArray *agn_locus_get_unique_refr_cliques(AgnLocus *locus)
 GtArray *agn_locus_genes(AgnLocus *locus, AgnComparisonSource src)
 {
   GtArray *genes = gt_array_new( sizeof(GtFeatureNode *) );
-  GtFeatureNode *fn = gt_feature_node_cast(locus);
-  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
-  GtFeatureNode *feature;
-  for(feature  = gt_feature_node_iterator_next(iter);
-      feature != NULL;
-      feature  = gt_feature_node_iterator_next(iter))
-  {
-    bool isgene = agn_typecheck_gene(feature);
-    bool meets_crit = locus_gene_source_test(locus, feature, src);
-    if(isgene && meets_crit)
-      gt_array_add(genes, feature);
-  }
-  gt_feature_node_iterator_delete(iter);
+  AgnLocusIter iter;
+  GtFeatureNode *gene;
+  agn_locus_iter_init(&iter, locus, src, AGN_TYPE_GENE);
+  while((gene = agn_locus_iter_next(&iter)) != NULL)
+    gt_array_add(genes, gene);
 
   return genes;
 }
@@ -572,22 +609,14 @@ GtArray *agn_locus_genes(AgnLocus *locus, AgnComparisonSource src)
 GtArray *agn_locus_gene_ids(AgnLocus *locus, AgnComparisonSource src)
 {
   GtArray *ids = gt_array_new( sizeof(const char *) );
-  GtFeatureNode *fn = gt_feature_node_cast(locus);
-  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
-  GtFeatureNode *feature;
-  for(feature  = gt_feature_node_iterator_next(iter);
-      feature != NULL;
-      feature  = gt_feature_node_iterator_next(iter))
+  AgnLocusIter iter;
+  GtFeatureNode *gene;
+  agn_locus_iter_init(&iter, locus, src, AGN_TYPE_GENE);
+  while((gene = agn_locus_iter_next(&iter)) != NULL)
   {
-    bool isgene = agn_typecheck_gene(feature);
-    bool meets_crit = locus_gene_source_test(locus, feature, src);
-    if(isgene && meets_crit)
-    {
-      const char *id = gt_feature_node_get_attribute(feature, "ID");
-      gt_array_add(ids, id);
-    }
+    const char *id = gt_feature_node_get_attribute(gene, "ID");
+    gt_array_add(ids, id);
   }
-  gt_feature_node_iterator_delete(iter);
 
   return ids;
 }
@@ -595,19 +624,10 @@ GtArray *agn_locus_gene_ids(AgnLocus *locus, AgnComparisonSource src)
 GtUword agn_locus_gene_num(AgnLocus *locus, AgnComparisonSource src)
 {
   GtUword count = 0;
-  GtFeatureNode *fn = gt_feature_node_cast(locus);
-  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
-  GtFeatureNode *feature;
-  for(feature  = gt_feature_node_iterator_next(iter);
-      feature != NULL;
-      feature  = gt_feature_node_iterator_next(iter))
-  {
-    bool isgene = agn_typecheck_gene(feature);
-    bool meets_crit = locus_gene_source_test(locus, feature, src);
-    if(isgene && meets_crit)
-      count++;
-  }
-  gt_feature_node_iterator_delete(iter);
+  AgnLocusIter iter;
+  agn_locus_iter_init(&iter, locus, src, AGN_TYPE_GENE);
+  while(agn_locus_iter_next(&iter) != NULL)
+    count++;
 
   return count;
 }
@@ -646,67 +666,56 @@ int agn_locus_inner_orientation(AgnLocus *left, AgnLocus *right)
     return 3;
 }
 
-GtArray *agn_locus_mrnas(AgnLocus *locus, AgnComparisonSource src)
+void agn_locus_iter_init(AgnLocusIter *iter, AgnLocus *locus,
+                         AgnComparisonSource src, unsigned types)
 {
-  GtArray *mrnas = gt_array_new( sizeof(GtFeatureNode *) );
-  GtFeatureNode *fn = gt_feature_node_cast(locus);
-  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
-  GtFeatureNode *feature;
-  for(feature  = gt_feature_node_iterator_next(iter);
-      feature != NULL;
-      feature  = gt_feature_node_iterator_next(iter))
+  agn_assert(iter && locus);
+  iter->members = locus_members(locus);
+  iter->index = 0;
+  iter->source = src;
+  iter->types = types;
+}
+
+GtFeatureNode *agn_locus_iter_next(AgnLocusIter *iter)
+{
+  GtUword nummembers = gt_array_size(iter->members);
+  while(iter->index < nummembers)
   {
-    bool isgene = agn_typecheck_gene(feature);
-    bool meets_crit = locus_gene_source_test(locus, feature, src);
-    if(!isgene || !meets_crit)
+    LocusMember *member = gt_array_get(iter->members, iter->index++);
+    if(!(member->types & iter->types))
       continue;
-
-    GtFeatureNodeIterator *subiter = gt_feature_node_iterator_new(feature);
-    GtFeatureNode *subfeature;
-    for(subfeature  = gt_feature_node_iterator_next(subiter);
-        subfeature != NULL;
-        subfeature  = gt_feature_node_iterator_next(subiter))
-    {
-      if(agn_typecheck_mrna(subfeature))
-        gt_array_add(mrnas, subfeature);
-    }
-    gt_feature_node_iterator_delete(subiter);
+    if(iter->source == REFERENCESOURCE && !member->inrefr)
+      continue;
+    if(iter->source == PREDICTIONSOURCE && !member->inpred)
+      continue;
+    return member->feature;
   }
-  gt_feature_node_iterator_delete(iter);
+  return NULL;
+}
+
+GtArray *agn_locus_mrnas(AgnLocus *locus, AgnComparisonSource src)
+{
+  GtArray *mrnas = gt_array_new( sizeof(GtFeatureNode *) );
+  AgnLocusIter iter;
+  GtFeatureNode *mrna;
+  agn_locus_iter_init(&iter, locus, src, AGN_TYPE_MRNA);
+  while((mrna = agn_locus_iter_next(&iter)) != NULL)
+    gt_array_add(mrnas, mrna);
 
   return mrnas;
 }
 
 GtArray *agn_locus_mrna_ids(AgnLocus *locus, AgnComparisonSource src)
 {
-  GtArray *ids = gt_array_new( sizeof(GtFeatureNode *) );
-  GtFeatureNode *fn = gt_feature_node_cast(locus);
-  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
-  GtFeatureNode *feature;
-  for(feature  = gt_feature_node_iterator_next(iter);
-      feature != NULL;
-      feature  = gt_feature_node_iterator_next(iter))
+  GtArray *ids = gt_array_new( sizeof(const char *) );
+  AgnLocusIter iter;
+  GtFeatureNode *mrna;
+  agn_locus_iter_init(&iter, locus, src, AGN_TYPE_MRNA);
+  while((mrna = agn_locus_iter_next(&iter)) != NULL)
   {
-    bool isgene = agn_typecheck_gene(feature);
-    bool meets_crit = locus_gene_source_test(locus, feature, src);
-    if(!isgene || !meets_crit)
-      continue;
-
-    GtFeatureNodeIterator *subiter = gt_feature_node_iterator_new(feature);
-    GtFeatureNode *subfeature;
-    for(subfeature  = gt_feature_node_iterator_next(subiter);
-        subfeature != NULL;
-        subfeature  = gt_feature_node_iterator_next(subiter))
-    {
-      if(agn_typecheck_mrna(subfeature))
-      {
-        const char *id = gt_feature_node_get_attribute(feature, "ID");
-        gt_array_add(ids, id);
-      }
-    }
-    gt_feature_node_iterator_delete(subiter);
+    const char *id = gt_feature_node_get_attribute(mrna, "ID");
+    gt_array_add(ids, id);
   }
-  gt_feature_node_iterator_delete(iter);
 
   return ids;
 }
@@ -714,30 +723,10 @@ GtArray *agn_locus_mrna_ids(AgnLocus *locus, AgnComparisonSource src)
 GtUword agn_locus_mrna_num(AgnLocus *locus, AgnComparisonSource src)
 {
   GtUword count = 0;
-  GtFeatureNode *fn = gt_feature_node_cast(locus);
-  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
-  GtFeatureNode *feature;
-  for(feature  = gt_feature_node_iterator_next(iter);
-      feature != NULL;
-      feature  = gt_feature_node_iterator_next(iter))
-  {
-    bool isgene = agn_typecheck_gene(feature);
-    bool meets_crit = locus_gene_source_test(locus, feature, src);
-    if(!isgene || !meets_crit)
-      continue;
-
-    GtFeatureNodeIterator *subiter = gt_feature_node_iterator_new(feature);
-    GtFeatureNode *subfeature;
-    for(subfeature  = gt_feature_node_iterator_next(subiter);
-        subfeature != NULL;
-        subfeature  = gt_feature_node_iterator_next(subiter))
-    {
-      if(agn_typecheck_mrna(subfeature))
-        count++;
-    }
-    gt_feature_node_iterator_delete(subiter);
-  }
-  gt_feature_node_iterator_delete(iter);
+  AgnLocusIter iter;
+  agn_locus_iter_init(&iter, locus, src, AGN_TYPE_MRNA);
+  while(agn_locus_iter_next(&iter) != NULL)
+    count++;
 
   return count;
 }
@@ -762,7 +751,7 @@ void agn_locus_png_track_selector(GtBlock *block, GtStr *track, void *data)
 {
   GtFeatureNode *fn = gt_block_get_top_level_feature(block);
   GtGenomeNode *gn = (GtGenomeNode *)fn;
-  const char *filename = gt_genome_node_get_filename(gn);
+  const char *filename = agn_genome_node_get_filename(gn);
   AgnLocusPngMetadata *metadata = data;
   char trackname[512];
 
@@ -802,12 +791,36 @@ void agn_locus_png_track_selector(GtBlock *block, GtStr *track, void *data)
 
 #ifndef WITHOUT_CAIRO
 void agn_locus_print_png(AgnLocus *locus, AgnLocusPngMetadata *metadata)
+{
+  GtError *error = gt_error_new();
+  GtStyle *style;
+  if(!(style = gt_style_new(error)))
+  {
+    fprintf(stderr, "error: %s\n", gt_error_get(error));
+    exit(EXIT_FAILURE);
+  }
+  if(gt_style_load_file(style, metadata->stylefile, error))
+  {
+    fprintf(stderr, "error: %s\n", gt_error_get(error));
+    exit(EXIT_FAILURE);
+  }
+  agn_locus_print_png_with_style(locus, metadata, style);
+  gt_style_delete(style);
+  gt_error_delete(error);
+}
+#endif
+
+#ifndef WITHOUT_CAIRO
+void agn_locus_print_png_with_style(AgnLocus *locus,
+                                    AgnLocusPngMetadata *metadata,
+                                    GtStyle *style)
 {
   GtError *error = gt_error_new();
   GtFeatureIndex *index = gt_feature_index_memory_new();
   GtUword i, graphic_width;
 
   GtArray *refr_trans = agn_locus_refr_mrnas(locus);
+  locus_png_label_transcripts(refr_trans, metadata->refrfile);
   for(i = 0; i < gt_array_size(refr_trans); i++)
   {
     GtFeatureNode *trans = *(GtFeatureNode **)gt_array_get(refr_trans, i);
@@ -818,9 +831,9 @@ void agn_locus_print_png(AgnLocus *locus, AgnLocusPngMetadata *metadata)
       exit(1);
     }
   }
-  gt_array_delete(refr_trans);
 
   GtArray *pred_trans = agn_locus_pred_mrnas(locus);
+  locus_png_label_transcripts(pred_trans, metadata->predfile);
   for(i = 0; i < gt_array_size(pred_trans); i++)
   {
     GtFeatureNode *trans = *(GtFeatureNode **)gt_array_get(pred_trans, i);
@@ -831,7 +844,6 @@ void agn_locus_print_png(AgnLocus *locus, AgnLocusPngMetadata *metadata)
       exit(1);
     }
   }
-  gt_array_delete(pred_trans);
 
   // Determine graphic width
   double scaling_factor = 0.05;
@@ -842,17 +854,6 @@ void agn_locus_print_png(AgnLocus *locus, AgnLocusPngMetadata *metadata)
     graphic_width = 10000;
 
   // Generate the graphic...this is going to get a bit hairy
-  GtStyle *style;
-  if(!(style = gt_style_new(error)))
-  {
-    fprintf(stderr, "error: %s\n", gt_error_get(error));
-    exit(EXIT_FAILURE);
-  }
-  if(gt_style_load_file(style, metadata->stylefile, error))
-  {
-    fprintf(stderr, "error: %s\n", gt_error_get(error));
-    exit(EXIT_FAILURE);
-  }
   GtStr *seqid = gt_genome_node_get_seqid(locus);
   GtRange locusrange = gt_genome_node_get_range(locus);
   GtDiagram *diagram = gt_diagram_new(index, gt_str_get(seqid), &locusrange,
@@ -902,11 +903,49 @@ void agn_locus_print_png(AgnLocus *locus, AgnLocusPngMetadata *metadata)
   gt_canvas_delete(canvas);
   gt_layout_delete(layout);
   gt_diagram_delete(diagram);
-  gt_style_delete(style);
   gt_error_delete(error);
+  locus_png_label_transcripts(refr_trans, NULL);
+  locus_png_label_transcripts(pred_trans, NULL);
+  gt_array_delete(refr_trans);
+  gt_array_delete(pred_trans);
 }
 #endif
 
+void agn_locus_print_svg(AgnLocus *locus, AgnLocusPngMetadata *metadata,
+                         FILE *outstream)
+{
+  GtArray *refr_trans, *pred_trans;
+  GtRange range;
+  GtUword height, y;
+  agn_assert(locus && metadata && outstream);
+
+  refr_trans = agn_locus_refr_mrnas(locus);
+  pred_trans = agn_locus_pred_mrnas(locus);
+  range = gt_genome_node_get_range(locus);
+  height = AGN_LOCUS_SVG_RULER + 2 * AGN_LOCUS_SVG_LABEL + AGN_LOCUS_SVG_ROW *
+           (gt_array_size(refr_trans) + gt_array_size(pred_trans));
+
+  fprintf(outstream,
+          "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%d\" "
+          "height=\"%lu\" font-family=\"sans-serif\" font-size=\"11\">\n"
+          "<line x1=\"%d\" y1=\"8\" x2=\"%d\" y2=\"8\" stroke=\"#666\"/>\n"
+          "<text x=\"%d\" y=\"22\">%lu</text>\n"
+          "<text x=\"%d\" y=\"22\" text-anchor=\"end\">%lu</text>\n",
+          AGN_LOCUS_SVG_WIDTH, height, AGN_LOCUS_SVG_MARGIN,
+          AGN_LOCUS_SVG_WIDTH - AGN_LOCUS_SVG_MARGIN, AGN_LOCUS_SVG_MARGIN,
+          range.start, AGN_LOCUS_SVG_WIDTH - AGN_LOCUS_SVG_MARGIN, range.end);
+
+  y = AGN_LOCUS_SVG_RULER;
+  y = locus_svg_track(refr_trans, &range, metadata->refrlabel,
+                      metadata->refrfile, true, y, outstream);
+  y = locus_svg_track(pred_trans, &range, metadata->predlabel,
+                      metadata->predfile, false, y, outstream);
+  fputs("</svg>\n", outstream);
+
+  gt_array_delete(refr_trans);
+  gt_array_delete(pred_trans);
+}
+
 void agn_locus_print_transcript_mapping(AgnLocus *locus, FILE *outstream)
 {
   GtStr *seqid = gt_genome_node_get_seqid(locus);
@@ -1002,6 +1041,31 @@ bool agn_locus_unit_test(AgnUnitTest *test)
   agn_comparison_resolve(&stats);
   bool grapetest1 = agn_comparison_test(&stats, &c);
   agn_unit_test_result(test, "grape test 1", grapetest1);
+
+  AgnLocusIter iter;
+  GtFeatureNode *feature;
+  GtArray *refrmrnas = agn_locus_refr_mrnas(locus);
+  GtUword numgenes = 0, nummrnas = 0;
+  bool itertest = gt_array_size(refrmrnas) > 0;
+  agn_locus_iter_init(&iter, locus, REFERENCESOURCE,
+                      AGN_TYPE_GENE | AGN_TYPE_MRNA);
+  while(itertest && (feature = agn_locus_iter_next(&iter)) != NULL)
+  {
+    if(agn_typecheck_gene(feature))
+    {
+      numgenes++;
+      continue;
+    }
+    itertest = nummrnas < gt_array_size(refrmrnas) &&
+      feature == *(GtFeatureNode **)gt_array_get(refrmrnas, nummrnas);
+    nummrnas++;
+  }
+  itertest = itertest && nummrnas == gt_array_size(refrmrnas) &&
+             numgenes == agn_locus_num_refr_genes(locus) &&
+             numgenes + agn_locus_num_pred_genes(locus) ==
+             agn_locus_num_genes(locus);
+  agn_unit_test_result(test, "locus iterator", itertest);
+  gt_array_delete(refrmrnas);
   agn_locus_delete(locus);
 
 
@@ -1056,6 +1120,23 @@ bool agn_locus_unit_test(AgnUnitTest *test)
   agn_comparison_resolve(&stats);
   bool grapetest2 = agn_comparison_test(&stats, &c);
   agn_unit_test_result(test, "grape test 2", grapetest2);
+
+  AgnLocusPngMetadata svgdata = { "", "", "refr.gff3", "pred.gff3", "Gold",
+                                  NULL };
+  FILE *svgfile = tmpfile();
+  agn_locus_print_svg(locus, &svgdata, svgfile);
+  char svgbuffer[8192];
+  rewind(svgfile);
+  size_t svglength = fread(svgbuffer, 1, sizeof(svgbuffer) - 1, svgfile);
+  svgbuffer[svglength] = '\0';
+  fclose(svgfile);
+  const char *predtrack = "Prediction annotations (pred.gff3)";
+  bool svgtest = strncmp(svgbuffer, "<svg ", 5) == 0 &&
+                 strstr(svgbuffer, "Gold (Reference)") != NULL &&
+                 strstr(svgbuffer, predtrack) != NULL &&
+                 strstr(svgbuffer, "<rect ") != NULL && svglength > 7 &&
+                 strcmp(svgbuffer + svglength - 7, "</svg>\n") == 0;
+  agn_unit_test_result(test, "SVG graphic", svgtest);
   agn_locus_delete(locus);
 
   AgnLocus *locus1 = gt_queue_get(queue);
@@ -1317,6 +1398,112 @@ static void locus_select_pairs(AgnLocus *locus, GtArray *refrcliques,
   gt_hashmap_delete(predcliques_acctd);
 }
 
+#ifndef WITHOUT_CAIRO
+static void locus_png_label_transcripts(GtArray *trans, const char *filename)
+{
+  GtUword i;
+  for(i = 0; i < gt_array_size(trans); i++)
+  {
+    GtGenomeNode *gn = *(GtGenomeNode **)gt_array_get(trans, i);
+    if(gt_genome_node_get_user_data(gn, "agn_filename") != NULL)
+      gt_genome_node_release_user_data(gn, "agn_filename");
+    if(filename != NULL)
+    {
+      gt_genome_node_add_user_data(gn, "agn_filename",
+                                   gt_str_new_cstr(filename),
+                                   (GtFree)gt_str_delete);
+    }
+  }
+}
+#endif
+
+static void locus_svg_escape(const char *text, FILE *outstream)
+{
+  const char *c;
+  for(c = text; *c != '\0'; c++)
+  {
+    if     (*c == '&')  fputs("&amp;", outstream);
+    else if(*c == '<')  fputs("&lt;", outstream);
+    else if(*c == '>')  fputs("&gt;", outstream);
+    else if(*c == '"')  fputs("&quot;", outstream);
+    else                fputc(*c, outstream);
+  }
+}
+
+static GtUword locus_svg_track(GtArray *trans, GtRange *range,
+                               const char *label, const char *source,
+                               bool isrefr, GtUword y, FILE *outstream)
+{
+  GtUword i;
+  const char *color = isrefr ? "#2b5d9b" : "#b8442d";
+  const char *srclabel = isrefr ? "Reference" : "Prediction";
+  double scale = (double)(AGN_LOCUS_SVG_WIDTH - 2 * AGN_LOCUS_SVG_MARGIN) /
+                 gt_range_length(range);
+
+  fprintf(outstream, "<text x=\"%d\" y=\"%lu\" font-weight=\"bold\">",
+          AGN_LOCUS_SVG_MARGIN, y + AGN_LOCUS_SVG_LABEL - 5);
+  if(label == NULL)
+  {
+    fprintf(outstream, "%s annotations (", srclabel);
+    locus_svg_escape(source, outstream);
+    fputs(")", outstream);
+  }
+  else
+  {
+    locus_svg_escape(label, outstream);
+    fprintf(outstream, " (%s)", srclabel);
+  }
+  fputs("</text>\n", outstream);
+  y += AGN_LOCUS_SVG_LABEL;
+
+  for(i = 0; i < gt_array_size(trans); i++)
+  {
+    GtFeatureNode *fn = *(GtFeatureNode **)gt_array_get(trans, i);
+    GtRange trange = gt_genome_node_get_range((GtGenomeNode *)fn);
+    GtUword mid = y + AGN_LOCUS_SVG_ROW / 2;
+    const char *tid = gt_feature_node_get_attribute(fn, "ID");
+
+    fputs("<g>", outstream);
+    if(tid != NULL)
+    {
+      fputs("<title>", outstream);
+      locus_svg_escape(tid, outstream);
+      fputs("</title>", outstream);
+    }
+    fprintf(outstream, "<line x1=\"%.1f\" y1=\"%lu\" x2=\"%.1f\" y2=\"%lu\" "
+            "stroke=\"%s\"/>", AGN_LOCUS_SVG_MARGIN +
+            (trange.start - range->start) * scale, mid, AGN_LOCUS_SVG_MARGIN +
+            (trange.end - range->start + 1) * scale, mid, color);
+
+    GtFeatureNode *child;
+    GtFeatureNodeIterator *iter = gt_feature_node_iterator_new_direct(fn);
+    for(child = gt_feature_node_iterator_next(iter);
+        child != NULL;
+        child = gt_feature_node_iterator_next(iter))
+    {
+      GtUword half;
+      if(agn_typecheck_cds(child))
+        half = 5;
+      else if(agn_typecheck_exon(child) || agn_typecheck_utr(child))
+        half = 3;
+      else
+        continue;
+
+      GtRange crange = gt_genome_node_get_range((GtGenomeNode *)child);
+      double width = gt_range_length(&crange) * scale;
+      fprintf(outstream, "<rect x=\"%.1f\" y=\"%lu\" width=\"%.1f\" "
+              "height=\"%lu\" fill=\"%s\"/>", AGN_LOCUS_SVG_MARGIN +
+              (crange.start - range->start) * scale, mid - half,
+              width < 1.0 ? 1.0 : width, 2 * half, color);
+    }
+    gt_feature_node_iterator_delete(iter);
+    fputs("</g>\n", outstream);
+    y += AGN_LOCUS_SVG_ROW;
+  }
+
+  return y;
+}
+
 static void locus_test_data(GtQueue *queue)
 {
   agn_assert(queue != NULL);
@@ -1441,6 +1628,51 @@ static bool locus_gene_source_test(AgnLocus *locus, GtFeatureNode *transcript,
   return false;
 }
 
+static GtArray *locus_members(AgnLocus *locus)
+{
+  GtArray *members = gt_genome_node_get_user_data(locus, "members");
+  if(members != NULL)
+    return members;
+
+  GtHashmap *refr_feats = gt_genome_node_get_user_data(locus, "refrfeats");
+  GtHashmap *pred_feats = gt_genome_node_get_user_data(locus, "predfeats");
+  members = gt_array_new( sizeof(LocusMember) );
+  GtFeatureNode *fn = gt_feature_node_cast(locus);
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+  GtFeatureNode *feature;
+  for(feature  = gt_feature_node_iterator_next(iter);
+      feature != NULL;
+      feature  = gt_feature_node_iterator_next(iter))
+  {
+    if(!agn_typecheck_gene(feature))
+      continue;
+
+    LocusMember gene = { feature, AGN_TYPE_GENE, false, false };
+    gene.inrefr = refr_feats && gt_hashmap_get(refr_feats, feature) != NULL;
+    gene.inpred = pred_feats && gt_hashmap_get(pred_feats, feature) != NULL;
+    gt_array_add(members, gene);
+
+    GtFeatureNodeIterator *subiter = gt_feature_node_iterator_new(feature);
+    GtFeatureNode *subfeature;
+    for(subfeature  = gt_feature_node_iterator_next(subiter);
+        subfeature != NULL;
+        subfeature  = gt_feature_node_iterator_next(subiter))
+    {
+      if(!agn_typecheck_mrna(subfeature))
+        continue;
+      LocusMember mrna = { subfeature, AGN_TYPE_MRNA, gene.inrefr,
+                           gene.inpred };
+      gt_array_add(members, mrna);
+    }
+    gt_feature_node_iterator_delete(subiter);
+  }
+  gt_feature_node_iterator_delete(iter);
+
+  gt_genome_node_add_user_data(locus, "members", members,
+                               (GtFree)gt_array_delete);
+  return members;
+}
+
 static void locus_update_range(AgnLocus *locus, GtFeatureNode *transcript)
 {
   GtRange locusrange = gt_genome_node_get_range(locus);
@@ -0,0 +1,576 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include "core/hashmap_api.h"
+#include "extended/array_out_stream_api.h"
+#include "AgnLocusCompositionStream.h"
+#include "AgnLocusStream.h"
+#include "AgnUtils.h"
+
+#define LOCUS_COMPOSITION_BINS 64
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+struct AgnLocusCompositionStream
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in_stream;
+  FILE *outstream;
+  FILE *seqstream;
+  GtHashmap *seqoffsets;
+  off_t scanoffset;
+  bool seqscomplete;
+  char *line;
+  size_t linesize;
+  GtStr *seqid;
+  GtStr *seqbuffer;
+  const char *sequence;
+  GtUword seqlength;
+  GtHashmap *classes;
+  bool written;
+};
+
+typedef struct
+{
+  GtUword count;
+  GtUword length;
+  GtUword gc;
+  GtUword n;
+  GtUword histogram[LOCUS_COMPOSITION_BINS];
+} LocusCompositionClass;
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+#define locus_composition_stream_cast(GS)\
+        gt_node_stream_cast(locus_composition_stream_class(), GS)
+
+/**
+ * @function Implements the GtNodeStream interface for this class.
+ */
+static const GtNodeStreamClass* locus_composition_stream_class(void);
+
+/**
+ * @function Compute the composition of the given iLocus, store it in the
+ * iLocus' attributes, and aggregate it with the iLocus' class.
+ */
+static void locus_composition_stream_compute(AgnLocusCompositionStream *stream,
+                                             GtFeatureNode *locus);
+
+/**
+ * @function Class destructor.
+ */
+static void locus_composition_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Write the length histogram of an iLocus class to the output.
+ */
+static int locus_composition_stream_histogram(void *key, void *value,
+                                              void *data, GtError *error);
+
+/**
+ * @function Read the sequence beginning at the current position of the
+ * sequence file, up to the next Fasta header (where the file is left
+ * positioned) or the end of the file.
+ */
+static int locus_composition_stream_load(AgnLocusCompositionStream *stream,
+                                         GtError *error);
+
+/**
+ * @function Pulls nodes from the input stream, computes the composition of
+ * each iLocus, and passes the nodes on. When the input stream is exhausted,
+ * the summary table is written.
+ */
+static int locus_composition_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                         GtError *error);
+
+/**
+ * @function Load the sequence with the given ID. The offset of each sequence
+ * is recorded as the file is scanned, so a sequence that has already been
+ * passed is read again directly from its offset. ``found`` is set to false if
+ * the sequence file contains no such sequence.
+ */
+static int locus_composition_stream_seek(AgnLocusCompositionStream *stream,
+                                         const char *seqid, bool *found,
+                                         GtError *error);
+
+/**
+ * @function Write the summary statistics of an iLocus class to the output.
+ */
+static int locus_composition_stream_summary(void *key, void *value,
+                                            void *data, GtError *error);
+
+/**
+ * @function Accumulate class counts for the unit test.
+ */
+static int locus_composition_stream_test_classes(void *key, void *value,
+                                                 void *data, GtError *error);
+
+/**
+ * @function Synthetic nucleotide at the given position of the unit test
+ * sequences.
+ */
+static char locus_composition_stream_test_base(GtUword pos);
+
+/**
+ * @function Determine the class of the given iLocus.
+ */
+static const char *locus_composition_stream_type(GtFeatureNode *locus);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream *agn_locus_composition_stream_new(GtNodeStream *in_stream,
+                                               const char *seqfile,
+                                               FILE *outstream,
+                                               GtError *error)
+{
+  GtNodeStream *ns;
+  AgnLocusCompositionStream *stream;
+  FILE *seqstream;
+  agn_assert(in_stream && seqfile);
+
+  seqstream = fopen(seqfile, "r");
+  if(seqstream == NULL)
+  {
+    gt_error_set(error, "cannot open sequence file '%s'", seqfile);
+    return NULL;
+  }
+
+  ns = gt_node_stream_create(locus_composition_stream_class(), false);
+  stream = locus_composition_stream_cast(ns);
+  stream->in_stream = gt_node_stream_ref(in_stream);
+  stream->outstream = outstream;
+  stream->seqstream = seqstream;
+  stream->seqoffsets = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
+                                      gt_free_func);
+  stream->scanoffset = 0;
+  stream->seqscomplete = false;
+  stream->line = NULL;
+  stream->linesize = 0;
+  stream->seqid = gt_str_new();
+  stream->seqbuffer = gt_str_new();
+  stream->sequence = NULL;
+  stream->seqlength = 0;
+  stream->classes = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
+                                   gt_free_func);
+  stream->written = false;
+  return ns;
+}
+
+bool agn_locus_composition_stream_unit_test(AgnUnitTest *test)
+{
+  const char *infile = "data/gff3/ilocus.in.gff3";
+  char seqfile[] = "/tmp/agn-locus-composition-XXXXXX";
+  int fd = mkstemp(seqfile);
+  agn_assert(fd >= 0);
+  close(fd);
+
+  // Sequences are written in reverse order, and seq01 is omitted, so that
+  // the stream must seek back to sequences already passed and skip unknown
+  // sequences.
+  FILE *seqstream = fopen(seqfile, "w");
+  agn_assert(seqstream != NULL);
+  int i;
+  for(i = 25; i > 1; i--)
+  {
+    fprintf(seqstream, ">seq%02d synthetic\n", i);
+    GtUword pos;
+    for(pos = 1; pos <= 2000; pos++)
+    {
+      fputc(locus_composition_stream_test_base(pos), seqstream);
+      if(pos % 60 == 0)
+        fputc('\n', seqstream);
+    }
+    fputc('\n', seqstream);
+  }
+  fclose(seqstream);
+
+  GtError *error = gt_error_new();
+  GtArray *loci = gt_array_new( sizeof(GtFeatureNode *) );
+  GtNodeStream *gff3 = gt_gff3_in_stream_new_unsorted(1, &infile);
+  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)gff3);
+  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)gff3);
+  GtNodeStream *lstream = agn_locus_stream_new(gff3, 200);
+  GtNodeStream *cstream = agn_locus_composition_stream_new(lstream, seqfile,
+                                                           NULL, error);
+  agn_assert(cstream != NULL);
+  GtNodeStream *aos = gt_array_out_stream_new(cstream, loci, error);
+  int result = gt_node_stream_pull(aos, error);
+
+  bool attrsuccess = result == 0 && gt_array_size(loci) > 0;
+  GtUword expected[2] = { 0, 0 };
+  GtUword j;
+  for(j = 0; attrsuccess && j < gt_array_size(loci); j++)
+  {
+    GtFeatureNode *locus = *(GtFeatureNode **)gt_array_get(loci, j);
+    GtGenomeNode *gn = (GtGenomeNode *)locus;
+    const char *gcattr = gt_feature_node_get_attribute(locus, "gc_content");
+    const char *nattr = gt_feature_node_get_attribute(locus, "n_content");
+    if(strcmp(gt_str_get(gt_genome_node_get_seqid(gn)), "seq01") == 0)
+    {
+      attrsuccess = gcattr == NULL && nattr == NULL;
+      continue;
+    }
+
+    GtRange range = gt_genome_node_get_range(gn);
+    GtUword pos, gc = 0, n = 0, length = gt_range_length(&range);
+    for(pos = range.start; pos <= range.end; pos++)
+    {
+      char base = locus_composition_stream_test_base(pos);
+      if(base == 'G')
+        gc++;
+      else if(base == 'N')
+        n++;
+    }
+    char gcstr[32], nstr[32];
+    sprintf(gcstr, "%.3lf", n < length ? (double)gc / (length - n) : 0.0);
+    sprintf(nstr, "%.3lf", (double)n / length);
+    attrsuccess = gcattr != NULL && nattr != NULL &&
+                  strcmp(gcattr, gcstr) == 0 && strcmp(nattr, nstr) == 0;
+    expected[0]++;
+    expected[1] += length;
+  }
+  agn_unit_test_result(test, "iLocus composition", attrsuccess);
+
+  AgnLocusCompositionStream *stream = locus_composition_stream_cast(cstream);
+  GtUword observed[2] = { 0, 0 };
+  gt_hashmap_foreach(stream->classes, locus_composition_stream_test_classes,
+                     observed, error);
+  bool classsuccess = observed[0] == expected[0] &&
+                      observed[1] == expected[1] &&
+                      gt_hashmap_get(stream->classes, "giLocus") != NULL &&
+                      gt_hashmap_get(stream->classes, "iiLocus") != NULL &&
+                      gt_hashmap_get(stream->classes, "fiLocus") != NULL;
+  agn_unit_test_result(test, "class summary", classsuccess);
+
+  while(gt_array_size(loci) > 0)
+  {
+    GtGenomeNode **gn = gt_array_pop(loci);
+    gt_genome_node_delete(*gn);
+  }
+  gt_array_delete(loci);
+  gt_node_stream_delete(aos);
+  gt_node_stream_delete(cstream);
+  gt_node_stream_delete(lstream);
+  gt_node_stream_delete(gff3);
+  gt_error_delete(error);
+  unlink(seqfile);
+
+  return agn_unit_test_success(test);
+}
+
+static const GtNodeStreamClass *locus_composition_stream_class(void)
+{
+  static const GtNodeStreamClass *nsc = NULL;
+  if(!nsc)
+  {
+    nsc = gt_node_stream_class_new(sizeof (AgnLocusCompositionStream),
+                                   locus_composition_stream_free,
+                                   locus_composition_stream_next);
+  }
+  return nsc;
+}
+
+static void locus_composition_stream_compute(AgnLocusCompositionStream *stream,
+                                             GtFeatureNode *locus)
+{
+  GtRange range = gt_genome_node_get_range((GtGenomeNode *)locus);
+  GtUword i, gc = 0, n = 0, length = gt_range_length(&range);
+  for(i = range.start - 1; i < range.end; i++)
+  {
+    // Positions beyond the end of the sequence are treated as unknown.
+    if(i >= stream->seqlength)
+    {
+      n += range.end - i;
+      break;
+    }
+    switch(stream->sequence[i])
+    {
+      case 'C': case 'c': case 'G': case 'g': case 'S': case 's':
+        gc++;
+        break;
+      case 'N': case 'n':
+        n++;
+        break;
+    }
+  }
+
+  char value[32];
+  sprintf(value, "%.3lf", n < length ? (double)gc / (length - n) : 0.0);
+  gt_feature_node_set_attribute(locus, "gc_content", value);
+  sprintf(value, "%.3lf", (double)n / length);
+  gt_feature_node_set_attribute(locus, "n_content", value);
+
+  const char *type = locus_composition_stream_type(locus);
+  LocusCompositionClass *cls = gt_hashmap_get(stream->classes, type);
+  if(cls == NULL)
+  {
+    cls = gt_calloc(1, sizeof(LocusCompositionClass));
+    gt_hashmap_add(stream->classes, gt_cstr_dup(type), cls);
+  }
+  GtUword bin = 0;
+  while(bin < LOCUS_COMPOSITION_BINS - 1 && (length >> (bin + 1)) > 0)
+    bin++;
+  cls->count++;
+  cls->length += length;
+  cls->gc += gc;
+  cls->n += n;
+  cls->histogram[bin]++;
+}
+
+static void locus_composition_stream_free(GtNodeStream *ns)
+{
+  AgnLocusCompositionStream *stream = locus_composition_stream_cast(ns);
+  gt_node_stream_delete(stream->in_stream);
+  fclose(stream->seqstream);
+  gt_hashmap_delete(stream->seqoffsets);
+  free(stream->line);
+  gt_str_delete(stream->seqid);
+  gt_str_delete(stream->seqbuffer);
+  gt_hashmap_delete(stream->classes);
+}
+
+static int locus_composition_stream_histogram(void *key, void *value,
+                                              void *data, GtError *error)
+{
+  LocusCompositionClass *cls = value;
+  FILE *outstream = data;
+  GtUword bin;
+  for(bin = 0; bin < LOCUS_COMPOSITION_BINS; bin++)
+  {
+    if(cls->histogram[bin] == 0)
+      continue;
+    fprintf(outstream, "%s\t%lu\t%lu\t%lu\n", (const char *)key, 1UL << bin,
+            (2UL << bin) - 1, cls->histogram[bin]);
+  }
+  return 0;
+}
+
+static int locus_composition_stream_load(AgnLocusCompositionStream *stream,
+                                         GtError *error)
+{
+  gt_str_reset(stream->seqbuffer);
+  while(1)
+  {
+    off_t linestart = ftello(stream->seqstream);
+    if(getline(&stream->line, &stream->linesize, stream->seqstream) == -1)
+      break;
+    if(stream->line[0] == '>')
+    {
+      fseeko(stream->seqstream, linestart, SEEK_SET);
+      break;
+    }
+    const char *c;
+    for(c = stream->line; *c != '\0'; c++)
+    {
+      if(!isspace((unsigned char)*c))
+        gt_str_append_char(stream->seqbuffer, *c);
+    }
+  }
+  if(ferror(stream->seqstream))
+  {
+    gt_error_set(error, "error reading sequence file");
+    return -1;
+  }
+  return 0;
+}
+
+static int locus_composition_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                         GtError *error)
+{
+  AgnLocusCompositionStream *stream;
+  int result;
+  gt_error_check(error);
+  stream = locus_composition_stream_cast(ns);
+
+  result = gt_node_stream_next(stream->in_stream, gn, error);
+  if(result)
+    return result;
+  if(*gn == NULL)
+  {
+    if(stream->written || stream->outstream == NULL)
+      return 0;
+    stream->written = true;
+    fprintf(stream->outstream,
+            "class\tcount\ttotal_bp\tmean_length\tgc_content\tn_content\n");
+    gt_hashmap_foreach_in_key_order(stream->classes,
+                                    locus_composition_stream_summary,
+                                    stream->outstream, error);
+    fprintf(stream->outstream, "\nclass\tmin_length\tmax_length\tcount\n");
+    gt_hashmap_foreach_in_key_order(stream->classes,
+                                    locus_composition_stream_histogram,
+                                    stream->outstream, error);
+    return 0;
+  }
+
+  GtFeatureNode *fn = gt_feature_node_try_cast(*gn);
+  if(fn == NULL || !gt_feature_node_has_type(fn, "locus"))
+    return 0;
+
+  bool found;
+  const char *seqid = gt_str_get(gt_genome_node_get_seqid(*gn));
+  if(locus_composition_stream_seek(stream, seqid, &found, error) == -1)
+  {
+    gt_genome_node_delete(*gn);
+    *gn = NULL;
+    return -1;
+  }
+  if(found)
+    locus_composition_stream_compute(stream, fn);
+
+  return 0;
+}
+
+static int locus_composition_stream_seek(AgnLocusCompositionStream *stream,
+                                         const char *seqid, bool *found,
+                                         GtError *error)
+{
+  if(stream->sequence != NULL && strcmp(gt_str_get(stream->seqid), seqid) == 0)
+  {
+    *found = true;
+    return 0;
+  }
+
+  stream->sequence = NULL;
+  off_t *offset = gt_hashmap_get(stream->seqoffsets, seqid);
+  bool loaded = false;
+  if(offset == NULL && !stream->seqscomplete)
+  {
+    // Continue scanning Fasta headers where the last scan stopped, recording
+    // the offset of each sequence along the way.
+    if(fseeko(stream->seqstream, stream->scanoffset, SEEK_SET) != 0)
+    {
+      gt_error_set(error, "cannot seek in sequence file");
+      return -1;
+    }
+    while(getline(&stream->line, &stream->linesize, stream->seqstream) != -1)
+    {
+      if(stream->line[0] != '>')
+        continue;
+      const char *id = strtok(stream->line + 1, " \n\t\r");
+      if(id == NULL)
+        id = "";
+      if(gt_hashmap_get(stream->seqoffsets, id) == NULL)
+      {
+        off_t *newoffset = gt_malloc( sizeof(off_t) );
+        *newoffset = ftello(stream->seqstream);
+        gt_hashmap_add(stream->seqoffsets, gt_cstr_dup(id), newoffset);
+      }
+      if(strcmp(id, seqid) == 0)
+      {
+        if(locus_composition_stream_load(stream, error) == -1)
+          return -1;
+        offset = gt_hashmap_get(stream->seqoffsets, seqid);
+        loaded = true;
+        break;
+      }
+    }
+    if(ferror(stream->seqstream))
+    {
+      gt_error_set(error, "error reading sequence file");
+      return -1;
+    }
+    if(!loaded)
+      stream->seqscomplete = true;
+    stream->scanoffset = ftello(stream->seqstream);
+  }
+
+  if(offset == NULL)
+  {
+    if(gt_str_length(stream->seqid) == 0 ||
+       strcmp(gt_str_get(stream->seqid), seqid) != 0)
+    {
+      fprintf(stderr, "[AEGeAn::AgnLocusCompositionStream] warning: no "
+              "sequence provided for '%s'\n", seqid);
+      gt_str_set(stream->seqid, seqid);
+    }
+    *found = false;
+    return 0;
+  }
+
+  if(!loaded)
+  {
+    if(fseeko(stream->seqstream, *offset, SEEK_SET) != 0)
+    {
+      gt_error_set(error, "cannot seek in sequence file");
+      return -1;
+    }
+    if(locus_composition_stream_load(stream, error) == -1)
+      return -1;
+  }
+  gt_str_set(stream->seqid, seqid);
+  stream->sequence = gt_str_get(stream->seqbuffer);
+  stream->seqlength = gt_str_length(stream->seqbuffer);
+  *found = true;
+  return 0;
+}
+
+static int locus_composition_stream_summary(void *key, void *value,
+                                            void *data, GtError *error)
+{
+  LocusCompositionClass *cls = value;
+  FILE *outstream = data;
+  double gc = cls->n < cls->length ?
+              (double)cls->gc / (cls->length - cls->n) : 0.0;
+  fprintf(outstream, "%s\t%lu\t%lu\t%.1lf\t%.3lf\t%.3lf\n", (const char *)key,
+          cls->count, cls->length, (double)cls->length / cls->count, gc,
+          (double)cls->n / cls->length);
+  return 0;
+}
+
+static int locus_composition_stream_test_classes(void *key, void *value,
+                                                 void *data, GtError *error)
+{
+  LocusCompositionClass *cls = value;
+  GtUword *totals = data;
+  GtUword bin, histcount = 0;
+  for(bin = 0; bin < LOCUS_COMPOSITION_BINS; bin++)
+    histcount += cls->histogram[bin];
+  agn_assert(histcount == cls->count);
+  totals[0] += cls->count;
+  totals[1] += cls->length;
+  return 0;
+}
+
+static char locus_composition_stream_test_base(GtUword pos)
+{
+  if(pos % 10 == 0)
+    return 'N';
+  if(pos % 3 == 0)
+    return 'G';
+  return 'A';
+}
+
+static const char *locus_composition_stream_type(GtFeatureNode *locus)
+{
+  const char *type = gt_feature_node_get_attribute(locus, "iLocus_type");
+  if(type == NULL)
+    type = gt_genome_node_get_user_data((GtGenomeNode *)locus, "iLocus_type");
+  if(type == NULL)
+  {
+    if(gt_feature_node_number_of_children(locus) > 0)
+      type = "giLocus";
+    else
+      type = "iiLocus";
+  }
+  return type;
+}
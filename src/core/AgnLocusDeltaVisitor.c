@@ -0,0 +1,472 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include <string.h>
+#include "core/hashmap_api.h"
+#include "extended/array_out_stream_api.h"
+#include "AgnLocus.h"
+#include "AgnLocusDeltaVisitor.h"
+#include "AgnLocusStream.h"
+#include "AgnTypecheck.h"
+#include "AgnUtils.h"
+
+#define locus_delta_visitor_cast(GV)\
+        gt_node_visitor_cast(locus_delta_visitor_class(), GV)
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+struct AgnLocusDeltaVisitor
+{
+  const GtNodeVisitor parent_instance;
+  GtArray *summaries;
+  GtArray *sequences;
+  GtHashmap *seqsbyid;
+  AgnLocus *prev_locus;
+  FILE *ilenfile;
+  int endmode;
+  bool skip_iiLoci;
+  bool finished;
+};
+
+typedef struct
+{
+  GtUword delta;
+  GtUword giloci;
+  GtUword iiloci;
+  GtUword iilocus_bp;
+  GtUword filoci;
+  GtUword filocus_bp;
+} LocusDeltaSummary;
+
+typedef struct
+{
+  GtRange range;
+  bool annotated;
+} LocusDeltaSequence;
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Implement the interface to the GtNodeVisitor class.
+ */
+static const GtNodeVisitorClass *locus_delta_visitor_class();
+
+/**
+ * @function Account for the terminal iLoci of the last sequence and the uLoci
+ * of all sequences without any gene loci.
+ */
+static void locus_delta_visitor_finish(AgnLocusDeltaVisitor *v);
+
+/**
+ * @function Class destructor.
+ */
+static void locus_delta_visitor_free(GtNodeVisitor *nv);
+
+/**
+ * @function Account for the fiLocus preceding the first gene locus of a
+ * sequence.
+ */
+static void locus_delta_visitor_initial(AgnLocusDeltaVisitor *v,
+                                        AgnLocus *locus,
+                                        LocusDeltaSequence *seq);
+
+/**
+ * @function Account for the space between two adjacent gene loci, mirroring
+ * the decisions made by ``AgnLocusStream`` when extending iLoci.
+ */
+static void locus_delta_visitor_internal(AgnLocusDeltaVisitor *v,
+                                         AgnLocus *prev, AgnLocus *locus);
+
+/**
+ * @function Account for the fiLocus following the last gene locus of a
+ * sequence.
+ */
+static void locus_delta_visitor_terminal(AgnLocusDeltaVisitor *v,
+                                         AgnLocus *locus,
+                                         LocusDeltaSequence *seq);
+
+/**
+ * @function Compute iLocus counts and lengths for the given delta using an
+ * ``AgnLocusStream``, for unit testing.
+ */
+static void locus_delta_visitor_test_stream(const char *filename,
+                                            LocusDeltaSummary *summary);
+
+/**
+ * @function Process each gene locus.
+ */
+static int locus_delta_visitor_visit_feature_node(GtNodeVisitor *nv,
+                                                  GtFeatureNode *fn,
+                                                  GtError *error);
+
+/**
+ * @function Store the range of each sequence.
+ */
+static int locus_delta_visitor_visit_region_node(GtNodeVisitor *nv,
+                                                 GtRegionNode *rn,
+                                                 GtError *error);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeVisitor *agn_locus_delta_visitor_new(GtArray *deltas, FILE *ilenfile)
+{
+  agn_assert(deltas && gt_array_size(deltas) > 0);
+  GtNodeVisitor *nv = gt_node_visitor_create(locus_delta_visitor_class());
+  AgnLocusDeltaVisitor *v = locus_delta_visitor_cast(nv);
+  v->summaries = gt_array_new( sizeof(LocusDeltaSummary) );
+  GtUword i;
+  for(i = 0; i < gt_array_size(deltas); i++)
+  {
+    LocusDeltaSummary summary;
+    memset(&summary, 0, sizeof(LocusDeltaSummary));
+    summary.delta = *(GtUword *)gt_array_get(deltas, i);
+    gt_array_add(v->summaries, summary);
+  }
+  v->sequences = gt_array_new( sizeof(LocusDeltaSequence *) );
+  v->seqsbyid = gt_hashmap_new(GT_HASH_STRING, gt_free_func, gt_free_func);
+  v->prev_locus = NULL;
+  v->ilenfile = ilenfile;
+  v->endmode = 0;
+  v->skip_iiLoci = false;
+  v->finished = false;
+  return nv;
+}
+
+void agn_locus_delta_visitor_print_summary(AgnLocusDeltaVisitor *v,
+                                           GtFile *outfile)
+{
+  agn_assert(v);
+  locus_delta_visitor_finish(v);
+  gt_file_xprintf(outfile, "delta\tgiLoci\tiiLoci\tiiLocus_bp\tfiLoci\t"
+                  "fiLocus_bp\n");
+  GtUword i;
+  for(i = 0; i < gt_array_size(v->summaries); i++)
+  {
+    LocusDeltaSummary *summary = gt_array_get(v->summaries, i);
+    gt_file_xprintf(outfile, "%lu\t%lu\t%lu\t%lu\t%lu\t%lu\n", summary->delta,
+                    summary->giloci, summary->iiloci, summary->iilocus_bp,
+                    summary->filoci, summary->filocus_bp);
+  }
+}
+
+void agn_locus_delta_visitor_set_endmode(AgnLocusDeltaVisitor *v, int endmode)
+{
+  agn_assert(v);
+  v->endmode = endmode;
+}
+
+void agn_locus_delta_visitor_skip_iiLoci(AgnLocusDeltaVisitor *v)
+{
+  agn_assert(v);
+  v->skip_iiLoci = true;
+}
+
+bool agn_locus_delta_visitor_unit_test(AgnUnitTest *test)
+{
+  const char *filename = "data/gff3/ilocus.in.gff3";
+  GtUword deltas[] = { 0, 100, 200, 500, 1000 };
+  GtUword numdeltas = sizeof(deltas) / sizeof(GtUword);
+  GtError *error = gt_error_new();
+
+  GtArray *deltaarray = gt_array_new( sizeof(GtUword) );
+  GtUword i;
+  for(i = 0; i < numdeltas; i++)
+    gt_array_add(deltaarray, deltas[i]);
+  GtNodeVisitor *nv = agn_locus_delta_visitor_new(deltaarray, NULL);
+  GtNodeStream *gff3 = gt_gff3_in_stream_new_unsorted(1, &filename);
+  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)gff3);
+  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)gff3);
+  GtNodeStream *lstream = agn_locus_stream_new(gff3, 0);
+  GtNodeStream *vstream = gt_visitor_stream_new(lstream, nv);
+  int result = gt_node_stream_pull(vstream, error);
+  locus_delta_visitor_finish(locus_delta_visitor_cast(nv));
+
+  AgnLocusDeltaVisitor *v = locus_delta_visitor_cast(nv);
+  bool test1 = result == 0;
+  for(i = 0; test1 && i < numdeltas; i++)
+  {
+    LocusDeltaSummary expected;
+    memset(&expected, 0, sizeof(LocusDeltaSummary));
+    expected.delta = deltas[i];
+    locus_delta_visitor_test_stream(filename, &expected);
+    LocusDeltaSummary *observed = gt_array_get(v->summaries, i);
+    test1 = memcmp(&expected, observed, sizeof(LocusDeltaSummary)) == 0;
+  }
+  agn_unit_test_result(test, "iLoci, multiple deltas", test1);
+
+  gt_node_stream_delete(vstream);
+  gt_node_stream_delete(lstream);
+  gt_node_stream_delete(gff3);
+  gt_array_delete(deltaarray);
+  gt_error_delete(error);
+  return agn_unit_test_success(test);
+}
+
+static const GtNodeVisitorClass *locus_delta_visitor_class()
+{
+  static const GtNodeVisitorClass *nvc = NULL;
+  if(!nvc)
+  {
+    nvc = gt_node_visitor_class_new(sizeof (AgnLocusDeltaVisitor),
+                                    locus_delta_visitor_free, NULL,
+                                    locus_delta_visitor_visit_feature_node,
+                                    locus_delta_visitor_visit_region_node,
+                                    NULL, NULL);
+  }
+  return nvc;
+}
+
+static void locus_delta_visitor_finish(AgnLocusDeltaVisitor *v)
+{
+  if(v->finished)
+    return;
+  v->finished = true;
+
+  if(v->prev_locus != NULL)
+  {
+    GtStr *seqid = gt_genome_node_get_seqid(v->prev_locus);
+    LocusDeltaSequence *seq = gt_hashmap_get(v->seqsbyid, gt_str_get(seqid));
+    locus_delta_visitor_terminal(v, v->prev_locus, seq);
+    gt_genome_node_delete(v->prev_locus);
+    v->prev_locus = NULL;
+  }
+
+  if(v->endmode < 0 || v->skip_iiLoci)
+    return;
+  GtUword i, j;
+  for(i = 0; i < gt_array_size(v->sequences); i++)
+  {
+    LocusDeltaSequence **seq = gt_array_get(v->sequences, i);
+    if((*seq)->annotated)
+      continue;
+    for(j = 0; j < gt_array_size(v->summaries); j++)
+    {
+      LocusDeltaSummary *summary = gt_array_get(v->summaries, j);
+      if(summary->delta == 0)
+        continue;
+      summary->filoci++;
+      summary->filocus_bp += gt_range_length(&(*seq)->range);
+    }
+  }
+}
+
+static void locus_delta_visitor_free(GtNodeVisitor *nv)
+{
+  AgnLocusDeltaVisitor *v = locus_delta_visitor_cast(nv);
+  if(v->prev_locus != NULL)
+    gt_genome_node_delete(v->prev_locus);
+  gt_array_delete(v->summaries);
+  gt_array_delete(v->sequences);
+  gt_hashmap_delete(v->seqsbyid);
+}
+
+static void locus_delta_visitor_initial(AgnLocusDeltaVisitor *v,
+                                        AgnLocus *locus,
+                                        LocusDeltaSequence *seq)
+{
+  if(seq == NULL || v->endmode < 0 || v->skip_iiLoci)
+    return;
+
+  GtRange range = gt_genome_node_get_range(locus);
+  GtUword i;
+  for(i = 0; i < gt_array_size(v->summaries); i++)
+  {
+    LocusDeltaSummary *summary = gt_array_get(v->summaries, i);
+    GtUword delta = summary->delta;
+    if(delta > 0 && range.start >= seq->range.start + (2*delta))
+    {
+      summary->filoci++;
+      summary->filocus_bp += range.start - delta - seq->range.start;
+    }
+  }
+}
+
+static void locus_delta_visitor_internal(AgnLocusDeltaVisitor *v,
+                                         AgnLocus *prev, AgnLocus *locus)
+{
+  const char *orientstrs[] = { "FF", "FR", "RF", "RR" };
+  const char *seqid = gt_str_get(gt_genome_node_get_seqid(locus));
+  GtRange prev_range = gt_genome_node_get_range(prev);
+  GtRange range = gt_genome_node_get_range(locus);
+  int orient = agn_locus_inner_orientation(prev, locus);
+  GtUword genenum = agn_typecheck_count(gt_feature_node_cast(locus),
+                                        agn_typecheck_gene);
+  GtUword i, k;
+  for(i = 0; i < gt_array_size(v->summaries); i++)
+  {
+    LocusDeltaSummary *summary = gt_array_get(v->summaries, i);
+    GtUword delta = summary->delta;
+    if(delta == 0)
+      continue;
+
+    if(prev_range.end + (3*delta) >= range.start)
+    {
+      if(v->ilenfile != NULL)
+      {
+        fprintf(v->ilenfile, "%lu\t%s\t0\t%s\n", delta, seqid,
+                orientstrs[orient]);
+      }
+    }
+    else if(v->endmode <= 0 && !v->skip_iiLoci)
+    {
+      GtUword length = range.start - prev_range.end - (2*delta) - 1;
+      summary->iiloci++;
+      summary->iilocus_bp += length;
+      if(v->ilenfile != NULL)
+      {
+        fprintf(v->ilenfile, "%lu\t%s\t%lu\t%s\n", delta, seqid, length,
+                orientstrs[orient]);
+      }
+    }
+
+    if(v->ilenfile != NULL)
+    {
+      for(k = 1; k < genenum; k++)
+        fprintf(v->ilenfile, "%lu\t%s\t0\tNA\n", delta, seqid);
+    }
+  }
+}
+
+static void locus_delta_visitor_terminal(AgnLocusDeltaVisitor *v,
+                                         AgnLocus *locus,
+                                         LocusDeltaSequence *seq)
+{
+  if(seq == NULL || v->endmode < 0 || v->skip_iiLoci)
+    return;
+
+  GtRange range = gt_genome_node_get_range(locus);
+  GtUword i;
+  for(i = 0; i < gt_array_size(v->summaries); i++)
+  {
+    LocusDeltaSummary *summary = gt_array_get(v->summaries, i);
+    GtUword delta = summary->delta;
+    if(delta > 0 && seq->range.end > (2*delta) &&
+       range.end <= seq->range.end - (2*delta))
+    {
+      summary->filoci++;
+      summary->filocus_bp += seq->range.end - range.end - delta;
+    }
+  }
+}
+
+static void locus_delta_visitor_test_stream(const char *filename,
+                                            LocusDeltaSummary *summary)
+{
+  GtError *error = gt_error_new();
+  GtArray *loci = gt_array_new( sizeof(AgnLocus *) );
+  GtNodeStream *gff3 = gt_gff3_in_stream_new_unsorted(1, &filename);
+  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)gff3);
+  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)gff3);
+  GtNodeStream *lstream = agn_locus_stream_new(gff3, summary->delta);
+  GtNodeStream *aos = gt_array_out_stream_new(lstream, loci, error);
+  gt_node_stream_pull(aos, error);
+
+  while(gt_array_size(loci) > 0)
+  {
+    AgnLocus **locus = gt_array_pop(loci);
+    GtRange range = gt_genome_node_get_range(*locus);
+    const char *type = gt_genome_node_get_user_data(*locus, "iLocus_type");
+    if(gt_feature_node_number_of_children(gt_feature_node_cast(*locus)) > 0)
+      summary->giloci++;
+    else if(type != NULL && strcmp(type, "fiLocus") == 0)
+    {
+      summary->filoci++;
+      summary->filocus_bp += gt_range_length(&range);
+    }
+    else
+    {
+      summary->iiloci++;
+      summary->iilocus_bp += gt_range_length(&range);
+    }
+    agn_locus_delete(*locus);
+  }
+
+  gt_node_stream_delete(aos);
+  gt_node_stream_delete(lstream);
+  gt_node_stream_delete(gff3);
+  gt_array_delete(loci);
+  gt_error_delete(error);
+}
+
+static int locus_delta_visitor_visit_feature_node(GtNodeVisitor *nv,
+                                                  GtFeatureNode *fn,
+                                                  GtError *error)
+{
+  AgnLocusDeltaVisitor *v = locus_delta_visitor_cast(nv);
+  gt_error_check(error);
+  agn_assert(gt_feature_node_has_type(fn, "locus"));
+
+  GtGenomeNode *locus = (GtGenomeNode *)fn;
+  GtStr *seqid = gt_genome_node_get_seqid(locus);
+  LocusDeltaSequence *seq = gt_hashmap_get(v->seqsbyid, gt_str_get(seqid));
+  if(seq != NULL)
+    seq->annotated = true;
+
+  GtUword i;
+  for(i = 0; i < gt_array_size(v->summaries); i++)
+  {
+    LocusDeltaSummary *summary = gt_array_get(v->summaries, i);
+    summary->giloci++;
+  }
+
+  if(v->prev_locus != NULL &&
+     gt_str_cmp(gt_genome_node_get_seqid(v->prev_locus), seqid) == 0)
+  {
+    locus_delta_visitor_internal(v, v->prev_locus, locus);
+  }
+  else
+  {
+    if(v->prev_locus != NULL)
+    {
+      GtStr *prev_seqid = gt_genome_node_get_seqid(v->prev_locus);
+      LocusDeltaSequence *prev_seq = gt_hashmap_get(v->seqsbyid,
+                                                    gt_str_get(prev_seqid));
+      locus_delta_visitor_terminal(v, v->prev_locus, prev_seq);
+    }
+    locus_delta_visitor_initial(v, locus, seq);
+  }
+
+  if(v->prev_locus != NULL)
+    gt_genome_node_delete(v->prev_locus);
+  v->prev_locus = gt_genome_node_ref(locus);
+  return 0;
+}
+
+static int locus_delta_visitor_visit_region_node(GtNodeVisitor *nv,
+                                                 GtRegionNode *rn,
+                                                 GtError *error)
+{
+  AgnLocusDeltaVisitor *v = locus_delta_visitor_cast(nv);
+  gt_error_check(error);
+
+  GtGenomeNode *gn = (GtGenomeNode *)rn;
+  const char *seqid = gt_str_get(gt_genome_node_get_seqid(gn));
+  GtRange range = gt_genome_node_get_range(gn);
+  LocusDeltaSequence *seq = gt_hashmap_get(v->seqsbyid, seqid);
+  if(seq != NULL)
+  {
+    seq->range = gt_range_join(&seq->range, &range);
+    return 0;
+  }
+
+  seq = gt_malloc( sizeof(LocusDeltaSequence) );
+  seq->range = range;
+  seq->annotated = false;
+  gt_hashmap_add(v->seqsbyid, gt_cstr_dup(seqid), seq);
+  gt_array_add(v->sequences, seq);
+  return 0;
+}
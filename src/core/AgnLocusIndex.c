@@ -0,0 +1,444 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "extended/array_out_stream_api.h"
+#include "AgnLocusIndex.h"
+#include "AgnLocusStream.h"
+#include "AgnUtils.h"
+
+//------------------------------------------------------------------------------
+// Data structure definition
+//------------------------------------------------------------------------------
+
+struct AgnLocusIndex
+{
+  void *map;
+  size_t mapsize;
+  const AgnLocusIndexHeader *header;
+  const AgnLocusIndexSeq *seqs;
+  const AgnLocusIndexEntry *entries;
+  const char *strtab;
+};
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Binary search for the directory entry of the given sequence.
+ * Returns NULL if the index contains no iLoci for the sequence.
+ */
+static const AgnLocusIndexSeq *locus_index_seq(AgnLocusIndex *index,
+                                               const char *seqid);
+
+/**
+ * @function Compute iLoci for the given GFF3 file, write an index of them to
+ * ``indexfile``, and store the iLoci in ``loci``.
+ */
+static void locus_index_test_data(const char *filename, const char *indexfile,
+                                  GtArray *loci);
+
+/**
+ * @function Check that every count, index, and string offset in the index
+ * mapped at ``map`` lies within the ``mapsize`` bytes of the mapping. Returns
+ * NULL if the index is valid, or a description of the first problem found.
+ */
+static const char *locus_index_validate(const void *map, size_t mapsize);
+
+/**
+ * @function Copy ``indexfile``, overwriting ``size`` bytes at ``offset`` with
+ * ``value`` (a negative offset counts from the end of the file), and return
+ * true if loading the corrupted copy fails.
+ */
+static bool locus_index_test_corrupt(const char *indexfile, long offset,
+                                     const void *value, size_t size);
+
+/**
+ * @function Find the iLoci in ``loci`` overlapping the given range by brute
+ * force, and compare with the result of an index lookup.
+ */
+static bool locus_index_test_query(AgnLocusIndex *index, GtArray *loci,
+                                   const char *seqid, GtUword start,
+                                   GtUword end);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+bool agn_locus_index_check(const char *filename)
+{
+  char magic[8];
+  FILE *instream = fopen(filename, "rb");
+  if(instream == NULL)
+    return false;
+  bool isindex = fread(magic, sizeof(magic), 1, instream) == 1 &&
+                 memcmp(magic, AGN_LOCUS_INDEX_MAGIC, sizeof(magic)) == 0;
+  fclose(instream);
+  return isindex;
+}
+
+void agn_locus_index_delete(AgnLocusIndex *index)
+{
+  munmap(index->map, index->mapsize);
+  gt_free(index);
+}
+
+GtUword agn_locus_index_lookup(AgnLocusIndex *index, const char *seqid,
+                               GtUword start, GtUword end, GtArray *hits)
+{
+  agn_assert(index && seqid && hits && start <= end);
+  const AgnLocusIndexSeq *seq = locus_index_seq(index, seqid);
+  if(seq == NULL)
+    return 0;
+  const AgnLocusIndexEntry *entries = index->entries + seq->firstlocus;
+
+  // Records past the first one starting after the query cannot overlap it...
+  GtUword lo = 0, hi = seq->numloci;
+  while(lo < hi)
+  {
+    GtUword mid = lo + (hi - lo) / 2;
+    if(entries[mid].start <= end)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  GtUword last = lo;
+
+  // ...and neither can records before the first one whose running maximum
+  // end coordinate reaches the query.
+  lo = 0;
+  hi = last;
+  while(lo < hi)
+  {
+    GtUword mid = lo + (hi - lo) / 2;
+    if(entries[mid].maxend < start)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  GtUword i, numhits = 0;
+  for(i = lo; i < last; i++)
+  {
+    if(entries[i].end < start)
+      continue;
+    AgnLocusIndexHit hit = { index->strtab + seq->seqid, entries[i].start,
+                             entries[i].end, index->strtab + entries[i].id,
+                             index->strtab + entries[i].type };
+    gt_array_add(hits, hit);
+    numhits++;
+  }
+  return numhits;
+}
+
+AgnLocusIndex *agn_locus_index_new(const char *filename, GtError *error)
+{
+  AgnLocusIndex *index;
+  struct stat filestats;
+  void *map;
+  int fd;
+
+  fd = open(filename, O_RDONLY);
+  if(fd < 0 || fstat(fd, &filestats) != 0)
+  {
+    if(fd >= 0)
+      close(fd);
+    gt_error_set(error, "cannot open iLocus index '%s'", filename);
+    return NULL;
+  }
+  if((size_t)filestats.st_size < sizeof(AgnLocusIndexHeader))
+  {
+    close(fd);
+    gt_error_set(error, "'%s' is not an iLocus index", filename);
+    return NULL;
+  }
+  map = mmap(NULL, filestats.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED)
+  {
+    gt_error_set(error, "cannot map iLocus index '%s'", filename);
+    return NULL;
+  }
+
+  const AgnLocusIndexHeader *header = map;
+  if(memcmp(header->magic, AGN_LOCUS_INDEX_MAGIC,
+            sizeof(header->magic)) != 0 ||
+     header->version != AGN_LOCUS_INDEX_VERSION)
+  {
+    munmap(map, filestats.st_size);
+    gt_error_set(error, "'%s' is not a valid iLocus index (version %d)",
+                 filename, AGN_LOCUS_INDEX_VERSION);
+    return NULL;
+  }
+  const char *problem = locus_index_validate(map, filestats.st_size);
+  if(problem != NULL)
+  {
+    munmap(map, filestats.st_size);
+    gt_error_set(error, "iLocus index '%s' is corrupt: %s", filename, problem);
+    return NULL;
+  }
+
+  index = gt_malloc( sizeof(AgnLocusIndex) );
+  index->map = map;
+  index->mapsize = filestats.st_size;
+  index->header = header;
+  index->seqs = (const AgnLocusIndexSeq *)(header + 1);
+  index->entries = (const AgnLocusIndexEntry *)
+                   (index->seqs + header->numseqs);
+  index->strtab = (const char *)(index->entries + header->numloci);
+  return index;
+}
+
+bool agn_locus_index_unit_test(AgnUnitTest *test)
+{
+  const char *infile = "data/gff3/ilocus.in.gff3";
+  char indexfile[] = "/tmp/agn-locus-index-XXXXXX";
+  int fd = mkstemp(indexfile);
+  agn_assert(fd >= 0);
+  close(fd);
+
+  GtArray *loci = gt_array_new( sizeof(GtFeatureNode *) );
+  locus_index_test_data(infile, indexfile, loci);
+
+  GtError *error = gt_error_new();
+  AgnLocusIndex *index = agn_locus_index_new(indexfile, error);
+  bool loadsuccess = index != NULL &&
+                     agn_locus_index_check(indexfile) &&
+                     !agn_locus_index_check(infile) &&
+                     gt_array_size(loci) > 0 &&
+                     index->header->numloci == gt_array_size(loci);
+  agn_unit_test_result(test, "load index", loadsuccess);
+
+  if(index != NULL)
+  {
+    bool pointsuccess = true, rangesuccess = true;
+    GtUword i;
+    for(i = 0; i < gt_array_size(loci); i++)
+    {
+      GtGenomeNode *locus = *(GtGenomeNode **)gt_array_get(loci, i);
+      const char *seqid = gt_str_get(gt_genome_node_get_seqid(locus));
+      GtRange range = gt_genome_node_get_range(locus);
+      GtUword before = range.start > 1 ? range.start - 1 : 1;
+      pointsuccess = pointsuccess &&
+        locus_index_test_query(index, loci, seqid, range.start, range.start) &&
+        locus_index_test_query(index, loci, seqid, range.end, range.end) &&
+        locus_index_test_query(index, loci, seqid, before, before);
+      rangesuccess = rangesuccess &&
+        locus_index_test_query(index, loci, seqid, before, range.end + 1000);
+    }
+    GtArray *hits = gt_array_new( sizeof(AgnLocusIndexHit) );
+    pointsuccess = pointsuccess &&
+      agn_locus_index_lookup(index, "bogusseq", 1, 1000000, hits) == 0 &&
+      gt_array_size(hits) == 0;
+    gt_array_delete(hits);
+    agn_unit_test_result(test, "point lookups", pointsuccess);
+    agn_unit_test_result(test, "range lookups", rangesuccess);
+
+    AgnLocusIndexHeader header = *index->header;
+    GtUint64 badlocus = header.numloci;
+    long seqoffset = sizeof(AgnLocusIndexHeader) +
+                     offsetof(AgnLocusIndexSeq, firstlocus);
+    long entryoffset = sizeof(AgnLocusIndexHeader) +
+                       header.numseqs * sizeof(AgnLocusIndexSeq) +
+                       offsetof(AgnLocusIndexEntry, id);
+    bool corruptsuccess = header.numseqs > 0 &&
+      locus_index_test_corrupt(indexfile, -1, "x", 1) &&
+      locus_index_test_corrupt(indexfile, seqoffset, &badlocus,
+                               sizeof(badlocus)) &&
+      locus_index_test_corrupt(indexfile, entryoffset, &header.strtabsize,
+                               sizeof(header.strtabsize));
+    agn_unit_test_result(test, "corrupt indexes", corruptsuccess);
+    agn_locus_index_delete(index);
+  }
+
+  while(gt_array_size(loci) > 0)
+  {
+    GtGenomeNode **gn = gt_array_pop(loci);
+    gt_genome_node_delete(*gn);
+  }
+  gt_array_delete(loci);
+  gt_error_delete(error);
+  unlink(indexfile);
+
+  return agn_unit_test_success(test);
+}
+
+static const AgnLocusIndexSeq *locus_index_seq(AgnLocusIndex *index,
+                                               const char *seqid)
+{
+  GtUword lo = 0, hi = index->header->numseqs;
+  while(lo < hi)
+  {
+    GtUword mid = lo + (hi - lo) / 2;
+    int cmp = strcmp(seqid, index->strtab + index->seqs[mid].seqid);
+    if(cmp == 0)
+      return index->seqs + mid;
+    if(cmp < 0)
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+  return NULL;
+}
+
+static bool locus_index_test_corrupt(const char *indexfile, long offset,
+                                     const void *value, size_t size)
+{
+  char corruptfile[] = "/tmp/agn-locus-index-XXXXXX";
+  int fd = mkstemp(corruptfile);
+  agn_assert(fd >= 0);
+  FILE *outstream = fdopen(fd, "wb");
+  FILE *instream = fopen(indexfile, "rb");
+  agn_assert(outstream != NULL && instream != NULL);
+  char buffer[4096];
+  size_t length;
+  while((length = fread(buffer, 1, sizeof(buffer), instream)) > 0)
+    fwrite(buffer, 1, length, outstream);
+  fclose(instream);
+  fseek(outstream, offset, offset < 0 ? SEEK_END : SEEK_SET);
+  fwrite(value, 1, size, outstream);
+  fclose(outstream);
+
+  GtError *error = gt_error_new();
+  AgnLocusIndex *index = agn_locus_index_new(corruptfile, error);
+  bool rejected = index == NULL && gt_error_is_set(error);
+  if(index != NULL)
+    agn_locus_index_delete(index);
+  gt_error_delete(error);
+  unlink(corruptfile);
+  return rejected;
+}
+
+static void locus_index_test_data(const char *filename, const char *indexfile,
+                                  GtArray *loci)
+{
+  GtNodeStream *current_stream, *last_stream;
+  GtQueue *streams = gt_queue_new();
+  GtError *error = gt_error_new();
+  FILE *outstream = fopen(indexfile, "wb");
+  agn_assert(outstream != NULL);
+
+  current_stream = gt_gff3_in_stream_new_unsorted(1, &filename);
+  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)current_stream);
+  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)current_stream);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  current_stream = agn_locus_stream_new(last_stream, 200);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  current_stream = agn_locus_index_out_stream_new(last_stream, outstream);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  current_stream = gt_array_out_stream_new(last_stream, loci, error);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  int result = gt_node_stream_pull(last_stream, error);
+  if(result == -1)
+  {
+    fprintf(stderr, "[AEGeAn::AgnLocusIndex] error processing node "
+            "stream: %s\n", gt_error_get(error));
+  }
+
+  while(gt_queue_size(streams) > 0)
+  {
+    current_stream = gt_queue_get(streams);
+    gt_node_stream_delete(current_stream);
+  }
+  gt_queue_delete(streams);
+  fclose(outstream);
+  gt_error_delete(error);
+}
+
+static const char *locus_index_validate(const void *map, size_t mapsize)
+{
+  const AgnLocusIndexHeader *header = map;
+  size_t remaining = mapsize - sizeof(AgnLocusIndexHeader);
+  if(header->numseqs > remaining / sizeof(AgnLocusIndexSeq))
+    return "sequence directory exceeds file size";
+  remaining -= header->numseqs * sizeof(AgnLocusIndexSeq);
+  if(header->numloci > remaining / sizeof(AgnLocusIndexEntry))
+    return "iLocus records exceed file size";
+  remaining -= header->numloci * sizeof(AgnLocusIndexEntry);
+  if(header->strtabsize != remaining)
+    return "string table size does not match file size";
+
+  const AgnLocusIndexSeq *seqs = (const AgnLocusIndexSeq *)(header + 1);
+  const AgnLocusIndexEntry *entries = (const AgnLocusIndexEntry *)
+                                      (seqs + header->numseqs);
+  const char *strtab = (const char *)(entries + header->numloci);
+  GtUint64 strtabsize = header->strtabsize;
+  if(strtabsize == 0 && (header->numseqs > 0 || header->numloci > 0))
+    return "string table is empty";
+  if(strtabsize > 0 && strtab[strtabsize - 1] != '\0')
+    return "string table is not NUL-terminated";
+
+  GtUword i;
+  for(i = 0; i < header->numseqs; i++)
+  {
+    const AgnLocusIndexSeq *seq = seqs + i;
+    if(seq->seqid >= strtabsize)
+      return "sequence ID out of range";
+    if(i > 0 && strcmp(strtab + seqs[i-1].seqid, strtab + seq->seqid) >= 0)
+      return "sequence directory is not sorted";
+    if(seq->firstlocus > header->numloci ||
+       seq->numloci > header->numloci - seq->firstlocus)
+      return "sequence iLocus range out of range";
+  }
+  for(i = 0; i < header->numloci; i++)
+  {
+    if(entries[i].id >= strtabsize || entries[i].type >= strtabsize)
+      return "iLocus ID or type out of range";
+  }
+
+  return NULL;
+}
+
+static bool locus_index_test_query(AgnLocusIndex *index, GtArray *loci,
+                                   const char *seqid, GtUword start,
+                                   GtUword end)
+{
+  GtArray *hits = gt_array_new( sizeof(AgnLocusIndexHit) );
+  GtUword numhits = agn_locus_index_lookup(index, seqid, start, end, hits);
+  GtUword i, expected = 0;
+  bool success = numhits == gt_array_size(hits);
+  for(i = 0; success && i < gt_array_size(loci); i++)
+  {
+    GtGenomeNode *locus = *(GtGenomeNode **)gt_array_get(loci, i);
+    GtRange range = gt_genome_node_get_range(locus);
+    if(strcmp(gt_str_get(gt_genome_node_get_seqid(locus)), seqid) != 0 ||
+       range.end < start || range.start > end)
+      continue;
+
+    const char *label = agn_feature_node_get_label((GtFeatureNode *)locus);
+    bool found = false;
+    GtUword j;
+    for(j = 0; !found && j < gt_array_size(hits); j++)
+    {
+      AgnLocusIndexHit *hit = gt_array_get(hits, j);
+      found = hit->start == range.start && hit->end == range.end &&
+              strcmp(hit->id, label) == 0 && strcmp(hit->seqid, seqid) == 0;
+    }
+    success = found;
+    expected++;
+  }
+  gt_array_delete(hits);
+  return success && expected == numhits;
+}
@@ -0,0 +1,319 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include <stdlib.h>
+#include <string.h>
+#include "core/hashmap_api.h"
+#include "AgnLocusIndexOutStream.h"
+#include "AgnUtils.h"
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+struct AgnLocusIndexOutStream
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in_stream;
+  FILE *outstream;
+  GtArray *seqs;
+  GtArray *loci;
+  GtStr *strtab;
+  GtHashmap *stroffsets;
+  GtHashmap *seqindex;
+  bool written;
+};
+
+typedef struct
+{
+  GtUint64 seq;
+  AgnLocusIndexEntry entry;
+} LocusIndexRecord;
+
+typedef struct
+{
+  const char *seqid;
+  GtUword index;
+} LocusIndexSeqRank;
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+#define locus_index_out_stream_cast(GS)\
+        gt_node_stream_cast(locus_index_out_stream_class(), GS)
+
+/**
+ * @function Implements the GtNodeStream interface for this class.
+ */
+static const GtNodeStreamClass* locus_index_out_stream_class(void);
+
+/**
+ * @function Class destructor.
+ */
+static void locus_index_out_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Pulls nodes from the input stream, records each iLocus, and passes
+ * the nodes on. When the input stream is exhausted, the index is written.
+ */
+static int locus_index_out_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                       GtError *error);
+
+/**
+ * @function Comparison function for sorting iLocus records by sequence, start,
+ * and end.
+ */
+static int locus_index_out_stream_record_compare(const void *p1,
+                                                 const void *p2);
+
+/**
+ * @function Comparison function for sorting sequences by ID.
+ */
+static int locus_index_out_stream_seq_compare(const void *p1, const void *p2);
+
+/**
+ * @function Add a string to the string table (unless already present) and
+ * return its offset.
+ */
+static GtUint64 locus_index_out_stream_string(AgnLocusIndexOutStream *stream,
+                                              const char *string);
+
+/**
+ * @function Sort the recorded iLoci and write the index to the output file.
+ */
+static int locus_index_out_stream_write(AgnLocusIndexOutStream *stream,
+                                        GtError *error);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream *agn_locus_index_out_stream_new(GtNodeStream *in_stream,
+                                             FILE *outstream)
+{
+  GtNodeStream *ns;
+  AgnLocusIndexOutStream *stream;
+  agn_assert(in_stream && outstream);
+  ns = gt_node_stream_create(locus_index_out_stream_class(), false);
+  stream = locus_index_out_stream_cast(ns);
+  stream->in_stream = gt_node_stream_ref(in_stream);
+  stream->outstream = outstream;
+  stream->seqs = gt_array_new( sizeof(AgnLocusIndexSeq) );
+  stream->loci = gt_array_new( sizeof(LocusIndexRecord) );
+  stream->strtab = gt_str_new();
+  stream->stroffsets = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
+                                      gt_free_func);
+  stream->seqindex = gt_hashmap_new(GT_HASH_STRING, gt_free_func, gt_free_func);
+  stream->written = false;
+  return ns;
+}
+
+static const GtNodeStreamClass *locus_index_out_stream_class(void)
+{
+  static const GtNodeStreamClass *nsc = NULL;
+  if(!nsc)
+  {
+    nsc = gt_node_stream_class_new(sizeof (AgnLocusIndexOutStream),
+                                   locus_index_out_stream_free,
+                                   locus_index_out_stream_next);
+  }
+  return nsc;
+}
+
+static void locus_index_out_stream_free(GtNodeStream *ns)
+{
+  AgnLocusIndexOutStream *stream = locus_index_out_stream_cast(ns);
+  gt_node_stream_delete(stream->in_stream);
+  gt_array_delete(stream->seqs);
+  gt_array_delete(stream->loci);
+  gt_str_delete(stream->strtab);
+  gt_hashmap_delete(stream->stroffsets);
+  gt_hashmap_delete(stream->seqindex);
+}
+
+static int locus_index_out_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                       GtError *error)
+{
+  AgnLocusIndexOutStream *stream;
+  int result;
+  gt_error_check(error);
+  stream = locus_index_out_stream_cast(ns);
+
+  result = gt_node_stream_next(stream->in_stream, gn, error);
+  if(result)
+    return result;
+  if(*gn == NULL)
+  {
+    if(stream->written)
+      return 0;
+    stream->written = true;
+    return locus_index_out_stream_write(stream, error);
+  }
+
+  GtFeatureNode *fn = gt_feature_node_try_cast(*gn);
+  if(fn == NULL || !gt_feature_node_has_type(fn, "locus"))
+    return 0;
+
+  const char *seqid = gt_str_get(gt_genome_node_get_seqid(*gn));
+  GtUword *seqindex = gt_hashmap_get(stream->seqindex, seqid);
+  if(seqindex == NULL)
+  {
+    AgnLocusIndexSeq seq = { locus_index_out_stream_string(stream, seqid),
+                             0, 0 };
+    gt_array_add(stream->seqs, seq);
+    seqindex = gt_malloc( sizeof(GtUword) );
+    *seqindex = gt_array_size(stream->seqs) - 1;
+    gt_hashmap_add(stream->seqindex, gt_cstr_dup(seqid), seqindex);
+  }
+
+  const char *type = gt_feature_node_get_attribute(fn, "iLocus_type");
+  if(type == NULL)
+    type = gt_genome_node_get_user_data(*gn, "iLocus_type");
+  if(type == NULL)
+    type = "locus";
+  GtRange range = gt_genome_node_get_range(*gn);
+  LocusIndexRecord record;
+  record.seq = *seqindex;
+  record.entry.start = range.start;
+  record.entry.end = range.end;
+  record.entry.maxend = range.end;
+  record.entry.id = locus_index_out_stream_string(stream,
+                                              agn_feature_node_get_label(fn));
+  record.entry.type = locus_index_out_stream_string(stream, type);
+  gt_array_add(stream->loci, record);
+
+  return 0;
+}
+
+static int locus_index_out_stream_record_compare(const void *p1,
+                                                 const void *p2)
+{
+  const LocusIndexRecord *r1 = p1;
+  const LocusIndexRecord *r2 = p2;
+  if(r1->seq != r2->seq)
+    return r1->seq < r2->seq ? -1 : 1;
+  if(r1->entry.start != r2->entry.start)
+    return r1->entry.start < r2->entry.start ? -1 : 1;
+  if(r1->entry.end != r2->entry.end)
+    return r1->entry.end < r2->entry.end ? -1 : 1;
+  return 0;
+}
+
+static int locus_index_out_stream_seq_compare(const void *p1, const void *p2)
+{
+  const LocusIndexSeqRank *s1 = p1;
+  const LocusIndexSeqRank *s2 = p2;
+  return strcmp(s1->seqid, s2->seqid);
+}
+
+static GtUint64 locus_index_out_stream_string(AgnLocusIndexOutStream *stream,
+                                              const char *string)
+{
+  GtUint64 *offset = gt_hashmap_get(stream->stroffsets, string);
+  if(offset != NULL)
+    return *offset;
+
+  offset = gt_malloc( sizeof(GtUint64) );
+  *offset = gt_str_length(stream->strtab);
+  gt_str_append_cstr(stream->strtab, string);
+  gt_str_append_char(stream->strtab, '\0');
+  gt_hashmap_add(stream->stroffsets, gt_cstr_dup(string), offset);
+  return *offset;
+}
+
+static int locus_index_out_stream_write(AgnLocusIndexOutStream *stream,
+                                        GtError *error)
+{
+  GtUword numseqs = gt_array_size(stream->seqs);
+  GtUword numloci = gt_array_size(stream->loci);
+  GtUword i;
+
+  // Sort sequences by ID, and then iLoci by sequence rank and position.
+  const char *strtab = gt_str_get_mem(stream->strtab);
+  LocusIndexSeqRank *ranks = gt_calloc(numseqs + 1, sizeof(LocusIndexSeqRank));
+  GtUword *rankofseq = gt_calloc(numseqs + 1, sizeof(GtUword));
+  for(i = 0; i < numseqs; i++)
+  {
+    AgnLocusIndexSeq *seq = gt_array_get(stream->seqs, i);
+    ranks[i].seqid = strtab + seq->seqid;
+    ranks[i].index = i;
+  }
+  qsort(ranks, numseqs, sizeof(LocusIndexSeqRank),
+        locus_index_out_stream_seq_compare);
+  for(i = 0; i < numseqs; i++)
+    rankofseq[ranks[i].index] = i;
+
+  LocusIndexRecord *records = gt_array_get_space(stream->loci);
+  for(i = 0; i < numloci; i++)
+    records[i].seq = rankofseq[records[i].seq];
+  qsort(records, numloci, sizeof(LocusIndexRecord),
+        locus_index_out_stream_record_compare);
+
+  // Build the sequence directory and compute the running maximum end
+  // coordinate of each sequence's iLoci.
+  AgnLocusIndexSeq *seqs = gt_calloc(numseqs + 1, sizeof(AgnLocusIndexSeq));
+  AgnLocusIndexEntry *entries = gt_calloc(numloci + 1,
+                                          sizeof(AgnLocusIndexEntry));
+  for(i = 0; i < numseqs; i++)
+  {
+    AgnLocusIndexSeq *seq = gt_array_get(stream->seqs, ranks[i].index);
+    seqs[i].seqid = seq->seqid;
+  }
+  for(i = 0; i < numloci; i++)
+  {
+    AgnLocusIndexSeq *seq = seqs + records[i].seq;
+    entries[i] = records[i].entry;
+    if(seq->numloci == 0)
+      seq->firstlocus = i;
+    else if(entries[i - 1].maxend > entries[i].maxend)
+      entries[i].maxend = entries[i - 1].maxend;
+    seq->numloci++;
+  }
+
+  AgnLocusIndexHeader header;
+  memset(&header, 0, sizeof(header));
+  strcpy(header.magic, AGN_LOCUS_INDEX_MAGIC);
+  header.version = AGN_LOCUS_INDEX_VERSION;
+  header.numseqs = numseqs;
+  header.numloci = numloci;
+  header.strtabsize = gt_str_length(stream->strtab);
+
+  bool success = fwrite(&header, sizeof(header), 1, stream->outstream) == 1;
+  if(success && header.numseqs > 0)
+  {
+    success = fwrite(seqs, sizeof(AgnLocusIndexSeq), header.numseqs,
+                     stream->outstream) == header.numseqs;
+  }
+  if(success && header.numloci > 0)
+  {
+    success = fwrite(entries, sizeof(AgnLocusIndexEntry), header.numloci,
+                     stream->outstream) == header.numloci;
+  }
+  if(success && header.strtabsize > 0)
+  {
+    success = fwrite(strtab, 1, header.strtabsize,
+                     stream->outstream) == header.strtabsize;
+  }
+  if(success)
+    success = fflush(stream->outstream) == 0;
+
+  gt_free(ranks);
+  gt_free(rankofseq);
+  gt_free(seqs);
+  gt_free(entries);
+  if(!success)
+  {
+    gt_error_set(error, "error writing iLocus index");
+    return -1;
+  }
+  return 0;
+}
@@ -8,8 +8,12 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
 
+#include <stdlib.h>
 #include <string.h>
 #include "core/queue_api.h"
+#include "core/undef_api.h"
+#include "extended/array_in_stream_api.h"
+#include "extended/feature_node_iterator_api.h"
 #include "extended/sort_stream_api.h"
 #include "AgnGeneStream.h"
 #include "AgnLocus.h"
@@ -40,6 +44,12 @@ struct AgnLocusRefineStream
   FILE *ilenfile;
 };
 
+typedef struct
+{
+  GtRange range;
+  GtUword index;
+} LocusRefineInterval;
+
 //------------------------------------------------------------------------------
 // Prototypes for private functions
 //------------------------------------------------------------------------------
@@ -47,7 +57,9 @@ struct AgnLocusRefineStream
 /**
  * @function Collect iLocus children (typically genes) into overlapping bins.
  * Overlap may be determined by UTR coordinates or CDS coordinates, and coding
- * genes are not considered to overlap with non-coding genes.
+ * genes are not considered to overlap with non-coding genes. Bins are the
+ * connected components of the overlap graph, computed by sorting and sweeping
+ * over the relevant ranges and merging with union-find.
  */
 static
 GtArray *locus_refine_stream_bin_features(AgnLocusRefineStream *stream,
@@ -72,6 +84,12 @@ static const GtNodeStreamClass *locus_refine_stream_class(void);
 static void locus_refine_stream_extend(AgnLocusRefineStream *stream,
                                        GtArray *iloci, AgnLocus *orig);
 
+/**
+ * @function Union-find: return the representative of the set containing
+ * feature ``i``, compressing the path along the way.
+ */
+static GtUword locus_refine_stream_find(GtUword *parents, GtUword i);
+
 /**
  * @function Destructor: release instance data.
  */
@@ -83,6 +101,13 @@ static void locus_refine_stream_free(GtNodeStream *ns);
 static int locus_refine_stream_handler(AgnLocusRefineStream *stream,
                                        GtGenomeNode *gn);
 
+/**
+ * @function Comparison function for sorting ``LocusRefineInterval`` objects by
+ * range.
+ */
+static int locus_refine_stream_interval_compare(const void *p1,
+                                                const void *p2);
+
 /**
  * @function While processing node i, it is often necessary to refer to the
  * nearest boundary of node i-1. However, in some cases the streaming
@@ -114,12 +139,37 @@ static int locus_refine_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
 static GtArray *locus_refine_stream_resolve_bins(AgnLocusRefineStream *stream,
                                                  GtArray *bins);
 
+/**
+ * @function Sort the given intervals and sweep over them, merging the sets of
+ * any two features whose ranges overlap by at least ``minoverlap`` bp. Since
+ * intervals are processed by start coordinate, an interval overlaps some
+ * member of the current component if and only if the component's maximum end
+ * coordinate reaches far enough, so each interval is handled in constant time.
+ */
+static void locus_refine_stream_sweep(LocusRefineInterval *intervals,
+                                      GtUword numintervals, GtUword minoverlap,
+                                      GtUword *parents);
+
 /**
  * @function Load data for unit tests.
  */
 static void locus_refine_stream_test_data(const char *filename, GtQueue *queue,
                                           GtUword delta);
 
+/**
+ * @function Bin genes A, B, C, and D, where A overlaps B, B overlaps C, A does
+ * not overlap C, and D overlaps nothing, presenting the genes to the binning
+ * procedure in two different orders. Returns true if both orders yield the
+ * bins {A, B, C} and {D}.
+ */
+static bool locus_refine_stream_test_nontransitive(bool by_cds);
+
+/**
+ * @function Union-find: merge the sets containing features ``i`` and ``j``.
+ * The feature with the smaller index becomes the representative.
+ */
+static void locus_refine_stream_union(GtUword *parents, GtUword i, GtUword j);
+
 //------------------------------------------------------------------------------
 // Method definitions
 //------------------------------------------------------------------------------
@@ -221,6 +271,10 @@ bool agn_locus_refine_stream_unit_test(AgnUnitTest *test)
   agn_unit_test_result(test, "Megachile rotundata CST: elen", test2a);
   gt_queue_delete(queue);
 
+  bool test3 = locus_refine_stream_test_nontransitive(true) &&
+               locus_refine_stream_test_nontransitive(false);
+  agn_unit_test_result(test, "non-transitive overlaps", test3);
+
   return agn_unit_test_success(test);
 }
 
@@ -232,36 +286,85 @@ GtArray *locus_refine_stream_bin_features(AgnLocusRefineStream *stream,
   GtUword numfeatures = gt_array_size(features);
   agn_assert(numfeatures >= 2);
 
-  GtArray *bins = gt_array_new( sizeof(GtArray *) );
-  GtArray *bin = gt_array_new( sizeof(GtGenomeNode *) );
-  GtGenomeNode **g1 = gt_array_get(features, 0);
-  gt_array_add(bin, *g1);
-  gt_array_add(bins, bin);
+  GtUword *parents = gt_malloc( sizeof(GtUword) * numfeatures );
+  LocusRefineInterval *coding = gt_malloc( sizeof(LocusRefineInterval) *
+                                           numfeatures );
+  LocusRefineInterval *noncoding = gt_malloc( sizeof(LocusRefineInterval) *
+                                              numfeatures );
+  GtUword i, numcoding = 0, numnoncoding = 0;
+  for(i = 0; i < numfeatures; i++)
+  {
+    GtFeatureNode **fn = gt_array_get(features, i);
+    parents[i] = i;
+    if(stream->by_cds)
+    {
+      GtRange cdsrange = agn_feature_node_get_cds_range(*fn);
+      if(cdsrange.end != 0)
+      {
+        coding[numcoding].range = cdsrange;
+        coding[numcoding].index = i;
+        numcoding++;
+        continue;
+      }
+    }
+    noncoding[numnoncoding].range = gt_genome_node_get_range(
+                                        (GtGenomeNode *)*fn);
+    noncoding[numnoncoding].index = i;
+    numnoncoding++;
+  }
 
-  GtUword i, j, current_bin = 0;
-  for(i = 1; i < numfeatures; i++)
+  // Coding features overlap by CDS, other features by their full range; a
+  // coding feature never overlaps a non-coding feature.
+  locus_refine_stream_sweep(coding, numcoding, stream->minoverlap, parents);
+  locus_refine_stream_sweep(noncoding, numnoncoding, stream->minoverlap,
+                            parents);
+
+  // Polycistrons: coding features with identical ranges belong together
+  // regardless of CDS overlap.
+  if(numcoding > 1)
   {
-    GtGenomeNode **gn = gt_array_get(features, i);
-    bin = *(GtArray **)gt_array_get(bins, current_bin);
-    bool overlaps = false;
-    for(j = 0; j < gt_array_size(bin); j++)
+    for(i = 0; i < numcoding; i++)
     {
-      GtGenomeNode **test_gn = gt_array_get(bin, j);
-      if(agn_overlap_ilocus(*gn, *test_gn, stream->minoverlap, stream->by_cds))
+      GtGenomeNode **gn = gt_array_get(features, coding[i].index);
+      coding[i].range = gt_genome_node_get_range(*gn);
+    }
+    qsort(coding, numcoding, sizeof(LocusRefineInterval),
+          locus_refine_stream_interval_compare);
+    for(i = 1; i < numcoding; i++)
+    {
+      if(gt_range_compare(&coding[i-1].range, &coding[i].range) == 0)
       {
-        overlaps = true;
-        gt_array_add(bin, *gn);
-        break;
+        locus_refine_stream_union(parents, coding[i-1].index,
+                                  coding[i].index);
       }
     }
-    if(!overlaps)
+  }
+
+  // Report components in the order of their first member.
+  GtArray *bins = gt_array_new( sizeof(GtArray *) );
+  GtUword *binindex = gt_malloc( sizeof(GtUword) * numfeatures );
+  for(i = 0; i < numfeatures; i++)
+    binindex[i] = GT_UNDEF_UWORD;
+  for(i = 0; i < numfeatures; i++)
+  {
+    GtGenomeNode **gn = gt_array_get(features, i);
+    GtUword root = locus_refine_stream_find(parents, i);
+    GtArray *bin;
+    if(binindex[root] == GT_UNDEF_UWORD)
     {
-      bin = gt_array_new( sizeof(GtFeatureNode *) );
-      gt_array_add(bin, *gn);
+      binindex[root] = gt_array_size(bins);
+      bin = gt_array_new( sizeof(GtGenomeNode *) );
       gt_array_add(bins, bin);
-      current_bin++;
     }
+    else
+      bin = *(GtArray **)gt_array_get(bins, binindex[root]);
+    gt_array_add(bin, *gn);
   }
+
+  gt_free(parents);
+  gt_free(binindex);
+  gt_free(coding);
+  gt_free(noncoding);
   gt_array_delete(features);
   return bins;
 }
@@ -287,24 +390,24 @@ static bool refine_locus_check_intron_genes(AgnLocusRefineStream *stream,
 
   GtFeatureNode *fn1 = gt_feature_node_cast(*gn1);
   GtFeatureNode *fn2 = gt_feature_node_cast(*gn2);
-  GtArray *exons = agn_typecheck_select(fn1, agn_typecheck_exon);
-  if(gt_array_size(exons) <= 1)
-  {
-    gt_array_delete(exons);
+  AgnTypeCensus census;
+  agn_typecheck_census(fn1, &census);
+  if(census.exon.count <= 1)
     return false;
-  }
 
-  GtUword i;
   bool overlap = false;
-  for(i = 0; i < gt_array_size(exons); i++)
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn1);
+  GtFeatureNode *exon;
+  for(exon  = gt_feature_node_iterator_next(iter);
+      exon != NULL && !overlap;
+      exon  = gt_feature_node_iterator_next(iter))
   {
-    GtGenomeNode **exon = gt_array_get(exons, i);
-    GtRange exonrange = gt_genome_node_get_range(*exon);
+    if(!agn_typecheck_exon(exon))
+      continue;
+    GtRange exonrange = gt_genome_node_get_range((GtGenomeNode *)exon);
     overlap = gt_range_overlap(&exonrange, &range2);
-    if(overlap)
-      break;
   }
-  gt_array_delete(exons);
+  gt_feature_node_iterator_delete(iter);
   if(overlap)
     return false;
 
@@ -496,8 +599,8 @@ static void locus_refine_stream_extend(AgnLocusRefineStream *stream,
     GtFeatureNode *fn1 = gt_feature_node_cast(*gn1);
     GtFeatureNode *fn2 = gt_feature_node_cast(*gn2);
 
-    bool cds1 = agn_typecheck_count(fn1, agn_typecheck_cds) > 0;;
-    if(cds1 == true)
+    // The first iLocus' coding status was determined above.
+    if(coding_status == true)
     {
       gt_feature_node_add_attribute(fn1, "iLocus_type", "siLocus");
       gt_feature_node_add_attribute(fn2, "iLocus_type", "niLocus");
@@ -645,6 +748,16 @@ static void locus_refine_stream_extend(AgnLocusRefineStream *stream,
   return;
 }
 
+static GtUword locus_refine_stream_find(GtUword *parents, GtUword i)
+{
+  while(parents[i] != i)
+  {
+    parents[i] = parents[parents[i]];
+    i = parents[i];
+  }
+  return i;
+}
+
 static void locus_refine_stream_free(GtNodeStream *ns)
 {
   agn_assert(ns);
@@ -706,6 +819,21 @@ static int locus_refine_stream_handler(AgnLocusRefineStream *stream,
   return 0;
 }
 
+static int locus_refine_stream_interval_compare(const void *p1,
+                                                const void *p2)
+{
+  const LocusRefineInterval *i1 = p1;
+  const LocusRefineInterval *i2 = p2;
+  int result = gt_range_compare(&i1->range, &i2->range);
+  if(result == 0)
+  {
+    if(i1->index < i2->index)
+      return -1;
+    return i1->index > i2->index;
+  }
+  return result;
+}
+
 static void
 locus_refine_stream_mark_for_deletion(AgnLocusRefineStream *stream,
                                       GtGenomeNode *gn)
@@ -868,6 +996,40 @@ static GtArray *locus_refine_stream_resolve_bins(AgnLocusRefineStream *stream,
   return iloci;
 }
 
+static void locus_refine_stream_sweep(LocusRefineInterval *intervals,
+                                      GtUword numintervals, GtUword minoverlap,
+                                      GtUword *parents)
+{
+  GtUword i, current = GT_UNDEF_UWORD, maxend = 0;
+  if(minoverlap == 0)
+    minoverlap = 1;
+
+  qsort(intervals, numintervals, sizeof(LocusRefineInterval),
+        locus_refine_stream_interval_compare);
+  for(i = 0; i < numintervals; i++)
+  {
+    GtRange *range = &intervals[i].range;
+    if(gt_range_length(range) < minoverlap)
+      continue;
+
+    // Sorted by start, so the overlap with any earlier interval is bounded by
+    // this interval's start; earlier intervals ending before the threshold can
+    // never overlap this interval or any later one.
+    GtUword threshold = range->start + minoverlap - 1;
+    if(current != GT_UNDEF_UWORD && maxend >= threshold)
+    {
+      locus_refine_stream_union(parents, current, intervals[i].index);
+      if(range->end > maxend)
+        maxend = range->end;
+    }
+    else
+    {
+      current = intervals[i].index;
+      maxend = range->end;
+    }
+  }
+}
+
 static void locus_refine_stream_test_data(const char *filename, GtQueue *queue,
                                           GtUword delta)
 {
@@ -928,3 +1090,86 @@ static void locus_refine_stream_test_data(const char *filename, GtQueue *queue,
   gt_error_delete(error);
   gt_array_delete(loci);
 }
+
+static bool locus_refine_stream_test_nontransitive(bool by_cds)
+{
+  GtRange ranges[] = { {100, 300}, {250, 500}, {450, 700}, {900, 1000} };
+  const char *ids[] = { "A", "B", "C", "D" };
+  GtUword orders[2][4] = { {0, 1, 2, 3}, {2, 3, 0, 1} };
+  GtUword masks[2][2];
+  bool success = true;
+
+  GtError *error = gt_error_new();
+  GtArray *nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  GtUword progress = 0;
+  GtNodeStream *ais = gt_array_in_stream_new(nodes, &progress, error);
+  GtNodeStream *ns = agn_locus_refine_stream_new(ais, 0, 1, by_cds);
+  AgnLocusRefineStream *stream = locus_refine_stream_cast(ns);
+  GtStr *seqid = gt_str_new_cstr("chr1");
+
+  GtUword i, j;
+  for(i = 0; i < 2; i++)
+  {
+    GtGenomeNode *locus = gt_feature_node_new(seqid, "locus", 100, 1000,
+                                              GT_STRAND_BOTH);
+    for(j = 0; j < 4; j++)
+    {
+      GtRange *rng = ranges + orders[i][j];
+      GtGenomeNode *gene = gt_feature_node_new(seqid, "gene", rng->start,
+                                               rng->end, GT_STRAND_FORWARD);
+      GtGenomeNode *mrna = gt_feature_node_new(seqid, "mRNA", rng->start,
+                                               rng->end, GT_STRAND_FORWARD);
+      GtGenomeNode *cds  = gt_feature_node_new(seqid, "CDS", rng->start,
+                                               rng->end, GT_STRAND_FORWARD);
+      gt_feature_node_add_attribute((GtFeatureNode *)gene, "ID",
+                                    ids[orders[i][j]]);
+      gt_feature_node_add_child((GtFeatureNode *)mrna, (GtFeatureNode *)cds);
+      gt_feature_node_add_child((GtFeatureNode *)gene, (GtFeatureNode *)mrna);
+      gt_feature_node_add_child((GtFeatureNode *)locus, (GtFeatureNode *)gene);
+    }
+
+    GtArray *bins = locus_refine_stream_bin_features(stream,
+                                                     (GtFeatureNode *)locus);
+    success = success && gt_array_size(bins) == 2;
+    masks[i][0] = masks[i][1] = 0;
+    for(j = 0; j < gt_array_size(bins); j++)
+    {
+      GtArray *bin = *(GtArray **)gt_array_get(bins, j);
+      GtUword k;
+      for(k = 0; k < gt_array_size(bin) && j < 2; k++)
+      {
+        GtFeatureNode *gene = *(GtFeatureNode **)gt_array_get(bin, k);
+        const char *id = gt_feature_node_get_attribute(gene, "ID");
+        masks[i][j] |= 1 << (id[0] - 'A');
+      }
+      gt_array_delete(bin);
+    }
+    gt_array_delete(bins);
+    gt_genome_node_delete(locus);
+
+    if(masks[i][0] > masks[i][1])
+    {
+      GtUword temp = masks[i][0];
+      masks[i][0] = masks[i][1];
+      masks[i][1] = temp;
+    }
+    success = success && masks[i][0] == 0x7 && masks[i][1] == 0x8;
+  }
+
+  gt_str_delete(seqid);
+  gt_node_stream_delete(ns);
+  gt_node_stream_delete(ais);
+  gt_array_delete(nodes);
+  gt_error_delete(error);
+  return success;
+}
+
+static void locus_refine_stream_union(GtUword *parents, GtUword i, GtUword j)
+{
+  GtUword root1 = locus_refine_stream_find(parents, i);
+  GtUword root2 = locus_refine_stream_find(parents, j);
+  if(root1 < root2)
+    parents[root2] = root1;
+  else if(root2 < root1)
+    parents[root1] = root2;
+}
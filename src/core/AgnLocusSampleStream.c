@@ -0,0 +1,282 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include "core/queue_api.h"
+#include "extended/array_out_stream_api.h"
+#include "AgnGeneStream.h"
+#include "AgnLocus.h"
+#include "AgnLocusSampleStream.h"
+#include "AgnLocusStream.h"
+#include "AgnUtils.h"
+
+#define AGN_SAMPLE_NUM_STRATA 64
+
+//------------------------------------------------------------------------------
+// Data structure definition
+//------------------------------------------------------------------------------
+
+struct AgnLocusSampleStream
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in_stream;
+  double rate;
+  GtUint64 randstate;
+  bool stratify;
+  GtUword counts[AGN_SAMPLE_NUM_STRATA];
+  double next[AGN_SAMPLE_NUM_STRATA];
+};
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+#define locus_sample_stream_cast(GS)\
+        gt_node_stream_cast(locus_sample_stream_class(), GS)
+
+/**
+ * @function Implements the GtNodeStream interface for this class.
+ */
+static const GtNodeStreamClass* locus_sample_stream_class(void);
+
+/**
+ * @function Class destructor.
+ */
+static void locus_sample_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Pulls nodes from the input stream and feeds them to the output
+ * stream if they are selected for the sample.
+ */
+static int locus_sample_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                    GtError *error);
+
+/**
+ * @function Decide whether the given locus should be included in the sample.
+ */
+static bool locus_sample_stream_select(AgnLocusSampleStream *stream,
+                                       GtGenomeNode *locus);
+
+/**
+ * @function Sample loci from a test data set and compute the number of loci
+ * selected and the sum of their start coordinates.
+ */
+static void locus_sample_stream_test_data(double rate, GtUword seed,
+                                          bool stratify, GtUword *count,
+                                          GtUword *checksum);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream* agn_locus_sample_stream_new(GtNodeStream *in_stream, double rate,
+                                          GtUword seed)
+{
+  GtNodeStream *ns;
+  AgnLocusSampleStream *stream;
+  GtUword i;
+  agn_assert(in_stream);
+  ns = gt_node_stream_create(locus_sample_stream_class(), false);
+  stream = locus_sample_stream_cast(ns);
+  stream->in_stream = gt_node_stream_ref(in_stream);
+  stream->rate = rate;
+  stream->randstate = agn_rand_seed(seed);
+  stream->stratify = false;
+  for(i = 0; i < AGN_SAMPLE_NUM_STRATA; i++)
+  {
+    stream->counts[i] = 0;
+    stream->next[i] = -1.0;
+  }
+  return ns;
+}
+
+void agn_locus_sample_stream_stratify(AgnLocusSampleStream *stream)
+{
+  agn_assert(stream);
+  stream->stratify = true;
+}
+
+bool agn_locus_sample_stream_unit_test(AgnUnitTest *test)
+{
+  GtUword total, totalsum, count1, sum1, count2, sum2;
+  locus_sample_stream_test_data(1.0, 42, false, &total, &totalsum);
+
+  locus_sample_stream_test_data(0.0, 42, false, &count1, &sum1);
+  bool test1 = total > 0 && count1 == 0;
+  agn_unit_test_result(test, "rate=0.0", test1);
+
+  locus_sample_stream_test_data(0.5, 42, false, &count1, &sum1);
+  locus_sample_stream_test_data(0.5, 42, false, &count2, &sum2);
+  bool test2 = count1 == count2 && sum1 == sum2 && count1 < total;
+  agn_unit_test_result(test, "reproducible sample", test2);
+
+  locus_sample_stream_test_data(1.0, 7, true, &count1, &sum1);
+  bool test3 = count1 == total && sum1 == totalsum;
+  agn_unit_test_result(test, "stratified, rate=1.0", test3);
+
+  locus_sample_stream_test_data(0.5, 42, true, &count1, &sum1);
+  locus_sample_stream_test_data(0.5, 42, true, &count2, &sum2);
+  bool test4 = count1 == count2 && sum1 == sum2 && count1 > 0 &&
+               count1 < total;
+  agn_unit_test_result(test, "stratified, reproducible", test4);
+
+  return agn_unit_test_success(test);
+}
+
+static const GtNodeStreamClass *locus_sample_stream_class(void)
+{
+  static const GtNodeStreamClass *nsc = NULL;
+  if(!nsc)
+  {
+    nsc = gt_node_stream_class_new(sizeof (AgnLocusSampleStream),
+                                   locus_sample_stream_free,
+                                   locus_sample_stream_next);
+  }
+  return nsc;
+}
+
+static void locus_sample_stream_free(GtNodeStream *ns)
+{
+  AgnLocusSampleStream *stream = locus_sample_stream_cast(ns);
+  gt_node_stream_delete(stream->in_stream);
+}
+
+static int locus_sample_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                    GtError *error)
+{
+  AgnLocusSampleStream *stream;
+  GtFeatureNode *fn;
+  gt_error_check(error);
+  stream = locus_sample_stream_cast(ns);
+
+  while(1)
+  {
+    int had_err = gt_node_stream_next(stream->in_stream, gn, error);
+    if(had_err)
+      return had_err;
+    if(!*gn)
+      return 0;
+
+    fn = gt_feature_node_try_cast(*gn);
+    if(!fn)
+      return 0;
+
+    agn_assert(gt_feature_node_has_type(fn, "locus"));
+    if(locus_sample_stream_select(stream, *gn))
+      return 0;
+
+    gt_genome_node_delete(*gn);
+  }
+
+  return 0;
+}
+
+static bool locus_sample_stream_select(AgnLocusSampleStream *stream,
+                                       GtGenomeNode *locus)
+{
+  if(stream->rate <= 0.0)
+    return false;
+  if(!stream->stratify)
+    return agn_rand_next(&stream->randstate) < stream->rate;
+
+  // Systematic sampling within each stratum: select every k-th locus, where
+  // k = 1/rate, starting from a random offset.
+  GtUword length = gt_genome_node_get_length(locus);
+  GtUword stratum = 0;
+  while(length > 1 && stratum < AGN_SAMPLE_NUM_STRATA - 1)
+  {
+    length >>= 1;
+    stratum++;
+  }
+
+  double interval = 1.0 / stream->rate;
+  if(stream->next[stratum] < 0.0)
+    stream->next[stratum] = agn_rand_next(&stream->randstate) * interval;
+
+  bool selected = false;
+  double index = (double)stream->counts[stratum];
+  if(index >= stream->next[stratum])
+  {
+    selected = true;
+    stream->next[stratum] += interval;
+  }
+  stream->counts[stratum]++;
+  return selected;
+}
+
+static void locus_sample_stream_test_data(double rate, GtUword seed,
+                                          bool stratify, GtUword *count,
+                                          GtUword *checksum)
+{
+  GtNodeStream *current_stream, *last_stream;
+  GtQueue *streams = gt_queue_new();
+  const char *filename = "data/gff3/amel-aug-nvit-param.gff3";
+
+  current_stream = gt_gff3_in_stream_new_unsorted(1, &filename);
+  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)current_stream);
+  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)current_stream);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  current_stream = gt_sort_stream_new(last_stream);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  FILE *log = fopen("/dev/null", "w");
+  GtLogger *logger = gt_logger_new(true, "", log);
+  current_stream = agn_gene_stream_new(last_stream, logger);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  current_stream = agn_locus_stream_new(last_stream, 0);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  current_stream = agn_locus_sample_stream_new(last_stream, rate, seed);
+  if(stratify)
+    agn_locus_sample_stream_stratify((AgnLocusSampleStream *)current_stream);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  GtError *error = gt_error_new();
+  GtArray *loci = gt_array_new( sizeof(AgnLocus *) );
+  current_stream = gt_array_out_stream_new(last_stream, loci, error);
+  agn_assert(!gt_error_is_set(error));
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  int result = gt_node_stream_pull(last_stream, error);
+  if(result == -1)
+  {
+    fprintf(stderr, "error loading unit test data: %s\n", gt_error_get(error));
+    exit(1);
+  }
+
+  *count = gt_array_size(loci);
+  *checksum = 0;
+  while(gt_array_size(loci) > 0)
+  {
+    AgnLocus **locus = gt_array_pop(loci);
+    *checksum += gt_genome_node_get_start(*locus);
+    gt_genome_node_delete(*locus);
+  }
+
+  while(gt_queue_size(streams) > 0)
+  {
+    GtNodeStream *ns = gt_queue_get(streams);
+    gt_node_stream_delete(ns);
+  }
+  gt_queue_delete(streams);
+  gt_logger_delete(logger);
+  if(log != NULL)
+    fclose(log);
+  gt_error_delete(error);
+  gt_array_delete(loci);
+}
@@ -10,6 +10,8 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 #include <string.h>
 #include "core/queue_api.h"
+#include "extended/array_in_stream_api.h"
+#include "extended/array_out_stream_api.h"
 #include "extended/feature_index_memory_api.h"
 #include "extended/sort_stream_api.h"
 #include "AgnGeneStream.h"
@@ -17,6 +19,7 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #include "AgnLocusStream.h"
 #include "AgnLocus.h"
 #include "AgnTypecheck.h"
+#include "AgnUtils.h"
 
 #define locus_stream_cast(GS)\
         gt_node_stream_cast(locus_stream_class(), GS)
@@ -34,6 +37,9 @@ struct AgnLocusStream
   bool skip_iiLoci;
   int endmode;
   GtFeatureIndex *seqranges;
+  GtStrArray *seqids;
+  GtUword seqindex;
+  GtStr *last_seqid;
   AgnLocus *prev_locus;
   GtQueue *locusqueue;
   GtGenomeNode *buffer;
@@ -108,6 +114,15 @@ static GtNodeStream *locus_stream_test_data2(GtFeatureIndex *iloci,
                                              GtNodeStream *ns, GtUword delta,
                                              bool skipends);
 
+/**
+ * @function Queue a uLocus (an iLocus spanning an entire sequence with no
+ * annotated features) for each sequence whose ID sorts before `seqid`, or for
+ * all remaining sequences if `seqid` is NULL. Sorted input is assumed, so each
+ * sequence ID is visited only once.
+ */
+static void locus_stream_uloci(AgnLocusStream *stream, GtStr *seqid,
+                               GtError *error);
+
 /**
  * @function Run unit tests for loci with delta > 0.
  */
@@ -118,6 +133,11 @@ static void locus_stream_unit_test_iloci(AgnUnitTest *test);
  */
 static void locus_stream_unit_test_loci(AgnUnitTest *test);
 
+/**
+ * @function Run unit tests for uLoci.
+ */
+static void locus_stream_unit_test_uloci(AgnUnitTest *test);
+
 //------------------------------------------------------------------------------
 // Method definitions
 //------------------------------------------------------------------------------
@@ -144,6 +164,9 @@ GtNodeStream *agn_locus_stream_new(GtNodeStream *in_stream, GtUword delta)
   stream->skip_iiLoci = false;
   stream->endmode = 0;
   stream->seqranges = gt_feature_index_memory_new();
+  stream->seqids = NULL;
+  stream->seqindex = 0;
+  stream->last_seqid = NULL;
   stream->prev_locus = NULL;
   stream->locusqueue = gt_queue_new();
   stream->buffer = NULL;
@@ -186,6 +209,7 @@ bool agn_locus_stream_unit_test(AgnUnitTest *test)
 {
   locus_stream_unit_test_loci(test);
   locus_stream_unit_test_iloci(test);
+  locus_stream_unit_test_uloci(test);
   return agn_unit_test_success(test);
 }
 
@@ -204,7 +228,7 @@ static int locus_stream_add_feature(AgnLocusStream *stream, AgnLocus *locus,
   }
   else
   {
-    const char * filename = gt_genome_node_get_filename((GtGenomeNode*)feature);
+    const char *filename = agn_genome_node_get_filename((GtGenomeNode*)feature);
     if(strcmp(filename, stream->refrfile) == 0)
       agn_locus_add_refr_feature(locus, feature);
     else if(strcmp(filename, stream->predfile) == 0)
@@ -434,10 +458,17 @@ static int locus_stream_fn_handler(AgnLocusStream *stream, GtGenomeNode **gn,
 {
   agn_assert(stream && gn && error);
 
+  // Input is sorted, so an incoming feature overlaps the current locus if and
+  // only if it is on the same sequence and starts at or before the largest end
+  // coordinate seen so far in the locus. No need to test each member.
   GtArray *current_locus = gt_array_new( sizeof(GtFeatureNode *) );
+  GtStr *current_seqid = NULL;
+  GtUword current_end = 0;
   if(stream->buffer != NULL)
   {
     gt_array_add(current_locus, stream->buffer);
+    current_seqid = gt_genome_node_get_seqid(stream->buffer);
+    current_end = gt_genome_node_get_end(stream->buffer);
     stream->buffer = NULL;
   }
 
@@ -459,20 +490,18 @@ static int locus_stream_fn_handler(AgnLocusStream *stream, GtGenomeNode **gn,
       break;
     }
 
-    GtUword i;
     bool overlap = false;
-    for(i = 0; i < gt_array_size(current_locus); i++)
+    if(current_seqid != NULL)
     {
-      GtGenomeNode **oldfeature = gt_array_get(current_locus, i);
-      if(agn_overlap_ilocus(*gn, *oldfeature, 1, false))
-      {
-        overlap = true;
-        break;
-      }
+      overlap = gt_genome_node_get_start(*gn) <= current_end &&
+                gt_str_cmp(gt_genome_node_get_seqid(*gn), current_seqid) == 0;
     }
     if(overlap || gt_array_size(current_locus) == 0)
     {
       gt_array_add(current_locus, *gn);
+      current_seqid = gt_genome_node_get_seqid(*gn);
+      if(gt_genome_node_get_end(*gn) > current_end)
+        current_end = gt_genome_node_get_end(*gn);
       again = true;
     }
     else
@@ -501,7 +530,10 @@ static int locus_stream_fn_handler(AgnLocusStream *stream, GtGenomeNode **gn,
     }
 
     if(stream->delta > 0)
+    {
+      locus_stream_uloci(stream, seqid, error);
       locus_stream_extend(stream, locus);
+    }
 
     stream->prev_locus = locus;
     if(gt_queue_size(stream->locusqueue) > 0)
@@ -522,6 +554,10 @@ static void locus_stream_free(GtNodeStream *ns)
   AgnLocusStream *stream = locus_stream_cast(ns);
   gt_node_stream_delete(stream->in_stream);
   gt_feature_index_delete(stream->seqranges);
+  if(stream->seqids != NULL)
+    gt_str_array_delete(stream->seqids);
+  if(stream->last_seqid != NULL)
+    gt_str_delete(stream->last_seqid);
   gt_queue_delete(stream->locusqueue);
   gt_str_delete(stream->source);
   if(stream->nameformat)
@@ -637,9 +673,21 @@ static int locus_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
   }
 
   int result = gt_node_stream_next(stream->in_stream, gn, error);
-  if(result || !*gn)
+  if(result)
     return result;
 
+  if(!*gn)
+  {
+    if(stream->delta > 0)
+      locus_stream_uloci(stream, NULL, error);
+    if(gt_queue_size(stream->locusqueue) > 0)
+    {
+      *gn = gt_queue_get(stream->locusqueue);
+      locus_stream_mint(stream, *gn);
+    }
+    return 0;
+  }
+
   if(gt_feature_node_try_cast(*gn))
     return locus_stream_fn_handler(stream, gn, error);
 
@@ -654,6 +702,12 @@ static int locus_stream_rn_handler(AgnLocusStream *stream, GtGenomeNode **gn,
 {
   agn_assert(stream && gn && error);
   GtRegionNode *rn = gt_region_node_cast(*gn);
+  if(stream->seqids != NULL)
+  {
+    // Sequence IDs will be reloaded the next time they are needed.
+    gt_str_array_delete(stream->seqids);
+    stream->seqids = NULL;
+  }
   return gt_feature_index_add_region_node(stream->seqranges, rn, error);
 }
 
@@ -752,6 +806,61 @@ static GtNodeStream *locus_stream_test_data2(GtFeatureIndex *iloci,
   return fstream;
 }
 
+static void locus_stream_uloci(AgnLocusStream *stream, GtStr *seqid,
+                               GtError *error)
+{
+  agn_assert(stream);
+  if(stream->endmode < 0 || stream->skip_iiLoci)
+    return;
+
+  if(stream->seqids == NULL)
+  {
+    stream->seqids = gt_feature_index_get_seqids(stream->seqranges, error);
+    stream->seqindex = 0;
+    while(stream->last_seqid != NULL &&
+          stream->seqindex < gt_str_array_size(stream->seqids) &&
+          strcmp(gt_str_array_get(stream->seqids, stream->seqindex),
+                 gt_str_get(stream->last_seqid)) <= 0)
+    {
+      stream->seqindex++;
+    }
+  }
+
+  while(stream->seqindex < gt_str_array_size(stream->seqids))
+  {
+    const char *useqid = gt_str_array_get(stream->seqids, stream->seqindex);
+    int cmp = -1;
+    if(seqid != NULL)
+      cmp = strcmp(useqid, gt_str_get(seqid));
+    if(cmp > 0)
+      break;
+    stream->seqindex++;
+    if(cmp == 0)
+      break;
+
+    GtRange seqrange;
+    gt_feature_index_get_range_for_seqid(stream->seqranges, &seqrange, useqid,
+                                         error);
+    GtStr *useqidstr = gt_str_new_cstr(useqid);
+    AgnLocus *ulocus = agn_locus_new(useqidstr);
+    agn_locus_set_range(ulocus, seqrange.start, seqrange.end);
+    gt_genome_node_add_user_data(ulocus, "iLocus_type", gt_cstr_dup("fiLocus"),
+                                 gt_free_func);
+    gt_feature_node_add_attribute(gt_feature_node_cast(ulocus), "unannot",
+                                  "true");
+    gt_queue_add(stream->locusqueue, ulocus);
+    gt_str_delete(useqidstr);
+  }
+
+  if(seqid != NULL &&
+     (stream->last_seqid == NULL || gt_str_cmp(seqid, stream->last_seqid) != 0))
+  {
+    if(stream->last_seqid != NULL)
+      gt_str_delete(stream->last_seqid);
+    stream->last_seqid = gt_str_clone(seqid);
+  }
+}
+
 static void locus_stream_unit_test_iloci(AgnUnitTest *test)
 {
   GtFeatureIndex *iloci = gt_feature_index_memory_new();
@@ -880,3 +989,66 @@ static void locus_stream_unit_test_loci(AgnUnitTest *test)
 
   gt_queue_delete(queue);
 }
+
+static void locus_stream_unit_test_uloci(AgnUnitTest *test)
+{
+  GtError *error = gt_error_new();
+  GtStr *chr1 = gt_str_new_cstr("chr1");
+  GtStr *chr2 = gt_str_new_cstr("chr2");
+  GtStr *chr3 = gt_str_new_cstr("chr3");
+  GtArray *nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  GtGenomeNode *gn = gt_region_node_new(chr1, 1, 5000);
+  gt_array_add(nodes, gn);
+  gn = gt_region_node_new(chr2, 1, 5000);
+  gt_array_add(nodes, gn);
+  gn = gt_region_node_new(chr3, 1, 2000);
+  gt_array_add(nodes, gn);
+  gn = gt_feature_node_new(chr2, "gene", 2001, 3000, GT_STRAND_FORWARD);
+  gt_array_add(nodes, gn);
+
+  GtUword progress = 0;
+  GtArray *loci = gt_array_new( sizeof(AgnLocus *) );
+  GtNodeStream *ais = gt_array_in_stream_new(nodes, &progress, error);
+  GtNodeStream *lstream = agn_locus_stream_new(ais, 100);
+  GtNodeStream *aos = gt_array_out_stream_new(lstream, loci, error);
+  int result = gt_node_stream_pull(aos, error);
+
+  bool test1 = result == 0 && gt_array_size(loci) == 5;
+  if(test1)
+  {
+    GtUword starts[] = {    1,    1, 1901, 3101,    1 };
+    GtUword ends[]   = { 5000, 1900, 3100, 5000, 2000 };
+    bool unannot[]   = { true, false, false, false, true };
+    GtStr *seqids[]  = { chr1, chr2, chr2, chr2, chr3 };
+    GtUword i;
+    for(i = 0; i < gt_array_size(loci); i++)
+    {
+      AgnLocus *locus = *(AgnLocus **)gt_array_get(loci, i);
+      GtFeatureNode *locusfn = gt_feature_node_cast(locus);
+      GtRange range = gt_genome_node_get_range(locus);
+      const char *ua = gt_feature_node_get_attribute(locusfn, "unannot");
+      const char *type = gt_genome_node_get_user_data(locus, "iLocus_type");
+      bool typematch = !unannot[i] ||
+                       (type != NULL && strcmp(type, "fiLocus") == 0);
+      test1 = test1 && range.start == starts[i] && range.end == ends[i] &&
+              unannot[i] == (ua != NULL) && typematch &&
+              gt_str_cmp(gt_genome_node_get_seqid(locus), seqids[i]) == 0;
+    }
+  }
+  agn_unit_test_result(test, "uLoci", test1);
+
+  while(gt_array_size(loci) > 0)
+  {
+    AgnLocus **locus = gt_array_pop(loci);
+    agn_locus_delete(*locus);
+  }
+  gt_array_delete(loci);
+  gt_array_delete(nodes);
+  gt_node_stream_delete(aos);
+  gt_node_stream_delete(lstream);
+  gt_node_stream_delete(ais);
+  gt_str_delete(chr1);
+  gt_str_delete(chr2);
+  gt_str_delete(chr3);
+  gt_error_delete(error);
+}
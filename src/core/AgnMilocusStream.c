@@ -0,0 +1,462 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include <string.h>
+#include "core/queue_api.h"
+#include "extended/array_in_stream_api.h"
+#include "extended/feature_node_iterator_api.h"
+#include "AgnLocus.h"
+#include "AgnMilocusStream.h"
+
+//------------------------------------------------------------------------------
+// Data structure definition
+//------------------------------------------------------------------------------
+
+struct AgnMilocusStream
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in_stream;
+  GtArray *window;
+  GtQueue *locusqueue;
+  GtStr *nameformat;
+  GtStr *source;
+  GtUword count;
+};
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+#define milocus_stream_cast(GS)\
+        gt_node_stream_cast(milocus_stream_class(), GS)
+
+/**
+ * @function Implements the GtNodeStream interface for this class.
+ */
+static const GtNodeStreamClass* milocus_stream_class(void);
+
+/**
+ * @function Comparison function for sorting attribute keys.
+ */
+static int milocus_stream_key_compare(const void *p1, const void *p2);
+
+/**
+ * @function Flush the current merge window to the output queue: a single iLocus
+ * is passed through as is, while two or more iLoci are merged into a miLocus.
+ */
+static void milocus_stream_flush(AgnMilocusStream *stream);
+
+/**
+ * @function Class destructor.
+ */
+static void milocus_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Merge all iLoci in the current window into a single miLocus. The
+ * genes of each iLocus are transferred to the miLocus, and the values of all
+ * integer-valued attributes (such as child feature counts and effective length)
+ * are summed.
+ */
+static AgnLocus *milocus_stream_merge(AgnMilocusStream *stream);
+
+/**
+ * @function Determine whether the given iLocus can be merged with its
+ * neighbors: single-gene and non-coding iLoci can be merged, unless they are
+ * nested within the intron of another gene.
+ */
+static bool milocus_stream_mergeable(GtFeatureNode *locus);
+
+/**
+ * @function Assign a serial name to the given locus.
+ */
+static void milocus_stream_mint(AgnMilocusStream *stream, GtGenomeNode *gn);
+
+/**
+ * @function Pulls nodes from the input stream, buffering runs of mergeable
+ * iLoci and feeding merged and unmerged iLoci to the output stream.
+ */
+static int milocus_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                               GtError *error);
+
+/**
+ * @function Create an iLocus for unit testing.
+ */
+static AgnLocus *milocus_stream_test_locus(GtStr *seqid, GtUword start,
+                                           GtUword end, const char *type,
+                                           const char *exception);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream *agn_milocus_stream_new(GtNodeStream *in_stream)
+{
+  GtNodeStream *ns = gt_node_stream_create(milocus_stream_class(), false);
+  AgnMilocusStream *stream = milocus_stream_cast(ns);
+  stream->in_stream = gt_node_stream_ref(in_stream);
+  stream->window = gt_array_new( sizeof(GtGenomeNode *) );
+  stream->locusqueue = gt_queue_new();
+  stream->nameformat = NULL;
+  stream->source = gt_str_new_cstr("AEGeAn::AgnLocusStream");
+  stream->count = 0;
+  return ns;
+}
+
+void agn_milocus_stream_set_name_format(AgnMilocusStream *stream,
+                                        const char *format)
+{
+  agn_assert(stream && format);
+  if(stream->nameformat)
+    gt_str_delete(stream->nameformat);
+  stream->nameformat = gt_str_new_cstr(format);
+}
+
+void agn_milocus_stream_set_source(AgnMilocusStream *stream,
+                                   const char *source)
+{
+  agn_assert(stream && source);
+  gt_str_delete(stream->source);
+  stream->source = gt_str_new_cstr(source);
+}
+
+bool agn_milocus_stream_unit_test(AgnUnitTest *test)
+{
+  GtError *error = gt_error_new();
+  GtStr *chr1 = gt_str_new_cstr("chr1");
+  GtStr *chr2 = gt_str_new_cstr("chr2");
+  GtArray *iloci = gt_array_new( sizeof(GtGenomeNode *) );
+  AgnLocus *locus;
+
+  locus = milocus_stream_test_locus(chr1, 1, 1000, "iiLocus", NULL);
+  gt_array_add(iloci, locus);
+  locus = milocus_stream_test_locus(chr1, 1001, 3000, "siLocus", NULL);
+  GtGenomeNode *gene = gt_feature_node_new(chr1, "gene", 1501, 2800,
+                                           GT_STRAND_FORWARD);
+  agn_locus_add_feature(locus, (GtFeatureNode *)gene);
+  gt_array_add(iloci, locus);
+  locus = milocus_stream_test_locus(chr1, 2901, 5000, "siLocus", NULL);
+  gt_array_add(iloci, locus);
+  locus = milocus_stream_test_locus(chr1, 5001, 6000, "niLocus", NULL);
+  gt_array_add(iloci, locus);
+  locus = milocus_stream_test_locus(chr1, 6001, 8000, "siLocus",
+                                    "intron-gene");
+  gt_array_add(iloci, locus);
+  locus = milocus_stream_test_locus(chr1, 8001, 9000, "siLocus", NULL);
+  gt_array_add(iloci, locus);
+  locus = milocus_stream_test_locus(chr2, 1, 500, "siLocus", NULL);
+  gt_array_add(iloci, locus);
+  locus = milocus_stream_test_locus(chr2, 501, 900, "niLocus", NULL);
+  gt_array_add(iloci, locus);
+
+  GtUword progress = 0;
+  GtNodeStream *arraystream = gt_array_in_stream_new(iloci, &progress, error);
+  GtNodeStream *stream = agn_milocus_stream_new(arraystream);
+  GtArray *output = gt_array_new( sizeof(GtGenomeNode *) );
+  GtGenomeNode *gn;
+  int result;
+  while(!(result = gt_node_stream_next(stream, &gn, error)) && gn)
+    gt_array_add(output, gn);
+  gt_node_stream_delete(stream);
+  gt_node_stream_delete(arraystream);
+
+  bool test1 = result == 0 && gt_array_size(output) == 5;
+  agn_unit_test_result(test, "merge count", test1);
+
+  bool test2 = false;
+  if(test1)
+  {
+    GtGenomeNode **milocus = gt_array_get(output, 1);
+    GtFeatureNode *mifn = gt_feature_node_cast(*milocus);
+    GtRange range = gt_genome_node_get_range(*milocus);
+    const char *type = gt_feature_node_get_attribute(mifn, "iLocus_type");
+    const char *efflen = gt_feature_node_get_attribute(mifn,
+                                                       "effective_length");
+    test2 = range.start == 1001 && range.end == 6000 &&
+            type != NULL && strcmp(type, "miLocus") == 0 &&
+            efflen != NULL && strcmp(efflen, "5100") == 0 &&
+            gt_feature_node_get_score(mifn) == 3.0 &&
+            gt_feature_node_number_of_children(mifn) == 1;
+  }
+  agn_unit_test_result(test, "merged iLocus", test2);
+
+  bool test3 = false;
+  if(test1)
+  {
+    GtGenomeNode **unmerged = gt_array_get(output, 3);
+    GtGenomeNode **milocus = gt_array_get(output, 4);
+    GtFeatureNode *unfn = gt_feature_node_cast(*unmerged);
+    GtFeatureNode *mifn = gt_feature_node_cast(*milocus);
+    GtRange unrange = gt_genome_node_get_range(*unmerged);
+    GtRange mirange = gt_genome_node_get_range(*milocus);
+    const char *untype = gt_feature_node_get_attribute(unfn, "iLocus_type");
+    const char *mitype = gt_feature_node_get_attribute(mifn, "iLocus_type");
+    test3 = unrange.start == 8001 && strcmp(untype, "siLocus") == 0 &&
+            mirange.start == 1 && mirange.end == 900 &&
+            strcmp(mitype, "miLocus") == 0 &&
+            gt_str_cmp(gt_genome_node_get_seqid(*milocus), chr2) == 0;
+  }
+  agn_unit_test_result(test, "sequence boundaries", test3);
+
+  while(gt_array_size(output) > 0)
+  {
+    GtGenomeNode **outnode = gt_array_pop(output);
+    gt_genome_node_delete(*outnode);
+  }
+  gt_array_delete(output);
+  gt_array_delete(iloci);
+  gt_str_delete(chr1);
+  gt_str_delete(chr2);
+  gt_error_delete(error);
+
+  return agn_unit_test_success(test);
+}
+
+static const GtNodeStreamClass *milocus_stream_class(void)
+{
+  static const GtNodeStreamClass *nsc = NULL;
+  if(!nsc)
+  {
+    nsc = gt_node_stream_class_new(sizeof (AgnMilocusStream),
+                                   milocus_stream_free,
+                                   milocus_stream_next);
+  }
+  return nsc;
+}
+
+static int milocus_stream_key_compare(const void *p1, const void *p2)
+{
+  const char * const *key1 = p1;
+  const char * const *key2 = p2;
+  return strcmp(*key1, *key2);
+}
+
+static void milocus_stream_flush(AgnMilocusStream *stream)
+{
+  GtUword numloci = gt_array_size(stream->window);
+  if(numloci == 0)
+    return;
+
+  if(numloci == 1)
+  {
+    GtGenomeNode **locus = gt_array_get(stream->window, 0);
+    gt_queue_add(stream->locusqueue, *locus);
+  }
+  else
+  {
+    AgnLocus *milocus = milocus_stream_merge(stream);
+    gt_queue_add(stream->locusqueue, milocus);
+  }
+  gt_array_reset(stream->window);
+}
+
+static void milocus_stream_free(GtNodeStream *ns)
+{
+  agn_assert(ns);
+  AgnMilocusStream *stream = milocus_stream_cast(ns);
+  gt_node_stream_delete(stream->in_stream);
+  while(gt_array_size(stream->window) > 0)
+  {
+    GtGenomeNode **locus = gt_array_pop(stream->window);
+    gt_genome_node_delete(*locus);
+  }
+  gt_array_delete(stream->window);
+  while(gt_queue_size(stream->locusqueue) > 0)
+  {
+    GtGenomeNode *locus = gt_queue_get(stream->locusqueue);
+    gt_genome_node_delete(locus);
+  }
+  gt_queue_delete(stream->locusqueue);
+  if(stream->nameformat)
+    gt_str_delete(stream->nameformat);
+  gt_str_delete(stream->source);
+}
+
+static AgnLocus *milocus_stream_merge(AgnMilocusStream *stream)
+{
+  GtUword numloci = gt_array_size(stream->window);
+  GtGenomeNode **first = gt_array_get(stream->window, 0);
+  AgnLocus *milocus = agn_locus_new(gt_genome_node_get_seqid(*first));
+  GtRange range = gt_genome_node_get_range(*first);
+
+  GtArray *keys = gt_array_new( sizeof(const char *) );
+  GtHashmap *sums = gt_hashmap_new(GT_HASH_STRING, gt_free_func, gt_free_func);
+  GtArray *children = gt_array_new( sizeof(GtFeatureNode *) );
+  GtUword i, j;
+  for(i = 0; i < numloci; i++)
+  {
+    GtGenomeNode **locus = gt_array_get(stream->window, i);
+    GtFeatureNode *locusfn = gt_feature_node_cast(*locus);
+    GtRange locusrange = gt_genome_node_get_range(*locus);
+    if(locusrange.start < range.start)
+      range.start = locusrange.start;
+    if(locusrange.end > range.end)
+      range.end = locusrange.end;
+
+    GtStrArray *attrs = gt_feature_node_get_attribute_list(locusfn);
+    for(j = 0; j < gt_str_array_size(attrs); j++)
+    {
+      const char *key = gt_str_array_get(attrs, j);
+      if(strcmp(key, "left_overlap") == 0 || strcmp(key, "right_overlap") == 0)
+        continue;
+      const char *value = gt_feature_node_get_attribute(locusfn, key);
+      size_t valuelen = strlen(value);
+      if(valuelen == 0 || strspn(value, "0123456789") != valuelen)
+        continue;
+
+      GtUword *sum = gt_hashmap_get(sums, key);
+      if(sum == NULL)
+      {
+        char *keycopy = gt_cstr_dup(key);
+        gt_array_add(keys, keycopy);
+        sum = gt_malloc( sizeof(GtUword) );
+        (*sum) = 0;
+        gt_hashmap_add(sums, keycopy, sum);
+      }
+      (*sum) += strtoul(value, NULL, 10);
+    }
+    gt_str_array_delete(attrs);
+
+    GtFeatureNode *child;
+    GtFeatureNodeIterator *iter = gt_feature_node_iterator_new_direct(locusfn);
+    for(child  = gt_feature_node_iterator_next(iter);
+        child != NULL;
+        child  = gt_feature_node_iterator_next(iter))
+    {
+      gt_array_add(children, child);
+    }
+    gt_feature_node_iterator_delete(iter);
+    for(j = 0; j < gt_array_size(children); j++)
+    {
+      GtFeatureNode **childfn = gt_array_get(children, j);
+      agn_locus_add_feature(milocus, *childfn);
+      gt_genome_node_ref((GtGenomeNode *)*childfn); // Compensate for deletion
+                                                    // of its former locus
+    }
+    gt_array_reset(children);
+    gt_genome_node_delete(*locus);
+  }
+  gt_array_delete(children);
+
+  GtFeatureNode *mifn = gt_feature_node_cast(milocus);
+  agn_locus_set_range(milocus, range.start, range.end);
+  gt_feature_node_set_source(mifn, stream->source);
+  gt_feature_node_set_score(mifn, (float)numloci);
+  gt_feature_node_add_attribute(mifn, "iLocus_type", "miLocus");
+  gt_array_sort(keys, milocus_stream_key_compare);
+  for(i = 0; i < gt_array_size(keys); i++)
+  {
+    const char **key = gt_array_get(keys, i);
+    GtUword *sum = gt_hashmap_get(sums, *key);
+    char value[32];
+    sprintf(value, "%lu", *sum);
+    gt_feature_node_add_attribute(mifn, *key, value);
+  }
+  gt_hashmap_delete(sums);
+  gt_array_delete(keys);
+
+  return milocus;
+}
+
+static bool milocus_stream_mergeable(GtFeatureNode *locus)
+{
+  const char *type = gt_feature_node_get_attribute(locus, "iLocus_type");
+  if(type == NULL)
+    return false;
+  if(strcmp(type, "siLocus") != 0 && strcmp(type, "niLocus") != 0)
+    return false;
+
+  const char *exc = gt_feature_node_get_attribute(locus, "iiLocus_exception");
+  return exc == NULL || strcmp(exc, "intron-gene") != 0;
+}
+
+static void milocus_stream_mint(AgnMilocusStream *stream, GtGenomeNode *gn)
+{
+  GtFeatureNode *fn = gt_feature_node_try_cast(gn);
+  if(fn == NULL)
+    return;
+
+  stream->count++;
+  if(stream->nameformat)
+  {
+    char locusname[256];
+    sprintf(locusname, gt_str_get(stream->nameformat), stream->count);
+    gt_feature_node_set_attribute(fn, "Name", locusname);
+  }
+}
+
+static int milocus_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                               GtError *error)
+{
+  agn_assert(ns && gn && error);
+  AgnMilocusStream *stream = milocus_stream_cast(ns);
+
+  while(gt_queue_size(stream->locusqueue) == 0)
+  {
+    int result = gt_node_stream_next(stream->in_stream, gn, error);
+    if(result)
+      return result;
+    if(!*gn)
+    {
+      milocus_stream_flush(stream);
+      if(gt_queue_size(stream->locusqueue) == 0)
+        return 0;
+      break;
+    }
+
+    GtFeatureNode *fn = gt_feature_node_try_cast(*gn);
+    if(fn == NULL)
+    {
+      if(gt_array_size(stream->window) == 0)
+        return 0;
+      milocus_stream_flush(stream);
+      gt_queue_add(stream->locusqueue, *gn);
+      break;
+    }
+
+    if(gt_array_size(stream->window) > 0)
+    {
+      GtGenomeNode **prev = gt_array_get(stream->window, 0);
+      if(gt_str_cmp(gt_genome_node_get_seqid(*prev),
+                    gt_genome_node_get_seqid(*gn)) != 0)
+      {
+        milocus_stream_flush(stream);
+      }
+    }
+
+    if(milocus_stream_mergeable(fn))
+      gt_array_add(stream->window, *gn);
+    else
+    {
+      milocus_stream_flush(stream);
+      gt_queue_add(stream->locusqueue, *gn);
+    }
+  }
+
+  *gn = gt_queue_get(stream->locusqueue);
+  milocus_stream_mint(stream, *gn);
+  return 0;
+}
+
+static AgnLocus *milocus_stream_test_locus(GtStr *seqid, GtUword start,
+                                           GtUword end, const char *type,
+                                           const char *exception)
+{
+  AgnLocus *locus = agn_locus_new(seqid);
+  GtFeatureNode *locusfn = gt_feature_node_cast(locus);
+  char lenstr[32];
+  agn_locus_set_range(locus, start, end);
+  sprintf(lenstr, "%lu", end - start + 1);
+  gt_feature_node_add_attribute(locusfn, "effective_length", lenstr);
+  gt_feature_node_add_attribute(locusfn, "iLocus_type", type);
+  if(exception != NULL)
+    gt_feature_node_add_attribute(locusfn, "iiLocus_exception", exception);
+  return locus;
+}
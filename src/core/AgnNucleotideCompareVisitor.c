@@ -0,0 +1,490 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include <string.h>
+#include "core/hashmap_api.h"
+#include "AgnNucleotideCompareVisitor.h"
+#include "AgnTypecheck.h"
+#include "AgnUtils.h"
+
+#define nucleotide_compare_visitor_cast(GV)\
+        gt_node_visitor_cast(nucleotide_compare_visitor_class(), GV)
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+struct AgnNucleotideCompareVisitor
+{
+  const GtNodeVisitor parent_instance;
+  char *refrfile;
+  char *predfile;
+  GtStrArray *seqids;
+  GtHashmap *seqdata;
+  AgnCompStatsScaled cds;
+  AgnCompStatsScaled utr;
+  bool finished;
+};
+
+/**
+ * @type Intervals collected for a single sequence.
+ */
+typedef struct
+{
+  GtRange seqrange;
+  bool has_region;
+  GtArray *refr_cds;
+  GtArray *refr_utr;
+  GtArray *pred_cds;
+  GtArray *pred_utr;
+} NucCompareSeqData;
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Add the ranges of all features in ``feats`` to ``ranges``.
+ */
+static void nucleotide_compare_add_ranges(GtArray *ranges, GtArray *feats);
+
+/**
+ * @function Implement the interface to the GtNodeVisitor class.
+ */
+static const GtNodeVisitorClass *nucleotide_compare_visitor_class();
+
+/**
+ * @function Sweep the intervals of each sequence and aggregate the counts.
+ */
+static void nucleotide_compare_finish(AgnNucleotideCompareVisitor *v);
+
+/**
+ * @function Release memory.
+ */
+static void nucleotide_compare_visitor_free(GtNodeVisitor *nv);
+
+/**
+ * @function Get the data for the given sequence, creating it if necessary.
+ */
+static NucCompareSeqData *
+nucleotide_compare_get_seqdata(AgnNucleotideCompareVisitor *v, GtStr *seqid);
+
+/**
+ * @function Compute the number of nucleotides shared by two sorted lists of
+ * disjoint ranges.
+ */
+static GtUword nucleotide_compare_intersect_length(GtArray *r1, GtArray *r2);
+
+/**
+ * @function Compute the total number of nucleotides in a list of ranges.
+ */
+static GtUword nucleotide_compare_length(GtArray *ranges);
+
+/**
+ * @function Sort the given ranges and merge any that overlap or abut. Returns a
+ * new array of disjoint ranges.
+ */
+static GtArray *nucleotide_compare_merge(GtArray *ranges);
+
+/**
+ * @function Destructor for per-sequence data.
+ */
+static void nucleotide_compare_seqdata_delete(NucCompareSeqData *data);
+
+/**
+ * @function Remove from ``r1`` any nucleotides covered by ``r2``; both must be
+ * sorted lists of disjoint ranges. Returns a new array.
+ */
+static GtArray *nucleotide_compare_subtract(GtArray *r1, GtArray *r2);
+
+/**
+ * @function Generate data for unit testing: compare ``refrfile`` against
+ * ``predfile``.
+ */
+static void nucleotide_compare_visitor_test_data(const char *refrfile,
+                                                 const char *predfile,
+                                                 AgnCompStatsScaled *cds,
+                                                 AgnCompStatsScaled *utr);
+
+/**
+ * @function Collect CDS and UTR intervals from each feature. UTRs need not be
+ * declared explicitly: the exons of each coding mRNA are collected along with
+ * any UTR features, and CDS intervals are subtracted from the result.
+ */
+static int nucleotide_compare_visit_feature_node(GtNodeVisitor *nv,
+                                                 GtFeatureNode *fn,
+                                                 GtError *error);
+
+/**
+ * @function Record the length of each sequence.
+ */
+static int nucleotide_compare_visit_region_node(GtNodeVisitor *nv,
+                                                GtRegionNode *rn,
+                                                GtError *error);
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+void agn_nucleotide_compare_visitor_get_stats(AgnNucleotideCompareVisitor *v,
+                                              AgnCompStatsScaled *cds,
+                                              AgnCompStatsScaled *utr)
+{
+  agn_assert(v && cds && utr);
+  if(!v->finished)
+    nucleotide_compare_finish(v);
+  *cds = v->cds;
+  *utr = v->utr;
+}
+
+GtNodeVisitor *agn_nucleotide_compare_visitor_new(const char *refrfile,
+                                                  const char *predfile)
+{
+  agn_assert(refrfile && predfile);
+  GtNodeVisitor *nv;
+  nv = gt_node_visitor_create(nucleotide_compare_visitor_class());
+  AgnNucleotideCompareVisitor *v = nucleotide_compare_visitor_cast(nv);
+  v->refrfile = gt_cstr_dup(refrfile);
+  v->predfile = gt_cstr_dup(predfile);
+  v->seqids = gt_str_array_new();
+  v->seqdata = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
+                              (GtFree)nucleotide_compare_seqdata_delete);
+  agn_comp_stats_scaled_init(&v->cds);
+  agn_comp_stats_scaled_init(&v->utr);
+  v->finished = false;
+  return nv;
+}
+
+bool agn_nucleotide_compare_visitor_unit_test(AgnUnitTest *test)
+{
+  AgnCompStatsScaled cds, utr;
+  nucleotide_compare_visitor_test_data("data/gff3/nuc-only-refr.gff3",
+                                       "data/gff3/nuc-only-pred.gff3",
+                                       &cds, &utr);
+
+  bool test1 = cds.tp == 190 && cds.fn == 10 && cds.fp == 30 && cds.tn == 770;
+  agn_unit_test_result(test, "CDS nucleotide counts", test1);
+
+  bool test2 = utr.tp == 50 && utr.fn == 50 && utr.fp == 30 && utr.tn == 870;
+  agn_unit_test_result(test, "UTR nucleotide counts", test2);
+
+  bool test3 = strcmp(cds.sns, "0.950") == 0 && strcmp(cds.sps, "0.864") == 0;
+  agn_unit_test_result(test, "CDS sensitivity/specificity", test3);
+
+  nucleotide_compare_visitor_test_data("data/gff3/nuc-only-refr-sansutrs.gff3",
+                                       "data/gff3/nuc-only-pred-sansutrs.gff3",
+                                       &cds, &utr);
+  bool test4 = cds.tp == 190 && cds.fn == 10 && cds.fp == 30 &&
+               cds.tn == 770 && utr.tp == 50 && utr.fn == 50 &&
+               utr.fp == 30 && utr.tn == 870;
+  agn_unit_test_result(test, "UTRs implied by exons and CDS", test4);
+
+  return agn_unit_test_success(test);
+}
+
+static void nucleotide_compare_add_ranges(GtArray *ranges, GtArray *feats)
+{
+  GtUword i;
+  for(i = 0; i < gt_array_size(feats); i++)
+  {
+    GtGenomeNode **feat = gt_array_get(feats, i);
+    GtRange range = gt_genome_node_get_range(*feat);
+    gt_array_add(ranges, range);
+  }
+}
+
+static const GtNodeVisitorClass *nucleotide_compare_visitor_class()
+{
+  static const GtNodeVisitorClass *nvc = NULL;
+  if(!nvc)
+  {
+    nvc = gt_node_visitor_class_new(sizeof (AgnNucleotideCompareVisitor),
+                                    nucleotide_compare_visitor_free, NULL,
+                                    nucleotide_compare_visit_feature_node,
+                                    nucleotide_compare_visit_region_node,
+                                    NULL, NULL);
+  }
+  return nvc;
+}
+
+static void nucleotide_compare_finish(AgnNucleotideCompareVisitor *v)
+{
+  GtUword i;
+  for(i = 0; i < gt_str_array_size(v->seqids); i++)
+  {
+    const char *seqid = gt_str_array_get(v->seqids, i);
+    NucCompareSeqData *data = gt_hashmap_get(v->seqdata, seqid);
+    GtUword seqlength = gt_range_length(&data->seqrange);
+
+    GtArray *refrcds = nucleotide_compare_merge(data->refr_cds);
+    GtArray *predcds = nucleotide_compare_merge(data->pred_cds);
+    GtArray *temp = nucleotide_compare_merge(data->refr_utr);
+    GtArray *utrranges = nucleotide_compare_subtract(temp, refrcds);
+    gt_array_delete(temp);
+    temp = nucleotide_compare_merge(data->pred_utr);
+    GtArray *predutr = nucleotide_compare_subtract(temp, predcds);
+    gt_array_delete(temp);
+
+    GtArray *refr[] = { refrcds, utrranges };
+    GtArray *pred[] = { predcds, predutr };
+    AgnCompStatsScaled *stats[] = { &v->cds, &v->utr };
+    int j;
+    for(j = 0; j < 2; j++)
+    {
+      GtUword shared = nucleotide_compare_intersect_length(refr[j], pred[j]);
+      GtUword refrlen = nucleotide_compare_length(refr[j]);
+      GtUword predlen = nucleotide_compare_length(pred[j]);
+      GtUword covered = refrlen + predlen - shared;
+      stats[j]->tp += shared;
+      stats[j]->fn += refrlen - shared;
+      stats[j]->fp += predlen - shared;
+      if(seqlength > covered)
+        stats[j]->tn += seqlength - covered;
+    }
+
+    gt_array_delete(refrcds);
+    gt_array_delete(predcds);
+    gt_array_delete(utrranges);
+    gt_array_delete(predutr);
+  }
+
+  gt_hashmap_reset(v->seqdata);
+  agn_comp_stats_scaled_resolve(&v->cds);
+  agn_comp_stats_scaled_resolve(&v->utr);
+  v->finished = true;
+}
+
+static void nucleotide_compare_visitor_free(GtNodeVisitor *nv)
+{
+  AgnNucleotideCompareVisitor *v = nucleotide_compare_visitor_cast(nv);
+  gt_free(v->refrfile);
+  gt_free(v->predfile);
+  gt_str_array_delete(v->seqids);
+  gt_hashmap_delete(v->seqdata);
+}
+
+static NucCompareSeqData *
+nucleotide_compare_get_seqdata(AgnNucleotideCompareVisitor *v, GtStr *seqid)
+{
+  NucCompareSeqData *data = gt_hashmap_get(v->seqdata, gt_str_get(seqid));
+  if(data == NULL)
+  {
+    data = gt_malloc( sizeof(NucCompareSeqData) );
+    data->seqrange.start = 0;
+    data->seqrange.end = 0;
+    data->has_region = false;
+    data->refr_cds = gt_array_new( sizeof(GtRange) );
+    data->refr_utr = gt_array_new( sizeof(GtRange) );
+    data->pred_cds = gt_array_new( sizeof(GtRange) );
+    data->pred_utr = gt_array_new( sizeof(GtRange) );
+    gt_hashmap_add(v->seqdata, gt_cstr_dup(gt_str_get(seqid)), data);
+    gt_str_array_add(v->seqids, seqid);
+  }
+  return data;
+}
+
+static GtUword nucleotide_compare_intersect_length(GtArray *r1, GtArray *r2)
+{
+  GtUword i = 0, j = 0, shared = 0;
+  while(i < gt_array_size(r1) && j < gt_array_size(r2))
+  {
+    GtRange *a = gt_array_get(r1, i);
+    GtRange *b = gt_array_get(r2, j);
+    GtUword start = a->start > b->start ? a->start : b->start;
+    GtUword end   = a->end   < b->end   ? a->end   : b->end;
+    if(start <= end)
+      shared += end - start + 1;
+    if(a->end < b->end)
+      i++;
+    else
+      j++;
+  }
+  return shared;
+}
+
+static GtUword nucleotide_compare_length(GtArray *ranges)
+{
+  GtUword i, length = 0;
+  for(i = 0; i < gt_array_size(ranges); i++)
+  {
+    GtRange *range = gt_array_get(ranges, i);
+    length += gt_range_length(range);
+  }
+  return length;
+}
+
+static GtArray *nucleotide_compare_merge(GtArray *ranges)
+{
+  GtUword i;
+  GtArray *merged = gt_array_new( sizeof(GtRange) );
+  if(gt_array_size(ranges) == 0)
+    return merged;
+
+  gt_array_sort(ranges, (GtCompare)gt_range_compare);
+  GtRange current = *(GtRange *)gt_array_get(ranges, 0);
+  for(i = 1; i < gt_array_size(ranges); i++)
+  {
+    GtRange *next = gt_array_get(ranges, i);
+    if(next->start <= current.end + 1)
+    {
+      if(next->end > current.end)
+        current.end = next->end;
+    }
+    else
+    {
+      gt_array_add(merged, current);
+      current = *next;
+    }
+  }
+  gt_array_add(merged, current);
+  return merged;
+}
+
+static void nucleotide_compare_seqdata_delete(NucCompareSeqData *data)
+{
+  gt_array_delete(data->refr_cds);
+  gt_array_delete(data->refr_utr);
+  gt_array_delete(data->pred_cds);
+  gt_array_delete(data->pred_utr);
+  gt_free(data);
+}
+
+static GtArray *nucleotide_compare_subtract(GtArray *r1, GtArray *r2)
+{
+  GtUword i, j = 0;
+  GtArray *result = gt_array_new( sizeof(GtRange) );
+  for(i = 0; i < gt_array_size(r1); i++)
+  {
+    GtRange current = *(GtRange *)gt_array_get(r1, i);
+    bool empty = false;
+    while(j < gt_array_size(r2) &&
+          ((GtRange *)gt_array_get(r2, j))->end < current.start)
+      j++;
+
+    GtUword k;
+    for(k = j; !empty && k < gt_array_size(r2); k++)
+    {
+      GtRange *cut = gt_array_get(r2, k);
+      if(cut->start > current.end)
+        break;
+      if(cut->start > current.start)
+      {
+        GtRange left = { current.start, cut->start - 1 };
+        gt_array_add(result, left);
+      }
+      if(cut->end >= current.end)
+        empty = true;
+      else
+        current.start = cut->end + 1;
+    }
+    if(!empty)
+      gt_array_add(result, current);
+  }
+  return result;
+}
+
+static void nucleotide_compare_visitor_test_data(const char *refrfile,
+                                                 const char *predfile,
+                                                 AgnCompStatsScaled *cds,
+                                                 AgnCompStatsScaled *utr)
+{
+  GtError *error = gt_error_new();
+  const char *files[] = { refrfile, predfile };
+  GtNodeStream *gff3in = gt_gff3_in_stream_new_unsorted(2, files);
+  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)gff3in);
+  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)gff3in);
+  GtNodeVisitor *nv = agn_nucleotide_compare_visitor_new(files[0], files[1]);
+  GtNodeStream *stream = gt_visitor_stream_new(gff3in, nv);
+  int pullresult = gt_node_stream_pull(stream, error);
+  if(pullresult == -1)
+  {
+    fprintf(stderr, "[AgnNucleotideCompareVisitor::"
+            "nucleotide_compare_visitor_test_data] error processing features: "
+            "%s\n", gt_error_get(error));
+  }
+  agn_nucleotide_compare_visitor_get_stats((AgnNucleotideCompareVisitor *)nv,
+                                           cds, utr);
+  gt_node_stream_delete(stream);
+  gt_node_stream_delete(gff3in);
+  gt_error_delete(error);
+}
+
+static int nucleotide_compare_visit_feature_node(GtNodeVisitor *nv,
+                                                 GtFeatureNode *fn,
+                                                 GtError *error)
+{
+  gt_error_check(error);
+  AgnNucleotideCompareVisitor *v = nucleotide_compare_visitor_cast(nv);
+  GtGenomeNode *gn = (GtGenomeNode *)fn;
+  agn_assert(!v->finished);
+
+  const char *filename = agn_genome_node_get_filename(gn);
+  bool isrefr;
+  if(strcmp(filename, v->refrfile) == 0)
+    isrefr = true;
+  else if(strcmp(filename, v->predfile) == 0)
+    isrefr = false;
+  else
+    return 0;
+
+  NucCompareSeqData *data;
+  data = nucleotide_compare_get_seqdata(v, gt_genome_node_get_seqid(gn));
+  GtRange range = gt_genome_node_get_range(gn);
+  if(!data->has_region)
+  {
+    if(data->seqrange.end == 0)
+      data->seqrange = range;
+    else
+      data->seqrange = gt_range_join(&data->seqrange, &range);
+  }
+
+  GtArray *utrranges = isrefr ? data->refr_utr : data->pred_utr;
+  GtArray *cds = agn_typecheck_select(fn, agn_typecheck_cds);
+  GtArray *utrs = agn_typecheck_select(fn, agn_typecheck_utr);
+  nucleotide_compare_add_ranges(isrefr ? data->refr_cds : data->pred_cds, cds);
+  nucleotide_compare_add_ranges(utrranges, utrs);
+  gt_array_delete(cds);
+  gt_array_delete(utrs);
+
+  // Exons minus CDS are UTR, whether or not the UTRs are declared
+  GtUword i;
+  GtArray *mrnas = agn_typecheck_select(fn, agn_typecheck_mrna);
+  for(i = 0; i < gt_array_size(mrnas); i++)
+  {
+    GtFeatureNode *mrna = *(GtFeatureNode **)gt_array_get(mrnas, i);
+    if(agn_typecheck_count(mrna, agn_typecheck_cds) == 0)
+      continue;
+    GtArray *exons = agn_typecheck_select(mrna, agn_typecheck_exon);
+    nucleotide_compare_add_ranges(utrranges, exons);
+    gt_array_delete(exons);
+  }
+  gt_array_delete(mrnas);
+
+  return 0;
+}
+
+static int nucleotide_compare_visit_region_node(GtNodeVisitor *nv,
+                                                GtRegionNode *rn,
+                                                GtError *error)
+{
+  gt_error_check(error);
+  AgnNucleotideCompareVisitor *v = nucleotide_compare_visitor_cast(nv);
+  GtGenomeNode *gn = (GtGenomeNode *)rn;
+
+  NucCompareSeqData *data;
+  data = nucleotide_compare_get_seqdata(v, gt_genome_node_get_seqid(gn));
+  GtRange range = gt_genome_node_get_range(gn);
+  if(!data->has_region)
+    data->seqrange = range;
+  else
+    data->seqrange = gt_range_join(&data->seqrange, &range);
+  data->has_region = true;
+
+  return 0;
+}
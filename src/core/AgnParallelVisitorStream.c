@@ -0,0 +1,494 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include <stdlib.h>
+#include <string.h>
+#include "core/array_api.h"
+#include "core/hashmap_api.h"
+#include "core/thread_api.h"
+#include "AgnMrnaRepVisitor.h"
+#include "AgnParallelVisitorStream.h"
+#include "AgnTypecheck.h"
+#include "AgnUtils.h"
+
+#define parallel_visitor_stream_cast(GS)\
+        gt_node_stream_cast(parallel_visitor_stream_class(), GS)
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+typedef struct
+{
+  GtNodeVisitor *visitor;
+  GtArray *batch;
+  GtUword start;
+  GtUword end;
+  GtArray *held;
+  FILE *outbuffer;
+  char *buffer;
+  size_t length;
+  GtError *error;
+  int result;
+} ParallelVisitorWorker;
+
+struct AgnParallelVisitorStream
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in_stream;
+  GtUword numworkers;
+  ParallelVisitorWorker *workers;
+  GtUword batchsize;
+  GtArray *batch;
+  GtUword nextindex;
+  FILE *outstream;
+};
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Implements the GtNodeStream interface for this class.
+ */
+static const GtNodeStreamClass* parallel_visitor_stream_class(void);
+
+/**
+ * @function Class destructor.
+ */
+static void parallel_visitor_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Read the next batch of nodes from the input stream and visit them
+ * with the worker threads. Returns -1 and sets ``error`` if reading or
+ * visiting any of the nodes failed.
+ */
+static int parallel_visitor_stream_fill(AgnParallelVisitorStream *stream,
+                                        GtError *error);
+
+/**
+ * @function Prepare the worker's slice of the current batch for concurrent
+ * processing. Each feature is given a private copy of its sequence ID, so
+ * that features created or deleted by the worker's visitor never touch a
+ * reference count shared with another thread, and an extra reference is taken
+ * on each feature so that any features the visitor removes are not freed
+ * until :c:func:`parallel_visitor_stream_release` is called on the main
+ * thread.
+ */
+static void parallel_visitor_stream_isolate(ParallelVisitorWorker *worker);
+
+/**
+ * @function Helper function for :c:func:`parallel_visitor_stream_isolate`:
+ * process a single feature, unless it has been processed already.
+ */
+static void parallel_visitor_stream_isolate_feature(ParallelVisitorWorker *w,
+                                                    GtFeatureNode *fn,
+                                                    GtHashmap *seqids,
+                                                    GtHashmap *visited);
+
+/**
+ * @function Delivers the next node of the current batch, reading and visiting
+ * a new batch first if the current one has been exhausted.
+ */
+static int parallel_visitor_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                        GtError *error);
+
+/**
+ * @function Drop the references taken by
+ * :c:func:`parallel_visitor_stream_isolate`, freeing any features the
+ * worker's visitor removed.
+ */
+static void parallel_visitor_stream_release(ParallelVisitorWorker *worker);
+
+/**
+ * @function Generate data for unit testing: the nodes of ``filename`` after
+ * selecting representative mRNAs, with either a ``GtVisitorStream`` (if
+ * ``numthreads`` is 0) or a parallel visitor stream. The mRNA map is written
+ * to ``mapstream``.
+ */
+static void parallel_visitor_stream_test_data(GtArray *nodes,
+                                              const char *filename,
+                                              GtUword numthreads,
+                                              FILE *mapstream);
+
+/**
+ * @function Visitor constructor used for unit testing.
+ */
+static GtNodeVisitor *parallel_visitor_stream_test_visitor(FILE *outstream,
+                                                           void *data);
+
+/**
+ * @function Thread function: visit each node in the worker's slice of the
+ * current batch.
+ */
+static void *parallel_visitor_stream_work(void *data);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream *agn_parallel_visitor_stream_new(GtNodeStream *in,
+                                              GtUword numthreads,
+                                              AgnParallelVisitorFunc func,
+                                              void *data, FILE *outstream)
+{
+  agn_assert(in && func);
+  GtNodeStream *ns = gt_node_stream_create(parallel_visitor_stream_class(),
+                                           false);
+  AgnParallelVisitorStream *stream = parallel_visitor_stream_cast(ns);
+  stream->in_stream = gt_node_stream_ref(in);
+  stream->numworkers = numthreads > 0 ? numthreads : 1;
+  stream->batchsize = 256;
+  stream->batch = gt_array_new( sizeof(GtGenomeNode *) );
+  stream->nextindex = 0;
+  stream->outstream = outstream;
+
+  stream->workers = gt_calloc(stream->numworkers,
+                              sizeof(ParallelVisitorWorker));
+  GtUword i;
+  for(i = 0; i < stream->numworkers; i++)
+  {
+    ParallelVisitorWorker *worker = stream->workers + i;
+    worker->batch = stream->batch;
+    worker->held = gt_array_new( sizeof(GtGenomeNode *) );
+    worker->error = gt_error_new();
+    if(outstream != NULL && stream->numworkers > 1)
+      worker->outbuffer = open_memstream(&worker->buffer, &worker->length);
+    else
+      worker->outbuffer = outstream;
+    worker->visitor = func(worker->outbuffer, data);
+  }
+  return ns;
+}
+
+void agn_parallel_visitor_stream_set_batch_size(AgnParallelVisitorStream *s,
+                                                GtUword batchsize)
+{
+  agn_assert(s && batchsize > 0);
+  s->batchsize = batchsize;
+}
+
+bool agn_parallel_visitor_stream_unit_test(AgnUnitTest *test)
+{
+  const char *filename = "data/gff3/amel-ogs-g7.gff3";
+  GtArray *serial = gt_array_new( sizeof(GtGenomeNode *) );
+  GtArray *parallel = gt_array_new( sizeof(GtGenomeNode *) );
+  char *serialmap, *parallelmap;
+  size_t seriallength, parallellength;
+
+  FILE *mapstream = open_memstream(&serialmap, &seriallength);
+  parallel_visitor_stream_test_data(serial, filename, 0, mapstream);
+  fclose(mapstream);
+  mapstream = open_memstream(&parallelmap, &parallellength);
+  parallel_visitor_stream_test_data(parallel, filename, 3, mapstream);
+  fclose(mapstream);
+
+  bool ordertest = gt_array_size(serial) > 0 &&
+                   gt_array_size(serial) == gt_array_size(parallel);
+  bool mrnatest = ordertest;
+  GtUword i;
+  for(i = 0; ordertest && i < gt_array_size(serial); i++)
+  {
+    GtGenomeNode *gn1 = *(GtGenomeNode **)gt_array_get(serial, i);
+    GtGenomeNode *gn2 = *(GtGenomeNode **)gt_array_get(parallel, i);
+    GtFeatureNode *fn1 = gt_feature_node_try_cast(gn1);
+    GtFeatureNode *fn2 = gt_feature_node_try_cast(gn2);
+    GtRange range1 = gt_genome_node_get_range(gn1);
+    GtRange range2 = gt_genome_node_get_range(gn2);
+    ordertest = (fn1 == NULL) == (fn2 == NULL) &&
+                gt_range_compare(&range1, &range2) == 0;
+    if(ordertest && fn1 != NULL)
+    {
+      ordertest = strcmp(agn_feature_node_get_label(fn1),
+                         agn_feature_node_get_label(fn2)) == 0;
+      mrnatest = mrnatest &&
+                 agn_typecheck_count(fn1, agn_typecheck_mrna) ==
+                 agn_typecheck_count(fn2, agn_typecheck_mrna);
+    }
+  }
+  agn_unit_test_result(test, "node order", ordertest);
+  agn_unit_test_result(test, "representative mRNAs", ordertest && mrnatest);
+
+  bool maptest = seriallength > 0 && seriallength == parallellength &&
+                 memcmp(serialmap, parallelmap, seriallength) == 0;
+  agn_unit_test_result(test, "visitor output order", maptest);
+
+  for(i = 0; i < gt_array_size(serial); i++)
+    gt_genome_node_delete(*(GtGenomeNode **)gt_array_get(serial, i));
+  for(i = 0; i < gt_array_size(parallel); i++)
+    gt_genome_node_delete(*(GtGenomeNode **)gt_array_get(parallel, i));
+  gt_array_delete(serial);
+  gt_array_delete(parallel);
+  free(serialmap);
+  free(parallelmap);
+
+  return agn_unit_test_success(test);
+}
+
+static const GtNodeStreamClass *parallel_visitor_stream_class(void)
+{
+  static const GtNodeStreamClass *nsc = NULL;
+  if(!nsc)
+  {
+    nsc = gt_node_stream_class_new(sizeof (AgnParallelVisitorStream),
+                                   parallel_visitor_stream_free,
+                                   parallel_visitor_stream_next);
+  }
+  return nsc;
+}
+
+static void parallel_visitor_stream_free(GtNodeStream *ns)
+{
+  AgnParallelVisitorStream *stream = parallel_visitor_stream_cast(ns);
+  GtUword i;
+  for(i = stream->nextindex; i < gt_array_size(stream->batch); i++)
+    gt_genome_node_delete(*(GtGenomeNode **)gt_array_get(stream->batch, i));
+  gt_array_delete(stream->batch);
+
+  for(i = 0; i < stream->numworkers; i++)
+  {
+    ParallelVisitorWorker *worker = stream->workers + i;
+    gt_node_visitor_delete(worker->visitor);
+    gt_array_delete(worker->held);
+    gt_error_delete(worker->error);
+    if(worker->outbuffer != NULL && worker->outbuffer != stream->outstream)
+    {
+      fclose(worker->outbuffer);
+      free(worker->buffer);
+    }
+  }
+  gt_free(stream->workers);
+  gt_node_stream_delete(stream->in_stream);
+}
+
+static int parallel_visitor_stream_fill(AgnParallelVisitorStream *stream,
+                                        GtError *error)
+{
+  GtUword i, numnodes;
+  int result = 0;
+  gt_array_reset(stream->batch);
+  stream->nextindex = 0;
+  while(gt_array_size(stream->batch) < stream->batchsize * stream->numworkers)
+  {
+    GtGenomeNode *gn;
+    result = gt_node_stream_next(stream->in_stream, &gn, error);
+    if(result || gn == NULL)
+      break;
+    gt_array_add(stream->batch, gn);
+  }
+  if(result)
+    return result;
+
+  // Each worker gets a contiguous slice, so that concatenating the workers'
+  // output buffers in order preserves the input order.
+  numnodes = gt_array_size(stream->batch);
+  GtUword numworkers = stream->numworkers;
+  if(numworkers > numnodes)
+    numworkers = numnodes > 0 ? numnodes : 1;
+  for(i = 0; i < numworkers; i++)
+  {
+    ParallelVisitorWorker *worker = stream->workers + i;
+    worker->start = numnodes * i / numworkers;
+    worker->end = numnodes * (i + 1) / numworkers;
+    worker->result = 0;
+    parallel_visitor_stream_isolate(worker);
+  }
+
+  GtThread **threads = gt_calloc(numworkers, sizeof(GtThread *));
+  for(i = 1; i < numworkers; i++)
+  {
+    threads[i] = gt_thread_new(parallel_visitor_stream_work,
+                               stream->workers + i, error);
+    if(threads[i] == NULL)
+    {
+      // GenomeTools was built without thread support; do the work here.
+      gt_error_unset(error);
+      parallel_visitor_stream_work(stream->workers + i);
+    }
+  }
+  parallel_visitor_stream_work(stream->workers);
+  for(i = 1; i < numworkers; i++)
+  {
+    if(threads[i] != NULL)
+    {
+      gt_thread_join(threads[i]);
+      gt_thread_delete(threads[i]);
+    }
+  }
+  gt_free(threads);
+
+  for(i = 0; i < numworkers; i++)
+  {
+    ParallelVisitorWorker *worker = stream->workers + i;
+    parallel_visitor_stream_release(worker);
+    if(worker->outbuffer != NULL && worker->outbuffer != stream->outstream)
+    {
+      fflush(worker->outbuffer);
+      fwrite(worker->buffer, 1, worker->length, stream->outstream);
+      rewind(worker->outbuffer);
+    }
+    if(result == 0 && worker->result != 0)
+    {
+      gt_error_set(error, "%s", gt_error_get(worker->error));
+      gt_error_unset(worker->error);
+      result = -1;
+    }
+  }
+  return result;
+}
+
+static void parallel_visitor_stream_isolate(ParallelVisitorWorker *worker)
+{
+  // Keys are the shared sequence IDs, values the worker's private copies; the
+  // table holds a reference to both so that no address is reused meanwhile.
+  GtHashmap *seqids = gt_hashmap_new(GT_HASH_DIRECT, (GtFree)gt_str_delete,
+                                     (GtFree)gt_str_delete);
+  GtHashmap *visited = gt_hashmap_new(GT_HASH_DIRECT, NULL, NULL);
+  GtUword i;
+  for(i = worker->start; i < worker->end; i++)
+  {
+    GtGenomeNode *gn = *(GtGenomeNode **)gt_array_get(worker->batch, i);
+    GtFeatureNode *fn = gt_feature_node_try_cast(gn);
+    if(fn == NULL)
+      continue;
+
+    // The iterator skips pseudo-features themselves, so handle the top-level
+    // feature explicitly.
+    parallel_visitor_stream_isolate_feature(worker, fn, seqids, visited);
+    GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+    GtFeatureNode *feature;
+    for(feature = gt_feature_node_iterator_next(iter);
+        feature != NULL;
+        feature = gt_feature_node_iterator_next(iter))
+    {
+      parallel_visitor_stream_isolate_feature(worker, feature, seqids,
+                                              visited);
+    }
+    gt_feature_node_iterator_delete(iter);
+  }
+  gt_hashmap_delete(visited);
+  gt_hashmap_delete(seqids);
+}
+
+static void parallel_visitor_stream_isolate_feature(ParallelVisitorWorker *w,
+                                                    GtFeatureNode *fn,
+                                                    GtHashmap *seqids,
+                                                    GtHashmap *visited)
+{
+  if(gt_hashmap_get(visited, fn) != NULL)
+    return;
+  gt_hashmap_add(visited, fn, fn);
+
+  GtGenomeNode *gn = gt_genome_node_ref((GtGenomeNode *)fn);
+  gt_array_add(w->held, gn);
+
+  GtStr *seqid = gt_genome_node_get_seqid(gn);
+  GtStr *copy = gt_hashmap_get(seqids, seqid);
+  if(copy == NULL)
+  {
+    copy = gt_str_clone(seqid);
+    gt_hashmap_add(seqids, gt_str_ref(seqid), copy);
+  }
+  gt_genome_node_change_seqid(gn, copy);
+}
+
+static int parallel_visitor_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                        GtError *error)
+{
+  gt_error_check(error);
+  AgnParallelVisitorStream *stream = parallel_visitor_stream_cast(ns);
+
+  if(stream->numworkers == 1)
+  {
+    int result = gt_node_stream_next(stream->in_stream, gn, error);
+    if(result || *gn == NULL)
+      return result;
+    return gt_genome_node_accept(*gn, stream->workers->visitor, error);
+  }
+
+  if(stream->nextindex == gt_array_size(stream->batch))
+  {
+    int result = parallel_visitor_stream_fill(stream, error);
+    if(result)
+      return result;
+  }
+
+  if(stream->nextindex == gt_array_size(stream->batch))
+    *gn = NULL;
+  else
+  {
+    *gn = *(GtGenomeNode **)gt_array_get(stream->batch, stream->nextindex);
+    stream->nextindex++;
+  }
+  return 0;
+}
+
+static void parallel_visitor_stream_release(ParallelVisitorWorker *worker)
+{
+  GtUword i;
+  for(i = 0; i < gt_array_size(worker->held); i++)
+    gt_genome_node_delete(*(GtGenomeNode **)gt_array_get(worker->held, i));
+  gt_array_reset(worker->held);
+}
+
+static void parallel_visitor_stream_test_data(GtArray *nodes,
+                                              const char *filename,
+                                              GtUword numthreads,
+                                              FILE *mapstream)
+{
+  GtError *error = gt_error_new();
+  GtNodeStream *gff3in = gt_gff3_in_stream_new_unsorted(1, &filename);
+  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)gff3in);
+  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)gff3in);
+  GtNodeStream *stream;
+  if(numthreads == 0)
+    stream = agn_mrna_rep_stream_new(gff3in, mapstream);
+  else
+  {
+    stream = agn_parallel_visitor_stream_new(gff3in, numthreads,
+                                     parallel_visitor_stream_test_visitor,
+                                     NULL, mapstream);
+    agn_parallel_visitor_stream_set_batch_size(
+        (AgnParallelVisitorStream *)stream, 7);
+  }
+  GtNodeStream *arraystream = gt_array_out_stream_all_new(stream, nodes,
+                                                          error);
+  int pullresult = gt_node_stream_pull(arraystream, error);
+  if(pullresult == -1)
+  {
+    fprintf(stderr, "[AgnParallelVisitorStream::parallel_visitor_stream_test_"
+            "data] error processing features: %s\n", gt_error_get(error));
+  }
+  gt_node_stream_delete(gff3in);
+  gt_node_stream_delete(stream);
+  gt_node_stream_delete(arraystream);
+  gt_error_delete(error);
+}
+
+static GtNodeVisitor *parallel_visitor_stream_test_visitor(FILE *outstream,
+                                                           void *data)
+{
+  return agn_mrna_rep_visitor_new(outstream);
+}
+
+static void *parallel_visitor_stream_work(void *data)
+{
+  ParallelVisitorWorker *worker = data;
+  GtUword i;
+  for(i = worker->start; i < worker->end; i++)
+  {
+    GtGenomeNode *gn = *(GtGenomeNode **)gt_array_get(worker->batch, i);
+    worker->result = gt_genome_node_accept(gn, worker->visitor, worker->error);
+    if(worker->result)
+      break;
+  }
+  return NULL;
+}
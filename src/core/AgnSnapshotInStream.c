@@ -0,0 +1,701 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "core/hashmap_api.h"
+#include "extended/array_out_stream_api.h"
+#include "extended/feature_node_iterator_api.h"
+#include "AgnGeneStream.h"
+#include "AgnSnapshotInStream.h"
+#include "AgnSnapshotOutStream.h"
+#include "AgnUtils.h"
+
+//------------------------------------------------------------------------------
+// Data structure definition
+//------------------------------------------------------------------------------
+
+struct AgnSnapshotInStream
+{
+  const GtNodeStream parent_instance;
+  GtStr *filename;
+  void *map;
+  size_t mapsize;
+  const AgnSnapshotHeader *header;
+  const AgnSnapshotSeq *seqs;
+  const AgnSnapshotFeature *feats;
+  const AgnSnapshotEdge *edges;
+  const char *strtab;
+  GtStr **seqids;
+  GtHashmap *sources;
+  GtArray *nodes;
+  GtArray *hasparent;
+  GtUword regioncursor;
+  GtUword seqcursor;
+  GtUword featcursor;
+  GtUword edgecursor;
+};
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+#define snapshot_in_stream_cast(GS)\
+        gt_node_stream_cast(snapshot_in_stream_class(), GS)
+
+/**
+ * @function Implements the GtNodeStream interface for this class.
+ */
+static const GtNodeStreamClass* snapshot_in_stream_class(void);
+
+/**
+ * @function Create a feature node from the given snapshot record.
+ */
+static GtFeatureNode *snapshot_in_stream_feature(AgnSnapshotInStream *stream,
+                                                 GtUword seqindex,
+                                                 const AgnSnapshotFeature *f);
+
+/**
+ * @function Class destructor.
+ */
+static void snapshot_in_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Delivers each region node, followed by each top-level feature.
+ */
+static int snapshot_in_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                   GtError *error);
+
+/**
+ * @function Retrieve the seqid of the given sequence.
+ */
+static GtStr *snapshot_in_stream_seqid(AgnSnapshotInStream *stream,
+                                       GtUword seqindex);
+
+/**
+ * @function Check that every count, index, and string offset in the snapshot
+ * mapped at ``map`` lies within the ``mapsize`` bytes of the mapping, so that
+ * records can be read later without any further checks. Returns NULL if the
+ * snapshot is valid, or a description of the first problem found.
+ */
+static const char *snapshot_in_stream_validate(const void *map,
+                                               size_t mapsize);
+
+/**
+ * @function Load the given GFF3 file, write a snapshot to ``snapshotfile``,
+ * and store the original features in ``feats``.
+ */
+static void snapshot_in_stream_test_data(const char *filename,
+                                         const char *snapshotfile,
+                                         GtArray *feats);
+
+/**
+ * @function Copy ``snapshotfile``, overwriting ``size`` bytes at ``offset``
+ * with ``value`` (a negative offset counts from the end of the file), and
+ * return true if the stream rejects the corrupted copy.
+ */
+static bool snapshot_in_stream_test_corrupt(const char *snapshotfile,
+                                            long offset, const void *value,
+                                            size_t size);
+
+/**
+ * @function Returns true if the two features (and their subfeatures) have the
+ * same type, location, and ID.
+ */
+static bool snapshot_in_stream_test_equal(GtFeatureNode *fn1,
+                                          GtFeatureNode *fn2);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+bool agn_snapshot_in_stream_check(const char *filename)
+{
+  char magic[8];
+  FILE *instream = fopen(filename, "rb");
+  if(instream == NULL)
+    return false;
+  bool issnapshot = fread(magic, sizeof(magic), 1, instream) == 1 &&
+                    memcmp(magic, AGN_SNAPSHOT_MAGIC, sizeof(magic)) == 0;
+  fclose(instream);
+  return issnapshot;
+}
+
+GtNodeStream *agn_snapshot_in_stream_new(const char *filename, GtError *error)
+{
+  GtNodeStream *ns;
+  AgnSnapshotInStream *stream;
+  struct stat filestats;
+  void *map;
+  int fd;
+
+  fd = open(filename, O_RDONLY);
+  if(fd < 0 || fstat(fd, &filestats) != 0)
+  {
+    if(fd >= 0)
+      close(fd);
+    gt_error_set(error, "cannot open annotation snapshot '%s'", filename);
+    return NULL;
+  }
+  if((size_t)filestats.st_size < sizeof(AgnSnapshotHeader))
+  {
+    close(fd);
+    gt_error_set(error, "'%s' is not an annotation snapshot", filename);
+    return NULL;
+  }
+  map = mmap(NULL, filestats.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED)
+  {
+    gt_error_set(error, "cannot map annotation snapshot '%s'", filename);
+    return NULL;
+  }
+
+  const AgnSnapshotHeader *header = map;
+  GtUint32 swapped = ((AGN_SNAPSHOT_VERSION & 0xff) << 24) |
+                     ((AGN_SNAPSHOT_VERSION & 0xff00) << 8) |
+                     ((AGN_SNAPSHOT_VERSION >> 8) & 0xff00) |
+                     ((AGN_SNAPSHOT_VERSION >> 24) & 0xff);
+  if(memcmp(header->magic, AGN_SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+     header->version != AGN_SNAPSHOT_VERSION)
+  {
+    munmap(map, filestats.st_size);
+    if(header->version == swapped && swapped != AGN_SNAPSHOT_VERSION)
+    {
+      gt_error_set(error, "annotation snapshot '%s' was written on a host "
+                   "with a different byte order", filename);
+    }
+    else
+    {
+      gt_error_set(error, "'%s' is not a valid annotation snapshot "
+                   "(version %d)", filename, AGN_SNAPSHOT_VERSION);
+    }
+    return NULL;
+  }
+  const char *problem = snapshot_in_stream_validate(map, filestats.st_size);
+  if(problem != NULL)
+  {
+    munmap(map, filestats.st_size);
+    gt_error_set(error, "annotation snapshot '%s' is corrupt: %s", filename,
+                 problem);
+    return NULL;
+  }
+
+  ns = gt_node_stream_create(snapshot_in_stream_class(), false);
+  stream = snapshot_in_stream_cast(ns);
+  stream->filename = gt_str_new_cstr(filename);
+  stream->map = map;
+  stream->mapsize = filestats.st_size;
+  stream->header = header;
+  stream->seqs = (const AgnSnapshotSeq *)(header + 1);
+  stream->feats = (const AgnSnapshotFeature *)
+                  (stream->seqs + header->numseqs);
+  stream->edges = (const AgnSnapshotEdge *)(stream->feats + header->numfeats);
+  stream->strtab = (const char *)(stream->edges + header->numedges);
+  stream->seqids = gt_calloc(header->numseqs, sizeof(GtStr *));
+  stream->sources = gt_hashmap_new(GT_HASH_DIRECT, NULL,
+                                   (GtFree)gt_str_delete);
+  stream->nodes = gt_array_new( sizeof(GtFeatureNode *) );
+  stream->hasparent = gt_array_new( sizeof(bool) );
+  stream->regioncursor = 0;
+  stream->seqcursor = 0;
+  stream->featcursor = 0;
+  stream->edgecursor = 0;
+  return ns;
+}
+
+bool agn_snapshot_in_stream_unit_test(AgnUnitTest *test)
+{
+  const char *infiles[] = { "data/gff3/amel-gene-multitrans.gff3",
+                            "data/gff3/grape-refr.gff3" };
+  const char *labels[] = { "multiple transcripts", "grape" };
+  int i;
+  for(i = 0; i < 2; i++)
+  {
+    char snapshotfile[] = "/tmp/agn-snapshot-XXXXXX";
+    int fd = mkstemp(snapshotfile);
+    agn_assert(fd >= 0);
+    close(fd);
+
+    GtArray *origfeats = gt_array_new( sizeof(GtFeatureNode *) );
+    snapshot_in_stream_test_data(infiles[i], snapshotfile, origfeats);
+
+    GtError *error = gt_error_new();
+    GtArray *snapfeats = gt_array_new( sizeof(GtFeatureNode *) );
+    GtNodeStream *snapstream = agn_snapshot_in_stream_new(snapshotfile,error);
+    GtNodeStream *arraystream = gt_array_out_stream_new(snapstream, snapfeats,
+                                                        error);
+    int pullresult = gt_node_stream_pull(arraystream, error);
+    bool result = pullresult == 0 &&
+                  agn_snapshot_in_stream_check(snapshotfile) &&
+                  !agn_snapshot_in_stream_check(infiles[i]) &&
+                  gt_array_size(origfeats) > 0 &&
+                  gt_array_size(origfeats) == gt_array_size(snapfeats);
+    GtUword j;
+    for(j = 0; result && j < gt_array_size(origfeats); j++)
+    {
+      GtFeatureNode *fn1 = *(GtFeatureNode **)gt_array_get(origfeats, j);
+      GtFeatureNode *fn2 = *(GtFeatureNode **)gt_array_get(snapfeats, j);
+      const char *filename = agn_genome_node_get_filename((GtGenomeNode *)fn2);
+      result = snapshot_in_stream_test_equal(fn1, fn2) &&
+               strcmp(filename, snapshotfile) == 0;
+    }
+    agn_unit_test_result(test, labels[i], result);
+
+    while(gt_array_size(origfeats) > 0)
+    {
+      GtGenomeNode **gn = gt_array_pop(origfeats);
+      gt_genome_node_delete(*gn);
+    }
+    gt_array_delete(origfeats);
+    while(gt_array_size(snapfeats) > 0)
+    {
+      GtGenomeNode **gn = gt_array_pop(snapfeats);
+      gt_genome_node_delete(*gn);
+    }
+    gt_array_delete(snapfeats);
+    gt_node_stream_delete(snapstream);
+    gt_node_stream_delete(arraystream);
+    gt_error_delete(error);
+    unlink(snapshotfile);
+  }
+
+  char snapshotfile[] = "/tmp/agn-snapshot-XXXXXX";
+  int fd = mkstemp(snapshotfile);
+  agn_assert(fd >= 0);
+  close(fd);
+  GtArray *feats = gt_array_new( sizeof(GtFeatureNode *) );
+  snapshot_in_stream_test_data(infiles[0], snapshotfile, feats);
+  while(gt_array_size(feats) > 0)
+  {
+    GtGenomeNode **gn = gt_array_pop(feats);
+    gt_genome_node_delete(*gn);
+  }
+  gt_array_delete(feats);
+
+  AgnSnapshotHeader header;
+  FILE *instream = fopen(snapshotfile, "rb");
+  agn_assert(instream != NULL);
+  bool readheader = fread(&header, sizeof(header), 1, instream) == 1;
+  fclose(instream);
+  GtUint32 swapped = header.version << 24;
+  GtUint64 badindex = header.numfeats;
+  long edgeoffset = sizeof(AgnSnapshotHeader) +
+                    header.numseqs * sizeof(AgnSnapshotSeq) +
+                    header.numfeats * sizeof(AgnSnapshotFeature) +
+                    offsetof(AgnSnapshotEdge, child);
+  long seqidoffset = sizeof(AgnSnapshotHeader) +
+                     offsetof(AgnSnapshotSeq, seqid);
+  bool corrupttest = readheader && header.numedges > 0 &&
+    snapshot_in_stream_test_corrupt(snapshotfile,
+                                    offsetof(AgnSnapshotHeader, version),
+                                    &swapped, sizeof(swapped)) &&
+    snapshot_in_stream_test_corrupt(snapshotfile, -1, "x", 1) &&
+    snapshot_in_stream_test_corrupt(snapshotfile, edgeoffset, &badindex,
+                                    sizeof(badindex)) &&
+    snapshot_in_stream_test_corrupt(snapshotfile, seqidoffset,
+                                    &header.strtabsize,
+                                    sizeof(header.strtabsize));
+  agn_unit_test_result(test, "corrupt snapshots", corrupttest);
+  unlink(snapshotfile);
+
+  return agn_unit_test_success(test);
+}
+
+static const GtNodeStreamClass *snapshot_in_stream_class(void)
+{
+  static const GtNodeStreamClass *nsc = NULL;
+  if(!nsc)
+  {
+    nsc = gt_node_stream_class_new(sizeof (AgnSnapshotInStream),
+                                   snapshot_in_stream_free,
+                                   snapshot_in_stream_next);
+  }
+  return nsc;
+}
+
+static GtFeatureNode *snapshot_in_stream_feature(AgnSnapshotInStream *stream,
+                                                 GtUword seqindex,
+                                                 const AgnSnapshotFeature *f)
+{
+  GtGenomeNode *gn;
+  GtFeatureNode *fn;
+  GtStr *seqid = snapshot_in_stream_seqid(stream, seqindex);
+
+  if(f->flags & AGN_SNAPSHOT_PSEUDO)
+    gn = gt_feature_node_new_pseudo(seqid, f->start, f->end, f->strand);
+  else
+  {
+    gn = gt_feature_node_new(seqid, stream->strtab + f->type, f->start, f->end,
+                             f->strand);
+  }
+  fn = gt_feature_node_cast(gn);
+
+  GtStr *source = gt_hashmap_get(stream->sources, (void *)(GtUword)f->source);
+  if(source == NULL)
+  {
+    source = gt_str_new_cstr(stream->strtab + f->source);
+    gt_hashmap_add(stream->sources, (void *)(GtUword)f->source, source);
+  }
+  if(strcmp(gt_str_get(source), ".") != 0)
+    gt_feature_node_set_source(fn, source);
+  if(f->flags & AGN_SNAPSHOT_HASSCORE)
+    gt_feature_node_set_score(fn, f->score);
+  if(f->phase != GT_PHASE_UNDEFINED)
+    gt_feature_node_set_phase(fn, f->phase);
+
+  const char *attr = stream->strtab + f->attrs;
+  GtUword i;
+  for(i = 0; i < f->nattrs; i++)
+  {
+    const char *key = attr;
+    const char *value = key + strlen(key) + 1;
+    gt_feature_node_add_attribute(fn, key, value);
+    attr = value + strlen(value) + 1;
+  }
+
+  return fn;
+}
+
+static void snapshot_in_stream_free(GtNodeStream *ns)
+{
+  AgnSnapshotInStream *stream = snapshot_in_stream_cast(ns);
+  GtUword i;
+  for(i = 0; i < stream->header->numseqs; i++)
+  {
+    if(stream->seqids[i] != NULL)
+      gt_str_delete(stream->seqids[i]);
+  }
+  gt_free(stream->seqids);
+  gt_hashmap_delete(stream->sources);
+  gt_array_delete(stream->nodes);
+  gt_array_delete(stream->hasparent);
+  gt_str_delete(stream->filename);
+  munmap(stream->map, stream->mapsize);
+}
+
+static int snapshot_in_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                   GtError *error)
+{
+  AgnSnapshotInStream *stream;
+  const AgnSnapshotSeq *seq;
+  gt_error_check(error);
+  stream = snapshot_in_stream_cast(ns);
+
+  while(stream->regioncursor < stream->header->numseqs)
+  {
+    GtUword seqindex = stream->regioncursor++;
+    seq = stream->seqs + seqindex;
+    if(seq->end == 0)
+      continue;
+    *gn = gt_region_node_new(snapshot_in_stream_seqid(stream, seqindex),
+                             seq->start, seq->end);
+    return 0;
+  }
+
+  if(stream->featcursor >= stream->header->numfeats)
+  {
+    *gn = NULL;
+    return 0;
+  }
+
+  seq = stream->seqs + stream->seqcursor;
+  while(seq->numfeats == 0 ||
+        stream->featcursor >= seq->firstfeat + seq->numfeats)
+  {
+    stream->seqcursor++;
+    agn_assert(stream->seqcursor < stream->header->numseqs);
+    seq = stream->seqs + stream->seqcursor;
+  }
+
+  // Reconstruct the feature graph rooted at the current feature
+  GtUword first = stream->featcursor;
+  GtUword last = first + 1;
+  GtUword seqend = seq->firstfeat + seq->numfeats;
+  agn_assert(stream->feats[first].flags & AGN_SNAPSHOT_ROOT);
+  while(last < seqend && !(stream->feats[last].flags & AGN_SNAPSHOT_ROOT))
+    last++;
+
+  gt_array_reset(stream->nodes);
+  gt_array_reset(stream->hasparent);
+  GtUword i;
+  for(i = first; i < last; i++)
+  {
+    GtFeatureNode *fn = snapshot_in_stream_feature(stream, stream->seqcursor,
+                                                   stream->feats + i);
+    bool hasparent = false;
+    gt_array_add(stream->nodes, fn);
+    gt_array_add(stream->hasparent, hasparent);
+  }
+  for(i = first; i < last; i++)
+  {
+    GtUint64 rep = stream->feats[i].multirep;
+    if(rep == AGN_SNAPSHOT_NONE || rep < first || rep >= last)
+      continue;
+    GtFeatureNode *fn = *(GtFeatureNode **)gt_array_get(stream->nodes,
+                                                         i - first);
+    if(rep == i)
+      gt_feature_node_make_multi_representative(fn);
+    else
+    {
+      GtFeatureNode *repfn = *(GtFeatureNode **)gt_array_get(stream->nodes,
+                                                              rep - first);
+      gt_feature_node_set_multi_representative(fn, repfn);
+    }
+  }
+  GtUword edgeend = seq->firstedge + seq->numedges;
+  while(stream->edgecursor < edgeend &&
+        stream->edges[stream->edgecursor].parent < last)
+  {
+    const AgnSnapshotEdge *edge = stream->edges + stream->edgecursor;
+    GtFeatureNode *parent = *(GtFeatureNode **)gt_array_get(stream->nodes,
+                                                             edge->parent -
+                                                             first);
+    GtFeatureNode *child = *(GtFeatureNode **)gt_array_get(stream->nodes,
+                                                            edge->child -
+                                                            first);
+    bool *hasparent = gt_array_get(stream->hasparent, edge->child - first);
+    if(*hasparent)
+      gt_genome_node_ref((GtGenomeNode *)child);
+    *hasparent = true;
+    gt_feature_node_add_child(parent, child);
+    stream->edgecursor++;
+  }
+  stream->featcursor = last;
+
+  *gn = *(GtGenomeNode **)gt_array_get(stream->nodes, 0);
+  gt_genome_node_add_user_data(*gn, "agn_filename",
+                               gt_str_ref(stream->filename),
+                               (GtFree)gt_str_delete);
+  return 0;
+}
+
+static GtStr *snapshot_in_stream_seqid(AgnSnapshotInStream *stream,
+                                       GtUword seqindex)
+{
+  if(stream->seqids[seqindex] == NULL)
+  {
+    const char *seqid = stream->strtab + stream->seqs[seqindex].seqid;
+    stream->seqids[seqindex] = gt_str_new_cstr(seqid);
+  }
+  return stream->seqids[seqindex];
+}
+
+static const char *snapshot_in_stream_validate(const void *map,
+                                               size_t mapsize)
+{
+  const AgnSnapshotHeader *header = map;
+  size_t remaining = mapsize - sizeof(AgnSnapshotHeader);
+  if(header->numseqs > remaining / sizeof(AgnSnapshotSeq))
+    return "sequence directory exceeds file size";
+  remaining -= header->numseqs * sizeof(AgnSnapshotSeq);
+  if(header->numfeats > remaining / sizeof(AgnSnapshotFeature))
+    return "feature records exceed file size";
+  remaining -= header->numfeats * sizeof(AgnSnapshotFeature);
+  if(header->numedges > remaining / sizeof(AgnSnapshotEdge))
+    return "parent/child records exceed file size";
+  remaining -= header->numedges * sizeof(AgnSnapshotEdge);
+  if(header->strtabsize != remaining)
+    return "string table size does not match file size";
+
+  // With a NUL at the end of the string table, every offset within the table
+  // refers to a terminated string.
+  const AgnSnapshotSeq *seqs = (const AgnSnapshotSeq *)(header + 1);
+  const AgnSnapshotFeature *feats = (const AgnSnapshotFeature *)
+                                    (seqs + header->numseqs);
+  const AgnSnapshotEdge *edges = (const AgnSnapshotEdge *)
+                                 (feats + header->numfeats);
+  const char *strtab = (const char *)(edges + header->numedges);
+  GtUint64 strtabsize = header->strtabsize;
+  if(strtabsize == 0 && (header->numseqs > 0 || header->numfeats > 0))
+    return "string table is empty";
+  if(strtabsize > 0 && strtab[strtabsize - 1] != '\0')
+    return "string table is not NUL-terminated";
+
+  GtUword i;
+  for(i = 0; i < header->numfeats; i++)
+  {
+    const AgnSnapshotFeature *f = feats + i;
+    if(f->type >= strtabsize || f->source >= strtabsize)
+      return "feature type or source out of range";
+    if(f->multirep != AGN_SNAPSHOT_NONE && f->multirep >= header->numfeats)
+      return "multi-feature representative out of range";
+    if(f->strand >= GT_NUM_OF_STRAND_TYPES || f->phase > GT_PHASE_UNDEFINED)
+      return "invalid feature strand or phase";
+    GtUint64 offset = f->attrs;
+    GtUword j;
+    for(j = 0; j < 2 * (GtUword)f->nattrs; j++)
+    {
+      if(offset >= strtabsize)
+        return "feature attributes out of range";
+      offset += strlen(strtab + offset) + 1;
+    }
+  }
+
+  // Non-empty sequences must be stored in order, and the parent/child records
+  // of each feature graph must refer only to features of that graph.
+  GtUint64 nextfeat = 0, nextedge = 0;
+  for(i = 0; i < header->numseqs; i++)
+  {
+    const AgnSnapshotSeq *seq = seqs + i;
+    if(seq->seqid >= strtabsize)
+      return "sequence ID out of range";
+    if(seq->numfeats == 0)
+    {
+      if(seq->numedges != 0)
+        return "parent/child records for a sequence with no features";
+      continue;
+    }
+    if(seq->firstfeat != nextfeat ||
+       seq->numfeats > header->numfeats - nextfeat)
+      return "sequence feature range out of order or out of range";
+    if(seq->numedges > 0 && (seq->firstedge != nextedge ||
+       seq->numedges > header->numedges - nextedge))
+      return "sequence parent/child range out of order or out of range";
+    nextfeat += seq->numfeats;
+    if(!(feats[seq->firstfeat].flags & AGN_SNAPSHOT_ROOT))
+      return "sequence does not begin with a top-level feature";
+
+    GtUint64 first, last, featend = seq->firstfeat + seq->numfeats;
+    GtUint64 edge = seq->firstedge;
+    GtUint64 edgeend = seq->numedges > 0 ? edge + seq->numedges : edge;
+    for(first = seq->firstfeat; first < featend; first = last)
+    {
+      last = first + 1;
+      while(last < featend && !(feats[last].flags & AGN_SNAPSHOT_ROOT))
+        last++;
+      while(edge < edgeend && edges[edge].parent < last)
+      {
+        if(edges[edge].parent < first || edges[edge].child < first ||
+           edges[edge].child >= last)
+          return "parent/child record out of range";
+        edge++;
+      }
+    }
+    if(edge != edgeend)
+      return "parent/child record out of range";
+    nextedge += seq->numedges;
+  }
+  if(nextfeat != header->numfeats || nextedge != header->numedges)
+    return "features or parent/child records not assigned to any sequence";
+
+  return NULL;
+}
+
+static void snapshot_in_stream_test_data(const char *filename,
+                                         const char *snapshotfile,
+                                         GtArray *feats)
+{
+  GtNodeStream *current_stream, *last_stream;
+  GtQueue *streams = gt_queue_new();
+  GtLogger *logger = gt_logger_new(true, "", stderr);
+  GtError *error = gt_error_new();
+  FILE *outstream = fopen(snapshotfile, "wb");
+  agn_assert(outstream != NULL);
+
+  current_stream = gt_gff3_in_stream_new_unsorted(1, &filename);
+  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)current_stream);
+  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)current_stream);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  current_stream = gt_sort_stream_new(last_stream);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  current_stream = agn_gene_stream_new(last_stream, logger);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  current_stream = agn_snapshot_out_stream_new(last_stream, outstream);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  current_stream = gt_array_out_stream_new(last_stream, feats, error);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  int result = gt_node_stream_pull(last_stream, error);
+  if(result == -1)
+  {
+    fprintf(stderr, "[AEGeAn::AgnSnapshotInStream] error processing node "
+            "stream: %s\n", gt_error_get(error));
+  }
+
+  while(gt_queue_size(streams) > 0)
+  {
+    current_stream = gt_queue_get(streams);
+    gt_node_stream_delete(current_stream);
+  }
+  gt_queue_delete(streams);
+  fclose(outstream);
+  gt_logger_delete(logger);
+  gt_error_delete(error);
+}
+
+static bool snapshot_in_stream_test_corrupt(const char *snapshotfile,
+                                            long offset, const void *value,
+                                            size_t size)
+{
+  char corruptfile[] = "/tmp/agn-snapshot-XXXXXX";
+  int fd = mkstemp(corruptfile);
+  agn_assert(fd >= 0);
+  FILE *outstream = fdopen(fd, "wb");
+  FILE *instream = fopen(snapshotfile, "rb");
+  agn_assert(outstream != NULL && instream != NULL);
+  char buffer[4096];
+  size_t length;
+  while((length = fread(buffer, 1, sizeof(buffer), instream)) > 0)
+    fwrite(buffer, 1, length, outstream);
+  fclose(instream);
+  fseek(outstream, offset, offset < 0 ? SEEK_END : SEEK_SET);
+  fwrite(value, 1, size, outstream);
+  fclose(outstream);
+
+  GtError *error = gt_error_new();
+  GtNodeStream *stream = agn_snapshot_in_stream_new(corruptfile, error);
+  bool rejected = stream == NULL && gt_error_is_set(error);
+  if(stream != NULL)
+    gt_node_stream_delete(stream);
+  gt_error_delete(error);
+  unlink(corruptfile);
+  return rejected;
+}
+
+static bool snapshot_in_stream_test_equal(GtFeatureNode *fn1,
+                                          GtFeatureNode *fn2)
+{
+  GtFeatureNodeIterator *iter1 = gt_feature_node_iterator_new(fn1);
+  GtFeatureNodeIterator *iter2 = gt_feature_node_iterator_new(fn2);
+  GtFeatureNode *f1 = gt_feature_node_iterator_next(iter1);
+  GtFeatureNode *f2 = gt_feature_node_iterator_next(iter2);
+  bool equal = true;
+  while(equal && f1 != NULL && f2 != NULL)
+  {
+    const char *id1 = gt_feature_node_get_attribute(f1, "ID");
+    const char *id2 = gt_feature_node_get_attribute(f2, "ID");
+    equal = gt_genome_node_cmp((GtGenomeNode *)f1, (GtGenomeNode *)f2) == 0 &&
+            strcmp(gt_feature_node_get_type(f1),
+                   gt_feature_node_get_type(f2)) == 0 &&
+            gt_feature_node_get_strand(f1) == gt_feature_node_get_strand(f2) &&
+            ((id1 == NULL && id2 == NULL) ||
+             (id1 != NULL && id2 != NULL && strcmp(id1, id2) == 0));
+    f1 = gt_feature_node_iterator_next(iter1);
+    f2 = gt_feature_node_iterator_next(iter2);
+  }
+  gt_feature_node_iterator_delete(iter1);
+  gt_feature_node_iterator_delete(iter2);
+  return equal && f1 == NULL && f2 == NULL;
+}
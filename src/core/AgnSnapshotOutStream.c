@@ -0,0 +1,367 @@
+/**
+
+Copyright (c) 2010-2014, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include <string.h>
+#include "core/hashmap_api.h"
+#include "extended/feature_node_iterator_api.h"
+#include "AgnSnapshotOutStream.h"
+#include "AgnUtils.h"
+
+//------------------------------------------------------------------------------
+// Data structure definition
+//------------------------------------------------------------------------------
+
+struct AgnSnapshotOutStream
+{
+  const GtNodeStream parent_instance;
+  GtNodeStream *in_stream;
+  FILE *outstream;
+  GtArray *seqs;
+  GtArray *feats;
+  GtArray *edges;
+  GtStr *strtab;
+  GtHashmap *stroffsets;
+  GtHashmap *seqindex;
+  GtHashmap *featindex;
+  GtUword currentseq;
+  bool written;
+};
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+#define snapshot_out_stream_cast(GS)\
+        gt_node_stream_cast(snapshot_out_stream_class(), GS)
+
+/**
+ * @function Implements the GtNodeStream interface for this class.
+ */
+static const GtNodeStreamClass* snapshot_out_stream_class(void);
+
+/**
+ * @function Class destructor.
+ */
+static void snapshot_out_stream_free(GtNodeStream *ns);
+
+/**
+ * @function Pulls nodes from the input stream, records them, and passes them
+ * on. When the input stream is exhausted, the snapshot is written.
+ */
+static int snapshot_out_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                    GtError *error);
+
+/**
+ * @function Record a feature and (recursively) its subfeatures, returning the
+ * index of the feature. Features already recorded are not recorded again.
+ */
+static GtUint64 snapshot_out_stream_record(AgnSnapshotOutStream *stream,
+                                           GtFeatureNode *fn, bool root);
+
+/**
+ * @function Retrieve the directory entry for the given sequence, creating a
+ * new entry if necessary. Returns NULL if the features annotated on the
+ * sequence would not be contiguous (i.e., the input is not sorted).
+ */
+static AgnSnapshotSeq *snapshot_out_stream_seq(AgnSnapshotOutStream *stream,
+                                               GtGenomeNode *gn, bool region);
+
+/**
+ * @function Add a string to the string table (unless already present) and
+ * return its offset.
+ */
+static GtUint64 snapshot_out_stream_string(AgnSnapshotOutStream *stream,
+                                           const char *string);
+
+/**
+ * @function Write the snapshot to the output file.
+ */
+static int snapshot_out_stream_write(AgnSnapshotOutStream *stream,
+                                     GtError *error);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+GtNodeStream *agn_snapshot_out_stream_new(GtNodeStream *in_stream,
+                                          FILE *outstream)
+{
+  GtNodeStream *ns;
+  AgnSnapshotOutStream *stream;
+  agn_assert(in_stream && outstream);
+  ns = gt_node_stream_create(snapshot_out_stream_class(), false);
+  stream = snapshot_out_stream_cast(ns);
+  stream->in_stream = gt_node_stream_ref(in_stream);
+  stream->outstream = outstream;
+  stream->seqs = gt_array_new( sizeof(AgnSnapshotSeq) );
+  stream->feats = gt_array_new( sizeof(AgnSnapshotFeature) );
+  stream->edges = gt_array_new( sizeof(AgnSnapshotEdge) );
+  stream->strtab = gt_str_new();
+  stream->stroffsets = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
+                                      gt_free_func);
+  stream->seqindex = gt_hashmap_new(GT_HASH_STRING, gt_free_func, gt_free_func);
+  stream->featindex = gt_hashmap_new(GT_HASH_DIRECT, NULL, gt_free_func);
+  stream->currentseq = GT_UNDEF_UWORD;
+  stream->written = false;
+  return ns;
+}
+
+static const GtNodeStreamClass *snapshot_out_stream_class(void)
+{
+  static const GtNodeStreamClass *nsc = NULL;
+  if(!nsc)
+  {
+    nsc = gt_node_stream_class_new(sizeof (AgnSnapshotOutStream),
+                                   snapshot_out_stream_free,
+                                   snapshot_out_stream_next);
+  }
+  return nsc;
+}
+
+static void snapshot_out_stream_free(GtNodeStream *ns)
+{
+  AgnSnapshotOutStream *stream = snapshot_out_stream_cast(ns);
+  gt_node_stream_delete(stream->in_stream);
+  gt_array_delete(stream->seqs);
+  gt_array_delete(stream->feats);
+  gt_array_delete(stream->edges);
+  gt_str_delete(stream->strtab);
+  gt_hashmap_delete(stream->stroffsets);
+  gt_hashmap_delete(stream->seqindex);
+  gt_hashmap_delete(stream->featindex);
+}
+
+static int snapshot_out_stream_next(GtNodeStream *ns, GtGenomeNode **gn,
+                                    GtError *error)
+{
+  AgnSnapshotOutStream *stream;
+  int result;
+  gt_error_check(error);
+  stream = snapshot_out_stream_cast(ns);
+
+  result = gt_node_stream_next(stream->in_stream, gn, error);
+  if(result)
+    return result;
+  if(*gn == NULL)
+  {
+    if(stream->written)
+      return 0;
+    stream->written = true;
+    return snapshot_out_stream_write(stream, error);
+  }
+
+  GtRegionNode *rn = gt_region_node_try_cast(*gn);
+  GtFeatureNode *fn = gt_feature_node_try_cast(*gn);
+  if(rn == NULL && fn == NULL)
+    return 0;
+
+  AgnSnapshotSeq *seq = snapshot_out_stream_seq(stream, *gn, rn != NULL);
+  if(seq == NULL)
+  {
+    gt_error_set(error, "cannot create snapshot: features on sequence '%s' are "
+                 "not contiguous; input must be sorted",
+                 gt_str_get(gt_genome_node_get_seqid(*gn)));
+    return -1;
+  }
+  if(rn != NULL)
+  {
+    GtRange range = gt_genome_node_get_range(*gn);
+    seq->start = range.start;
+    seq->end = range.end;
+    return 0;
+  }
+
+  GtUword numfeats = gt_array_size(stream->feats);
+  GtUword numedges = gt_array_size(stream->edges);
+  snapshot_out_stream_record(stream, fn, true);
+  seq->numfeats += gt_array_size(stream->feats) - numfeats;
+  seq->numedges += gt_array_size(stream->edges) - numedges;
+
+  // Multi-feature representatives are resolved once the entire feature graph
+  // has been recorded.
+  GtUword i;
+  for(i = numfeats; i < gt_array_size(stream->feats); i++)
+  {
+    AgnSnapshotFeature *feat = gt_array_get(stream->feats, i);
+    if(feat->multirep == AGN_SNAPSHOT_NONE)
+      continue;
+    GtFeatureNode *rep = (GtFeatureNode *)(GtUword)feat->multirep;
+    GtUint64 *repindex = gt_hashmap_get(stream->featindex, rep);
+    feat->multirep = repindex ? *repindex : AGN_SNAPSHOT_NONE;
+  }
+  gt_hashmap_reset(stream->featindex);
+
+  return 0;
+}
+
+static GtUint64 snapshot_out_stream_record(AgnSnapshotOutStream *stream,
+                                           GtFeatureNode *fn, bool root)
+{
+  GtUint64 *index = gt_hashmap_get(stream->featindex, fn);
+  if(index != NULL)
+    return *index;
+
+  AgnSnapshotFeature feat;
+  GtRange range = gt_genome_node_get_range((GtGenomeNode *)fn);
+  memset(&feat, 0, sizeof(feat));
+  feat.start = range.start;
+  feat.end = range.end;
+  feat.type = snapshot_out_stream_string(stream, gt_feature_node_get_type(fn));
+  feat.source = snapshot_out_stream_string(stream,
+                                           gt_feature_node_get_source(fn));
+  feat.strand = gt_feature_node_get_strand(fn);
+  feat.phase = gt_feature_node_get_phase(fn);
+  feat.multirep = AGN_SNAPSHOT_NONE;
+  if(root)
+    feat.flags |= AGN_SNAPSHOT_ROOT;
+  if(gt_feature_node_is_pseudo(fn))
+    feat.flags |= AGN_SNAPSHOT_PSEUDO;
+  if(gt_feature_node_score_is_defined(fn))
+  {
+    feat.flags |= AGN_SNAPSHOT_HASSCORE;
+    feat.score = gt_feature_node_get_score(fn);
+  }
+  if(gt_feature_node_is_multi(fn))
+  {
+    GtFeatureNode *rep = gt_feature_node_get_multi_representative(fn);
+    feat.multirep = (GtUint64)(GtUword)rep;
+  }
+
+  GtStrArray *attrs = gt_feature_node_get_attribute_list(fn);
+  GtUword i;
+  feat.attrs = gt_str_length(stream->strtab);
+  feat.nattrs = gt_str_array_size(attrs);
+  for(i = 0; i < gt_str_array_size(attrs); i++)
+  {
+    const char *key = gt_str_array_get(attrs, i);
+    const char *value = gt_feature_node_get_attribute(fn, key);
+    gt_str_append_cstr(stream->strtab, key);
+    gt_str_append_char(stream->strtab, '\0');
+    gt_str_append_cstr(stream->strtab, value);
+    gt_str_append_char(stream->strtab, '\0');
+  }
+  gt_str_array_delete(attrs);
+
+  GtUint64 featindex = gt_array_size(stream->feats);
+  gt_array_add(stream->feats, feat);
+  index = gt_malloc( sizeof(GtUint64) );
+  *index = featindex;
+  gt_hashmap_add(stream->featindex, fn, index);
+
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new_direct(fn);
+  GtFeatureNode *child;
+  for(child  = gt_feature_node_iterator_next(iter);
+      child != NULL;
+      child  = gt_feature_node_iterator_next(iter))
+  {
+    AgnSnapshotEdge edge;
+    edge.parent = featindex;
+    edge.child = snapshot_out_stream_record(stream, child, false);
+    gt_array_add(stream->edges, edge);
+  }
+  gt_feature_node_iterator_delete(iter);
+
+  return featindex;
+}
+
+static AgnSnapshotSeq *snapshot_out_stream_seq(AgnSnapshotOutStream *stream,
+                                               GtGenomeNode *gn, bool region)
+{
+  const char *seqid = gt_str_get(gt_genome_node_get_seqid(gn));
+  GtUword *index = gt_hashmap_get(stream->seqindex, seqid);
+  GtUword numseqs = gt_array_size(stream->seqs);
+  if(index != NULL)
+  {
+    AgnSnapshotSeq *seq = gt_array_get(stream->seqs, *index);
+    if(region || *index == stream->currentseq)
+      return seq;
+    if(seq->numfeats > 0)
+      return NULL;
+    seq->firstfeat = gt_array_size(stream->feats);
+    seq->firstedge = gt_array_size(stream->edges);
+    stream->currentseq = *index;
+    return seq;
+  }
+
+  AgnSnapshotSeq seq;
+  memset(&seq, 0, sizeof(seq));
+  seq.seqid = snapshot_out_stream_string(stream, seqid);
+  seq.firstfeat = gt_array_size(stream->feats);
+  seq.firstedge = gt_array_size(stream->edges);
+  gt_array_add(stream->seqs, seq);
+  index = gt_malloc( sizeof(GtUword) );
+  *index = numseqs;
+  gt_hashmap_add(stream->seqindex, gt_cstr_dup(seqid), index);
+  if(!region)
+    stream->currentseq = numseqs;
+  return gt_array_get(stream->seqs, numseqs);
+}
+
+static GtUint64 snapshot_out_stream_string(AgnSnapshotOutStream *stream,
+                                           const char *string)
+{
+  GtUint64 *offset = gt_hashmap_get(stream->stroffsets, string);
+  if(offset != NULL)
+    return *offset;
+
+  offset = gt_malloc( sizeof(GtUint64) );
+  *offset = gt_str_length(stream->strtab);
+  gt_str_append_cstr(stream->strtab, string);
+  gt_str_append_char(stream->strtab, '\0');
+  gt_hashmap_add(stream->stroffsets, gt_cstr_dup(string), offset);
+  return *offset;
+}
+
+static int snapshot_out_stream_write(AgnSnapshotOutStream *stream,
+                                     GtError *error)
+{
+  AgnSnapshotHeader header;
+  memset(&header, 0, sizeof(header));
+  strcpy(header.magic, AGN_SNAPSHOT_MAGIC);
+  header.version = AGN_SNAPSHOT_VERSION;
+  header.numseqs = gt_array_size(stream->seqs);
+  header.numfeats = gt_array_size(stream->feats);
+  header.numedges = gt_array_size(stream->edges);
+  header.strtabsize = gt_str_length(stream->strtab);
+
+  bool success = fwrite(&header, sizeof(header), 1, stream->outstream) == 1;
+  if(success && header.numseqs > 0)
+  {
+    success = fwrite(gt_array_get_space(stream->seqs), sizeof(AgnSnapshotSeq),
+                     header.numseqs, stream->outstream) == header.numseqs;
+  }
+  if(success && header.numfeats > 0)
+  {
+    success = fwrite(gt_array_get_space(stream->feats),
+                     sizeof(AgnSnapshotFeature), header.numfeats,
+                     stream->outstream) == header.numfeats;
+  }
+  if(success && header.numedges > 0)
+  {
+    success = fwrite(gt_array_get_space(stream->edges),
+                     sizeof(AgnSnapshotEdge), header.numedges,
+                     stream->outstream) == header.numedges;
+  }
+  if(success && header.strtabsize > 0)
+  {
+    success = fwrite(gt_str_get_mem(stream->strtab), 1, header.strtabsize,
+                     stream->outstream) == header.strtabsize;
+  }
+  if(success)
+    success = fflush(stream->outstream) == 0;
+
+  if(!success)
+  {
+    gt_error_set(error, "error writing annotation snapshot");
+    return -1;
+  }
+  return 0;
+}
@@ -7,16 +7,163 @@ the 'LICENSE' file in the AEGeAn source code distribution or
 online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 
 **/
+#include <stddef.h>
 #include <string.h>
 #include "extended/feature_node_iterator_api.h"
 #include "AgnTypecheck.h"
 #include "AgnUtils.h"
 
+#define TYPECHECK_CACHE_SIZE 64
+
+//------------------------------------------------------------------------------
+// Data structure definitions
+//------------------------------------------------------------------------------
+
+typedef struct
+{
+  const char *type;
+  unsigned classes;
+} TypecheckAlias;
+
+typedef struct
+{
+  const char *type;
+  unsigned classes;
+} TypecheckCacheSlot;
+
+// All recognized spellings of each feature type class
+static const TypecheckAlias typecheck_aliases[] =
+{
+  { "gene",                            AGN_TYPE_GENE },
+  { "pseudogene",                      AGN_TYPE_PSEUDOGENE },
+  { "mRNA",                            AGN_TYPE_MRNA | AGN_TYPE_TRANSCRIPT },
+  { "messenger RNA",                   AGN_TYPE_MRNA | AGN_TYPE_TRANSCRIPT },
+  { "messenger_RNA",                   AGN_TYPE_MRNA | AGN_TYPE_TRANSCRIPT },
+  { "tRNA",                            AGN_TYPE_TRANSCRIPT },
+  { "transfer RNA",                    AGN_TYPE_TRANSCRIPT },
+  { "rRNA",                            AGN_TYPE_TRANSCRIPT },
+  { "ribosomal RNA",                   AGN_TYPE_TRANSCRIPT },
+  { "exon",                            AGN_TYPE_EXON },
+  { "intron",                          AGN_TYPE_INTRON },
+  { "CDS",                             AGN_TYPE_CDS },
+  { "coding sequence",                 AGN_TYPE_CDS },
+  { "coding_sequence",                 AGN_TYPE_CDS },
+  { "UTR",                             AGN_TYPE_UTR },
+  { "untranslated region",             AGN_TYPE_UTR },
+  { "untranslated_region",             AGN_TYPE_UTR },
+  { "5' UTR",                          AGN_TYPE_UTR | AGN_TYPE_UTR5P },
+  { "5'UTR",                           AGN_TYPE_UTR | AGN_TYPE_UTR5P },
+  { "five prime UTR",                  AGN_TYPE_UTR | AGN_TYPE_UTR5P },
+  { "five_prime_UTR",                  AGN_TYPE_UTR | AGN_TYPE_UTR5P },
+  { "five prime untranslated region",  AGN_TYPE_UTR | AGN_TYPE_UTR5P },
+  { "five_prime_untranslated_region",  AGN_TYPE_UTR | AGN_TYPE_UTR5P },
+  { "3' UTR",                          AGN_TYPE_UTR | AGN_TYPE_UTR3P },
+  { "3'UTR",                           AGN_TYPE_UTR | AGN_TYPE_UTR3P },
+  { "three prime UTR",                 AGN_TYPE_UTR | AGN_TYPE_UTR3P },
+  { "three_prime_UTR",                 AGN_TYPE_UTR | AGN_TYPE_UTR3P },
+  { "three prime untranslated region", AGN_TYPE_UTR | AGN_TYPE_UTR3P },
+  { "three_prime_untranslated_region", AGN_TYPE_UTR | AGN_TYPE_UTR3P },
+  { "start_codon",                     AGN_TYPE_START_CODON },
+  { "start codon",                     AGN_TYPE_START_CODON },
+  { "initiation codon",                AGN_TYPE_START_CODON },
+  { "stop_codon",                      AGN_TYPE_STOP_CODON },
+  { "stop codon",                      AGN_TYPE_STOP_CODON },
+  // What about 'termination codon'?
+  { NULL,                              AGN_TYPE_NONE },
+};
+
+// Location of each type class' summary in the census, in bit order
+static const size_t typecheck_census_offsets[] =
+{
+  offsetof(AgnTypeCensus, gene),
+  offsetof(AgnTypeCensus, pseudogene),
+  offsetof(AgnTypeCensus, mrna),
+  offsetof(AgnTypeCensus, transcript),
+  offsetof(AgnTypeCensus, exon),
+  offsetof(AgnTypeCensus, intron),
+  offsetof(AgnTypeCensus, cds),
+  offsetof(AgnTypeCensus, utr),
+  offsetof(AgnTypeCensus, utr5p),
+  offsetof(AgnTypeCensus, utr3p),
+  offsetof(AgnTypeCensus, start_codon),
+  offsetof(AgnTypeCensus, stop_codon),
+};
+
+// Type strings are interned by GenomeTools, so the classification of each
+// type is cached by address. The cache is per thread so that lookups need no
+// locking.
+static __thread TypecheckCacheSlot typecheck_cache[TYPECHECK_CACHE_SIZE];
+
+
+//------------------------------------------------------------------------------
+// Prototypes for private functions
+//------------------------------------------------------------------------------
+
+/**
+ * @function Determine the classes of the given type by comparing it to each
+ * recognized spelling.
+ */
+static unsigned typecheck_classify(const char *type);
+
+
+//------------------------------------------------------------------------------
+// Method implementations
+//------------------------------------------------------------------------------
+
+
 bool agn_typecheck_cds(GtFeatureNode *fn)
 {
-  return gt_feature_node_has_type(fn, "CDS") ||
-         gt_feature_node_has_type(fn, "coding sequence") ||
-         gt_feature_node_has_type(fn, "coding_sequence");
+  return agn_typecheck_classes(fn) & AGN_TYPE_CDS;
+}
+
+void agn_typecheck_census(GtFeatureNode *fn, AgnTypeCensus *census)
+{
+  memset(census, 0, sizeof(AgnTypeCensus));
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+  GtFeatureNode *feature;
+  for(feature  = gt_feature_node_iterator_next(iter);
+      feature != NULL;
+      feature  = gt_feature_node_iterator_next(iter))
+  {
+    agn_typecheck_census_add(census, feature);
+  }
+  gt_feature_node_iterator_delete(iter);
+}
+
+void agn_typecheck_census_add(AgnTypeCensus *census, GtFeatureNode *fn)
+{
+  unsigned classes = agn_typecheck_classes(fn);
+  if(classes == AGN_TYPE_NONE)
+    return;
+
+  GtRange range = gt_genome_node_get_range((GtGenomeNode *)fn);
+  GtUword bit;
+  for(bit = 0; classes != 0; bit++, classes >>= 1)
+  {
+    if(!(classes & 1))
+      continue;
+    AgnTypeSummary *summary = (AgnTypeSummary *)
+                              ((char *)census + typecheck_census_offsets[bit]);
+    if(summary->count == 0)
+      summary->range = range;
+    else
+      summary->range = gt_range_join(&summary->range, &range);
+    summary->count++;
+    summary->length += gt_range_length(&range);
+  }
+}
+
+unsigned agn_typecheck_classes(GtFeatureNode *fn)
+{
+  const char *type = gt_feature_node_get_type(fn);
+  TypecheckCacheSlot *slot;
+  slot = typecheck_cache + ((GtUword)type >> 4) % TYPECHECK_CACHE_SIZE;
+  if(slot->type != type)
+  {
+    slot->classes = typecheck_classify(type);
+    slot->type = type;
+  }
+  return slot->classes;
 }
 
 GtUword agn_typecheck_count(GtFeatureNode *fn, bool (*func)(GtFeatureNode *))
@@ -38,7 +185,7 @@ GtUword agn_typecheck_count(GtFeatureNode *fn, bool (*func)(GtFeatureNode *))
 
 bool agn_typecheck_exon(GtFeatureNode *fn)
 {
-  return gt_feature_node_has_type(fn, "exon");
+  return agn_typecheck_classes(fn) & AGN_TYPE_EXON;
 }
 
 GtUword agn_typecheck_feature_combined_length(GtFeatureNode *root,
@@ -67,24 +214,72 @@ GtUword agn_typecheck_feature_combined_length(GtFeatureNode *root,
 
 bool agn_typecheck_gene(GtFeatureNode *fn)
 {
-  return gt_feature_node_has_type(fn, "gene");
+  return agn_typecheck_classes(fn) & AGN_TYPE_GENE;
+}
+
+void agn_typecheck_group(GtFeatureNode *fn, AgnTypeGroups *groups)
+{
+  GtArray **arrays[] = { &groups->cds, &groups->exons, &groups->introns,
+                         &groups->utrs, &groups->start_codons,
+                         &groups->stop_codons };
+  GtUword i;
+  for(i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++)
+  {
+    if(*arrays[i] == NULL)
+      *arrays[i] = gt_array_new( sizeof(GtFeatureNode *) );
+    else
+      gt_array_reset(*arrays[i]);
+  }
+
+  GtFeatureNodeIterator *iter = gt_feature_node_iterator_new(fn);
+  GtFeatureNode *feature;
+  for(feature  = gt_feature_node_iterator_next(iter);
+      feature != NULL;
+      feature  = gt_feature_node_iterator_next(iter))
+  {
+    unsigned classes = agn_typecheck_classes(feature);
+    if(classes & AGN_TYPE_CDS)
+      gt_array_add(groups->cds, feature);
+    else if(classes & AGN_TYPE_EXON)
+      gt_array_add(groups->exons, feature);
+    else if(classes & AGN_TYPE_INTRON)
+      gt_array_add(groups->introns, feature);
+    else if(classes & AGN_TYPE_UTR)
+      gt_array_add(groups->utrs, feature);
+    else if(classes & AGN_TYPE_START_CODON)
+      gt_array_add(groups->start_codons, feature);
+    else if(classes & AGN_TYPE_STOP_CODON)
+      gt_array_add(groups->stop_codons, feature);
+  }
+  gt_feature_node_iterator_delete(iter);
+  for(i = 0; i < sizeof(arrays) / sizeof(arrays[0]); i++)
+    gt_array_sort(*arrays[i], (GtCompare)agn_genome_node_compare);
+}
+
+void agn_typecheck_groups_free(AgnTypeGroups *groups)
+{
+  gt_array_delete(groups->cds);
+  gt_array_delete(groups->exons);
+  gt_array_delete(groups->introns);
+  gt_array_delete(groups->utrs);
+  gt_array_delete(groups->start_codons);
+  gt_array_delete(groups->stop_codons);
+  memset(groups, 0, sizeof(AgnTypeGroups));
 }
 
 bool agn_typecheck_intron(GtFeatureNode *fn)
 {
-  return gt_feature_node_has_type(fn, "intron");
+  return agn_typecheck_classes(fn) & AGN_TYPE_INTRON;
 }
 
 bool agn_typecheck_mrna(GtFeatureNode *fn)
 {
-  return gt_feature_node_has_type(fn, "mRNA") ||
-         gt_feature_node_has_type(fn, "messenger RNA") ||
-         gt_feature_node_has_type(fn, "messenger_RNA");
+  return agn_typecheck_classes(fn) & AGN_TYPE_MRNA;
 }
 
 bool agn_typecheck_pseudogene(GtFeatureNode *fn)
 {
-  return gt_feature_node_has_type(fn, "pseudogene");
+  return agn_typecheck_classes(fn) & AGN_TYPE_PSEUDOGENE;
 }
 
 GtArray *agn_typecheck_select(GtFeatureNode *fn, bool (*func)(GtFeatureNode *))
@@ -123,52 +318,41 @@ GtArray *agn_typecheck_select_str(GtFeatureNode *fn, const char *type)
 
 bool agn_typecheck_start_codon(GtFeatureNode *fn)
 {
-  return gt_feature_node_has_type(fn, "start_codon") ||
-         gt_feature_node_has_type(fn, "start codon") ||
-         gt_feature_node_has_type(fn, "initiation codon");
+  return agn_typecheck_classes(fn) & AGN_TYPE_START_CODON;
 }
 
 bool agn_typecheck_stop_codon(GtFeatureNode *fn)
 {
-  return gt_feature_node_has_type(fn, "stop_codon") ||
-         gt_feature_node_has_type(fn, "stop codon");
-         // What about 'termination codon'?
+  return agn_typecheck_classes(fn) & AGN_TYPE_STOP_CODON;
 }
 
 bool agn_typecheck_transcript(GtFeatureNode *fn)
 {
-  return agn_typecheck_mrna(fn) ||
-         gt_feature_node_has_type(fn, "tRNA") ||
-         gt_feature_node_has_type(fn, "transfer RNA") ||
-         gt_feature_node_has_type(fn, "rRNA") ||
-         gt_feature_node_has_type(fn, "ribosomal RNA");
+  return agn_typecheck_classes(fn) & AGN_TYPE_TRANSCRIPT;
 }
 
 bool agn_typecheck_utr(GtFeatureNode *fn)
 {
-  return gt_feature_node_has_type(fn, "UTR") ||
-         gt_feature_node_has_type(fn, "untranslated region") ||
-         gt_feature_node_has_type(fn, "untranslated_region") ||
-         agn_typecheck_utr3p(fn) ||
-         agn_typecheck_utr5p(fn);
+  return agn_typecheck_classes(fn) & AGN_TYPE_UTR;
 }
 
 bool agn_typecheck_utr3p(GtFeatureNode *fn)
 {
-  return gt_feature_node_has_type(fn, "3' UTR") ||
-         gt_feature_node_has_type(fn, "3'UTR") ||
-         gt_feature_node_has_type(fn, "three prime UTR") ||
-         gt_feature_node_has_type(fn, "three_prime_UTR") ||
-         gt_feature_node_has_type(fn, "three prime untranslated region") ||
-         gt_feature_node_has_type(fn, "three_prime_untranslated_region");
+  return agn_typecheck_classes(fn) & AGN_TYPE_UTR3P;
 }
 
 bool agn_typecheck_utr5p(GtFeatureNode *fn)
 {
-  return gt_feature_node_has_type(fn, "5' UTR") ||
-         gt_feature_node_has_type(fn, "5'UTR") ||
-         gt_feature_node_has_type(fn, "five prime UTR") ||
-         gt_feature_node_has_type(fn, "five_prime_UTR") ||
-         gt_feature_node_has_type(fn, "five prime untranslated region") ||
-         gt_feature_node_has_type(fn, "five_prime_untranslated_region");
+  return agn_typecheck_classes(fn) & AGN_TYPE_UTR5P;
+}
+
+static unsigned typecheck_classify(const char *type)
+{
+  const TypecheckAlias *alias;
+  for(alias = typecheck_aliases; alias->type != NULL; alias++)
+  {
+    if(strcmp(type, alias->type) == 0)
+      return alias->classes;
+  }
+  return AGN_TYPE_NONE;
 }
@@ -214,6 +214,11 @@ void agn_feature_node_remove_tree(GtFeatureNode *root, GtFeatureNode *fn)
   }
   gt_feature_node_iterator_delete(iter);
   gt_feature_node_remove_leaf(root, fn);
+
+  // Drop the AgnLocus member index (see agn_locus_iter_init), if any
+  GtGenomeNode *rootgn = (GtGenomeNode *)root;
+  if(gt_genome_node_get_user_data(rootgn, "members") != NULL)
+    gt_genome_node_release_user_data(rootgn, "members");
 }
 
 int agn_genome_node_compare(GtGenomeNode **gn_a, GtGenomeNode **gn_b)
@@ -221,6 +226,14 @@ int agn_genome_node_compare(GtGenomeNode **gn_a, GtGenomeNode **gn_b)
   return gt_genome_node_cmp(*gn_a, *gn_b);
 }
 
+const char *agn_genome_node_get_filename(GtGenomeNode *gn)
+{
+  GtStr *filename = gt_genome_node_get_user_data(gn, "agn_filename");
+  if(filename != NULL)
+    return gt_str_get(filename);
+  return gt_genome_node_get_filename(gn);
+}
+
 GtUword agn_mrna_3putr_length(GtFeatureNode *mrna)
 {
   return agn_typecheck_feature_combined_length(mrna, agn_typecheck_utr3p);
@@ -310,6 +323,24 @@ void agn_print_version(const char *progname, FILE *outstream)
           AGN_SEMANTIC_VERSION, AGN_VERSION_STABILITY, AGN_VERSION_HASH_SLUG);
 }
 
+double agn_rand_next(GtUint64 *state)
+{
+  agn_assert(state && *state != 0);
+  *state ^= *state >> 12;
+  *state ^= *state << 25;
+  *state ^= *state >> 27;
+  GtUint64 value = *state * 2685821657736338717ULL;
+  return (double)(value >> 11) / 9007199254740992.0;
+}
+
+GtUint64 agn_rand_seed(GtUword seed)
+{
+  GtUint64 state = ((GtUint64)seed + 1) * 11400714819323198485ULL;
+  if(state == 0)
+    state = 88172645463325252ULL;
+  return state;
+}
+
 int agn_sprintf_comma(GtUword n, char *buffer)
 {
   if(n < 1000)
@@ -11,9 +11,10 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #include <getopt.h>
 #include <math.h>
 #include "genometools.h"
+#include "AgnAttributePruneStream.h"
 #include "AgnGaevalVisitor.h"
-#include "AgnInferCDSVisitor.h"
-#include "AgnInferExonsVisitor.h"
+#include "AgnInferStructureVisitor.h"
+#include "AgnSnapshotInStream.h"
 #include "AgnUtils.h"
 
 typedef struct
@@ -22,6 +23,7 @@ typedef struct
   const char **genefiles;
   int numgenefiles;
   GtStr *tsvout;
+  const char *keepattrs;
   AgnGaevalParams params;
 } GaevalOptions;
 
@@ -46,7 +48,11 @@ static void print_usage(FILE *outstream)
 "    -h|--help               print this help message and exit\n"
 "    -v|--version            print version number and exit\n"
 "    -t|--tsv FILE           print coverage and integrity scores to the\n"
-"                            specified file in tab-separated text\n\n"
+"                            specified file in tab-separated text\n"
+"    -K|--keep-attrs: STRING remove all attributes except ID, Parent, Name,\n"
+"                            accession, and those in the given\n"
+"                            comma-separated list, from alignments and gene\n"
+"                            models to reduce memory usage\n\n"
 "  Weights for calculating integrity score (must add up to 1.0):\n"
 "    -a|--alpha: DOUBLE      introns confirmed, or %% expected CDS length for\n"
 "                            single-exon genes; default is 0.6\n"
@@ -62,15 +68,17 @@ static void print_usage(FILE *outstream)
 static void parse_options(int argc, char **argv, GaevalOptions *options)
 {
   options->tsvout = NULL;
+  options->keepattrs = NULL;
   default_params(&options->params);
   int opt = 0;
   int optindex = 0;
-  const char *optstr = "hvt:a:b:g:e:c:5:3:";
+  const char *optstr = "hvt:K:a:b:g:e:c:5:3:";
   const struct option gaeval_options[] =
   {
     { "help",      no_argument,       NULL, 'h' },
     { "version",   no_argument,       NULL, 'v' },
     { "tsv",       required_argument, NULL, 't' },
+    { "keep-attrs", required_argument, NULL, 'K' },
     { "alpha",     required_argument, NULL, 'a' },
     { "beta",      required_argument, NULL, 'b' },
     { "gamma",     required_argument, NULL, 'g' },
@@ -103,6 +111,8 @@ static void parse_options(int argc, char **argv, GaevalOptions *options)
     }
     else if(opt == 'g')
       options->params.gamma = atof(optarg);
+    else if(opt == 'K')
+      options->keepattrs = optarg;
     else if(opt == 't')
     {
       if(options->tsvout != NULL)
@@ -154,30 +164,56 @@ int main(int argc, char **argv)
   gt_lib_init();
   parse_options(argc, argv, &options);
   streams = gt_queue_new();
+  error = gt_error_new();
 
   stream = gt_gff3_in_stream_new_unsorted(1, &options.alignfile);
   gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)stream);
   gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)stream);
   gt_queue_add(streams, stream);
   align_stream = stream;
+  if(options.keepattrs != NULL)
+  {
+    stream = agn_attribute_prune_stream_new(align_stream, options.keepattrs);
+    gt_queue_add(streams, stream);
+    align_stream = stream;
+  }
 
-  stream = gt_gff3_in_stream_new_unsorted(options.numgenefiles,
-                                          options.genefiles);
-  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)stream);
-  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)stream);
-  gt_queue_add(streams, stream);
-  last_stream = stream;
-
-  GtStr *source = gt_str_new_cstr("AEGeAn::GAEVAL");
   GtLogger *logger = gt_logger_new(true, "", stderr);
-  stream = agn_infer_cds_stream_new(last_stream, source, logger);
-  gt_queue_add(streams, stream);
-  last_stream = stream;
+  if(options.numgenefiles == 1 &&
+     agn_snapshot_in_stream_check(options.genefiles[0]))
+  {
+    // Snapshots already contain canonical exon and CDS features.
+    stream = agn_snapshot_in_stream_new(options.genefiles[0], error);
+    if(stream == NULL)
+    {
+      fprintf(stderr, "[GAEVAL] error: %s\n", gt_error_get(error));
+      return 1;
+    }
+    gt_queue_add(streams, stream);
+    last_stream = stream;
+  }
+  else
+  {
+    stream = gt_gff3_in_stream_new_unsorted(options.numgenefiles,
+                                            options.genefiles);
+    gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)stream);
+    gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)stream);
+    gt_queue_add(streams, stream);
+    last_stream = stream;
+
+    if(options.keepattrs != NULL)
+    {
+      stream = agn_attribute_prune_stream_new(last_stream, options.keepattrs);
+      gt_queue_add(streams, stream);
+      last_stream = stream;
+    }
 
-  stream = agn_infer_exons_stream_new(last_stream, source, logger);
-  gt_queue_add(streams, stream);
-  last_stream = stream;
-  gt_str_delete(source);
+    GtStr *source = gt_str_new_cstr("AEGeAn::GAEVAL");
+    stream = agn_infer_structure_stream_new(last_stream, source, logger);
+    gt_queue_add(streams, stream);
+    last_stream = stream;
+    gt_str_delete(source);
+  }
 
   GtNodeVisitor *nv = agn_gaeval_visitor_new(align_stream, options.params);
   if(options.tsvout)
@@ -196,7 +232,6 @@ int main(int argc, char **argv)
   //----------
   // Execute the processing stream
   //----------
-  error = gt_error_new();
   int had_err = gt_node_stream_pull(last_stream, error);
   if(had_err)
     fprintf(stderr, "Error processing node stream: %s\n", gt_error_get(error));
@@ -21,6 +21,7 @@ typedef struct
   FILE *genestream;
   char *nameformat;
   unsigned long delta;
+  GtArray *deltas;
   GtFile *outstream;
   void (*filefreefunc)(GtFile *);
   GtHashmap *type_parents;
@@ -31,11 +32,42 @@ typedef struct
   bool skipiiLoci;
   bool refine;
   bool by_cds;
+  bool miloci;
   GtUword minoverlap;
   FILE *ilenfile;
+  FILE *indexstream;
+  const char *seqfile;
+  FILE *statsstream;
   bool retain;
+  GtUword numthreads;
+  const char *keepattrs;
 } LocusPocusOptions;
 
+// Data structure for computing the iLoci of a single sequence in parallel mode
+typedef struct
+{
+  GtStr *seqid;
+  GtArray *nodes;
+  GtArray *loci;
+  GtQueue *streams;
+  GtNodeStream *out_stream;
+  GtUword progress;
+  FILE *ilenfile;
+  char *ilenbuffer;
+  size_t ilenlength;
+  GtError *error;
+  int result;
+} LocusPocusJob;
+
+// Data structure for each thread in parallel mode; thread number `threadnum`
+// handles every `numthreads`-th job, so the threads share no mutable state
+typedef struct
+{
+  GtArray *jobs;
+  GtUword threadnum;
+  GtUword numthreads;
+} LocusPocusWorker;
+
 // Set default values for program
 static void set_option_defaults(LocusPocusOptions *options)
 {
@@ -45,6 +77,7 @@ static void set_option_defaults(LocusPocusOptions *options)
   options->genestream = NULL;
   options->nameformat = NULL;
   options->delta = 500;
+  options->deltas = NULL;
   options->outstream = gt_file_new_from_fileptr(stdout);
   options->filefreefunc = gt_file_delete_without_handle;
   options->type_parents = gt_hashmap_new(GT_HASH_STRING, gt_free_func,
@@ -55,10 +88,16 @@ static void set_option_defaults(LocusPocusOptions *options)
   options->verbose = false;
   options->skipiiLoci = false;
   options->refine = false;
+  options->miloci = false;
   options->by_cds = false;
   options->minoverlap = 1;
   options->ilenfile = NULL;
+  options->indexstream = NULL;
+  options->seqfile = NULL;
+  options->statsstream = NULL;
   options->retain = false;
+  options->numthreads = 1;
+  options->keepattrs = NULL;
 }
 
 static void free_option_memory(LocusPocusOptions *options)
@@ -72,8 +111,14 @@ static void free_option_memory(LocusPocusOptions *options)
     fclose(options->transstream);
   if(options->nameformat != NULL)
     gt_free(options->nameformat);
+  if(options->deltas != NULL)
+    gt_array_delete(options->deltas);
   if(options->ilenfile != NULL)
     fclose(options->ilenfile);
+  if(options->indexstream != NULL)
+    fclose(options->indexstream);
+  if(options->statsstream != NULL)
+    fclose(options->statsstream);
 }
 
 // Usage statement
@@ -86,11 +131,24 @@ static void print_usage(FILE *outstream)
 "    -d|--debug             print detailed debugging messages to terminal\n"
 "                           (standard error)\n"
 "    -h|--help              print this help message and exit\n"
+"    -j|--threads: INT      compute iLoci for different sequences in parallel\n"
+"                           using the given number of threads; output is\n"
+"                           identical to a single-threaded run; default is 1;\n"
+"                           cannot be combined with --deltas\n"
+"    -K|--keep-attrs: LIST  remove all attributes except ID, Parent, Name,\n"
+"                           accession, and those in the given\n"
+"                           comma-separated list, to reduce memory usage\n"
 "    -v|--version           print version number and exit\n\n"
 "  iLocus parsing:\n"
 "    -l|--delta: INT        when parsing interval loci, use the following\n"
 "                           delta to extend gene loci and include potential\n"
 "                           regulatory regions; default is 500\n"
+"    -D|--deltas: LIST      comma-separated list of delta values; compute the\n"
+"                           iLoci for all deltas in a single pass and report\n"
+"                           a summary table of iLocus counts and lengths for\n"
+"                           each delta instead of GFF3; with --ilens, iiLocus\n"
+"                           lengths are reported with a leading delta column;\n"
+"                           cannot be combined with refinement options\n"
 "    -s|--skipends          when enumerating interval loci, exclude\n"
 "                           unannotated (and presumably incomplete) iLoci at\n"
 "                           either end of the sequence\n"
@@ -106,7 +164,10 @@ static void print_usage(FILE *outstream)
 "                           overlap; implies 'refine' mode\n"
 "    -m|--minoverlap: INT   the minimum number of nucleotides two genes must\n"
 "                           overlap to be grouped in the same iLocus; default\n"
-"                           is 1\n\n"
+"                           is 1\n"
+"    -M|--miloci            merge each run of consecutive single-gene and\n"
+"                           non-coding iLoci into a single merged iLocus\n"
+"                           (miLocus); implies 'refine' mode\n\n"
 "  Output options:\n"
 "    -n|--namefmt: STR     provide a printf-style format string to override\n"
 "                           the default ID format for newly created loci;\n"
@@ -128,7 +189,17 @@ static void print_usage(FILE *outstream)
 "                           to its corresponding locus to the given file\n"
 "    -V|--verbose           include all locus subfeatures (genes, RNAs, etc)\n"
 "                           in the GFF3 output; default includes only locus\n"
-"                           features\n\n"
+"                           features\n"
+"    -x|--index: FILE       write a compact binary index of iLocus boundaries\n"
+"                           to the given file, for fast position and range\n"
+"                           lookups with 'locusquery'; requires --namefmt\n"
+"    -F|--fasta: FILE       genomic sequences in Fasta format; if provided,\n"
+"                           the GC content and N content of each iLocus are\n"
+"                           reported as attributes\n"
+"    -S|--seqstats: FILE    with --fasta, write a summary table of iLocus\n"
+"                           counts, lengths, composition, and length\n"
+"                           histograms for each iLocus class to the given\n"
+"                           file\n\n"
 "  Input options:\n"
 "    -f|--filter: TYPE      comma-separated list of feature types to use in\n"
 "                           constructing loci/iLoci; default is 'gene'\n"
@@ -146,29 +217,36 @@ parse_options(int argc, char **argv, LocusPocusOptions *options, GtError *error)
 {
   int opt = 0;
   int optindex = 0;
-  const char *optstr = "cdef:g:hi:l:m:n:o:p:rsTt:uVvy";
+  const char *optstr = "cD:deF:f:g:hi:j:K:l:Mm:n:o:p:rS:sTt:uVvx:y";
   const char *key, *value, *oldvalue;
   const struct option locuspocus_options[] =
   {
     { "cds",        no_argument,       NULL, 'c' },
+    { "deltas",     required_argument, NULL, 'D' },
     { "debug",      no_argument,       NULL, 'd' },
     { "endsonly",   no_argument,       NULL, 'e' },
+    { "fasta",      required_argument, NULL, 'F' },
     { "filter",     required_argument, NULL, 'f' },
     { "genemap",    required_argument, NULL, 'g' },
     { "help",       no_argument,       NULL, 'h' },
     { "ilens",      required_argument, NULL, 'i' },
+    { "threads",    required_argument, NULL, 'j' },
+    { "keep-attrs", required_argument, NULL, 'K' },
     { "delta",      required_argument, NULL, 'l' },
+    { "miloci",     no_argument,       NULL, 'M' },
     { "minoverlap", required_argument, NULL, 'm' },
     { "namefmt",    required_argument, NULL, 'n' },
     { "outfile",    required_argument, NULL, 'o' },
     { "parent",     required_argument, NULL, 'p' },
     { "refine",     no_argument,       NULL, 'r' },
+    { "seqstats",   required_argument, NULL, 'S' },
     { "skipends",   no_argument,       NULL, 's' },
     { "retainids",  no_argument,       NULL, 'T' },
     { "transmap",   required_argument, NULL, 't' },
     { "pseudo",     no_argument,       NULL, 'u' },
     { "version",    no_argument,       NULL, 'v' },
     { "verbose",    no_argument,       NULL, 'V' },
+    { "index",      required_argument, NULL, 'x' },
     { "skipiiloci", no_argument,       NULL, 'y' },
     { NULL,         no_argument,       NULL,  0  },
   };
@@ -181,6 +259,25 @@ parse_options(int argc, char **argv, LocusPocusOptions *options, GtError *error)
       options->by_cds = 1;
       options->refine = 1;
     }
+    else if(opt == 'D')
+    {
+      if(options->deltas != NULL)
+        gt_array_delete(options->deltas);
+      options->deltas = gt_array_new( sizeof(GtUword) );
+      for(value  = strtok(optarg, ",");
+          value != NULL;
+          value  = strtok(NULL, ","))
+      {
+        GtUword delta;
+        if(sscanf(value, "%lu", &delta) != 1)
+        {
+          gt_error_set(error, "could not convert delta '%s' to an integer",
+                       value);
+          break;
+        }
+        gt_array_add(options->deltas, delta);
+      }
+    }
     else if(opt == 'd')
       options->debug = 1;
     else if(opt == 'e')
@@ -192,6 +289,8 @@ parse_options(int argc, char **argv, LocusPocusOptions *options, GtError *error)
       }
       options->endmode = 1;
     }
+    else if(opt == 'F')
+      options->seqfile = optarg;
     else if(opt == 'f')
     {
       gt_hashmap_delete(options->filter);
@@ -227,6 +326,18 @@ parse_options(int argc, char **argv, LocusPocusOptions *options, GtError *error)
       if(options->ilenfile == NULL)
         gt_error_set(error, "could not open ilenfile file '%s'", optarg);
     }
+    else if(opt == 'j')
+    {
+      char extra;
+      if(optarg[0] == '-' ||
+         sscanf(optarg, "%lu%c", &options->numthreads, &extra) != 1 ||
+         options->numthreads == 0)
+      {
+        gt_error_set(error, "invalid number of threads '%s'", optarg);
+      }
+    }
+    else if(opt == 'K')
+      options->keepattrs = optarg;
     else if(opt == 'l')
     {
       if(sscanf(optarg, "%lu", &options->delta) == EOF)
@@ -235,6 +346,11 @@ parse_options(int argc, char **argv, LocusPocusOptions *options, GtError *error)
                      optarg);
       }
     }
+    else if(opt == 'M')
+    {
+      options->miloci = true;
+      options->refine = 1;
+    }
     else if(opt == 'm')
     {
       if(sscanf(optarg, "%lu", &options->minoverlap) == EOF)
@@ -273,6 +389,12 @@ parse_options(int argc, char **argv, LocusPocusOptions *options, GtError *error)
     }
     else if(opt == 'r')
       options->refine = 1;
+    else if(opt == 'S')
+    {
+      options->statsstream = fopen(optarg, "w");
+      if(options->statsstream == NULL)
+        gt_error_set(error, "could not open seqstats file '%s'", optarg);
+    }
     else if(opt == 's')
     {
       if(options->endmode > 0)
@@ -299,11 +421,262 @@ parse_options(int argc, char **argv, LocusPocusOptions *options, GtError *error)
     }
     else if(opt == 'V')
       options->verbose = 1;
+    else if(opt == 'x')
+    {
+      options->indexstream = fopen(optarg, "wb");
+      if(options->indexstream == NULL)
+        gt_error_set(error, "could not open index file '%s'", optarg);
+    }
     else if(opt == 'y')
       options->skipiiLoci = true;
   }
 }
 
+// Create the iLocus parsing stream (and the refinement and miLocus streams, if
+// requested) downstream of `in_stream`, adding each to the `streams` queue;
+// returns the last stream created
+static GtNodeStream *locus_streams_new(GtNodeStream *in_stream,
+                                       LocusPocusOptions *options,
+                                       FILE *ilenfile, GtQueue *streams)
+{
+  GtNodeStream *current_stream, *last_stream;
+
+  current_stream = agn_locus_stream_new(in_stream, options->delta);
+  AgnLocusStream *ls = (AgnLocusStream*)current_stream;
+  agn_locus_stream_set_source(ls, "AEGeAn::LocusPocus");
+  agn_locus_stream_set_endmode(ls, options->endmode);
+  agn_locus_stream_track_ilens(ls, ilenfile);
+  if(options->nameformat != NULL)
+    agn_locus_stream_set_name_format(ls, options->nameformat);
+  if(options->skipiiLoci)
+    agn_locus_stream_skip_iiLoci(ls);
+  gt_queue_add(streams, current_stream);
+  last_stream = current_stream;
+
+  if(options->refine)
+  {
+    current_stream = agn_locus_refine_stream_new(last_stream, options->delta,
+                                                 options->minoverlap,
+                                                 options->by_cds);
+    AgnLocusRefineStream *lrs = (AgnLocusRefineStream *)current_stream;
+    agn_locus_refine_stream_set_source(lrs, "AEGeAn::LocusPocus");
+    agn_locus_refine_stream_track_ilens(lrs, ilenfile);
+    if(options->nameformat != NULL)
+      agn_locus_refine_stream_set_name_format(lrs, options->nameformat);
+    gt_queue_add(streams, current_stream);
+    last_stream = current_stream;
+  }
+
+  if(options->miloci)
+  {
+    current_stream = agn_milocus_stream_new(last_stream);
+    AgnMilocusStream *mls = (AgnMilocusStream *)current_stream;
+    agn_milocus_stream_set_source(mls, "AEGeAn::LocusPocus");
+    if(options->nameformat != NULL)
+      agn_milocus_stream_set_name_format(mls, options->nameformat);
+    gt_queue_add(streams, current_stream);
+    last_stream = current_stream;
+  }
+
+  return last_stream;
+}
+
+// Thread function for parallel mode: pull each of this worker's jobs through
+// its iLocus streams
+static void *locuspocus_worker(void *data)
+{
+  LocusPocusWorker *worker = data;
+  GtUword i;
+  for(i = worker->threadnum;
+      i < gt_array_size(worker->jobs);
+      i += worker->numthreads)
+  {
+    LocusPocusJob *job = gt_array_get(worker->jobs, i);
+    job->result = gt_node_stream_pull(job->out_stream, job->error);
+  }
+  return NULL;
+}
+
+// Parallel mode: collect all nodes from `in_stream`, compute the iLoci of each
+// sequence concurrently with a separate copy of the iLocus streams, and store
+// the results in `output` in the same order as the single-threaded streams.
+// Loci are counted across all sequences (a prefix sum over the per-sequence
+// counts) so that names match the single-threaded run; the ilens of each
+// sequence are buffered in memory and written in order.
+static int locuspocus_parallel(GtNodeStream *in_stream,
+                               LocusPocusOptions *options, GtArray *output,
+                               GtError *error)
+{
+  GtArray *nodes = gt_array_new( sizeof(GtGenomeNode *) );
+  GtNodeStream *collect_stream = gt_array_out_stream_all_new(in_stream, nodes,
+                                                             error);
+  int result = gt_node_stream_pull(collect_stream, error);
+  gt_node_stream_delete(collect_stream);
+  if(result == -1)
+  {
+    while(gt_array_size(nodes) > 0)
+    {
+      GtGenomeNode **gn = gt_array_pop(nodes);
+      gt_genome_node_delete(*gn);
+    }
+    gt_array_delete(nodes);
+    return -1;
+  }
+
+  // Partition features by sequence. Each job gets its own reference to the
+  // corresponding region node, since the locus stream needs sequence ranges.
+  // Sequences without features get a job as well, so that their uLoci are
+  // reported in the same position as in a single-threaded run.
+  GtHashmap *jobindex = gt_hashmap_new(GT_HASH_STRING, NULL, gt_free_func);
+  GtArray *jobs = gt_array_new( sizeof(LocusPocusJob) );
+  GtArray *trailing = gt_array_new( sizeof(GtGenomeNode *) );
+  LocusPocusJob *job = NULL;
+  bool features_seen = false;
+  GtUword i, j;
+  for(i = 0; i < gt_array_size(nodes); i++)
+  {
+    GtGenomeNode *gn = *(GtGenomeNode **)gt_array_get(nodes, i);
+    GtStr *seqid = gt_genome_node_get_seqid(gn);
+    bool isfeature = gt_feature_node_try_cast(gn) != NULL;
+    bool isregion = !isfeature && gt_region_node_try_cast(gn) != NULL;
+    if(!isfeature)
+      gt_array_add(features_seen ? trailing : output, gn);
+    if(!isfeature && !isregion)
+      continue;
+
+    GtUword *index = gt_hashmap_get(jobindex, gt_str_get(seqid));
+    if(index == NULL)
+    {
+      LocusPocusJob newjob;
+      memset(&newjob, 0, sizeof(LocusPocusJob));
+      newjob.seqid = seqid;
+      newjob.nodes = gt_array_new( sizeof(GtGenomeNode *) );
+      newjob.loci = gt_array_new( sizeof(GtGenomeNode *) );
+      gt_array_add(jobs, newjob);
+      index = gt_malloc( sizeof(GtUword) );
+      *index = gt_array_size(jobs) - 1;
+      gt_hashmap_add(jobindex, gt_str_get(seqid), index);
+    }
+    job = gt_array_get(jobs, *index);
+    if(isregion)
+    {
+      gt_genome_node_ref(gn);
+      gt_array_add(job->nodes, gn);
+    }
+    else
+    {
+      features_seen = true;
+      gt_array_add(job->nodes, gn);
+    }
+  }
+  gt_array_delete(nodes);
+  gt_hashmap_delete(jobindex);
+
+  // All streams are created up front, by a single thread.
+  for(i = 0; i < gt_array_size(jobs); i++)
+  {
+    job = gt_array_get(jobs, i);
+    job->error = gt_error_new();
+    job->streams = gt_queue_new();
+    if(options->ilenfile != NULL)
+      job->ilenfile = open_memstream(&job->ilenbuffer, &job->ilenlength);
+    GtNodeStream *ais = gt_array_in_stream_new(job->nodes, &job->progress,
+                                               job->error);
+    gt_queue_add(job->streams, ais);
+    GtNodeStream *last_stream = locus_streams_new(ais, options, job->ilenfile,
+                                                  job->streams);
+    job->out_stream = gt_array_out_stream_all_new(last_stream, job->loci,
+                                                  job->error);
+    gt_queue_add(job->streams, job->out_stream);
+  }
+
+  GtUword numthreads = options->numthreads;
+  if(numthreads > gt_array_size(jobs))
+    numthreads = gt_array_size(jobs) > 0 ? gt_array_size(jobs) : 1;
+  LocusPocusWorker *workers = gt_malloc( sizeof(LocusPocusWorker) *
+                                         numthreads );
+  GtThread **threads = gt_calloc(numthreads, sizeof(GtThread *));
+  for(i = 0; i < numthreads; i++)
+  {
+    workers[i].jobs = jobs;
+    workers[i].threadnum = i;
+    workers[i].numthreads = numthreads;
+  }
+  for(i = 1; i < numthreads; i++)
+  {
+    threads[i] = gt_thread_new(locuspocus_worker, workers + i, error);
+    if(threads[i] == NULL)
+    {
+      // GenomeTools was built without thread support; do the work here.
+      gt_error_unset(error);
+      locuspocus_worker(workers + i);
+    }
+  }
+  locuspocus_worker(workers);
+  for(i = 1; i < numthreads; i++)
+  {
+    if(threads[i] != NULL)
+    {
+      gt_thread_join(threads[i]);
+      gt_thread_delete(threads[i]);
+    }
+  }
+  gt_free(threads);
+  gt_free(workers);
+
+  // Concatenate results in sequence order, minting final names.
+  GtUword count = 0;
+  for(i = 0; i < gt_array_size(jobs); i++)
+  {
+    job = gt_array_get(jobs, i);
+    if(job->result == -1 && result == 0)
+    {
+      gt_error_set(error, "%s", gt_error_get(job->error));
+      result = -1;
+    }
+    for(j = 0; j < gt_array_size(job->loci); j++)
+    {
+      GtGenomeNode *gn = *(GtGenomeNode **)gt_array_get(job->loci, j);
+      GtFeatureNode *fn = gt_feature_node_try_cast(gn);
+      if(fn == NULL)
+      {
+        // Region nodes are already in the output.
+        gt_genome_node_delete(gn);
+        continue;
+      }
+      count++;
+      if(options->nameformat != NULL)
+      {
+        char locusname[256];
+        sprintf(locusname, options->nameformat, count);
+        gt_feature_node_set_attribute(fn, "Name", locusname);
+      }
+      gt_array_add(output, gn);
+    }
+
+    if(job->ilenfile != NULL)
+    {
+      fclose(job->ilenfile);
+      fwrite(job->ilenbuffer, 1, job->ilenlength, options->ilenfile);
+      free(job->ilenbuffer);
+    }
+    while(gt_queue_size(job->streams) > 0)
+    {
+      GtNodeStream *ns = gt_queue_get(job->streams);
+      gt_node_stream_delete(ns);
+    }
+    gt_queue_delete(job->streams);
+    gt_array_delete(job->nodes);
+    gt_array_delete(job->loci);
+    gt_error_delete(job->error);
+  }
+  gt_array_add_array(output, trailing);
+  gt_array_delete(trailing);
+  gt_array_delete(jobs);
+
+  return result;
+}
+
 // Main program
 int main(int argc, char **argv)
 {
@@ -323,6 +696,31 @@ int main(int argc, char **argv)
     fprintf(stderr, "[LocusPocus] error: %s", gt_error_get(error));
     return 1;
   }
+  if(options.deltas != NULL && options.refine)
+  {
+    fprintf(stderr, "[LocusPocus] error: multi-delta mode (--deltas) cannot be "
+            "combined with refinement options\n");
+    return 1;
+  }
+  if(options.deltas != NULL && options.numthreads > 1)
+  {
+    fprintf(stderr, "[LocusPocus] error: multi-delta mode (--deltas) cannot be "
+            "combined with --threads\n");
+    return 1;
+  }
+  if(options.statsstream != NULL && options.seqfile == NULL)
+  {
+    fprintf(stderr, "[LocusPocus] error: iLocus composition statistics "
+            "(--seqstats) require genomic sequences (--fasta)\n");
+    return 1;
+  }
+  if(options.indexstream != NULL && options.nameformat == NULL)
+  {
+    fprintf(stderr, "[LocusPocus] error: the iLocus index (--index) requires "
+            "a name format (--namefmt), so that indexed iLoci have the same "
+            "IDs as the GFF3 output\n");
+    return 1;
+  }
   int numfiles = argc - optind;
   if(numfiles < 1)
   {
@@ -340,13 +738,39 @@ int main(int argc, char **argv)
   //----- Set up the node processing stream -----//
   //---------------------------------------------//
 
-  current_stream = gt_gff3_in_stream_new_unsorted(numfiles,
-                                                  (const char **)argv + optind);
-  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)current_stream);
-  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)current_stream);
+  bool snapshot = numfiles == 1 && agn_snapshot_in_stream_check(argv[optind]);
+  if(snapshot)
+  {
+    current_stream = agn_snapshot_in_stream_new(argv[optind], error);
+    if(current_stream == NULL)
+    {
+      fprintf(stderr, "[LocusPocus] error: %s\n", gt_error_get(error));
+      return 1;
+    }
+  }
+  else
+  {
+    current_stream = gt_gff3_in_stream_new_unsorted(numfiles, (const char **)
+                                                    argv + optind);
+    gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)current_stream);
+    gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)current_stream);
+  }
   gt_queue_add(streams, current_stream);
   last_stream = current_stream;
 
+  if(!snapshot && options.keepattrs != NULL)
+  {
+    current_stream = agn_attribute_prune_stream_new(last_stream,
+                                                    options.keepattrs);
+    if(options.pseudofix)
+    {
+      agn_attribute_prune_stream_keep((AgnAttributePruneStream *)
+                                      current_stream, "pseudo");
+    }
+    gt_queue_add(streams, current_stream);
+    last_stream = current_stream;
+  }
+
   if(options.pseudofix)
   {
     current_stream = agn_pseudogene_fix_stream_new(last_stream);
@@ -363,37 +787,55 @@ int main(int argc, char **argv)
   gt_queue_add(streams, current_stream);
   last_stream = current_stream;
 
-  current_stream = gt_sort_stream_new(last_stream);
-  gt_queue_add(streams, current_stream);
-  last_stream = current_stream;
+  if(!snapshot)
+  {
+    current_stream = gt_sort_stream_new(last_stream);
+    gt_queue_add(streams, current_stream);
+    last_stream = current_stream;
+  }
 
-  current_stream = agn_locus_stream_new(last_stream, options.delta);
-  AgnLocusStream *ls = (AgnLocusStream*)current_stream;
-  agn_locus_stream_set_source(ls, "AEGeAn::LocusPocus");
-  agn_locus_stream_set_endmode(ls, options.endmode);
-  agn_locus_stream_track_ilens(ls, options.ilenfile);
-  if(options.nameformat != NULL)
-    agn_locus_stream_set_name_format(ls, options.nameformat);
-  if(options.skipiiLoci)
-    agn_locus_stream_skip_iiLoci(ls);
-  gt_queue_add(streams, current_stream);
-  last_stream = current_stream;
+  GtArray *loci = NULL;
+  GtUword progress = 0;
+  GtNodeVisitor *deltavisitor = NULL;
+  if(options.deltas != NULL)
+  {
+    current_stream = agn_locus_stream_new(last_stream, 0);
+    agn_locus_stream_set_source((AgnLocusStream *)current_stream,
+                                "AEGeAn::LocusPocus");
+    gt_queue_add(streams, current_stream);
+    last_stream = current_stream;
 
-  if(options.refine)
+    deltavisitor = agn_locus_delta_visitor_new(options.deltas,
+                                               options.ilenfile);
+    AgnLocusDeltaVisitor *dv = (AgnLocusDeltaVisitor *)deltavisitor;
+    agn_locus_delta_visitor_set_endmode(dv, options.endmode);
+    if(options.skipiiLoci)
+      agn_locus_delta_visitor_skip_iiLoci(dv);
+    current_stream = gt_visitor_stream_new(last_stream, deltavisitor);
+    gt_queue_add(streams, current_stream);
+    last_stream = current_stream;
+  }
+  else if(options.numthreads > 1)
   {
-    current_stream = agn_locus_refine_stream_new(last_stream, options.delta,
-                                                 options.minoverlap,
-                                                 options.by_cds);
-    AgnLocusRefineStream *lrs = (AgnLocusRefineStream *)current_stream;
-    agn_locus_refine_stream_set_source(lrs, "AEGeAn::LocusPocus");
-    agn_locus_refine_stream_track_ilens(lrs, options.ilenfile);
-    if(options.nameformat != NULL)
-      agn_locus_refine_stream_set_name_format(lrs, options.nameformat);
+    loci = gt_array_new( sizeof(GtGenomeNode *) );
+    if(locuspocus_parallel(last_stream, &options, loci, error) == -1)
+    {
+      fprintf(stderr, "[LocusPocus] error: %s\n", gt_error_get(error));
+      return 1;
+    }
+    current_stream = gt_array_in_stream_new(loci, &progress, error);
     gt_queue_add(streams, current_stream);
     last_stream = current_stream;
   }
+  else
+  {
+    last_stream = locus_streams_new(last_stream, &options, options.ilenfile,
+                                    streams);
+  }
 
-  if(options.genestream != NULL || options.transstream != NULL)
+  // Multi-delta mode reports summary tables rather than iLoci.
+  bool gff3out = deltavisitor == NULL;
+  if(gff3out && (options.genestream != NULL || options.transstream != NULL))
   {
     current_stream = agn_locus_map_stream_new(last_stream, options.genestream,
                                               options.transstream);
@@ -401,18 +843,47 @@ int main(int argc, char **argv)
     last_stream = current_stream;
   }
 
-  if(options.verbose == 0)
+  if(gff3out && options.seqfile != NULL)
+  {
+    current_stream = agn_locus_composition_stream_new(last_stream,
+                                                      options.seqfile,
+                                                      options.statsstream,
+                                                      error);
+    if(current_stream == NULL)
+    {
+      fprintf(stderr, "[LocusPocus] error: %s\n", gt_error_get(error));
+      return 1;
+    }
+    gt_queue_add(streams, current_stream);
+    last_stream = current_stream;
+  }
+
+  if(gff3out && options.indexstream != NULL)
+  {
+    current_stream = agn_locus_index_out_stream_new(last_stream,
+                                                    options.indexstream);
+    gt_queue_add(streams, current_stream);
+    last_stream = current_stream;
+  }
+
+  if(gff3out && options.verbose == 0)
   {
     current_stream = agn_remove_children_stream_new(last_stream);
     gt_queue_add(streams, current_stream);
     last_stream = current_stream;
   }
 
-  current_stream = gt_gff3_out_stream_new(last_stream, options.outstream);
-  if(options.retain)
-    gt_gff3_out_stream_retain_id_attributes((GtGFF3OutStream *)current_stream);
-  gt_queue_add(streams, current_stream);
-  last_stream = current_stream;
+  if(gff3out)
+  {
+    current_stream = gt_gff3_out_stream_new(last_stream, options.outstream);
+    if(options.retain)
+    {
+      gt_gff3_out_stream_retain_id_attributes(
+        (GtGFF3OutStream *)current_stream);
+    }
+    gt_queue_add(streams, current_stream);
+    last_stream = current_stream;
+  }
 
 
   //----- Execute the node processing stream -----//
@@ -421,6 +892,11 @@ int main(int argc, char **argv)
   int result = gt_node_stream_pull(last_stream, error);
   if(result == -1)
     fprintf(stderr, "[LocusPocus] error: %s", gt_error_get(error));
+  else if(deltavisitor != NULL)
+  {
+    agn_locus_delta_visitor_print_summary((AgnLocusDeltaVisitor *)deltavisitor,
+                                          options.outstream);
+  }
 
 
   // Free memory and terminate
@@ -430,6 +906,8 @@ int main(int argc, char **argv)
     gt_node_stream_delete(current_stream);
   }
   gt_queue_delete(streams);
+  if(loci != NULL)
+    gt_array_delete(loci);
   gt_logger_delete(logger);
   gt_error_delete(error);
   free_option_memory(&options);
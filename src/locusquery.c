@@ -0,0 +1,178 @@
+/**
+
+Copyright (c) 2010-2016, Daniel S. Standage and CONTRIBUTORS
+
+The AEGeAn Toolkit is distributed under the ISC License. See
+the 'LICENSE' file in the AEGeAn source code distribution or
+online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
+
+**/
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+#include "genometools.h"
+#include "AgnLocusIndex.h"
+
+typedef struct
+{
+  const char *indexfile;
+  FILE *outstream;
+} LocusQueryOptions;
+
+static void print_usage(FILE *outstream)
+{
+  fprintf(outstream,
+"\nlocusquery: find the iLoci overlapping a list of positions or ranges\n"
+"Usage: locusquery [options] -i index.lidx queries.txt [queries2.txt ...]\n"
+"  Options:\n"
+"    -h|--help           print this help message and exit\n"
+"    -i|--index: FILE    iLocus index created with 'locuspocus --index';\n"
+"                        required\n"
+"    -o|--outfile: FILE  name of file to which output will be written;\n"
+"                        default is terminal (stdout)\n\n"
+"  Each query is a line with a sequence ID and a position, or a sequence ID\n"
+"  and start and end coordinates, separated by whitespace; queries are read\n"
+"  from standard input if no query files are given. Each iLocus overlapping a\n"
+"  query is reported on a separate line containing the query, the iLocus ID,\n"
+"  type, start, and end; queries with no overlapping iLoci are reported with\n"
+"  '.' in place of the iLocus fields.\n\n");
+}
+
+static void parse_options(int argc, char **argv, LocusQueryOptions *options)
+{
+  int opt = 0;
+  int optindex = 0;
+  const char *optstr = "hi:o:";
+  const struct option locusquery_options[] =
+  {
+    { "help",    no_argument,       NULL, 'h' },
+    { "index",   required_argument, NULL, 'i' },
+    { "outfile", required_argument, NULL, 'o' },
+    { NULL,      no_argument,       NULL,  0  },
+  };
+  for(opt  = getopt_long(argc, argv, optstr, locusquery_options, &optindex);
+      opt != -1;
+      opt  = getopt_long(argc, argv, optstr, locusquery_options, &optindex))
+  {
+    if(opt == 'h')
+    {
+      print_usage(stdout);
+      exit(0);
+    }
+    else if(opt == 'i')
+      options->indexfile = optarg;
+    else if(opt == 'o')
+    {
+      options->outstream = fopen(optarg, "w");
+      if(options->outstream == NULL)
+      {
+        fprintf(stderr, "[LocusQuery] error: could not open output file "
+                "'%s'\n", optarg);
+        exit(1);
+      }
+    }
+  }
+
+  if(options->indexfile == NULL)
+  {
+    fprintf(stderr, "[LocusQuery] error: please provide an iLocus index "
+            "with -i\n");
+    print_usage(stderr);
+    exit(1);
+  }
+}
+
+static int process_queries(AgnLocusIndex *index, FILE *instream,
+                           const char *filename, FILE *outstream)
+{
+  GtArray *hits = gt_array_new( sizeof(AgnLocusIndexHit) );
+  char *line = NULL, *seqid = NULL;
+  size_t linesize = 0, seqidsize = 0;
+  GtUword linenum = 0;
+  int had_err = 0;
+
+  while(!had_err && getline(&line, &linesize, instream) != -1)
+  {
+    linenum++;
+    if(seqidsize < linesize)
+    {
+      seqidsize = linesize;
+      seqid = gt_realloc(seqid, seqidsize);
+    }
+
+    GtUword start, end;
+    int numvalues = sscanf(line, "%s %lu %lu", seqid, &start, &end);
+    if(numvalues <= 0 || seqid[0] == '#')
+      continue;
+    if(numvalues == 2)
+      end = start;
+    else if(numvalues != 3 || start > end)
+    {
+      fprintf(stderr, "[LocusQuery] error: malformed query at line %lu of "
+              "%s\n", linenum, filename);
+      had_err = 1;
+      break;
+    }
+
+    gt_array_reset(hits);
+    if(agn_locus_index_lookup(index, seqid, start, end, hits) == 0)
+    {
+      fprintf(outstream, "%s\t%lu\t%lu\t.\t.\t.\t.\n", seqid, start, end);
+      continue;
+    }
+    GtUword i;
+    for(i = 0; i < gt_array_size(hits); i++)
+    {
+      AgnLocusIndexHit *hit = gt_array_get(hits, i);
+      fprintf(outstream, "%s\t%lu\t%lu\t%s\t%s\t%lu\t%lu\n", seqid, start, end,
+              hit->id, hit->type, hit->start, hit->end);
+    }
+  }
+
+  free(line);
+  gt_free(seqid);
+  gt_array_delete(hits);
+  return had_err;
+}
+
+int main(int argc, char **argv)
+{
+  LocusQueryOptions options = { NULL, stdout };
+  parse_options(argc, argv, &options);
+
+  gt_lib_init();
+  GtError *error = gt_error_new();
+  AgnLocusIndex *index = agn_locus_index_new(options.indexfile, error);
+  if(index == NULL)
+  {
+    fprintf(stderr, "[LocusQuery] error: %s\n", gt_error_get(error));
+    gt_error_delete(error);
+    return 1;
+  }
+
+  int had_err = 0;
+  if(optind == argc)
+    had_err = process_queries(index, stdin, "standard input",
+                              options.outstream);
+  for(; !had_err && optind < argc; optind++)
+  {
+    FILE *instream = fopen(argv[optind], "r");
+    if(instream == NULL)
+    {
+      fprintf(stderr, "[LocusQuery] error: could not open query file "
+              "'%s'\n", argv[optind]);
+      had_err = 1;
+      break;
+    }
+    had_err = process_queries(index, instream, argv[optind],
+                              options.outstream);
+    fclose(instream);
+  }
+
+  agn_locus_index_delete(index);
+  gt_error_delete(error);
+  if(options.outstream != stdout)
+    fclose(options.outstream);
+  gt_lib_clean();
+  return had_err;
+}
@@ -9,7 +9,9 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 **/
 #include <getopt.h>
 #include "genometools.h"
+#include "AgnAttributePruneStream.h"
 #include "AgnMrnaRepVisitor.h"
+#include "AgnParallelVisitorStream.h"
 #include "AgnPseudogeneFixVisitor.h"
 
 typedef struct
@@ -19,6 +21,8 @@ typedef struct
   bool fix_pseudogenes;
   bool locus_parent;
   FILE *mapstream;
+  GtUword numthreads;
+  const char *keepattrs;
 } PmrnaOptions;
 
 static void print_usage(FILE *outstream)
@@ -31,6 +35,13 @@ static void print_usage(FILE *outstream)
 "    -i|--introns        flag indicating that introns are declared explicitly\n"
 "                        and do not need to be inferred from exon features;\n"
 "                        default is to infer introns\n"
+"    -j|--threads: INT   process genes in parallel using the given number of\n"
+"                        threads; output is identical to a single-threaded\n"
+"                        run\n"
+"    -K|--keep-attrs: STRING\n"
+"                        remove all attributes except ID, Parent, Name,\n"
+"                        accession, and those in the given comma-separated\n"
+"                        list, to reduce memory usage\n"
 "    -l|--locus          report a single representative mRNA for each locus\n"
 "                        instead of each gene\n"
 "    -m|--map: FILE      write each gene/mRNA mapping to the specified file\n"
@@ -41,11 +52,13 @@ static void parse_options(int argc, char **argv, PmrnaOptions *options)
 {
   int opt = 0;
   int optindex = 0;
-  const char *optstr = "hilm:p";
+  const char *optstr = "hij:K:lm:p";
   const struct option pmrna_options[] =
   {
     { "help",        no_argument,       NULL, 'h' },
     { "introns",     no_argument,       NULL, 'i' },
+    { "threads",     required_argument, NULL, 'j' },
+    { "keep-attrs",  required_argument, NULL, 'K' },
     { "locus",       no_argument,       NULL, 'l' },
     { "map",         required_argument, NULL, 'm' },
     { "pseudogenes", no_argument,       NULL, 'o' },
@@ -62,6 +75,19 @@ static void parse_options(int argc, char **argv, PmrnaOptions *options)
     }
     else if(opt == 'i')
       options->infer_introns = false;
+    else if(opt == 'j')
+    {
+      char extra;
+      if(optarg[0] == '-' ||
+         sscanf(optarg, "%lu%c", &options->numthreads, &extra) != 1 ||
+         options->numthreads == 0)
+      {
+        fprintf(stderr, "error: invalid number of threads '%s'\n", optarg);
+        exit(1);
+      }
+    }
+    else if(opt == 'K')
+      options->keepattrs = optarg;
     else if(opt == 'l')
       options->locus_parent = true;
     else if(opt == 'm')
@@ -78,12 +104,26 @@ static void parse_options(int argc, char **argv, PmrnaOptions *options)
   }
 }
 
+static GtNodeVisitor *pseudogene_fix_visitor(FILE *outstream, void *data)
+{
+  return agn_pseudogene_fix_visitor_new();
+}
+
+static GtNodeVisitor *mrna_rep_visitor(FILE *outstream, void *data)
+{
+  PmrnaOptions *options = data;
+  GtNodeVisitor *nv = agn_mrna_rep_visitor_new(outstream);
+  if(options->locus_parent)
+    agn_mrna_rep_visitor_set_parent_type((AgnMrnaRepVisitor *)nv, "locus");
+  return nv;
+}
+
 int main(int argc, char **argv)
 {
   GtError *error;
   GtNodeStream *stream, *last_stream;
   GtQueue *streams;
-  PmrnaOptions options = { true, NULL, true, false, NULL };
+  PmrnaOptions options = { true, NULL, true, false, NULL, 1, NULL };
   parse_options(argc, argv, &options);
 
   //----------
@@ -98,9 +138,20 @@ int main(int argc, char **argv)
   gt_queue_add(streams, stream);
   last_stream = stream;
 
+  if(options.keepattrs != NULL)
+  {
+    stream = agn_attribute_prune_stream_new(last_stream, options.keepattrs);
+    agn_attribute_prune_stream_keep((AgnAttributePruneStream *)stream,
+                                    "pseudo");
+    gt_queue_add(streams, stream);
+    last_stream = stream;
+  }
+
   if(options.fix_pseudogenes)
   {
-    stream = agn_pseudogene_fix_stream_new(last_stream);
+    stream = agn_parallel_visitor_stream_new(last_stream, options.numthreads,
+                                             pseudogene_fix_visitor, NULL,
+                                             NULL);
     gt_queue_add(streams, stream);
     last_stream = stream;
   }
@@ -112,11 +163,6 @@ int main(int argc, char **argv)
     last_stream = stream;
   }
 
-  GtNodeVisitor *nv = agn_mrna_rep_visitor_new(options.mapstream);
-  if(options.locus_parent)
-  {
-    agn_mrna_rep_visitor_set_parent_type((AgnMrnaRepVisitor *)nv, "locus");
-  }
   if(options.mapstream)
   {
     if(options.locus_parent)
@@ -128,7 +174,9 @@ int main(int argc, char **argv)
       fprintf(options.mapstream, "GeneID\tMrnaID\n");
     }
   }
-  stream = gt_visitor_stream_new(last_stream, nv);
+  stream = agn_parallel_visitor_stream_new(last_stream, options.numthreads,
+                                           mrna_rep_visitor, &options,
+                                           options.mapstream);
   gt_queue_add(streams, stream);
   last_stream = stream;
 
@@ -12,11 +12,76 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #include "genometools.h"
 #include "aegean.h"
 
+static void print_usage(FILE *outstream)
+{
+  fprintf(outstream,
+"\ntidygff3: clean up GFF3 data for downstream processing\n"
+"Usage: tidygff3 [options] < annot.gff3 > new.gff3\n"
+"  Options:\n"
+"    -h|--help           print this help message and exit\n"
+"    -j|--threads: INT   correct pseudogene features in parallel using the\n"
+"                        given number of threads\n"
+"    -K|--keep-attrs: STRING\n"
+"                        remove all attributes except ID, Parent, Name,\n"
+"                        accession, and those in the given comma-separated\n"
+"                        list, to reduce memory usage\n\n");
+}
+
+static void parse_options(int argc, char **argv, GtUword *numthreads,
+                          const char **keepattrs)
+{
+  int opt = 0;
+  int optindex = 0;
+  const char *optstr = "hj:K:";
+  const struct option tidy_options[] =
+  {
+    { "help",    no_argument,       NULL, 'h' },
+    { "threads", required_argument, NULL, 'j' },
+    { "keep-attrs", required_argument, NULL, 'K' },
+    { NULL,      no_argument,       NULL,  0  },
+  };
+  for(opt  = getopt_long(argc, argv + 0, optstr, tidy_options, &optindex);
+      opt != -1;
+      opt  = getopt_long(argc, argv + 0, optstr, tidy_options, &optindex))
+  {
+    if(opt == 'h')
+    {
+      print_usage(stdout);
+      exit(0);
+    }
+    else if(opt == 'j')
+    {
+      char extra;
+      if(optarg[0] == '-' || sscanf(optarg, "%lu%c", numthreads, &extra) != 1 ||
+         *numthreads == 0)
+      {
+        fprintf(stderr, "error: invalid number of threads '%s'\n", optarg);
+        exit(1);
+      }
+    }
+    else if(opt == 'K')
+      *keepattrs = optarg;
+    else
+    {
+      print_usage(stderr);
+      exit(1);
+    }
+  }
+}
+
+static GtNodeVisitor *pseudogene_fix_visitor(FILE *outstream, void *data)
+{
+  return agn_pseudogene_fix_visitor_new();
+}
+
 int main(int argc, char **argv)
 {
   GtError *error;
   GtNodeStream *stream, *last_stream;
   GtQueue *streams;
+  GtUword numthreads = 1;
+  const char *keepattrs = NULL;
+  parse_options(argc, argv, &numthreads, &keepattrs);
 
   // Set up the processing stream
   //----------
@@ -29,7 +94,20 @@ int main(int argc, char **argv)
   gt_queue_add(streams, stream);
   last_stream = stream;
 
-  stream = agn_pseudogene_fix_stream_new(last_stream);
+  if(keepattrs != NULL)
+  {
+    // Keep the attributes the pseudogene fix and the filters below rely on.
+    stream = agn_attribute_prune_stream_new(last_stream, keepattrs);
+    AgnAttributePruneStream *prune = (AgnAttributePruneStream *)stream;
+    agn_attribute_prune_stream_keep(prune, "pseudo");
+    agn_attribute_prune_stream_keep(prune, "exception");
+    agn_attribute_prune_stream_keep(prune, "gene_biotype");
+    gt_queue_add(streams, stream);
+    last_stream = stream;
+  }
+
+  stream = agn_parallel_visitor_stream_new(last_stream, numthreads,
+                                           pseudogene_fix_visitor, NULL, NULL);
   gt_queue_add(streams, stream);
   last_stream = stream;
 
@@ -22,6 +22,7 @@ typedef struct
 {
   FILE *idfile;
   GtHashmap *ids2keep;
+  const char *keepattrs;
   FILE *outfile;
   bool typeoverride;
   GtHashmap *typestoextract;
@@ -122,13 +123,14 @@ static void xtract_options_parse(int argc, char **argv,
 {
   int opt = 0;
   int optindex = 0;
-  const char *optstr = "dhi:o:t:Vvw:";
+  const char *optstr = "dhi:K:o:t:Vvw:";
   char *type;
   const struct option xtractore_options[] =
   {
     { "debug",    no_argument,       NULL, 'd' },
     { "help",     no_argument,       NULL, 'h' },
     { "idfile",   required_argument, NULL, 'i' },
+    { "keep-attrs", required_argument, NULL, 'K' },
     { "outfile",  required_argument, NULL, 'o' },
     { "type",     required_argument, NULL, 't' },
     { "verbose",  no_argument,       NULL, 'V' },
@@ -155,6 +157,8 @@ static void xtract_options_parse(int argc, char **argv,
       if(options->idfile == NULL)
         gt_error_set(error, "could not open ID file '%s'", optarg);
     }
+    else if(opt == 'K')
+      options->keepattrs = optarg;
     else if(opt == 'o')
     {
       options->outfile = fopen(optarg, "w");
@@ -210,6 +214,7 @@ static void xtract_options_set_defaults(XtractoreOptions *options)
 {
   options->idfile = NULL;
   options->ids2keep = NULL;
+  options->keepattrs = NULL;
   options->outfile = stdout;
   options->typeoverride = false;
   options->typestoextract = gt_hashmap_new(GT_HASH_STRING, gt_free_func, NULL);
@@ -403,6 +408,10 @@ static void xt_print_usage(FILE *outstream)
 "    -i|--idfile: FILE     file containing a list of feature IDs (1 per line\n"
 "                          with no spaces); if provided, only features with\n"
 "                          IDs in this file will be extracted\n"
+"    -K|--keep-attrs: STRING\n"
+"                          remove all attributes except ID, Parent, Name,\n"
+"                          accession, and those in the given comma-separated\n"
+"                          list, to reduce memory usage\n"
 "    -o|--outfile: FILE    file to which output sequences will be written;\n"
 "                          default is terminal (stdout)\n"
 "    -t|--type: STRING     feature type to extract; can be used multiple\n"
@@ -452,9 +461,27 @@ int main(int argc, char **argv)
 
   streams = gt_queue_new();
 
-  current_stream = gt_gff3_in_stream_new_unsorted(1, &featfile);
-  gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)current_stream);
-  gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)current_stream);
+  if(agn_snapshot_in_stream_check(featfile))
+  {
+    current_stream = agn_snapshot_in_stream_new(featfile, error);
+    if(current_stream == NULL)
+    {
+      fprintf(stderr, "[xtractore] error: %s\n", gt_error_get(error));
+      return 1;
+    }
+  }
+  else
+  {
+    current_stream = gt_gff3_in_stream_new_unsorted(1, &featfile);
+    gt_gff3_in_stream_check_id_attributes((GtGFF3InStream *)current_stream);
+    gt_gff3_in_stream_enable_tidy_mode((GtGFF3InStream *)current_stream);
+    if(options.keepattrs != NULL)
+    {
+      gt_queue_add(streams, current_stream);
+      current_stream = agn_attribute_prune_stream_new(current_stream,
+                                                      options.keepattrs);
+    }
+  }
   gt_queue_add(streams, current_stream);
   last_stream = current_stream;
 
@@ -77,3 +77,37 @@ if [ $status == 0 ]; then
 fi
 printf "        | %-36s | %s\n" "Amel Group7.16 (HTML)" $result
 rm -r $tempfile ${tempfile}.orig
+
+# PNG graphics for annotations loaded from snapshots
+bin/canon-gff3 --outfile=/dev/null --snapshot=${tempfile}.refr.snap \
+               data/gff3/amel-ogs-g716.gff3
+bin/canon-gff3 --outfile=/dev/null --snapshot=${tempfile}.pred.snap \
+               data/gff3/amel-ncbi-g716.gff3
+for input in gff3 snapshot
+do
+  refrfile=data/gff3/amel-ogs-g716.gff3
+  predfile=data/gff3/amel-ncbi-g716.gff3
+  if [ "$input" == "snapshot" ]; then
+    refrfile=${tempfile}.refr.snap
+    predfile=${tempfile}.pred.snap
+  fi
+  $memcheckcmd \
+  bin/parseval --datashare=data/share/ \
+               --outformat=html \
+               --outfile=${tempfile}.${input} \
+               --overwrite \
+               --png \
+               --refrlabel=OGS \
+               --predlabel=NCBI \
+               $refrfile $predfile
+  (cd ${tempfile}.${input} && find . -name "*.png" | sort) \
+    > ${tempfile}.${input}.pngs
+done
+
+result="FAIL"
+if [ -s ${tempfile}.gff3.pngs ] &&
+   diff ${tempfile}.gff3.pngs ${tempfile}.snapshot.pngs > /dev/null 2>&1; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "Amel Group7.16 (snapshot, PNG)" $result
+rm -r ${tempfile}.*
@@ -18,3 +18,17 @@ if [[ $status == 0 ]]; then
 fi
 printf "        | %-36s | %s\n" "A. mellifera gene multitrans" $result
 rm $tempfile
+
+$memcheckcmd \
+bin/canon-gff3 --threads 1 --outfile $tempfile data/gff3/amel-ogs-g7.gff3
+$memcheckcmd \
+bin/canon-gff3 --threads 4 --outfile ${tempfile}.j4 data/gff3/amel-ogs-g7.gff3
+
+diff $tempfile ${tempfile}.j4 > /dev/null
+status=$?
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "A. mellifera OGS, 4 threads" $result
+rm $tempfile ${tempfile}.j4
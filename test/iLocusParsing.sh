@@ -52,5 +52,17 @@ run_func_test "iiLocus Flank Orientations (test 1)" data/misc/zitest-01-ilens.ts
 run_func_test "iiLocus Flank Orientations (test 2)" data/misc/zitest-02-ilens.tsv --ilens=${tempfile} --cds data/gff3/zitest-02.gff3
 run_func_test "iiLocus Flank Orientations (test 3)" data/misc/zitest-03-ilens.tsv --ilens=${tempfile} --cds data/gff3/zitest-03.gff3
 
+# Output with several threads must be identical to single-threaded output,
+# including iiLocus lengths and the names minted with --namefmt.
+reffile="ilocus-j1-tempfile.gff3"
+refilens="ilocus-j1-tempfile.txt"
+refcds="ilocus-j1-cds-tempfile.gff3"
+bin/locuspocus --threads=1 --namefmt=iLoc%05lu --delta=200 --outfile=$reffile --ilens=$refilens --parent mRNA:gene data/gff3/ilocus.in.gff3
+bin/locuspocus --threads=1 --namefmt=iLoc%05lu --delta=200 --outfile=$refcds --cds --parent mRNA:gene data/gff3/ilocus.in.gff3
+run_func_test "4 threads (GFF3)" $reffile --threads=4 --namefmt=iLoc%05lu --delta=200 --outfile=${tempfile} --ilens=/dev/null --parent mRNA:gene data/gff3/ilocus.in.gff3
+run_func_test "4 threads (iiLocus lengths)" $refilens --threads=4 --namefmt=iLoc%05lu --delta=200 --outfile=/dev/null --ilens=${tempfile} --parent mRNA:gene data/gff3/ilocus.in.gff3
+run_func_test "4 threads (CDS)" $refcds --threads=4 --namefmt=iLoc%05lu --delta=200 --outfile=${tempfile} --cds --parent mRNA:gene data/gff3/ilocus.in.gff3
+rm $reffile $refilens $refcds
+
 
 exit $failures
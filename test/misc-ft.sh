@@ -46,6 +46,38 @@ fi
 printf "        | %-36s | %s\n" "A. mellifera pseudo" $result
 rm $tempfile
 
+$memcheckcmd \
+bin/pmrna --threads 1 --map ${tempfile}.map < data/gff3/amel-ogs-g7.gff3 \
+          > $tempfile
+$memcheckcmd \
+bin/pmrna --threads 4 --map ${tempfile}.j4.map < data/gff3/amel-ogs-g7.gff3 \
+          > ${tempfile}.j4
+
+diff $tempfile ${tempfile}.j4 > /dev/null
+diff ${tempfile}.map ${tempfile}.j4.map > /dev/null
+status=$?
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "A. mellifera OGS, 4 threads" $result
+rm $tempfile ${tempfile}.j4 ${tempfile}.map ${tempfile}.j4.map
+
+$memcheckcmd \
+bin/pmrna --map ${tempfile}.map < data/gff3/pbar-partial.gff3 > /dev/null
+$memcheckcmd \
+bin/pmrna --keep-attrs=gbkey --map ${tempfile}.K.map \
+          < data/gff3/pbar-partial.gff3 > /dev/null
+
+diff ${tempfile}.map ${tempfile}.K.map > /dev/null
+status=$?
+result="FAIL"
+if [[ $status == 0 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "P. barbatus labels, --keep-attrs" $result
+rm ${tempfile}.map ${tempfile}.K.map
+
 
 
 echo "    AEGeAn::tidygff3"
@@ -60,3 +92,18 @@ if [[ $status == 0 ]]; then
 fi
 printf "        | %-36s | %s\n" "A. dorsata exception" $result
 rm $tempfile
+
+
+echo "    AEGeAn::ParsEval"
+$memcheckcmd \
+bin/parseval --outformat=tsv --outfile=$tempfile \
+             data/gff3/nuc-only-refr.gff3 data/gff3/nuc-only-pred-distal.gff3
+
+refrrows=$(grep -c $'\tunmatched_refr\tmRNA1\tNA\t' $tempfile || true)
+predrows=$(grep -c $'\tunmatched_pred\tNA\tmRNA3\t' $tempfile || true)
+result="FAIL"
+if [[ $refrrows == 1 && $predrows == 1 ]]; then
+  result="PASS"
+fi
+printf "        | %-36s | %s\n" "TSV rows for unmatched loci" $result
+rm $tempfile
@@ -9,6 +9,7 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 **/
 #include <string.h>
 #include "AgnAttributeFilterStream.h"
+#include "AgnAttributePruneStream.h"
 #include "AgnCliquePair.h"
 #include "AgnFilterStream.h"
 #include "AgnGaevalVisitor.h"
@@ -17,12 +18,21 @@ online at https://github.com/standage/AEGeAn/blob/master/LICENSE.
 #include "AgnInferCDSVisitor.h"
 #include "AgnInferExonsVisitor.h"
 #include "AgnInferParentStream.h"
+#include "AgnInferStructureVisitor.h"
 #include "AgnLocus.h"
+#include "AgnLocusCompositionStream.h"
+#include "AgnLocusDeltaVisitor.h"
+#include "AgnLocusIndex.h"
 #include "AgnLocusRefineStream.h"
+#include "AgnLocusSampleStream.h"
 #include "AgnLocusStream.h"
+#include "AgnMilocusStream.h"
 #include "AgnMrnaRepVisitor.h"
+#include "AgnNucleotideCompareVisitor.h"
+#include "AgnParallelVisitorStream.h"
 #include "AgnPseudogeneFixVisitor.h"
 #include "AgnRemoveChildrenVisitor.h"
+#include "AgnSnapshotInStream.h"
 #include "AgnTranscriptClique.h"
 
 int main(int argc, char **argv)
@@ -33,12 +43,16 @@ int main(int argc, char **argv)
   GtQueue *tests = gt_queue_new();
   gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnAttributeFilterStream",
                                         agn_attribute_filter_stream_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnAttributePruneStream",
+                                        agn_attribute_prune_stream_unit_test));
   gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnPseudogeneFixVisitor",
                                         agn_pseudogene_fix_visitor_unit_test));
   gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnInferParentStream",
                                         agn_infer_parent_stream_unit_test));
   gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnMrnaRepVisitor",
                                         agn_mrna_rep_visitor_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnParallelVisitorStream",
+                                     agn_parallel_visitor_stream_unit_test));
   gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnRemoveChildrenVisitor",
                                         agn_remove_children_visitor_unit_test));
   gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnTranscriptClique",
@@ -53,16 +67,32 @@ int main(int argc, char **argv)
                                         agn_infer_cds_visitor_unit_test));
   gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnInferExonsVisitor",
                                         agn_infer_exons_visitor_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnInferStructureVisitor",
+                                     agn_infer_structure_visitor_unit_test));
   gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnGeneStream",
                                         agn_gene_stream_unit_test));
   gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnLocusStream",
                                         agn_locus_stream_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnLocusDeltaVisitor",
+                                        agn_locus_delta_visitor_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnLocusIndex",
+                                        agn_locus_index_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnLocusCompositionStream",
+                                   agn_locus_composition_stream_unit_test));
   gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnLocusRefineStream",
                                         agn_locus_refine_stream_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnMilocusStream",
+                                        agn_milocus_stream_unit_test));
   gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnGaevalVisitor",
                                         agn_gaeval_visitor_unit_test));
   gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnIdFilterStream",
                                         agn_id_filter_stream_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnNucleotideCompareVisitor",
+                                     agn_nucleotide_compare_visitor_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnLocusSampleStream",
+                                        agn_locus_sample_stream_unit_test));
+  gt_queue_add(tests, agn_unit_test_new("AEGeAn::AgnSnapshotInStream",
+                                        agn_snapshot_in_stream_unit_test));
 
   unsigned passes   = 0;
   unsigned failures = 0;